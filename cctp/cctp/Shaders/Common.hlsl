@@ -12,42 +12,152 @@ struct RayPayload
     float HitDistance;
 };
 
-// The max number of probes in the probe field
-#define MAX_PROBE_COUNT 350
+// Probe field constants. These must be kept in sync with the constants in Source/Renderer/GIConstants.h
+// The max number of probe volumes sharing the probe pool
+#define MAX_PROBE_VOLUME_COUNT 8
+// Probe states, matching ProbeState in ProbeVolume.h
+#define PROBE_STATE_ACTIVE 0
+#define PROBE_STATE_INACTIVE 1
 // The number of rays traced from a probe. McGuire uses up to 256 rays
 #define PROBE_RAY_COUNT 32
+// The number of rotations of the probe ray directions in the probe ray table. Rotation zero leaves the directions unrotated
+#define PROBE_RAY_ROTATION_COUNT 64
 // The amount of texels in a square side to use to store a probes irradiance data in
 #define IRRADIANCE_PROBE_SIDE_LENGTH 8 
 // The amount of texels in a square side to use to store a probes visibility data in
 #define VISIBILITY_PROBE_SIDE_LENGTH 16 
-// Border size in pixels around each probe's data pack. Should be at least 1 to protect data from blurring with next probe
+// The most spherical harmonic coefficients a probe stores, for bands zero to two. Probes of L1 volumes store the first four
+#define PROBE_SH_MAX_COEFFICIENT_COUNT 9
+// Channels of each spherical harmonic coefficient: irradiance (rgb), distance and square distance
+#define PROBE_SH_CHANNEL_COUNT 5
+// The uints holding a probe's coefficients in the spherical harmonic buffer, two halves to a uint, channels of a coefficient next to each other
+#define PROBE_SH_STRIDE 23
+// Probe encodings, matching ProbeEncoding in ProbeVolume.h
+#define PROBE_ENCODING_OCTAHEDRAL 0
+#define PROBE_ENCODING_SH_L1 1
+#define PROBE_ENCODING_SH_L2 2
+// Border size in texels on every side of each probe's data. Borders hold the texels across the edges of the octahedral square, so bilinear
+// samples near an edge blend in the directions beyond it instead of a neighbouring probe's
 #define PROBE_PADDING 1
 // The maximum distance a ray can travel
 #define MAX_DISTANCE 1.0
 
-// Irradiance texture dimension
-#define IRRADIANCE_TEXTURE_WIDTH 4300.0
-#define IRRADIANCE_TEXTURE_HEIGHT 16.0
+// Exponent of the cosine weighting a probe's rays are filtered into visibility texels with. Higher keeps each texel to the rays closest to its
+// direction, so distances stay sharp at the edges of occluders
+#define PROBE_VISIBILITY_SHARPNESS 50.0
+// Fraction of the probe spacing a shading point is pushed along its normal before probe visibility is tested from it
+#define PROBE_VISIBILITY_NORMAL_BIAS 0.2
+// Least variance of a probe's hit distances the visibility weight assumes, so texels whose rays all hit at one distance still fade smoothly
+#define PROBE_MIN_VISIBILITY_VARIANCE 0.0001
 
-// Visibility texture dimension
-#define VISIBILITY_TEXTURE_WIDTH 7000.0
-#define VISIBILITY_TEXTURE_HEIGHT 32.0
+#define SHADOW_BIAS 0.04
 
-// The number of blur iterations to perform on each output texture
-#define IRRADIANCE_BLUR_ITERATIONS 2
-#define VISIBILITY_BLUR_ITERATIONS 0
+// A probe volume's grid. Matches ProbeVolumeData in Source/Renderer/GIConstants.h
+struct ProbeVolumeData
+{
+    float4 GridOriginAndSpacing; // Stores the position of grid coordinate zero (xyz) and probe spacing (w)
+    int4 ProbeCounts; // Stores probe counts (xyz) and the pool index of the volume's first probe (w)
+    int4 ScrollOffset; // Stores the toroidal scroll offset (xyz) and the probe encoding of the volume's probes (w)
+};
 
-#define SHADOW_BIAS 0.04
+// Blend history of a probe. Matches ProbeStatistics in Source/Renderer/GIConstants.h
+struct ProbeStatistics
+{
+    float3 Position; // The position the probe's history was gathered at. A probe moved elsewhere starts a new history
+    float SampleCount; // The number of gathers blended into the history
+    float Change; // Mean relative change of the probe's rays against its history in the last gather
+    float LuminanceVariance; // Variance of the per ray luminance change in the last gather
+    float MeanLuminance; // Mean luminance of the probe's rays after the last blend
+    float Hysteresis; // The hysteresis the last gather was blended with
+};
+
+// A probe ray under one rotation. Matches ProbeRay in Source/Renderer/ProbeRayTable.h
+struct ProbeRay
+{
+    float3 Direction;
+};
+
+// The rotation of the probe ray table a probe's rays are traced with in an update. Seed zero traces the unrotated directions
+// Ported to the CPU in Source/Renderer/ProbeRayTable.cpp
+uint GetProbeRayRotationIndex(uint seed, uint probeIndex)
+{
+    if (seed == 0)
+        return 0;
+
+    // PCG hash of the seed and probe index
+    uint state = seed * 747796405u + probeIndex * 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return 1 + (((word >> 22u) ^ word) % (PROBE_RAY_ROTATION_COUNT - 1));
+}
+
+// The probe volume lookup below is ported to the CPU in Source/Renderer/CPU/ProbeLookup.cpp
+bool ProbeVolumeContains(ProbeVolumeData volume, float3 position)
+{
+    const float3 gridPosition = (position - volume.GridOriginAndSpacing.xyz) / volume.GridOriginAndSpacing.w;
+    return all(gridPosition >= 0.0) && all(gridPosition <= (float3) (volume.ProbeCounts.xyz - 1));
+}
+
+// Pool index of the probe at a grid coordinate counted from the volume's minimum corner, wrapped toroidally by the scroll offset
+int GetPoolProbeIndex(ProbeVolumeData volume, int3 gridCoordinate)
+{
+    const int3 counts = volume.ProbeCounts.xyz;
+    const int3 wrapped = (((gridCoordinate + volume.ScrollOffset.xyz) % counts) + counts) % counts;
+    return volume.ProbeCounts.w + wrapped.x + counts.x * (wrapped.y + counts.y * wrapped.z);
+}
+
+// Grid coordinate of the minimum corner probe of the cell containing the position, clamped to the grid, and the position's offset from
+// that probe in probe spacings
+void GetProbeCage(ProbeVolumeData volume, float3 position, out int3 baseCoordinate, out float3 alpha)
+{
+    const float3 gridPosition = (position - volume.GridOriginAndSpacing.xyz) / volume.GridOriginAndSpacing.w;
+    baseCoordinate = clamp((int3) floor(gridPosition), int3(0, 0, 0), max(volume.ProbeCounts.xyz - 2, int3(0, 0, 0)));
+    alpha = saturate(gridPosition - (float3) baseCoordinate);
+}
 
-float2 GetProbeTopLeftPosition(uint probeIndex, float singleProbeSideLength, uint padding)
+// Probe atlases are tiled by the layout in Source/Renderer/ProbeAtlasLayout.h. Probe p takes the tile in column p % probesPerRow and row
+// p / probesPerRow, each tile being the probe's square of texels with a border of padding texels on every side. Returns the top left of the square
+float2 GetProbeTopLeftPosition(uint probeIndex, uint probesPerRow, float singleProbeSideLength, uint padding)
 {
+    const float tileSideLength = singleProbeSideLength + (float) (2 * padding);
     return float2(
-                    (float) (padding * probeIndex) + ((float) probeIndex * singleProbeSideLength),
-                    0.0
-                 );
+                    (float) (probeIndex % probesPerRow) * tileSideLength,
+                    (float) (probeIndex / probesPerRow) * tileSideLength
+                 ) + (float) padding;
 }
 
-float2 GetProbeTexelCoordinate(float3 direction, uint probeIndex, float singleProbeSideLength, uint padding)
+// Texel dimensions of an atlas laid out with the probes per row and row count
+float2 GetProbeAtlasDimensions(uint probesPerRow, uint rowCount, float singleProbeSideLength, uint padding)
+{
+    return float2(probesPerRow, rowCount) * (singleProbeSideLength + (float) (2 * padding));
+}
+
+// The texel of a probe's octahedral square holding the same direction as a texel up to a side length outside it. Crossing an edge of the square
+// mirrors the texel along that edge, so a border texel takes the texel of the square it touches across the edge and a corner the opposite corner
+// Ported to the CPU in Source/Renderer/CPU/ProbeFilter.cpp
+int2 WrapOctahedralTexel(int2 texel, int sideLength)
+{
+    if (texel.x < 0)
+        texel = int2(-1 - texel.x, sideLength - 1 - texel.y);
+    else if (texel.x >= sideLength)
+        texel = int2(2 * sideLength - 1 - texel.x, sideLength - 1 - texel.y);
+
+    if (texel.y < 0)
+        texel = int2(sideLength - 1 - texel.x, -1 - texel.y);
+    else if (texel.y >= sideLength)
+        texel = int2(sideLength - 1 - texel.x, 2 * sideLength - 1 - texel.y);
+    return texel;
+}
+
+// Direction through the centre of a texel of a probe's octahedral square, counted from its top left. Texels outside the square take the direction of
+// the texel across the edge
+// Ported to the CPU in Source/Renderer/CPU/ProbeFilter.cpp
+float3 GetProbeTexelDirection(int2 texel, int sideLength)
+{
+    const float2 octCoord = (((float2) WrapOctahedralTexel(texel, sideLength) + 0.5) / (float) sideLength) * 2.0 - 1.0;
+    return OctDecode(octCoord);
+}
+
+float2 GetProbeTexelCoordinate(float3 direction, uint probeIndex, uint probesPerRow, float singleProbeSideLength, uint padding)
 {
     // Encode the direction to oct texture coordinate in [0, 1] range
     float2 normalizedOctCoordZeroOne = (OctEncode(direction) + 1.0) * 0.5;
@@ -56,11 +166,48 @@ float2 GetProbeTexelCoordinate(float3 direction, uint probeIndex, float singlePr
     float2 normalizedOctCoordTextureDimensions = (normalizedOctCoordZeroOne * singleProbeSideLength);
 
     // Calculate the top left texel of this probe's output in the texture
-    float2 probeTopLeftPosition = GetProbeTopLeftPosition(probeIndex, singleProbeSideLength, padding);
+    float2 probeTopLeftPosition = GetProbeTopLeftPosition(probeIndex, probesPerRow, singleProbeSideLength, padding);
 
     return probeTopLeftPosition + normalizedOctCoordTextureDimensions;
 }
 
+// The spherical harmonic coefficients a probe of the encoding stores, zero for octahedral probes
+uint GetProbeShCoefficientCount(int encoding)
+{
+    return encoding == PROBE_ENCODING_SH_L2 ? 9 : (encoding == PROBE_ENCODING_SH_L1 ? 4 : 0);
+}
+
+// Real spherical harmonic basis functions of a unit direction up to band two, as Sloan orders them. L1 probes use the first four
+// Ported to the CPU in Source/Math/SphericalHarmonics.cpp
+void EvaluateShBasis(float3 direction, out float basis[PROBE_SH_MAX_COEFFICIENT_COUNT])
+{
+    basis[0] = 0.282095;
+    basis[1] = 0.488603 * direction.y;
+    basis[2] = 0.488603 * direction.z;
+    basis[3] = 0.488603 * direction.x;
+    basis[4] = 1.092548 * direction.x * direction.y;
+    basis[5] = 1.092548 * direction.y * direction.z;
+    basis[6] = 0.315392 * (3.0 * direction.z * direction.z - 1.0);
+    basis[7] = 1.092548 * direction.x * direction.z;
+    basis[8] = 0.546274 * (direction.x * direction.x - direction.y * direction.y);
+}
+
+// Value of one channel of a probe's coefficients at the direction the basis functions were evaluated for
+float EvaluateShWithBasis(float coefficients[PROBE_SH_MAX_COEFFICIENT_COUNT * PROBE_SH_CHANNEL_COUNT], float basis[PROBE_SH_MAX_COEFFICIENT_COUNT],
+                          uint coefficientCount, uint channel)
+{
+    float value = 0.0;
+    for (uint c = 0; c < coefficientCount; ++c)
+        value += basis[c] * coefficients[c * PROBE_SH_CHANNEL_COUNT + channel];
+    return value;
+}
+
+// Half h of a probe's coefficients, coefficient h / PROBE_SH_CHANNEL_COUNT of channel h % PROBE_SH_CHANNEL_COUNT, from the uint holding it
+float UnpackProbeShHalf(uint packed, uint h)
+{
+    return f16tof32(packed >> ((h & 1) * 16));
+}
+
 float3 Lighting(float3 vertexNormalWS, float3 lightVectorWS, float3 cameraVectorWS, float shadow, float lightIntensity)
 {
     // Ambient
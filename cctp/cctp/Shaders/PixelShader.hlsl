@@ -4,9 +4,11 @@
 cbuffer PerFrameConstants : register(b0)
 {
     float4x4 LightMatrix;
-    float4 ProbePositionsWS[MAX_PROBE_COUNT];
     float4 LightDirectionWS;
-    float4 packedData; // Stores probe count (x), probe spacing (y), light intensity (z)
+    float4 packedData; // Stores probe count (x), probe spacing (y), light intensity (z), probe volume count (w)
+    int4 probeAtlasLayout; // Stores probes per atlas row (x), atlas row count (y), atlas probe capacity (z)
+    float4 probeBlendSettings; // Stores hysteresis (x), change threshold (y), probe ray rotation seed bits (z)
+    ProbeVolumeData ProbeVolumes[MAX_PROBE_VOLUME_COUNT];
 }
 
 struct VertexOut
@@ -27,43 +29,137 @@ SamplerState linearSampler : register(s0, space1);
 Texture2D<float> shadowMap : register(t0);
 Texture2D<float3> irradianceData : register(t1);
 Texture2D<float2> visibilityData : register(t2);
+StructuredBuffer<float4> ProbePositionsWS : register(t3);
+StructuredBuffer<uint> ProbeStates : register(t4);
+// Coefficients of the probes of spherical harmonic volumes, PROBE_SH_STRIDE uints per probe
+StructuredBuffer<uint> ProbeShCoefficients : register(t5);
 
 float Square(float x)
 {
     return x * x;
 }
 
+// Weight of a probe by the direction to it from the shading point. Probes behind the surface are faded out smoothly rather than cut off,
+// so the weight of a cage never drops to zero while the point is lit through it
+float ProbeNormalWeight(float3 direction, float3 shadingPointNormal)
+{
+    return Square((dot(direction, shadingPointNormal) + 1.0) * 0.5) + 0.2;
+}
+
+// Weight of a probe by whether geometry it traced lies between it and the shading point, from the mean (x) and mean square (y) of the
+// distances its rays hit towards the point. Chebyshev's inequality bounds the chance the probe sees as far as the point by the variance of
+// those distances, so a wall close to the probe occludes the point sharply while a surface at the point's own distance barely does. Rays
+// never see past the max distance, so farther points are tested at it, and probes not traced yet hold zero
+float ProbeVisibilityWeight(float2 moments, float distance)
+{
+    distance = min(distance, MAX_DISTANCE);
+    if (moments.x <= 0.0 || distance <= moments.x)
+        return 1.0;
+    const float variance = max(moments.y - Square(moments.x), PROBE_MIN_VISIBILITY_VARIANCE);
+    const float chebyshev = variance / (variance + Square(distance - moments.x));
+    // The bound is loose, so cubing it darkens the tail that would otherwise leak light through thin walls
+    return chebyshev * chebyshev * chebyshev;
+}
+
+// Loads the coefficients of a spherical harmonic probe
+void LoadProbeSh(int p, uint coefficientCount, out float coefficients[PROBE_SH_MAX_COEFFICIENT_COUNT * PROBE_SH_CHANNEL_COUNT])
+{
+    for (uint h = 0; h < PROBE_SH_MAX_COEFFICIENT_COUNT * PROBE_SH_CHANNEL_COUNT; ++h)
+        coefficients[h] = h < coefficientCount * PROBE_SH_CHANNEL_COUNT ? UnpackProbeShHalf(ProbeShCoefficients[p * PROBE_SH_STRIDE + h / 2], h) : 0.0;
+}
+
+// Ported to the CPU in Source/Renderer/CPU/ProbeShading.cpp
 float3 Irradiance(float3 shadingPoint, float3 shadingPointNormal)
 {
     shadingPointNormal = normalize(shadingPointNormal);
     float3 sumIrradiance = float3(0.0, 0.0, 0.0);
-    for (int i = 0; i < (int) packedData.x; ++i)
+    float sumWeight = 0.0;
+
+    // Light the point from the first volume containing it, or the coarsest volume when none do
+    const int volumeCount = (int) packedData.w;
+    if (volumeCount == 0)
+        return sumIrradiance;
+    int volumeIndex = volumeCount - 1;
+    for (int v = 0; v < volumeCount; ++v)
     {
-        float3 probePosition = ProbePositionsWS[i].rgb;
-
-        float3 pointToProbe = probePosition - shadingPoint;
-        float distance = length(pointToProbe);
-        float3 direction = normalize(pointToProbe);
-
-        // Sample irradiance and visibility from this probe
-        float2 irradianceTexelIndex = GetProbeTexelCoordinate(direction, i, IRRADIANCE_PROBE_SIDE_LENGTH, PROBE_PADDING);
-        //float2 visibilityTexelIndex = GetProbeTexelCoordinate(direction, i, VISIBILITY_PROBE_SIDE_LENGTH, PROBE_PADDING);
-
-        float3 probeIrradiance = irradianceData.SampleLevel(linearSampler, irradianceTexelIndex / float2(IRRADIANCE_TEXTURE_WIDTH, IRRADIANCE_TEXTURE_HEIGHT), 0).rgb;
-        //float2 probeVisibility = irradianceData.SampleLevel(linearSampler, visibilityTexelIndex / float2(VISIBILITY_TEXTURE_WIDTH, VISIBILITY_TEXTURE_HEIGHT), 0).rg;
-
-        // Weight irradiance by distance and orientation to the probe
-        float weight = 1.0 / max(distance, 0.001);
-
-        float orientation = dot(shadingPointNormal, direction);
-        weight *= max(0.0, orientation);
-
-        weight *= min(distance, 1.0);
+        if (ProbeVolumeContains(ProbeVolumes[v], shadingPoint))
+        {
+            volumeIndex = v;
+            break;
+        }
+    }
+    const ProbeVolumeData volume = ProbeVolumes[volumeIndex];
+    const float2 irradianceAtlasDimensions = GetProbeAtlasDimensions(probeAtlasLayout.x, probeAtlasLayout.y, IRRADIANCE_PROBE_SIDE_LENGTH, PROBE_PADDING);
+    const float2 visibilityAtlasDimensions = GetProbeAtlasDimensions(probeAtlasLayout.x, probeAtlasLayout.y, VISIBILITY_PROBE_SIDE_LENGTH, PROBE_PADDING);
+
+    // Visibility is tested from a point pushed off the surface, so the surface the probes' rays hit around the point does not occlude it
+    const float3 visibilityPoint = shadingPoint + shadingPointNormal * (volume.GridOriginAndSpacing.w * PROBE_VISIBILITY_NORMAL_BIAS);
+
+    // Spherical harmonic probes are all evaluated in the direction of the normal, so its basis functions are shared by the cage
+    const uint shCoefficientCount = GetProbeShCoefficientCount(volume.ScrollOffset.w);
+    float normalBasis[PROBE_SH_MAX_COEFFICIENT_COUNT];
+    EvaluateShBasis(shadingPointNormal, normalBasis);
+
+    // Blend the eight probes at the corners of the grid cell around the point
+    int3 baseCoordinate;
+    float3 alpha;
+    GetProbeCage(volume, shadingPoint, baseCoordinate, alpha);
+    for (int c = 0; c < 8; ++c)
+    {
+        const int3 offset = int3(c & 1, (c >> 1) & 1, c >> 2);
+        const int3 corner = min(baseCoordinate + offset, volume.ProbeCounts.xyz - 1);
+        const int i = GetPoolProbeIndex(volume, corner);
+
+        // Inactive probes and probes past the atlas capacity hold no traced data
+        if (i >= probeAtlasLayout.z || ProbeStates[i] != PROBE_STATE_ACTIVE)
+            continue;
+
+        float3 pointToProbe = ProbePositionsWS[i].xyz - shadingPoint;
+        float3 direction = pointToProbe / max(length(pointToProbe), 0.0001);
+        float3 visibilityPointToProbe = ProbePositionsWS[i].xyz - visibilityPoint;
+        float visibilityDistance = length(visibilityPointToProbe);
+        float3 visibilityDirection = visibilityPointToProbe / max(visibilityDistance, 0.0001);
+
+        // Trilinear weight of the corner from the point's position in the cell
+        const float3 trilinear = lerp(1.0 - alpha, alpha, (float3) offset);
+        float weight = trilinear.x * trilinear.y * trilinear.z;
+        weight *= ProbeNormalWeight(direction, shadingPointNormal);
+
+        [branch]
+        if (shCoefficientCount > 0)
+        {
+            float coefficients[PROBE_SH_MAX_COEFFICIENT_COUNT * PROBE_SH_CHANNEL_COUNT];
+            LoadProbeSh(i, shCoefficientCount, coefficients);
+
+            // Ringing can take either function below zero
+            float directionBasis[PROBE_SH_MAX_COEFFICIENT_COUNT];
+            EvaluateShBasis(-visibilityDirection, directionBasis);
+            const float2 moments = float2(EvaluateShWithBasis(coefficients, directionBasis, shCoefficientCount, 3),
+                                          EvaluateShWithBasis(coefficients, directionBasis, shCoefficientCount, 4));
+            weight *= ProbeVisibilityWeight(max(moments, 0.0), visibilityDistance);
+
+            const float3 shIrradiance = float3(EvaluateShWithBasis(coefficients, normalBasis, shCoefficientCount, 0),
+                                               EvaluateShWithBasis(coefficients, normalBasis, shCoefficientCount, 1),
+                                               EvaluateShWithBasis(coefficients, normalBasis, shCoefficientCount, 2));
+            sumIrradiance += weight * max(shIrradiance, 0.0);
+            sumWeight += weight;
+            continue;
+        }
+
+        // Visibility is read in the direction from the probe to the point. Moments are linear, so they are filtered like irradiance
+        float2 visibilityTexelIndex = GetProbeTexelCoordinate(-visibilityDirection, i, probeAtlasLayout.x, VISIBILITY_PROBE_SIDE_LENGTH, PROBE_PADDING);
+        weight *= ProbeVisibilityWeight(visibilityData.SampleLevel(linearSampler, visibilityTexelIndex / visibilityAtlasDimensions, 0).rg, visibilityDistance);
+
+        // Every probe is sampled in the direction of the surface normal, so the blend is over the same direction of each probe
+        float2 irradianceTexelIndex = GetProbeTexelCoordinate(shadingPointNormal, i, probeAtlasLayout.x, IRRADIANCE_PROBE_SIDE_LENGTH, PROBE_PADDING);
+        float3 probeIrradiance = irradianceData.SampleLevel(linearSampler, irradianceTexelIndex / irradianceAtlasDimensions, 0).rgb;
 
-        // Sum irradiance
         sumIrradiance += weight * probeIrradiance;
+        sumWeight += weight;
     }
-    return sumIrradiance;
+
+    // Normalize so probes skipped as inactive or occluded do not darken the point
+    return sumWeight > 0.0 ? sumIrradiance / sumWeight : sumIrradiance;
 }
 
 float4 main(VertexOut input) : SV_TARGET
@@ -1,128 +1,355 @@
 #include "Common.hlsl"
 
 RaytracingAccelerationStructure SceneBVH : register(t0);
-RWTexture2D<float3> irradianceOutput : register(u0);
-RWTexture2D<float2> visibilityOutput : register(u1);
+// This gather's rays, radiance (rgb) and hit distance (a) of ray r of probe p at p * PROBE_RAY_COUNT + r. Filtered into the filtered textures by
+// ProbeFilter then blended into the atlases the pixel shader reads by ProbeBlend
+RWStructuredBuffer<float4> probeRayData : register(u0);
+RWStructuredBuffer<ProbeStatistics> probeStatistics : register(u2);
+RWTexture2D<float3> irradianceAtlas : register(u3);
+RWTexture2D<float2> visibilityAtlas : register(u4);
+// Coefficients of the probes of spherical harmonic volumes, PROBE_SH_STRIDE uints per probe. Blended into in place of the atlases
+RWStructuredBuffer<uint> probeShCoefficients : register(u5);
+// This gather's rays filtered, borders included
+RWTexture2D<float3> irradianceFiltered : register(u6);
+RWTexture2D<float2> visibilityFiltered : register(u7);
+StructuredBuffer<float4> ProbePositionsWS : register(t1);
+StructuredBuffer<uint> ProbeStates : register(t2);
+// Pool indices of the probes scheduled this frame by Source/Renderer/ProbeUpdateScheduler.h, one per dispatch index
+StructuredBuffer<uint> ProbeUpdateIndices : register(t3);
+// Ray directions under every rotation, generated once by Source/Renderer/ProbeRayTable.h
+StructuredBuffer<ProbeRay> ProbeRays : register(t4);
 
 cbuffer PerFrameConstants : register(b0)
 {
     float4x4 LightMatrix;
-    float4 ProbePositionsWS[MAX_PROBE_COUNT];
     float4 LightDirectionWS;
-    float4 packedData; // Stores probe count (x), probe spacing (y), light intensity (z)
+    float4 packedData; // Stores probe count (x), probe spacing (y), light intensity (z), probe volume count (w)
+    int4 probeAtlasLayout; // Stores probes per atlas row (x), atlas row count (y), atlas probe capacity (z)
+    float4 probeBlendSettings; // Stores hysteresis (x), change threshold (y), probe ray rotation seed bits (z)
+    ProbeVolumeData ProbeVolumes[MAX_PROBE_VOLUME_COUNT];
 };
 
-// Majercik et al. https://jcgt.org/published/0008/02/01/
-float3 SphericalFibonacci(float i, float n)
+// Below this mean luminance changes are measured against this instead, so near black probes do not count as changing a lot
+#define PROBE_CHANGE_LUMINANCE_FLOOR 0.01
+// Sample counts stop growing past this, long after the hysteresis has taken over from equal weighting
+#define PROBE_MAX_SAMPLE_COUNT 1024.0
+
+float Luminance(float3 color)
 {
-    const float PHI = sqrt(5) * 0.5 + 0.5;
-#define madfrac(A, B) ((A)*(B)-floor((A)*(B)))
-    float phi = 2.0 * PI * madfrac(i, PHI - 1);
-    float cosTheta = 1.0 - (2.0 * i + 1.0) * (1.0 / n);
-    float sinTheta = sqrt(saturate(1.0 - cosTheta * cosTheta));
-    return float3(
-        cos(phi) * sinTheta,
-        sin(phi) * sinTheta,
-        cosTheta);
-#undef madfrac
+    return dot(color, float3(0.2126, 0.7152, 0.0722));
 }
 
-void BlurIrradianceOutput(const float2 probeTopLeft)
+// Blends this gather's filtered output for a probe's tile, borders included, into its history in the atlases. Gathers are weighted equally until the
+// history is long enough for the hysteresis. A probe changing by more than half the change threshold, such as after a light or object moved, blends
+// with less hysteresis the more it changed, and past the threshold discards its history and takes the output outright, so it adapts in a few gathers
+// instead of fading over many.
+// A probe moved since its last gather has no history at its new position. The blend is linear and the same for every texel of the tile, so
+// borders filtered from the texels across the edges stay equal to those texels in the atlases
+// Ported to the CPU in Source/Renderer/CPU/ProbeTracer.cpp
+void BlendProbeOutput(const int p, const float3 origin)
 {
-    for (int y = probeTopLeft.y; y < probeTopLeft.y + IRRADIANCE_PROBE_SIDE_LENGTH; ++y)
+    const float2 irradianceTopLeft = GetProbeTopLeftPosition(p, probeAtlasLayout.x, IRRADIANCE_PROBE_SIDE_LENGTH, PROBE_PADDING) - PROBE_PADDING;
+    const float2 visibilityTopLeft = GetProbeTopLeftPosition(p, probeAtlasLayout.x, VISIBILITY_PROBE_SIDE_LENGTH, PROBE_PADDING) - PROBE_PADDING;
+    const int irradianceTileSideLength = IRRADIANCE_PROBE_SIDE_LENGTH + 2 * PROBE_PADDING;
+    const int visibilityTileSideLength = VISIBILITY_PROBE_SIDE_LENGTH + 2 * PROBE_PADDING;
+
+    ProbeStatistics statistics = probeStatistics[p];
+    float sampleCount = all(statistics.Position == origin) ? statistics.SampleCount : 0.0;
+
+    // Measure the output against the history, as the relative change in irradiance luminance and in visibility distance
+    float sumLuminance = 0.0;
+    float sumLuminanceChange = 0.0;
+    float sumAbsoluteLuminanceChange = 0.0;
+    float sumSquareLuminanceChange = 0.0;
+    for (int iy = 0; iy < irradianceTileSideLength; ++iy)
+    {
+        for (int ix = 0; ix < irradianceTileSideLength; ++ix)
+        {
+            const float2 texel = irradianceTopLeft + float2(ix, iy);
+            const float luminance = Luminance(irradianceFiltered[texel]);
+            const float previousLuminance = Luminance(irradianceAtlas[texel]);
+            sumLuminance += max(luminance, previousLuminance);
+            sumLuminanceChange += luminance - previousLuminance;
+            sumAbsoluteLuminanceChange += abs(luminance - previousLuminance);
+            sumSquareLuminanceChange += (luminance - previousLuminance) * (luminance - previousLuminance);
+        }
+    }
+
+    float sumDistanceChange = 0.0;
+    for (int vy = 0; vy < visibilityTileSideLength; ++vy)
+    {
+        for (int vx = 0; vx < visibilityTileSideLength; ++vx)
+        {
+            const float2 texel = visibilityTopLeft + float2(vx, vy);
+            sumDistanceChange += abs(visibilityFiltered[texel].r - visibilityAtlas[texel].r) / MAX_DISTANCE;
+        }
+    }
+
+    const float irradianceTexelCount = irradianceTileSideLength * irradianceTileSideLength;
+    const float irradianceChange = sumAbsoluteLuminanceChange / max(sumLuminance, PROBE_CHANGE_LUMINANCE_FLOOR * irradianceTexelCount);
+    const float change = max(irradianceChange, sumDistanceChange / (visibilityTileSideLength * visibilityTileSideLength));
+    if (change > probeBlendSettings.y)
+        sampleCount = 0.0;
+    const float hysteresis = min(probeBlendSettings.x, sampleCount / (sampleCount + 1.0)) * saturate(2.0 - (2.0 * change / probeBlendSettings.y));
+
+    sumLuminance = 0.0;
+    for (int by = 0; by < irradianceTileSideLength; ++by)
+    {
+        for (int bx = 0; bx < irradianceTileSideLength; ++bx)
+        {
+            const float2 texel = irradianceTopLeft + float2(bx, by);
+            const float3 irradiance = lerp(irradianceFiltered[texel], irradianceAtlas[texel], hysteresis);
+            irradianceAtlas[texel] = irradiance;
+            sumLuminance += Luminance(irradiance);
+        }
+    }
+
+    for (int cy = 0; cy < visibilityTileSideLength; ++cy)
     {
-        for (int x = probeTopLeft.x; x < probeTopLeft.x + IRRADIANCE_PROBE_SIDE_LENGTH; ++x)
+        for (int cx = 0; cx < visibilityTileSideLength; ++cx)
         {
-            [branch]
-            if (x < probeTopLeft.x || x > probeTopLeft.x + IRRADIANCE_PROBE_SIDE_LENGTH ||
-                        y < probeTopLeft.y || y > probeTopLeft.y + IRRADIANCE_PROBE_SIDE_LENGTH)
-            {
-                continue;
-            }
-            else
-            {
-                float2 top = float2(x, y) + float2(0, 1);
-                float2 right = float2(x, y) + float2(1, 0);
-                float2 left = float2(x, y) + float2(-1, 0);
-                float2 bottom = float2(x, y) + float2(0, -1);
-                float3 newValue = irradianceOutput[float2(x, y)];
-                newValue = lerp(newValue, irradianceOutput[top], 0.5f);
-                newValue = lerp(newValue, irradianceOutput[left], 0.5f);
-                newValue = lerp(newValue, irradianceOutput[bottom], 0.5f);
-                newValue = lerp(newValue, irradianceOutput[right], 0.5f);
-                irradianceOutput[float2(x, y)] = newValue;
-            }
+            const float2 texel = visibilityTopLeft + float2(cx, cy);
+            visibilityAtlas[texel] = lerp(visibilityFiltered[texel], visibilityAtlas[texel], hysteresis);
         }
     }
+
+    const float meanLuminanceChange = sumLuminanceChange / irradianceTexelCount;
+    statistics.Position = origin;
+    statistics.SampleCount = min(sampleCount + 1.0, PROBE_MAX_SAMPLE_COUNT);
+    statistics.Change = change;
+    statistics.LuminanceVariance = max((sumSquareLuminanceChange / irradianceTexelCount) - (meanLuminanceChange * meanLuminanceChange), 0.0);
+    statistics.MeanLuminance = sumLuminance / irradianceTexelCount;
+    statistics.Hysteresis = hysteresis;
+    probeStatistics[p] = statistics;
+}
+
+// Encoding of the volume whose range of pool indices holds the probe
+int GetProbeEncoding(const int p)
+{
+    for (int v = 0; v < (int) packedData.w; ++v)
+    {
+        const int4 counts = ProbeVolumes[v].ProbeCounts;
+        if (p >= counts.w && p < counts.w + counts.x * counts.y * counts.z)
+            return ProbeVolumes[v].ScrollOffset.w;
+    }
+    return PROBE_ENCODING_OCTAHEDRAL;
+}
+
+// Blends this gather's spherical harmonic projection into a probe's history as BlendProbeOutput blends atlas texels. The change is measured with the
+// gather and history evaluated in the directions of the probe's rays in place of texels
+// Ported to the CPU in Source/Renderer/CPU/ProbeTracer.cpp
+void BlendProbeSh(const int p, const float3 origin, const uint rotationIndex, const uint coefficientCount,
+                  float gather[PROBE_SH_MAX_COEFFICIENT_COUNT * PROBE_SH_CHANNEL_COUNT])
+{
+    const uint halfCount = coefficientCount * PROBE_SH_CHANNEL_COUNT;
+    float history[PROBE_SH_MAX_COEFFICIENT_COUNT * PROBE_SH_CHANNEL_COUNT];
+    for (uint h = 0; h < PROBE_SH_MAX_COEFFICIENT_COUNT * PROBE_SH_CHANNEL_COUNT; ++h)
+        history[h] = h < halfCount ? UnpackProbeShHalf(probeShCoefficients[p * PROBE_SH_STRIDE + h / 2], h) : 0.0;
+
+    ProbeStatistics statistics = probeStatistics[p];
+    float sampleCount = all(statistics.Position == origin) ? statistics.SampleCount : 0.0;
+
+    float luminances[PROBE_RAY_COUNT];
+    float previousLuminances[PROBE_RAY_COUNT];
+    float sumLuminance = 0.0;
+    float sumLuminanceChange = 0.0;
+    float sumAbsoluteLuminanceChange = 0.0;
+    float sumSquareLuminanceChange = 0.0;
+    float sumDistanceChange = 0.0;
+    for (int r = 0; r < PROBE_RAY_COUNT; ++r)
+    {
+        float basis[PROBE_SH_MAX_COEFFICIENT_COUNT];
+        EvaluateShBasis(ProbeRays[rotationIndex * PROBE_RAY_COUNT + r].Direction, basis);
+        luminances[r] = Luminance(float3(EvaluateShWithBasis(gather, basis, coefficientCount, 0), EvaluateShWithBasis(gather, basis, coefficientCount, 1),
+                                         EvaluateShWithBasis(gather, basis, coefficientCount, 2)));
+        previousLuminances[r] = Luminance(float3(EvaluateShWithBasis(history, basis, coefficientCount, 0), EvaluateShWithBasis(history, basis, coefficientCount, 1),
+                                                 EvaluateShWithBasis(history, basis, coefficientCount, 2)));
+        const float luminanceChange = luminances[r] - previousLuminances[r];
+        sumLuminance += max(luminances[r], previousLuminances[r]);
+        sumLuminanceChange += luminanceChange;
+        sumAbsoluteLuminanceChange += abs(luminanceChange);
+        sumSquareLuminanceChange += luminanceChange * luminanceChange;
+        sumDistanceChange += abs(EvaluateShWithBasis(gather, basis, coefficientCount, 3) - EvaluateShWithBasis(history, basis, coefficientCount, 3)) / MAX_DISTANCE;
+    }
+
+    const float irradianceChange = sumAbsoluteLuminanceChange / max(sumLuminance, PROBE_CHANGE_LUMINANCE_FLOOR * PROBE_RAY_COUNT);
+    const float change = max(irradianceChange, sumDistanceChange / PROBE_RAY_COUNT);
+    if (change > probeBlendSettings.y)
+        sampleCount = 0.0;
+    const float hysteresis = min(probeBlendSettings.x, sampleCount / (sampleCount + 1.0)) * saturate(2.0 - (2.0 * change / probeBlendSettings.y));
+
+    // Two halves to a uint. The high half of the last uint of an L2 probe is unused
+    for (uint u = 0; u < (halfCount + 1) / 2; ++u)
+    {
+        const float low = lerp(gather[2 * u], history[2 * u], hysteresis);
+        const float high = (2 * u + 1) < halfCount ? lerp(gather[2 * u + 1], history[2 * u + 1], hysteresis) : 0.0;
+        probeShCoefficients[p * PROBE_SH_STRIDE + u] = f32tof16(low) | (f32tof16(high) << 16);
+    }
+
+    // Evaluation is linear in the coefficients, so the blended luminance is the blend of the luminances
+    sumLuminance = 0.0;
+    for (int b = 0; b < PROBE_RAY_COUNT; ++b)
+        sumLuminance += lerp(luminances[b], previousLuminances[b], hysteresis);
+
+    const float meanLuminanceChange = sumLuminanceChange / PROBE_RAY_COUNT;
+    statistics.Position = origin;
+    statistics.SampleCount = min(sampleCount + 1.0, PROBE_MAX_SAMPLE_COUNT);
+    statistics.Change = change;
+    statistics.LuminanceVariance = max((sumSquareLuminanceChange / PROBE_RAY_COUNT) - (meanLuminanceChange * meanLuminanceChange), 0.0);
+    statistics.MeanLuminance = sumLuminance / PROBE_RAY_COUNT;
+    statistics.Hysteresis = hysteresis;
+    probeStatistics[p] = statistics;
+}
+
+// Filtered gather of a texel of a probe's tile, counted from the top left of its square: the radiance of every ray of the gather weighted by the
+// cosine between the ray and the texel's direction, which is the irradiance / pi the texel's direction receives. Texels outside the square, in its
+// borders, take the direction of the texel across the edge. Every ray reaches every texel, so the ray count is independent of the side length
+// Ported to the CPU in Source/Renderer/CPU/ProbeFilter.cpp
+float3 FilterIrradianceTexel(const int p, const uint rotationIndex, const int2 texel)
+{
+    const float3 texelDirection = GetProbeTexelDirection(texel, IRRADIANCE_PROBE_SIDE_LENGTH);
+    float3 sumRadiance = float3(0.0, 0.0, 0.0);
+    float sumWeight = 0.0;
+    for (int r = 0; r < PROBE_RAY_COUNT; ++r)
+    {
+        const float weight = max(dot(texelDirection, ProbeRays[rotationIndex * PROBE_RAY_COUNT + r].Direction), 0.0);
+        sumRadiance += weight * probeRayData[p * PROBE_RAY_COUNT + r].rgb;
+        sumWeight += weight;
+    }
+    return sumWeight > 0.0 ? sumRadiance / sumWeight : float3(0.0, 0.0, 0.0);
+}
+
+// As FilterIrradianceTexel for the distance and square distance of a visibility texel, with the cosine raised to PROBE_VISIBILITY_SHARPNESS
+float2 FilterVisibilityTexel(const int p, const uint rotationIndex, const int2 texel)
+{
+    const float3 texelDirection = GetProbeTexelDirection(texel, VISIBILITY_PROBE_SIDE_LENGTH);
+    float2 sumDistance = float2(0.0, 0.0);
+    float sumWeight = 0.0;
+    for (int r = 0; r < PROBE_RAY_COUNT; ++r)
+    {
+        const float weight = pow(max(dot(texelDirection, ProbeRays[rotationIndex * PROBE_RAY_COUNT + r].Direction), 0.0), PROBE_VISIBILITY_SHARPNESS);
+        const float hitDistance = probeRayData[p * PROBE_RAY_COUNT + r].a;
+        sumDistance += weight * float2(hitDistance, hitDistance * hitDistance);
+        sumWeight += weight;
+    }
+    return sumWeight > 0.0 ? sumDistance / sumWeight : float2(MAX_DISTANCE, MAX_DISTANCE * MAX_DISTANCE);
 }
 
-void BlurVisibilityOutput(const float2 probeTopLeft)
+// Projects the gather's rays of a spherical harmonic probe, spread evenly over the sphere, onto its coefficients and turns the projected radiance into
+// irradiance / pi with the cosine lobe's band factors
+// Ported to the CPU in Source/Renderer/CPU/ProbeTracer.cpp
+void ProjectProbeSh(const int p, const uint rotationIndex, const uint coefficientCount, out float gather[PROBE_SH_MAX_COEFFICIENT_COUNT * PROBE_SH_CHANNEL_COUNT])
 {
-    for (int y = probeTopLeft.y; y < probeTopLeft.y + VISIBILITY_PROBE_SIDE_LENGTH; ++y)
+    for (int h = 0; h < PROBE_SH_MAX_COEFFICIENT_COUNT * PROBE_SH_CHANNEL_COUNT; ++h)
+        gather[h] = 0.0;
+
+    for (int r = 0; r < PROBE_RAY_COUNT; ++r)
     {
-        for (int x = probeTopLeft.x; x < probeTopLeft.x + VISIBILITY_PROBE_SIDE_LENGTH; ++x)
+        const float4 rayData = probeRayData[p * PROBE_RAY_COUNT + r];
+        const float values[PROBE_SH_CHANNEL_COUNT] = { rayData.r, rayData.g, rayData.b, rayData.a, rayData.a * rayData.a };
+        float basis[PROBE_SH_MAX_COEFFICIENT_COUNT];
+        EvaluateShBasis(ProbeRays[rotationIndex * PROBE_RAY_COUNT + r].Direction, basis);
+        for (uint c = 0; c < coefficientCount; ++c)
         {
-            [branch]
-            if (x < probeTopLeft.x || x > probeTopLeft.x + VISIBILITY_PROBE_SIDE_LENGTH ||
-                        y < probeTopLeft.y || y > probeTopLeft.y + VISIBILITY_PROBE_SIDE_LENGTH)
-            {
-                continue;
-            }
-            else
-            {
-                float2 top = float2(x, y) + float2(0, 1);
-                float2 right = float2(x, y) + float2(1, 0);
-                float2 left = float2(x, y) + float2(-1, 0);
-                float2 bottom = float2(x, y) + float2(0, -1);
-                float2 newValue = visibilityOutput[float2(x, y)].rg;
-                newValue = lerp(newValue, visibilityOutput[top], 0.5f);
-                newValue = lerp(newValue, visibilityOutput[left], 0.5f);
-                newValue = lerp(newValue, visibilityOutput[bottom], 0.5f);
-                newValue = lerp(newValue, visibilityOutput[right], 0.5f);
-                visibilityOutput[float2(x, y)] = newValue;
-            }
+            const float weightedBasis = basis[c] * (4.0 * PI / PROBE_RAY_COUNT);
+            for (uint k = 0; k < PROBE_SH_CHANNEL_COUNT; ++k)
+                gather[c * PROBE_SH_CHANNEL_COUNT + k] += weightedBasis * values[k];
         }
     }
+
+    for (uint c = 1; c < coefficientCount; ++c)
+    {
+        const float bandFactor = c < 4 ? 2.0 / 3.0 : 0.25;
+        for (uint k = 0; k < 3; ++k)
+            gather[c * PROBE_SH_CHANNEL_COUNT + k] *= bandFactor;
+    }
+}
+
+// Whether the probe at the pool index is traced, skipping indices past the probes or the atlases and probes classified as inside geometry or away
+// from every surface
+bool IsProbeTraced(const int p)
+{
+    return p < (int) packedData.x && p < probeAtlasLayout.z && ProbeStates[p] == PROBE_STATE_ACTIVE;
 }
 
 [shader("raygeneration")]
 void RayGen()
 {    
-    // Shoot rays from each probe
-    for (int p = 0; p < (int) packedData.x; ++p)
+    // Shoot rays from the probe scheduled at this thread's dispatch index
+    const int p = (int) ProbeUpdateIndices[DispatchRaysIndex().x];
+    if (!IsProbeTraced(p))
+        return;
+
+    // Each update traces the probe's rays under a new rotation of the table. Rays are stored whatever the probe's encoding, which only the filter and
+    // blend stages depend on
+    const uint rotationIndex = GetProbeRayRotationIndex(asuint(probeBlendSettings.z), (uint) p);
+    for (int r = 0; r < PROBE_RAY_COUNT; ++r)
     {
-        for (int r = 0; r < PROBE_RAY_COUNT; ++r)
+        RayDesc ray;
+        ray.Origin = ProbePositionsWS[p].xyz;
+        ray.Direction = ProbeRays[rotationIndex * PROBE_RAY_COUNT + r].Direction;
+        ray.TMin = 0.0;
+        ray.TMax = MAX_DISTANCE;
+
+        RayPayload payload =
         {
-            float3 dir = normalize(SphericalFibonacci((float) r, (float) PROBE_RAY_COUNT));
-
-            RayDesc ray;
-            ray.Origin = ProbePositionsWS[p].xyz;
-            ray.Direction = dir;
-            ray.TMin = 0.0;
-            ray.TMax = MAX_DISTANCE;
-
-            RayPayload payload =
-            {
-                float3(0.0, 0.0, 0.0),
-                0.0
-            };
-            TraceRay(SceneBVH, RAY_FLAG_CULL_BACK_FACING_TRIANGLES, 0xff, 0, 0, 0, ray, payload);
-            
-            // Store irradiance for probe
-            irradianceOutput[GetProbeTexelCoordinate(dir, p, IRRADIANCE_PROBE_SIDE_LENGTH, PROBE_PADDING)].rgb = payload.HitIrradiance;
-
-            // Store visibility for probe as distance and square distance
-            float2 visibilityTexel = GetProbeTexelCoordinate(dir, p, VISIBILITY_PROBE_SIDE_LENGTH, PROBE_PADDING);
-            visibilityOutput[visibilityTexel].r = payload.HitDistance;
-            visibilityOutput[visibilityTexel].g = payload.HitDistance * payload.HitDistance;
-        }
-        
-        // Blur irradiance output
-        for (int i = 0; i < IRRADIANCE_BLUR_ITERATIONS; ++i)
-            BlurIrradianceOutput(GetProbeTopLeftPosition(p, IRRADIANCE_PROBE_SIDE_LENGTH, PROBE_PADDING));
-        
-        // Blur visibility output
-        for (int v = 0; v < VISIBILITY_BLUR_ITERATIONS; ++v)
-            BlurVisibilityOutput(GetProbeTopLeftPosition(p, VISIBILITY_PROBE_SIDE_LENGTH, PROBE_PADDING));
+            float3(0.0, 0.0, 0.0),
+            0.0
+        };
+        TraceRay(SceneBVH, RAY_FLAG_CULL_BACK_FACING_TRIANGLES, 0xff, 0, 0, 0, ray, payload);
+
+        // Store the ray's radiance and hit distance for the probe
+        probeRayData[p * PROBE_RAY_COUNT + r] = float4(payload.HitIrradiance, payload.HitDistance);
     }
-}
\ No newline at end of file
+}
+
+// Filters the rays of the probes traced by the last RayGen dispatch into the filtered textures, one thread per texel of a visibility tile, borders
+// included, for each probe along y. Threads within the size of an irradiance tile filter its texel too. Spherical harmonic probes have no texels to filter
+[shader("raygeneration")]
+void ProbeFilter()
+{
+    const int p = (int) ProbeUpdateIndices[DispatchRaysIndex().y];
+    if (!IsProbeTraced(p) || GetProbeEncoding(p) != PROBE_ENCODING_OCTAHEDRAL)
+        return;
+
+    const uint rotationIndex = GetProbeRayRotationIndex(asuint(probeBlendSettings.z), (uint) p);
+    const int t = (int) DispatchRaysIndex().x;
+    const int irradianceTileSideLength = IRRADIANCE_PROBE_SIDE_LENGTH + 2 * PROBE_PADDING;
+    if (t < irradianceTileSideLength * irradianceTileSideLength)
+    {
+        const int2 irradianceTopLeft = (int2) GetProbeTopLeftPosition(p, probeAtlasLayout.x, IRRADIANCE_PROBE_SIDE_LENGTH, PROBE_PADDING);
+        const int2 texel = int2(t % irradianceTileSideLength, t / irradianceTileSideLength) - PROBE_PADDING;
+        irradianceFiltered[irradianceTopLeft + texel] = FilterIrradianceTexel(p, rotationIndex, texel);
+    }
+
+    const int visibilityTileSideLength = VISIBILITY_PROBE_SIDE_LENGTH + 2 * PROBE_PADDING;
+    if (t < visibilityTileSideLength * visibilityTileSideLength)
+    {
+        const int2 visibilityTopLeft = (int2) GetProbeTopLeftPosition(p, probeAtlasLayout.x, VISIBILITY_PROBE_SIDE_LENGTH, PROBE_PADDING);
+        const int2 texel = int2(t % visibilityTileSideLength, t / visibilityTileSideLength) - PROBE_PADDING;
+        visibilityFiltered[visibilityTopLeft + texel] = FilterVisibilityTexel(p, rotationIndex, texel);
+    }
+}
+
+// Blends the gathers of the probes traced by the last RayGen dispatch into their history, one thread per probe. Octahedral probes blend their filtered
+// gathers into the atlases, spherical harmonic probes project their rays and blend the coefficients
+[shader("raygeneration")]
+void ProbeBlend()
+{
+    const int p = (int) ProbeUpdateIndices[DispatchRaysIndex().x];
+    if (!IsProbeTraced(p))
+        return;
+
+    const uint shCoefficientCount = GetProbeShCoefficientCount(GetProbeEncoding(p));
+    [branch]
+    if (shCoefficientCount > 0)
+    {
+        const uint rotationIndex = GetProbeRayRotationIndex(asuint(probeBlendSettings.z), (uint) p);
+        float shGather[PROBE_SH_MAX_COEFFICIENT_COUNT * PROBE_SH_CHANNEL_COUNT];
+        ProjectProbeSh(p, rotationIndex, shCoefficientCount, shGather);
+        BlendProbeSh(p, ProbePositionsWS[p].xyz, rotationIndex, shCoefficientCount, shGather);
+        return;
+    }
+
+    BlendProbeOutput(p, ProbePositionsWS[p].xyz);
+}
@@ -11,9 +11,8 @@ cbuffer PerObjectConstants : register(b0)
 cbuffer PerFrameConstants : register(b1)
 {
     float4x4 LightMatrix;
-    float4 ProbePositionsWS[MAX_PROBE_COUNT];
     float4 LightDirectionWS;
-    float4 packedData; // Stores probe count (x), probe spacing (y), light intensity (z)
+    float4 packedData; // Stores probe count (x), probe spacing (y), light intensity (z), probe volume count (w)
 }
 
 cbuffer PerPassConstants : register(b2)
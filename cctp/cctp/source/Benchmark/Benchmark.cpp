@@ -0,0 +1,63 @@
+#include "CpuPch.h"
+#include "Benchmark.h"
+
+const std::vector<Benchmark::Entry>& Benchmark::GetEntries()
+{
+	static const std::vector<Entry> entries =
+	{
+		{ "bvh", "SAH binned BVH build time and quality", &BvhBuild },
+		{ "tlas", "Top level BVH refit and rebuild under moving instances", &TopLevelBvhUpdate },
+		{ "wide", "BVH4 and BVH8 SIMD traversal of single rays and probe ray packets", &WideBvhTrace },
+		{ "triangle", "Scalar and SIMD ray triangle kernels, with watertightness checks", &TriangleIntersection },
+		{ "octahedral", "Scalar and AVX2 batch octahedral encode and decode, checked bit for bit against the shader math", &OctahedralEncoding },
+		{ "probes", "Probe volume update and upload cost with a transform per probe against structure of arrays storage with change tracking", &ProbeVolumeUpdate },
+		{ "scroll", "Probes traced and trace time for a probe volume following a camera, moved as a whole against scrolled toroidally", &ProbeVolumeScroll },
+		{ "classify", "Probe classification cost and the rays saved by skipping probes inside geometry or away from every surface", &ProbeClassification },
+		{ "relocate", "Probe relocation out of nearby geometry, and incremental relocation of the probes near a moving instance", &ProbeRelocation },
+		{ "pool", "Probe pool of 64k+ probes over several volumes: validation, 2D atlas layout, scrolling uploads and constant time shading point lookup", &ProbePoolLookup },
+		{ "cage", "Shading point irradiance from the eight probe cage against a loop over every probe, at 125, 1k and 10k probes", &ProbeCageIrradiance },
+		{ "hysteresis", "Temporal blending of probe gathers: flicker left under noisy input, convergence statistics and gathers to adapt to a moved light", &ProbeHysteresis },
+		{ "schedule", "Budgeted probe update scheduling against retracing every probe each gather: per frame cost, spikes, probe age and scheduling cost", &ProbeSchedule },
+		{ "raytable", "Probe ray table: ray setup from the table against computing directions per ray, and angle from visibility texels to the nearest ray with random rotations", &ProbeRayTable },
+		{ "bake", "Baked probe files: startup by mapping baked atlases against tracing them, file size with and without compression, and round trip error", &ProbeBake },
+		{ "packing", "Scalar and AVX2/F16C batch conversion of atlas texels to R11G11B10, R9G9B9E5 and R16G16 floats against memcpy, with round trip errors", &PackedFloatConversion },
+		{ "sh", "L1 and L2 spherical harmonic probes against octahedral atlas tiles: memory per probe, scalar and AVX2 projection and evaluation, shading cost and error against densely traced irradiance", &ProbeSphericalHarmonics },
+		{ "filter", "Probe filter stage: per probe cost of filtering every ray into every texel and of the octahedral border copy, and seam error of bilinear samples near tile edges", &ProbeGatherFilter },
+		{ "invalidate", "Change driven probe updates: probes invalidated by the bounds the door sweeps through against retracing every probe, rays traced in a static scene and the irradiance error left", &ProbeInvalidation },
+		{ "raydata", "Probe ray data: rays lost to shared texels when each ray is stored in its texel, and error and cost of filtering 16 to 256 rays into the same atlas tiles against densely traced irradiance", &ProbeRayData },
+		{ "leak", "Probe light leaks: irradiance leaking through a thin wall into a closed room and error in the lit room without visibility weighting, with mean distance weighting and with Chebyshev weighting, and the cost of each per shading point", &ProbeLightLeak }
+	};
+	return entries;
+}
+
+bool Benchmark::Run(const std::string& name, std::ostream& output)
+{
+	bool found = false;
+	for (const auto& entry : GetEntries())
+	{
+		if (name == "all" || name == entry.Name)
+		{
+			output << "== " << entry.Name << ": " << entry.Description << " ==\n";
+			entry.Run(output);
+			output << "\n";
+			found = true;
+		}
+	}
+	return found;
+}
+
+double Benchmark::GetElapsedMilliseconds(const std::chrono::high_resolution_clock::time_point& start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void Benchmark::CreateDemoScene(DemoSceneFixture& fixture)
+{
+	DemoSceneLayout::CreateSceneInstances(fixture.Transforms, fixture.Materials);
+	DemoSceneLayout::CreateRaytracingScene(fixture.Transforms, fixture.Materials, fixture.Scene);
+}
+
+Renderer::ProbeVolume Benchmark::CreateDemoProbeVolume(const float spacing, const glm::vec3& extents)
+{
+	return Renderer::ProbeVolume(DemoSceneLayout::PROBE_VOLUME_START_POSITION, extents, spacing, DemoSceneLayout::PROBE_VOLUME_DEBUG_PROBE_SCALE);
+}
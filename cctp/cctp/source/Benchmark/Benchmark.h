@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Scene/Scenes/DemoSceneLayout.h"
+
+namespace Benchmark
+{
+	struct Entry
+	{
+		const char* Name = "";
+		const char* Description = "";
+		void(*Run)(std::ostream& output) = nullptr;
+	};
+
+	const std::vector<Entry>& GetEntries();
+	// Runs the benchmark with the given name, or every benchmark when the name is "all". Returns false if no benchmark matched
+	bool Run(const std::string& name, std::ostream& output);
+
+	double GetElapsedMilliseconds(const std::chrono::high_resolution_clock::time_point& start);
+
+	// The demo scene's instances and the CPU raytracing scene built from them, traced by the probe benchmarks
+	struct DemoSceneFixture
+	{
+		std::vector<Transform> Transforms;
+		std::vector<Renderer::Material> Materials;
+		Renderer::CPU::RaytracingScene Scene;
+	};
+	void CreateDemoScene(DemoSceneFixture& fixture);
+
+	// The probe benchmarks measure a denser volume than the demo scene's, over the same space
+	constexpr glm::vec3 DENSE_PROBE_VOLUME_EXTENTS = glm::vec3(5.0f);
+	constexpr float DENSE_PROBE_VOLUME_SPACING = 0.5f;
+	// A probe volume at the position of the demo scene's, the dense volume by default
+	Renderer::ProbeVolume CreateDemoProbeVolume(const float spacing = DENSE_PROBE_VOLUME_SPACING, const glm::vec3& extents = DENSE_PROBE_VOLUME_EXTENTS);
+
+	// Benchmarks
+	void BvhBuild(std::ostream& output);
+	void TopLevelBvhUpdate(std::ostream& output);
+	void WideBvhTrace(std::ostream& output);
+	void TriangleIntersection(std::ostream& output);
+	void OctahedralEncoding(std::ostream& output);
+	void ProbeVolumeUpdate(std::ostream& output);
+	void ProbeVolumeScroll(std::ostream& output);
+	void ProbeClassification(std::ostream& output);
+	void ProbeRelocation(std::ostream& output);
+	void ProbePoolLookup(std::ostream& output);
+	void ProbeCageIrradiance(std::ostream& output);
+	void ProbeHysteresis(std::ostream& output);
+	void ProbeSchedule(std::ostream& output);
+	void ProbeRayTable(std::ostream& output);
+	void ProbeBake(std::ostream& output);
+	void PackedFloatConversion(std::ostream& output);
+	void ProbeSphericalHarmonics(std::ostream& output);
+	void ProbeGatherFilter(std::ostream& output);
+	void ProbeInvalidation(std::ostream& output);
+	void ProbeRayData(std::ostream& output);
+	void ProbeLightLeak(std::ostream& output);
+}
@@ -0,0 +1,205 @@
+#include "CpuPch.h"
+#include "Benchmark.h"
+#include "Renderer/Geometry.h"
+#include "Renderer/CPU/Bvh.h"
+#include "Renderer/CPU/TriangleIntersection.h"
+#include "Threading/TaskScheduler.h"
+
+namespace
+{
+	struct TestMesh
+	{
+		std::string Name;
+		std::vector<Renderer::Vertex1Pos1UV1Norm> Vertices;
+		std::vector<uint32_t> Indices;
+	};
+
+	std::vector<TestMesh> CreateTestMeshes()
+	{
+		std::vector<TestMesh> meshes(4);
+
+		meshes[0].Name = "Cube";
+		Renderer::Geometry::GenerateCubeGeometry(meshes[0].Vertices, meshes[0].Indices, 1.0f);
+
+		meshes[1].Name = "Sphere 64x32";
+		Renderer::Geometry::GenerateSphereGeometry(meshes[1].Vertices, meshes[1].Indices, 1.0f, 64, 32);
+
+		meshes[2].Name = "Sphere 1024x512";
+		Renderer::Geometry::GenerateSphereGeometry(meshes[2].Vertices, meshes[2].Indices, 1.0f, 1024, 512);
+
+		meshes[3].Name = "Triangle soup";
+		Renderer::Geometry::GenerateTriangleSoupGeometry(meshes[3].Vertices, meshes[3].Indices, 1000000, 10.0f, 0.1f, 1);
+
+		return meshes;
+	}
+
+	void PrintBuildStats(std::ostream& output, const Renderer::CPU::Bvh& bvh)
+	{
+		const auto& stats = bvh.GetStats();
+		output << "Triangles: " << stats.PrimitiveCount <<
+			"  Build (ms): " << stats.BuildMilliseconds <<
+			"  Mtris/s: " << (static_cast<double>(stats.PrimitiveCount) / (stats.BuildMilliseconds * 1000.0)) <<
+			"  Nodes: " << stats.NodeCount <<
+			"  Leaves: " << stats.LeafCount <<
+			"  Tris/leaf (avg/max): " << stats.GetAverageLeafPrimitiveCount() << "/" << stats.MaxLeafPrimitiveCount <<
+			"  Depth: " << stats.MaxDepth <<
+			"  SAH cost: " << stats.SahCost <<
+			"  Memory (MB): " << (static_cast<double>(bvh.GetMemoryBytes()) / (1024.0 * 1024.0)) << "\n";
+	}
+
+	// Closest hit against every triangle, used to validate traversal
+	bool IntersectBruteForce(const TestMesh& mesh, const Renderer::CPU::Ray& ray, Renderer::CPU::RayHit& hit)
+	{
+		bool hitFound = false;
+		for (size_t i = 0; i < mesh.Indices.size(); i += 3)
+		{
+			float t;
+			glm::vec2 barycentrics;
+			if (Renderer::CPU::IntersectTriangle(ray.Origin, ray.Direction,
+				mesh.Vertices[mesh.Indices[i]].Position, mesh.Vertices[mesh.Indices[i + 1]].Position, mesh.Vertices[mesh.Indices[i + 2]].Position,
+				false, t, barycentrics) &&
+				t >= ray.TMin && t < hit.T)
+			{
+				hit.T = t;
+				hit.PrimitiveIndex = static_cast<uint32_t>(i / 3);
+				hitFound = true;
+			}
+		}
+		return hitFound;
+	}
+
+	// Random rays starting inside the mesh bounds
+	std::vector<Renderer::CPU::Ray> CreateRays(const BoundingBox& bounds, const size_t rayCount, const uint32_t seed)
+	{
+		std::mt19937 generator(seed);
+		std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+		std::vector<Renderer::CPU::Ray> rays(rayCount);
+		for (auto& ray : rays)
+		{
+			ray.Origin = bounds.Min + bounds.GetExtents() * glm::vec3(distribution(generator), distribution(generator), distribution(generator));
+			ray.Direction = glm::vec3(distribution(generator), distribution(generator), distribution(generator)) * 2.0f - 1.0f;
+			ray.Direction = (glm::dot(ray.Direction, ray.Direction) > 0.0f) ? glm::normalize(ray.Direction) : glm::vec3(0.0f, 0.0f, 1.0f);
+		}
+		return rays;
+	}
+}
+
+void Benchmark::BvhBuild(std::ostream& output)
+{
+	constexpr size_t traceRayCount = 100000;
+	// Brute force validation is limited to roughly this many ray triangle tests per mesh
+	constexpr size_t validationTestBudget = 200000000;
+
+	auto meshes = CreateTestMeshes();
+	for (const auto& mesh : meshes)
+	{
+		output << mesh.Name << "\n";
+
+		Renderer::CPU::Bvh bvh;
+		bvh.Build(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices.data(), mesh.Indices.size());
+		PrintBuildStats(output, bvh);
+
+		// Closest hit trace throughput on a single thread
+		const auto rays = CreateRays(bvh.GetBounds(), traceRayCount, 7);
+		size_t hitCount = 0;
+		const auto traceStart = std::chrono::high_resolution_clock::now();
+		for (const auto& ray : rays)
+		{
+			Renderer::CPU::RayHit hit = {};
+			hit.T = ray.TMax;
+			if (bvh.Intersect(ray.Origin, ray.Direction, ray.TMin, false, false, hit))
+			{
+				++hitCount;
+			}
+		}
+		const double traceMilliseconds = GetElapsedMilliseconds(traceStart);
+
+		// Compare closest hit distances against testing every triangle
+		const size_t triangleCount = mesh.Indices.size() / 3;
+		const size_t validationRayCount = std::min(rays.size(), std::max<size_t>(1, validationTestBudget / triangleCount));
+		size_t mismatchCount = 0;
+		for (size_t i = 0; i < validationRayCount; ++i)
+		{
+			Renderer::CPU::RayHit bvhHit = {};
+			bvhHit.T = rays[i].TMax;
+			Renderer::CPU::RayHit bruteForceHit = bvhHit;
+			bvh.Intersect(rays[i].Origin, rays[i].Direction, rays[i].TMin, false, false, bvhHit);
+			IntersectBruteForce(mesh, rays[i], bruteForceHit);
+			if (bvhHit.T != bruteForceHit.T)
+			{
+				++mismatchCount;
+			}
+		}
+
+		output << "Rays: " << rays.size() <<
+			"  Hit (%): " << (100.0 * static_cast<double>(hitCount) / static_cast<double>(rays.size())) <<
+			"  Trace (ms): " << traceMilliseconds <<
+			"  Mrays/s: " << (static_cast<double>(rays.size()) / (traceMilliseconds * 1000.0)) <<
+			"  Validated rays: " << validationRayCount <<
+			"  Mismatches: " << mismatchCount << "\n";
+	}
+
+	// Build time and quality trade off against the number of split planes evaluated
+	const auto& largestMesh = meshes[2];
+	output << largestMesh.Name << " bin count\n";
+	for (uint32_t binCount = 4; binCount <= Renderer::CPU::Bvh::MaxBinCount; binCount *= 2)
+	{
+		Renderer::CPU::BvhBuildSettings settings = {};
+		settings.BinCount = binCount;
+
+		Renderer::CPU::Bvh bvh;
+		output << "Bins: " << binCount << "  ";
+		bvh.Build(largestMesh.Vertices.data(), largestMesh.Vertices.size(), largestMesh.Indices.data(), largestMesh.Indices.size(), settings);
+		PrintBuildStats(output, bvh);
+	}
+
+	// Build time against the number of threads, doubling up to every hardware thread
+	const uint32_t hardwareThreadCount = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<uint32_t> threadCounts;
+	for (uint32_t threadCount = 1; threadCount < hardwareThreadCount; threadCount *= 2)
+	{
+		threadCounts.push_back(threadCount);
+	}
+	threadCounts.push_back(hardwareThreadCount);
+
+	for (size_t m = 2; m < meshes.size(); ++m)
+	{
+		const auto& mesh = meshes[m];
+		output << mesh.Name << " parallel build  Hardware threads: " << hardwareThreadCount << "\n";
+
+		double singleThreadMilliseconds = 0.0;
+		Renderer::CPU::BvhBuildStats singleThreadStats;
+		for (const uint32_t threadCount : threadCounts)
+		{
+			Threading::TaskScheduler scheduler(threadCount);
+			Renderer::CPU::BvhBuildSettings settings = {};
+			settings.pTaskScheduler = &scheduler;
+
+			// Best of a few builds, as the first touches memory for the first time
+			constexpr uint32_t buildCount = 3;
+			double milliseconds = std::numeric_limits<double>::max();
+			Renderer::CPU::Bvh bvh;
+			for (uint32_t i = 0; i < buildCount; ++i)
+			{
+				milliseconds = std::min(milliseconds, bvh.Build(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices.data(), mesh.Indices.size(), settings).BuildMilliseconds);
+			}
+
+			if (threadCount == 1)
+			{
+				singleThreadMilliseconds = milliseconds;
+				singleThreadStats = bvh.GetStats();
+			}
+
+			// Splits do not depend on the thread count, so the tree must match the single threaded one. The cost is summed in node order, which differs
+			const auto& stats = bvh.GetStats();
+			const bool matches = stats.NodeCount == singleThreadStats.NodeCount && stats.LeafCount == singleThreadStats.LeafCount &&
+				stats.MaxDepth == singleThreadStats.MaxDepth && std::abs(stats.SahCost - singleThreadStats.SahCost) <= 1e-4f * singleThreadStats.SahCost;
+			output << "Threads: " << threadCount <<
+				"  Build (ms): " << milliseconds <<
+				"  Mtris/s: " << (static_cast<double>(stats.PrimitiveCount) / (milliseconds * 1000.0)) <<
+				"  Speedup: " << (singleThreadMilliseconds / milliseconds) <<
+				"  Matches single thread: " << (matches ? "yes" : "no") << "\n";
+		}
+	}
+}
\ No newline at end of file
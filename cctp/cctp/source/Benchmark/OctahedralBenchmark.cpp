@@ -0,0 +1,187 @@
+#include "CpuPch.h"
+#include "Benchmark.h"
+#include "Math/Simd.h"
+#include "Math/Octahedral.h"
+#include "Renderer/GIConstants.h"
+#include "Renderer/CPU/ProbeTracer.h"
+
+namespace
+{
+	// Counts elements that differ in any bit
+	template<typename T>
+	size_t CountBitMismatches(const std::vector<T>& values, const std::vector<T>& referenceValues)
+	{
+		size_t mismatchCount = 0;
+		for (size_t i = 0; i < values.size(); ++i)
+		{
+			if (memcmp(&values[i], &referenceValues[i], sizeof(T)) != 0)
+			{
+				++mismatchCount;
+			}
+		}
+		return mismatchCount;
+	}
+
+	// Runs function() and returns millions of elements processed per second
+	template<typename Function>
+	double MeasureMelementsPerSecond(const size_t count, Function&& function)
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+		function();
+		return static_cast<double>(count) / (Benchmark::GetElapsedMilliseconds(start) * 1000.0);
+	}
+}
+
+void Benchmark::OctahedralEncoding(std::ostream& output)
+{
+	// Every point of a grid over the octahedral square, including its edges, centre and diagonals
+	constexpr uint32_t gridSideLength = 4097;
+	const float gridScale = 2.0f / static_cast<float>(gridSideLength - 1);
+
+	std::vector<glm::vec2> octCoords;
+	octCoords.reserve(static_cast<size_t>(gridSideLength) * gridSideLength);
+	for (uint32_t y = 0; y < gridSideLength; ++y)
+	{
+		for (uint32_t x = 0; x < gridSideLength; ++x)
+		{
+			octCoords.emplace_back(static_cast<float>(x) * gridScale - 1.0f, static_cast<float>(y) * gridScale - 1.0f);
+		}
+	}
+
+	const bool avx2 = Math::SupportsAvx2();
+	output << "AVX2: " << (avx2 ? "yes" : "no, batches run the scalar code") << "  Threads: 1  Grid points: " << octCoords.size() << "\n";
+
+	// Decode the grid, checking the batch results bit for bit against the shader math ported in Math::OctDecode
+	std::vector<glm::vec3> referenceDirections(octCoords.size());
+	const double referenceDecodeMelements = MeasureMelementsPerSecond(octCoords.size(), [&]()
+		{
+			for (size_t i = 0; i < octCoords.size(); ++i)
+			{
+				referenceDirections[i] = Math::OctDecode(octCoords[i]);
+			}
+		});
+	std::vector<glm::vec3> directions(octCoords.size());
+	const double scalarDecodeMelements = MeasureMelementsPerSecond(octCoords.size(), [&]()
+		{
+			Math::OctDecode(octCoords.data(), octCoords.size(), directions.data(), false);
+		});
+	size_t decodeMismatchCount = CountBitMismatches(directions, referenceDirections);
+	const double avx2DecodeMelements = MeasureMelementsPerSecond(octCoords.size(), [&]()
+		{
+			Math::OctDecode(octCoords.data(), octCoords.size(), directions.data());
+		});
+	decodeMismatchCount += CountBitMismatches(directions, referenceDirections);
+
+	output << "Decode  Mdirections/s (single/scalar batch/AVX2 batch): " <<
+		referenceDecodeMelements << "/" << scalarDecodeMelements << "/" << avx2DecodeMelements <<
+		"  Mismatches: " << decodeMismatchCount << "\n";
+
+	// Encode the decoded grid along with the axes with every sign of zero in their other components, which take the SignNotZero edge cases
+	std::vector<glm::vec3> encodeDirections = referenceDirections;
+	for (int32_t axis = 0; axis < 3; ++axis)
+	{
+		for (const float value : { 1.0f, -1.0f })
+		{
+			for (const float zeroA : { 0.0f, -0.0f })
+			{
+				for (const float zeroB : { 0.0f, -0.0f })
+				{
+					glm::vec3 direction = glm::vec3(0.0f, 0.0f, 0.0f);
+					direction[axis] = value;
+					direction[(axis + 1) % 3] = zeroA;
+					direction[(axis + 2) % 3] = zeroB;
+					encodeDirections.push_back(direction);
+				}
+			}
+		}
+	}
+
+	std::vector<glm::vec2> referenceOctCoords(encodeDirections.size());
+	const double referenceEncodeMelements = MeasureMelementsPerSecond(encodeDirections.size(), [&]()
+		{
+			for (size_t i = 0; i < encodeDirections.size(); ++i)
+			{
+				referenceOctCoords[i] = Math::OctEncode(encodeDirections[i]);
+			}
+		});
+	std::vector<glm::vec2> encodedOctCoords(encodeDirections.size());
+	const double scalarEncodeMelements = MeasureMelementsPerSecond(encodeDirections.size(), [&]()
+		{
+			Math::OctEncode(encodeDirections.data(), encodeDirections.size(), encodedOctCoords.data(), false);
+		});
+	size_t encodeMismatchCount = CountBitMismatches(encodedOctCoords, referenceOctCoords);
+	const double avx2EncodeMelements = MeasureMelementsPerSecond(encodeDirections.size(), [&]()
+		{
+			Math::OctEncode(encodeDirections.data(), encodeDirections.size(), encodedOctCoords.data());
+		});
+	encodeMismatchCount += CountBitMismatches(encodedOctCoords, referenceOctCoords);
+
+	// Encoding then decoding returns the direction up to rounding. Grid points on the edges of the square share directions, so directions are compared
+	std::vector<glm::vec3> roundTripDirections(octCoords.size());
+	Math::OctDecode(referenceOctCoords.data(), octCoords.size(), roundTripDirections.data());
+	float maxRoundTripError = 0.0f;
+	for (size_t i = 0; i < octCoords.size(); ++i)
+	{
+		maxRoundTripError = std::max(maxRoundTripError, glm::length(roundTripDirections[i] - referenceDirections[i]));
+	}
+
+	output << "Encode  Mdirections/s (single/scalar batch/AVX2 batch): " <<
+		referenceEncodeMelements << "/" << scalarEncodeMelements << "/" << avx2EncodeMelements <<
+		"  Mismatches: " << encodeMismatchCount <<
+		"  Max round trip error: " << maxRoundTripError << "\n";
+
+	// Probe atlas texel coordinates must match GetProbeTexelCoordinate, the port of the shader function of the same name
+	const Renderer::ProbeAtlasLayout atlasLayout(4096, glm::ivec3(16));
+	const uint32_t probeIndex = atlasLayout.GetProbeCapacity() - 1;
+	for (const uint32_t sideLength : { Renderer::IRRADIANCE_PROBE_SIDE_LENGTH, Renderer::VISIBILITY_PROBE_SIDE_LENGTH })
+	{
+		const glm::vec2 topLeft = Renderer::CPU::GetProbeTopLeftPosition(probeIndex, atlasLayout.GetProbesPerRow(), static_cast<float>(sideLength), Renderer::PROBE_PADDING);
+
+		std::vector<glm::vec2> referenceTexelCoordinates(encodeDirections.size());
+		for (size_t i = 0; i < encodeDirections.size(); ++i)
+		{
+			referenceTexelCoordinates[i] = Renderer::CPU::GetProbeTexelCoordinate(encodeDirections[i], probeIndex, atlasLayout.GetProbesPerRow(), static_cast<float>(sideLength), Renderer::PROBE_PADDING);
+		}
+
+		std::vector<glm::vec2> texelCoordinates(encodeDirections.size());
+		Math::OctEncodeTexels(encodeDirections.data(), encodeDirections.size(), topLeft, static_cast<float>(sideLength), texelCoordinates.data(), false);
+		size_t texelMismatchCount = CountBitMismatches(texelCoordinates, referenceTexelCoordinates);
+		const double texelEncodeMelements = MeasureMelementsPerSecond(encodeDirections.size(), [&]()
+			{
+				Math::OctEncodeTexels(encodeDirections.data(), encodeDirections.size(), topLeft, static_cast<float>(sideLength), texelCoordinates.data());
+			});
+		texelMismatchCount += CountBitMismatches(texelCoordinates, referenceTexelCoordinates);
+
+		// Decoding the texel centres, with the scalar batch as the reference as the shaders have no inverse
+		std::vector<glm::vec2> texelCentres;
+		for (uint32_t y = 0; y < sideLength; ++y)
+		{
+			for (uint32_t x = 0; x < sideLength; ++x)
+			{
+				texelCentres.push_back(topLeft + glm::vec2(static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f));
+			}
+		}
+		std::vector<glm::vec3> referenceTexelDirections(texelCentres.size());
+		Math::OctDecodeTexels(texelCentres.data(), texelCentres.size(), topLeft, static_cast<float>(sideLength), referenceTexelDirections.data(), false);
+		std::vector<glm::vec3> texelDirections(texelCentres.size());
+		Math::OctDecodeTexels(texelCentres.data(), texelCentres.size(), topLeft, static_cast<float>(sideLength), texelDirections.data());
+		texelMismatchCount += CountBitMismatches(texelDirections, referenceTexelDirections);
+
+		// Every texel centre direction must map back into its own texel
+		size_t wrongTexelCount = 0;
+		std::vector<glm::vec2> roundTripTexelCoordinates(texelCentres.size());
+		Math::OctEncodeTexels(texelDirections.data(), texelDirections.size(), topLeft, static_cast<float>(sideLength), roundTripTexelCoordinates.data());
+		for (size_t i = 0; i < texelCentres.size(); ++i)
+		{
+			if (glm::floor(roundTripTexelCoordinates[i]) != glm::floor(texelCentres[i]))
+			{
+				++wrongTexelCount;
+			}
+		}
+
+		output << "Texels  Side length: " << sideLength <<
+			"  Encode Mdirections/s: " << texelEncodeMelements <<
+			"  Mismatches: " << texelMismatchCount <<
+			"  Texel centres mapped to another texel: " << wrongTexelCount << "/" << texelCentres.size() << "\n";
+	}
+}
@@ -0,0 +1,205 @@
+#include "CpuPch.h"
+#include "Benchmark.h"
+#include "Math/Simd.h"
+#include "Math/PackedFloat.h"
+
+namespace
+{
+	// Counts elements that differ in any bit
+	template<typename T>
+	size_t CountBitMismatches(const std::vector<T>& values, const std::vector<T>& referenceValues)
+	{
+		size_t mismatchCount = 0;
+		for (size_t i = 0; i < values.size(); ++i)
+		{
+			if (memcmp(&values[i], &referenceValues[i], sizeof(T)) != 0)
+			{
+				++mismatchCount;
+			}
+		}
+		return mismatchCount;
+	}
+
+	// Runs function() and returns gigabytes read and written per second
+	template<typename Function>
+	double MeasureGigabytesPerSecond(const size_t byteCount, Function&& function)
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+		function();
+		return static_cast<double>(byteCount) / (Benchmark::GetElapsedMilliseconds(start) * 1.0e6);
+	}
+
+	// Converts the values one at a time and with the scalar and AVX2 batches, in both directions, checking the batches bit for bit against the single
+	// conversions. Returns the values after a round trip
+	template<typename T, typename Pack, typename Unpack, typename PackBatch, typename UnpackBatch>
+	std::vector<T> MeasureFormat(const char* pName, const std::vector<T>& values, Pack&& pack, Unpack&& unpack, PackBatch&& packBatch,
+		UnpackBatch&& unpackBatch, std::ostream& output)
+	{
+		const size_t byteCount = values.size() * (sizeof(T) + sizeof(uint32_t));
+
+		std::vector<uint32_t> referencePacked(values.size());
+		const double referencePackGigabytes = MeasureGigabytesPerSecond(byteCount, [&]()
+			{
+				for (size_t i = 0; i < values.size(); ++i)
+				{
+					referencePacked[i] = pack(values[i]);
+				}
+			});
+		std::vector<uint32_t> packed(values.size());
+		const double scalarPackGigabytes = MeasureGigabytesPerSecond(byteCount, [&]() { packBatch(values.data(), values.size(), packed.data(), false); });
+		size_t packMismatchCount = CountBitMismatches(packed, referencePacked);
+		const double simdPackGigabytes = MeasureGigabytesPerSecond(byteCount, [&]() { packBatch(values.data(), values.size(), packed.data(), true); });
+		packMismatchCount += CountBitMismatches(packed, referencePacked);
+
+		std::vector<T> referenceUnpacked(values.size());
+		const double referenceUnpackGigabytes = MeasureGigabytesPerSecond(byteCount, [&]()
+			{
+				for (size_t i = 0; i < values.size(); ++i)
+				{
+					referenceUnpacked[i] = unpack(referencePacked[i]);
+				}
+			});
+		std::vector<T> unpacked(values.size());
+		const double scalarUnpackGigabytes = MeasureGigabytesPerSecond(byteCount, [&]() { unpackBatch(referencePacked.data(), values.size(), unpacked.data(), false); });
+		size_t unpackMismatchCount = CountBitMismatches(unpacked, referenceUnpacked);
+		const double simdUnpackGigabytes = MeasureGigabytesPerSecond(byteCount, [&]() { unpackBatch(referencePacked.data(), values.size(), unpacked.data(), true); });
+		unpackMismatchCount += CountBitMismatches(unpacked, referenceUnpacked);
+
+		output << pName << "  Pack GB/s (single/scalar batch/SIMD batch): " << referencePackGigabytes << "/" << scalarPackGigabytes << "/" << simdPackGigabytes <<
+			"  Mismatches: " << packMismatchCount << "\n";
+		output << pName << "  Unpack GB/s (single/scalar batch/SIMD batch): " << referenceUnpackGigabytes << "/" << scalarUnpackGigabytes << "/" << simdUnpackGigabytes <<
+			"  Mismatches: " << unpackMismatchCount << "\n";
+		return referenceUnpacked;
+	}
+
+	// Counts the packed values in [first, last) with the given stride that do not pack back to themselves after unpacking
+	template<typename Pack, typename Unpack>
+	size_t CountRepackMismatches(const uint32_t first, const uint32_t last, const uint32_t stride, Pack&& pack, Unpack&& unpack)
+	{
+		size_t mismatchCount = 0;
+		for (uint32_t packed = first; packed < last; packed += stride)
+		{
+			mismatchCount += (pack(unpack(packed)) != packed) ? 1 : 0;
+		}
+		return mismatchCount;
+	}
+}
+
+void Benchmark::PackedFloatConversion(std::ostream& output)
+{
+	// An atlas sized array of lighting values spread log uniformly from below the smallest denormals of the formats to above their largest values,
+	// with the special cases mixed in
+	constexpr uint32_t atlasSideLength = 2048;
+	constexpr size_t valueCount = static_cast<size_t>(atlasSideLength) * atlasSideLength;
+	const std::array<float, 14> specialValues =
+	{
+		0.0f, -0.0f, -1.0f,
+		std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+		std::numeric_limits<float>::quiet_NaN(), std::bit_cast<float>(0x7F800001u), std::bit_cast<float>(0xFFC12345u),
+		std::numeric_limits<float>::denorm_min(),
+		// Halfway between neighbouring values of six and five bit mantissas, ties to even
+		1.0f + 1.0f / 128.0f, 1.0f + 3.0f / 64.0f,
+		// Largest values of the formats, and values rounding past them
+		65024.0f, Math::R9G9B9E5_SHAREDEXP_MAX, 65520.0f
+	};
+
+	std::mt19937 random(20);
+	std::uniform_real_distribution<float> exponent(-28.0f, 18.0f);
+	std::uniform_int_distribution<size_t> special(0, 63);
+	auto randomValue = [&]()
+	{
+		const size_t s = special(random);
+		return (s < specialValues.size()) ? specialValues[s] : std::exp2(exponent(random));
+	};
+
+	std::vector<glm::vec3> irradiance(valueCount);
+	std::vector<glm::vec2> visibility(valueCount);
+	for (size_t i = 0; i < valueCount; ++i)
+	{
+		irradiance[i] = glm::vec3(randomValue(), randomValue(), randomValue());
+		visibility[i] = glm::vec2(randomValue(), randomValue());
+	}
+
+	output << "AVX2: " << (Math::SupportsAvx2() ? "yes" : "no") << "  F16C: " << (Math::SupportsF16c() ? "yes" : "no") <<
+		"  Threads: 1  Texels: " << valueCount << " (" << atlasSideLength << "x" << atlasSideLength << ")\n";
+
+	// A copy of the float atlas reads and writes as many bytes as a conversion that ran at memory bandwidth
+	std::vector<glm::vec3> copy(valueCount);
+	const double copyGigabytes = MeasureGigabytesPerSecond(2 * valueCount * sizeof(glm::vec3), [&]()
+		{
+			memcpy(copy.data(), irradiance.data(), valueCount * sizeof(glm::vec3));
+		});
+	output << "memcpy GB/s: " << copyGigabytes << "\n";
+
+	const auto r11g11b10 = MeasureFormat("R11G11B10_FLOAT", irradiance,
+		[](const glm::vec3& value) { return Math::PackR11G11B10Float(value); },
+		[](const uint32_t packed) { return Math::UnpackR11G11B10Float(packed); },
+		[](const glm::vec3* pValues, const size_t count, uint32_t* pPacked, const bool allowAvx2) { Math::PackR11G11B10Float(pValues, count, pPacked, allowAvx2); },
+		[](const uint32_t* pPacked, const size_t count, glm::vec3* pValues, const bool allowAvx2) { Math::UnpackR11G11B10Float(pPacked, count, pValues, allowAvx2); },
+		output);
+	const auto r9g9b9e5 = MeasureFormat("R9G9B9E5_SHAREDEXP", irradiance,
+		[](const glm::vec3& value) { return Math::PackR9G9B9E5SharedExp(value); },
+		[](const uint32_t packed) { return Math::UnpackR9G9B9E5SharedExp(packed); },
+		[](const glm::vec3* pValues, const size_t count, uint32_t* pPacked, const bool allowAvx2) { Math::PackR9G9B9E5SharedExp(pValues, count, pPacked, allowAvx2); },
+		[](const uint32_t* pPacked, const size_t count, glm::vec3* pValues, const bool allowAvx2) { Math::UnpackR9G9B9E5SharedExp(pPacked, count, pValues, allowAvx2); },
+		output);
+	const auto r16g16 = MeasureFormat("R16G16_FLOAT", visibility,
+		[](const glm::vec2& value) { return Math::PackR16G16Float(value); },
+		[](const uint32_t packed) { return Math::UnpackR16G16Float(packed); },
+		[](const glm::vec2* pValues, const size_t count, uint32_t* pPacked, const bool allowAvx2) { Math::PackR16G16Float(pValues, count, pPacked, allowAvx2); },
+		[](const uint32_t* pPacked, const size_t count, glm::vec2* pValues, const bool allowAvx2) { Math::UnpackR16G16Float(pPacked, count, pValues, allowAvx2); },
+		output);
+
+	// Round trip error of the values between the smallest normal and the largest value of each format. Shared exponent channels are measured against
+	// the largest channel of their texel, as darker channels keep fewer bits
+	float r11g11b10Error = 0.0f;
+	float r9g9b9e5Error = 0.0f;
+	float r16g16Error = 0.0f;
+	auto inRange = [](const float value, const float maxValue) { return (value >= std::ldexp(1.0f, -14)) && (value <= maxValue); };
+	for (size_t i = 0; i < valueCount; ++i)
+	{
+		const float maxChannel = std::max(std::max(irradiance[i].x, irradiance[i].y), irradiance[i].z);
+		for (int32_t c = 0; c < 3; ++c)
+		{
+			if (inRange(irradiance[i][c], 65024.0f))
+			{
+				r11g11b10Error = std::max(r11g11b10Error, std::abs(r11g11b10[i][c] - irradiance[i][c]) / irradiance[i][c]);
+			}
+			if (inRange(irradiance[i][c], Math::R9G9B9E5_SHAREDEXP_MAX) && inRange(maxChannel, Math::R9G9B9E5_SHAREDEXP_MAX))
+			{
+				r9g9b9e5Error = std::max(r9g9b9e5Error, std::abs(r9g9b9e5[i][c] - irradiance[i][c]) / maxChannel);
+			}
+		}
+		for (int32_t c = 0; c < 2; ++c)
+		{
+			if (inRange(visibility[i][c], 65504.0f))
+			{
+				r16g16Error = std::max(r16g16Error, std::abs(r16g16[i][c] - visibility[i][c]) / visibility[i][c]);
+			}
+		}
+	}
+	output << "Worst relative round trip error (R11G11B10/R9G9B9E5 against the largest channel/R16G16): " << r11g11b10Error << "/" <<
+		r9g9b9e5Error << "/" << r16g16Error << "\n";
+
+	// Every finite code of the small float channels, every finite and infinite half, and every normalized shared exponent red code unpacks to a value
+	// that packs back to the same code
+	size_t repackMismatchCount = 0;
+	repackMismatchCount += CountRepackMismatches(0, 0x7C0, 1,
+		[](const glm::vec3& value) { return Math::PackR11G11B10Float(value) & 0x7FF; }, [](const uint32_t packed) { return Math::UnpackR11G11B10Float(packed); });
+	repackMismatchCount += CountRepackMismatches(0, 0x7C0 << 11, 1 << 11,
+		[](const glm::vec3& value) { return Math::PackR11G11B10Float(value) & (0x7FF << 11); }, [](const uint32_t packed) { return Math::UnpackR11G11B10Float(packed); });
+	repackMismatchCount += CountRepackMismatches(0, 0x3E0u << 22, 1 << 22,
+		[](const glm::vec3& value) { return Math::PackR11G11B10Float(value) & (0x3FFu << 22); }, [](const uint32_t packed) { return Math::UnpackR11G11B10Float(packed); });
+	for (const uint32_t half : { 0u, 0x8000u })
+	{
+		repackMismatchCount += CountRepackMismatches(half, half + 0x7C01, 1,
+			[](const glm::vec2& value) { return Math::PackR16G16Float(value); }, [](const uint32_t packed) { return Math::UnpackR16G16Float(packed); });
+	}
+	for (uint32_t sharedExponent = 0; sharedExponent < 32; ++sharedExponent)
+	{
+		const uint32_t firstMantissa = (sharedExponent == 0) ? 0 : 256;
+		repackMismatchCount += CountRepackMismatches((sharedExponent << 27) | firstMantissa, (sharedExponent << 27) | 512, 1,
+			[](const glm::vec3& value) { return Math::PackR9G9B9E5SharedExp(value); }, [](const uint32_t packed) { return Math::UnpackR9G9B9E5SharedExp(packed); });
+	}
+	output << "Codes that do not repack to themselves: " << repackMismatchCount << "\n";
+}
@@ -0,0 +1,145 @@
+#include "CpuPch.h"
+#include "Benchmark.h"
+#include "Math/PackedFloat.h"
+#include "Renderer/BakedProbeFile.h"
+#include "Renderer/ProbeVolume.h"
+#include "Renderer/CPU/ProbeTracer.h"
+#include "Renderer/CPU/RaytracingScene.h"
+#include "Scene/Scenes/DemoSceneLayout.h"
+
+namespace
+{
+	// Mean absolute luminance difference of the irradiance atlases, relative to the mean luminance of the reference
+	double MeasureAtlasError(const Renderer::CPU::Texture2D<glm::vec3>& atlas, const Renderer::CPU::Texture2D<glm::vec3>& reference)
+	{
+		double sumDifference = 0.0;
+		double sumReference = 0.0;
+		for (size_t i = 0; i < reference.GetTexelCount(); ++i)
+		{
+			sumDifference += std::abs(Renderer::CPU::Luminance(atlas.GetData()[i]) - Renderer::CPU::Luminance(reference.GetData()[i]));
+			sumReference += Renderer::CPU::Luminance(reference.GetData()[i]);
+		}
+		return sumReference > 0.0 ? sumDifference / sumReference : 0.0;
+	}
+}
+
+void Benchmark::ProbeBake(std::ostream& output)
+{
+	DemoSceneFixture demoScene;
+	CreateDemoScene(demoScene);
+	const auto& scene = demoScene.Scene;
+
+	Renderer::ProbeVolume volume = CreateDemoProbeVolume();
+	const auto& probePositions = volume.GetProbePositions();
+	const glm::ivec3 gridProbeCounts = glm::ivec3(volume.GetProbeCountX(), volume.GetProbeCountY(), volume.GetProbeCountZ());
+
+	Renderer::CPU::ProbeTraceSettings settings = {};
+	settings.LightDirectionWS = DemoSceneLayout::DEFAULT_LIGHT_DIRECTION_WS;
+
+	// The probes that are baked, traced in the same atlas layout as the probes loaded from the bake. Starting without a bake costs these gathers
+	Renderer::CPU::ProbeTracer bakedTracer;
+	bakedTracer.ReserveAtlases(probePositions.size(), gridProbeCounts);
+	double bakeMilliseconds = 0.0;
+	for (uint32_t g = 0; g < Renderer::BAKE_GATHER_COUNT; ++g)
+	{
+		settings.RayRotationSeed = g + 1;
+		bakeMilliseconds += bakedTracer.TraceProbes(scene, probePositions, settings).GetTotalMilliseconds();
+	}
+
+	output << "Probes: " << probePositions.size() << "  Rays per probe: " << Renderer::PROBE_RAY_COUNT << "\n";
+	output << "Bake  Gathers: " << Renderer::BAKE_GATHER_COUNT << "  Trace (ms): " << bakeMilliseconds << "\n";
+
+	auto start = std::chrono::high_resolution_clock::now();
+	Renderer::BakedProbeAtlases atlases;
+	bakedTracer.GetBakedProbes(0, gridProbeCounts, atlases);
+	const double packMilliseconds = GetElapsedMilliseconds(start);
+
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "ProbeBakeBenchmark.probes";
+	for (const auto compression : { Renderer::BakedProbeCompression::None, Renderer::BakedProbeCompression::PlanarDeltaRunLength })
+	{
+		start = std::chrono::high_resolution_clock::now();
+		if (!volume.SaveBakedProbes(path, atlases, compression))
+		{
+			output << "ERROR: Failed to write " << path << "\n";
+			return;
+		}
+		const double saveMilliseconds = GetElapsedMilliseconds(start);
+
+		// Reading the whole file into memory stands in for a loader that parses it
+		start = std::chrono::high_resolution_clock::now();
+		std::ifstream file(path, std::ios::binary);
+		const std::vector<char> fileBytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		const double readMilliseconds = GetElapsedMilliseconds(start);
+
+		// Opening maps and validates the file and decompresses compressed sections. Copying the sections out stands in for filling the upload
+		// buffer, which is all the GPU upload does on the CPU
+		start = std::chrono::high_resolution_clock::now();
+		Renderer::BakedProbeFile bakedProbeFile;
+		if (!volume.LoadBakedProbes(path, bakedProbeFile))
+		{
+			output << "ERROR: Failed to load " << path << "\n";
+			return;
+		}
+		const double openMilliseconds = GetElapsedMilliseconds(start);
+
+		const auto& data = bakedProbeFile.GetData();
+		start = std::chrono::high_resolution_clock::now();
+		std::vector<uint8_t> uploadBuffer(atlases.IrradianceAtlas.size() + atlases.VisibilityAtlas.size() + atlases.Statistics.size() * sizeof(Renderer::ProbeStatistics));
+		std::copy(data.pIrradianceAtlas, data.pIrradianceAtlas + atlases.IrradianceAtlas.size(), uploadBuffer.begin());
+		std::copy(data.pVisibilityAtlas, data.pVisibilityAtlas + atlases.VisibilityAtlas.size(), uploadBuffer.begin() + atlases.IrradianceAtlas.size());
+		std::copy(reinterpret_cast<const uint8_t*>(data.pStatistics), reinterpret_cast<const uint8_t*>(data.pStatistics + atlases.Statistics.size()),
+			uploadBuffer.begin() + atlases.IrradianceAtlas.size() + atlases.VisibilityAtlas.size());
+		const double copyMilliseconds = GetElapsedMilliseconds(start);
+
+		// The CPU tracer unpacks the baked probes back to floats and continues their history
+		Renderer::CPU::ProbeTracer loadedTracer;
+		start = std::chrono::high_resolution_clock::now();
+		loadedTracer.LoadBakedProbes(data, 0);
+		const double unpackMilliseconds = GetElapsedMilliseconds(start);
+		const double loadedError = MeasureAtlasError(loadedTracer.GetIrradianceAtlas(), bakedTracer.GetIrradianceAtlas());
+		const bool statisticsMatch = std::equal(bakedTracer.GetProbeStatistics().begin(), bakedTracer.GetProbeStatistics().begin() + probePositions.size(),
+			loadedTracer.GetProbeStatistics().begin(), [](const Renderer::ProbeStatistics& a, const Renderer::ProbeStatistics& b)
+			{
+				return (a.SampleCount == b.SampleCount) && (a.Position == b.Position);
+			});
+		settings.RayRotationSeed = Renderer::BAKE_GATHER_COUNT + 1;
+		const auto stats = loadedTracer.TraceProbes(scene, probePositions, settings);
+
+		const auto& header = bakedProbeFile.GetHeader();
+		const auto& irradianceEntry = header.Sections[static_cast<size_t>(Renderer::BakedProbeSection::IrradianceAtlas)];
+		const auto& visibilityEntry = header.Sections[static_cast<size_t>(Renderer::BakedProbeSection::VisibilityAtlas)];
+		output << (compression == Renderer::BakedProbeCompression::None ? "Uncompressed  " : "Compressed  ") <<
+			"File (KB): " << (bakedProbeFile.GetFileSize() / 1024) <<
+			"  Atlas compression (irradiance/visibility): " << (static_cast<double>(irradianceEntry.UncompressedSize) / irradianceEntry.Size) << "x/" <<
+			(static_cast<double>(visibilityEntry.UncompressedSize) / visibilityEntry.Size) << "x" <<
+			"  Save (ms): " << saveMilliseconds <<
+			"  Read whole file (ms): " << readMilliseconds << " for " << (fileBytes.size() / 1024) << " KB" <<
+			"  Open (ms): " << openMilliseconds <<
+			"  Copy to upload (ms): " << copyMilliseconds <<
+			"  Unpack to float (ms): " << unpackMilliseconds <<
+			"  Startup against baking (x faster): " << (bakeMilliseconds / (openMilliseconds + copyMilliseconds)) << "\n";
+		output << "  Irradiance error after load: " << (loadedError * 100.0) << "%" <<
+			"  History kept: " << (statisticsMatch ? "yes" : "no") <<
+			"  Mean change of the next gather: " << stats.MeanChange <<
+			"  Probes restarted by the next gather: " << stats.RestartedProbeCount << "\n";
+	}
+	output << "Pack (ms): " << packMilliseconds << "\n";
+
+	// The same gather continuing the probes that were never saved, which the loaded probes should match
+	settings.RayRotationSeed = Renderer::BAKE_GATHER_COUNT + 1;
+	const auto bakedStats = bakedTracer.TraceProbes(scene, probePositions, settings);
+	output << "Without save and load  Mean change of the next gather: " << bakedStats.MeanChange <<
+		"  Probes restarted by the next gather: " << bakedStats.RestartedProbeCount << "\n";
+
+	// Worst relative round trip error of the packed formats over the range of the atlases
+	float irradianceError = 0.0f;
+	float visibilityError = 0.0f;
+	for (float value = 1.0e-3f; value < 1.0e3f; value *= 1.01f)
+	{
+		irradianceError = std::max(irradianceError, std::abs(Math::UnpackR11G11B10Float(Math::PackR11G11B10Float(glm::vec3(value))).z - value) / value);
+		visibilityError = std::max(visibilityError, std::abs(Math::UnpackR16G16Float(Math::PackR16G16Float(glm::vec2(value))).x - value) / value);
+	}
+	output << "Worst relative packing error (R11G11B10 blue/R16G16): " << irradianceError << "/" << visibilityError << "\n";
+
+	std::filesystem::remove(path);
+}
@@ -0,0 +1,131 @@
+#include "CpuPch.h"
+#include "Benchmark.h"
+#include "Renderer/ProbePool.h"
+#include "Renderer/CPU/ProbeShading.h"
+#include "Renderer/CPU/ProbeTracer.h"
+
+namespace
+{
+	// Port of the previous Irradiance() loop in Shaders/PixelShader.hlsl, which weighted every probe by distance and orientation
+	glm::vec3 IrradianceAllProbes(const Renderer::CPU::ProbeShadingInputs& inputs, const glm::vec3& shadingPoint, const glm::vec3& shadingPointNormal)
+	{
+		const glm::vec3 normal = glm::normalize(shadingPointNormal);
+		const auto& irradianceAtlas = *inputs.pIrradianceAtlas;
+		const uint32_t probesPerRow = inputs.pAtlasLayout->GetProbesPerRow();
+		const glm::vec2 irradianceAtlasDimensions = glm::vec2(inputs.pAtlasLayout->GetIrradianceAtlasDimensions());
+		glm::vec3 sumIrradiance = glm::vec3(0.0f, 0.0f, 0.0f);
+		for (uint32_t i = 0; i < static_cast<uint32_t>(inputs.pProbePositions->size()); ++i)
+		{
+			if ((*inputs.pProbeStates)[i] != static_cast<uint32_t>(Renderer::ProbeState::Active))
+			{
+				continue;
+			}
+
+			const glm::vec3 pointToProbe = glm::vec3((*inputs.pProbePositions)[i]) - shadingPoint;
+			const float distance = glm::length(pointToProbe);
+			const glm::vec3 direction = glm::normalize(pointToProbe);
+			const glm::vec2 irradianceTexelIndex = Renderer::CPU::GetProbeTexelCoordinate(direction, i, probesPerRow,
+				static_cast<float>(Renderer::IRRADIANCE_PROBE_SIDE_LENGTH), Renderer::PROBE_PADDING);
+			const glm::vec3 probeIrradiance = irradianceAtlas.SampleLinear(irradianceTexelIndex / irradianceAtlasDimensions);
+
+			float weight = 1.0f / std::max(distance, 0.001f);
+			weight *= std::max(0.0f, glm::dot(normal, direction));
+			weight *= std::min(distance, 1.0f);
+			sumIrradiance += weight * probeIrradiance;
+		}
+		return sumIrradiance;
+	}
+}
+
+void Benchmark::ProbeCageIrradiance(std::ostream& output)
+{
+	constexpr float probeSpacing = 0.5f;
+	constexpr size_t pointCount = 1 << 16;
+	for (const glm::ivec3 probeCounts : { glm::ivec3(5, 5, 5), glm::ivec3(10, 10, 10), glm::ivec3(20, 20, 25) })
+	{
+		Renderer::ProbePool pool;
+		pool.AddVolume(Renderer::ProbeVolume(glm::vec3(0.0f), glm::vec3(probeCounts) * probeSpacing, probeSpacing, 0.05f));
+		const auto& volume = pool.GetVolume(0);
+		const uint32_t probeCount = pool.GetTotalProbeCount();
+		std::vector<Renderer::ProbeVolumeData> volumeData;
+		pool.GetVolumeData(volumeData);
+
+		// Some probes are inactive, as classification leaves them
+		std::mt19937 generator(14);
+		std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+		std::vector<uint32_t> probeStates(probeCount);
+		for (auto& state : probeStates)
+		{
+			state = static_cast<uint32_t>(distribution(generator) < 0.05f ? Renderer::ProbeState::Inactive : Renderer::ProbeState::Active);
+		}
+
+		// Atlases laid out for every probe, with geometry at random distances around each probe
+		const Renderer::ProbeAtlasLayout atlasLayout(probeCount, probeCounts);
+		Renderer::CPU::Texture2D<glm::vec3> irradianceAtlas(atlasLayout.GetIrradianceAtlasDimensions().x, atlasLayout.GetIrradianceAtlasDimensions().y);
+		Renderer::CPU::Texture2D<glm::vec2> visibilityAtlas(atlasLayout.GetVisibilityAtlasDimensions().x, atlasLayout.GetVisibilityAtlasDimensions().y);
+		for (size_t i = 0; i < visibilityAtlas.GetTexelCount(); ++i)
+		{
+			const float distance = 0.1f + distribution(generator) * Renderer::PROBE_MAX_RAY_DISTANCE;
+			visibilityAtlas.GetData()[i] = glm::vec2(distance, distance * distance);
+		}
+
+		Renderer::CPU::ProbeShadingInputs inputs = {};
+		inputs.pVolumeData = &volumeData;
+		inputs.pProbePositions = &volume.GetProbePositions();
+		inputs.pProbeStates = &probeStates;
+		inputs.pAtlasLayout = &atlasLayout;
+		inputs.pIrradianceAtlas = &irradianceAtlas;
+		inputs.pVisibilityAtlas = &visibilityAtlas;
+
+		// Shading points inside the probe grid with random normals
+		const glm::vec3 gridOrigin = glm::vec3(volumeData[0].GridOriginAndSpacing);
+		const glm::vec3 gridSize = glm::vec3(probeCounts - 1) * probeSpacing;
+		std::vector<glm::vec3> points(pointCount);
+		std::vector<glm::vec3> normals(pointCount);
+		for (size_t p = 0; p < pointCount; ++p)
+		{
+			points[p] = gridOrigin + glm::vec3(distribution(generator), distribution(generator), distribution(generator)) * gridSize;
+			normals[p] = Renderer::CPU::SphericalFibonacci(distribution(generator) * 255.0f, 256.0f);
+		}
+
+		// Every probe seeing the same irradiance must light every point with it, whichever probes are skipped or down weighted
+		const glm::vec3 constantIrradiance = glm::vec3(0.25f, 0.5f, 0.75f);
+		irradianceAtlas.Clear(constantIrradiance);
+		float maxConstantError = 0.0f;
+		for (size_t p = 0; p < pointCount; ++p)
+		{
+			const glm::vec3 error = glm::abs(Renderer::CPU::Irradiance(inputs, points[p], normals[p]) - constantIrradiance);
+			maxConstantError = std::max(maxConstantError, std::max(error.x, std::max(error.y, error.z)));
+		}
+
+		for (size_t i = 0; i < irradianceAtlas.GetTexelCount(); ++i)
+		{
+			irradianceAtlas.GetData()[i] = glm::vec3(distribution(generator), distribution(generator), distribution(generator));
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		glm::vec3 checksum = glm::vec3(0.0f);
+		for (size_t p = 0; p < pointCount; ++p)
+		{
+			checksum += Renderer::CPU::Irradiance(inputs, points[p], normals[p]);
+		}
+		const double cageMilliseconds = GetElapsedMilliseconds(start);
+
+		// The loop over every probe is timed on a slice of the points
+		const size_t loopPointCount = std::min(pointCount, static_cast<size_t>((1 << 20) / probeCount));
+		start = std::chrono::high_resolution_clock::now();
+		for (size_t p = 0; p < loopPointCount; ++p)
+		{
+			checksum += IrradianceAllProbes(inputs, points[p], normals[p]);
+		}
+		const double loopMilliseconds = GetElapsedMilliseconds(start);
+
+		const double loopNanoseconds = loopMilliseconds * 1e6 / loopPointCount;
+		const double cageNanoseconds = cageMilliseconds * 1e6 / pointCount;
+		output << "Probes: " << probeCount << "  Shading points: " << pointCount <<
+			"  Irradiance (ns per point, all probes/cage): " << loopNanoseconds << "/" << cageNanoseconds <<
+			"  Speedup: " << (loopNanoseconds / cageNanoseconds) <<
+			"  Max constant field error: " << maxConstantError <<
+			"  Checksum: " << static_cast<uint64_t>(checksum.x + checksum.y + checksum.z) % 1000 << "\n";
+	}
+}
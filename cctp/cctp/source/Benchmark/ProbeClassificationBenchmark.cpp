@@ -0,0 +1,48 @@
+#include "CpuPch.h"
+#include "Benchmark.h"
+#include "Renderer/ProbeVolume.h"
+#include "Renderer/CPU/ProbeClassifier.h"
+#include "Renderer/CPU/ProbeTracer.h"
+#include "Renderer/CPU/RaytracingScene.h"
+#include "Scene/Scenes/DemoSceneLayout.h"
+#include "Threading/TaskScheduler.h"
+
+void Benchmark::ProbeClassification(std::ostream& output)
+{
+	DemoSceneFixture demoScene;
+	CreateDemoScene(demoScene);
+	const auto& scene = demoScene.Scene;
+
+	// The demo scene volume, then denser volumes over the same space
+	output << "Threads: 1\n";
+	for (const float spacing : { DemoSceneLayout::PROBE_VOLUME_PROBE_SPACING, 0.83f, 0.7f })
+	{
+		Renderer::ProbeVolume volume = CreateDemoProbeVolume(spacing);
+		std::vector<uint32_t> probeIndices(volume.GetTotalProbeCount());
+		std::iota(probeIndices.begin(), probeIndices.end(), 0);
+
+		Threading::TaskScheduler scheduler(1);
+		Renderer::CPU::ProbeClassificationSettings classificationSettings = {};
+		classificationSettings.pTaskScheduler = &scheduler;
+		auto probeStates = volume.GetProbeStates();
+		const auto classificationStats = Renderer::CPU::ClassifyProbes(scene, volume.GetProbePositions(), probeIndices, classificationSettings, probeStates);
+		volume.SetProbeStates(probeStates);
+
+		// Trace every probe, then only the active ones
+		Renderer::CPU::ProbeTraceSettings traceSettings = {};
+		traceSettings.LightDirectionWS = DemoSceneLayout::DEFAULT_LIGHT_DIRECTION_WS;
+		traceSettings.pTaskScheduler = &scheduler;
+		Renderer::CPU::ProbeTracer tracer;
+		const auto allStats = tracer.TraceProbes(scene, volume.GetProbePositions(), traceSettings);
+		traceSettings.pProbeStates = &volume.GetProbeStates();
+		const auto activeStats = tracer.TraceProbes(scene, volume.GetProbePositions(), traceSettings);
+
+		output << "Probes: " << volume.GetTotalProbeCount() << "  Spacing: " << spacing <<
+			"  Classify (ms): " << classificationStats.Milliseconds <<
+			"  Inside geometry: " << classificationStats.InsideGeometryCount <<
+			"  Far from surfaces: " << classificationStats.FarFromSurfaceCount <<
+			"  Rays per update (all/active): " << allStats.RayCount << "/" << activeStats.RayCount <<
+			"  Rays saved: " << activeStats.SkippedRayCount <<
+			"  Update (ms, all/active): " << allStats.GetTotalMilliseconds() << "/" << activeStats.GetTotalMilliseconds() << "\n";
+	}
+}
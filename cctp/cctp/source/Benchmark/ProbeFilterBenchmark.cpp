@@ -0,0 +1,233 @@
+#include "CpuPch.h"
+#include "Benchmark.h"
+#include "Math/Octahedral.h"
+#include "Renderer/ProbeRayTable.h"
+#include "Renderer/ProbeVolume.h"
+#include "Renderer/CPU/ProbeFilter.h"
+#include "Renderer/CPU/ProbeTracer.h"
+#include "Renderer/CPU/RaytracingScene.h"
+#include "Scene/Scenes/DemoSceneLayout.h"
+#include "Threading/TaskScheduler.h"
+
+namespace
+{
+	// FilterIrradianceTexel in Shaders/RayGen.hlsl, which filters every texel of the tile, borders included, from the rays in place of copying the borders
+	glm::vec3 FilterTexel(const glm::vec4* pRayData, const glm::vec3* pRayDirections, const glm::ivec2& texel, const int32_t sideLength)
+	{
+		const glm::vec3 texelDirection = Renderer::CPU::GetProbeTexelDirection(texel, sideLength);
+		glm::vec3 sumRadiance = glm::vec3(0.0f);
+		float sumWeight = 0.0f;
+		for (uint32_t r = 0; r < Renderer::PROBE_RAY_COUNT; ++r)
+		{
+			const float weight = std::max(glm::dot(texelDirection, pRayDirections[r]), 0.0f);
+			sumRadiance += weight * glm::vec3(pRayData[r]);
+			sumWeight += weight;
+		}
+		return sumWeight > 0.0f ? sumRadiance / sumWeight : glm::vec3(0.0f);
+	}
+
+	// A smooth function of direction, offset per probe so neighbouring tiles hold different values
+	glm::vec3 TestSignal(const glm::vec3& direction, const uint32_t p)
+	{
+		return glm::vec3(0.5f) + (0.5f * direction) + glm::vec3(static_cast<float>(p % 4));
+	}
+}
+
+void Benchmark::ProbeGatherFilter(std::ostream& output)
+{
+	constexpr auto irradianceSideLength = static_cast<int32_t>(Renderer::IRRADIANCE_PROBE_SIDE_LENGTH);
+	constexpr auto visibilitySideLength = static_cast<int32_t>(Renderer::VISIBILITY_PROBE_SIDE_LENGTH);
+	const glm::ivec3 probeCounts = glm::ivec3(16, 16, 4);
+	const auto probeCount = static_cast<uint32_t>(probeCounts.x * probeCounts.y * probeCounts.z);
+	const Renderer::ProbeAtlasLayout atlasLayout(probeCount, probeCounts);
+	const uint32_t probesPerRow = atlasLayout.GetProbesPerRow();
+	const glm::uvec2 irradianceDimensions = atlasLayout.GetIrradianceAtlasDimensions();
+	const glm::uvec2 visibilityDimensions = atlasLayout.GetVisibilityAtlasDimensions();
+	std::vector<glm::ivec2> irradianceTopLefts(probeCount);
+	std::vector<glm::ivec2> visibilityTopLefts(probeCount);
+	for (uint32_t p = 0; p < probeCount; ++p)
+	{
+		irradianceTopLefts[p] = glm::ivec2(Renderer::CPU::GetProbeTopLeftPosition(p, probesPerRow, static_cast<float>(irradianceSideLength), Renderer::PROBE_PADDING));
+		visibilityTopLefts[p] = glm::ivec2(Renderer::CPU::GetProbeTopLeftPosition(p, probesPerRow, static_cast<float>(visibilitySideLength), Renderer::PROBE_PADDING));
+	}
+
+	// Rays of random radiance and distances, traced under each probe's rotation of the ray table
+	std::mt19937 generator(22);
+	std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+	const Renderer::ProbeRayTable& rayTable = Renderer::GetProbeRayTable();
+	std::vector<glm::vec4> rayData(static_cast<size_t>(probeCount) * Renderer::PROBE_RAY_COUNT);
+	std::vector<glm::vec3> rayDirections(rayData.size());
+	for (size_t i = 0; i < rayData.size(); ++i)
+	{
+		const auto p = static_cast<uint32_t>(i / Renderer::PROBE_RAY_COUNT);
+		const auto r = static_cast<uint32_t>(i % Renderer::PROBE_RAY_COUNT);
+		rayData[i] = glm::vec4(distribution(generator), distribution(generator), distribution(generator), distribution(generator) * Renderer::PROBE_MAX_RAY_DISTANCE);
+		rayDirections[i] = rayTable.GetRay(Renderer::GetProbeRayRotationIndex(1, p), r).Direction;
+	}
+
+	// Single thread cost per probe. The filter stage runs a thread per texel
+	constexpr uint32_t REPEAT_COUNT = 8;
+	Renderer::CPU::Texture2D<glm::vec3> irradianceFiltered(irradianceDimensions.x, irradianceDimensions.y);
+	Renderer::CPU::Texture2D<glm::vec2> visibilityFiltered(visibilityDimensions.x, visibilityDimensions.y);
+	double irradianceMilliseconds = 0.0;
+	double visibilityMilliseconds = 0.0;
+	double borderMilliseconds = 0.0;
+	for (uint32_t r = 0; r < REPEAT_COUNT; ++r)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t p = 0; p < probeCount; ++p)
+		{
+			const size_t firstRay = static_cast<size_t>(p) * Renderer::PROBE_RAY_COUNT;
+			Renderer::CPU::FilterProbeRays(rayData.data() + firstRay, rayDirections.data() + firstRay, Renderer::PROBE_RAY_COUNT, irradianceFiltered,
+				irradianceTopLefts[p], Renderer::IRRADIANCE_PROBE_SIDE_LENGTH);
+		}
+		irradianceMilliseconds += GetElapsedMilliseconds(start);
+
+		start = std::chrono::high_resolution_clock::now();
+		for (uint32_t p = 0; p < probeCount; ++p)
+		{
+			const size_t firstRay = static_cast<size_t>(p) * Renderer::PROBE_RAY_COUNT;
+			Renderer::CPU::FilterProbeRays(rayData.data() + firstRay, rayDirections.data() + firstRay, Renderer::PROBE_RAY_COUNT, visibilityFiltered,
+				visibilityTopLefts[p], Renderer::VISIBILITY_PROBE_SIDE_LENGTH);
+		}
+		visibilityMilliseconds += GetElapsedMilliseconds(start);
+
+		start = std::chrono::high_resolution_clock::now();
+		for (uint32_t p = 0; p < probeCount; ++p)
+		{
+			Renderer::CPU::CopyProbeTileBorder(irradianceFiltered, irradianceTopLefts[p], Renderer::IRRADIANCE_PROBE_SIDE_LENGTH);
+			Renderer::CPU::CopyProbeTileBorder(visibilityFiltered, visibilityTopLefts[p], Renderer::VISIBILITY_PROBE_SIDE_LENGTH);
+		}
+		borderMilliseconds += GetElapsedMilliseconds(start);
+	}
+	const double nanosecondsPerProbe = 1.0e6 / (static_cast<double>(probeCount) * REPEAT_COUNT);
+	constexpr int32_t visibilityTileSideLength = visibilitySideLength + 2 * static_cast<int32_t>(Renderer::PROBE_PADDING);
+	output << "Probes: " << probeCount << "  Rays per probe: " << Renderer::PROBE_RAY_COUNT << "  Visibility sharpness: " << Renderer::PROBE_VISIBILITY_SHARPNESS <<
+		"  GPU threads per probe: " << (visibilityTileSideLength * visibilityTileSideLength) << "\n";
+	output << "Single thread (ns per probe)  Irradiance filter with borders: " << (irradianceMilliseconds * nanosecondsPerProbe) <<
+		"  Visibility filter with borders: " << (visibilityMilliseconds * nanosecondsPerProbe) <<
+		"  Border copy alone: " << (borderMilliseconds * nanosecondsPerProbe) << "\n";
+
+	// The filter and border copy against the per texel filter the shader makes, borders included
+	float maxShaderDifference = 0.0f;
+	for (uint32_t p = 0; p < probeCount; ++p)
+	{
+		const size_t firstRay = static_cast<size_t>(p) * Renderer::PROBE_RAY_COUNT;
+		for (int32_t y = -static_cast<int32_t>(Renderer::PROBE_PADDING); y < irradianceSideLength + static_cast<int32_t>(Renderer::PROBE_PADDING); ++y)
+		{
+			for (int32_t x = -static_cast<int32_t>(Renderer::PROBE_PADDING); x < irradianceSideLength + static_cast<int32_t>(Renderer::PROBE_PADDING); ++x)
+			{
+				const glm::vec3 texel = FilterTexel(rayData.data() + firstRay, rayDirections.data() + firstRay, glm::ivec2(x, y), irradianceSideLength);
+				const glm::vec3 difference = glm::abs(texel - irradianceFiltered.Load(irradianceTopLefts[p].x + x, irradianceTopLefts[p].y + y));
+				maxShaderDifference = std::max({ maxShaderDifference, difference.x, difference.y, difference.z });
+			}
+		}
+	}
+	output << "Max difference from the shader's per texel filter: " << maxShaderDifference << "\n";
+
+	// Seams. Tiles hold a smooth function of direction at their texel centres, and bilinear samples in random directions are compared against it,
+	// with the borders left unfilled and with the borders copied. Samples within a texel of an edge read the border
+	{
+		Renderer::CPU::Texture2D<glm::vec3> atlas(irradianceDimensions.x, irradianceDimensions.y);
+		const float sideLength = static_cast<float>(irradianceSideLength);
+		for (uint32_t p = 0; p < probeCount; ++p)
+		{
+			for (int32_t y = 0; y < irradianceSideLength; ++y)
+			{
+				for (int32_t x = 0; x < irradianceSideLength; ++x)
+				{
+					const glm::vec2 octCoord = ((glm::vec2(static_cast<float>(x), static_cast<float>(y)) + 0.5f) / sideLength) * 2.0f - 1.0f;
+					atlas.Store(irradianceTopLefts[p].x + x, irradianceTopLefts[p].y + y, TestSignal(Math::OctDecode(octCoord), p));
+				}
+			}
+		}
+
+		constexpr size_t sampleCount = 1 << 18;
+		std::uniform_int_distribution<uint32_t> probeDistribution(0, probeCount - 1);
+		std::uniform_real_distribution<float> directionDistribution(-1.0f, 1.0f);
+		std::vector<uint32_t> sampleProbes(sampleCount);
+		std::vector<glm::vec3> sampleDirections(sampleCount);
+		for (size_t i = 0; i < sampleCount; ++i)
+		{
+			sampleProbes[i] = probeDistribution(generator);
+			sampleDirections[i] = glm::normalize(glm::vec3(directionDistribution(generator), directionDistribution(generator), directionDistribution(generator)) +
+				glm::vec3(0.0f, 0.0f, 1.0e-3f));
+		}
+
+		const glm::vec2 atlasDimensions = glm::vec2(irradianceDimensions);
+		for (const bool copyBorders : { false, true })
+		{
+			if (copyBorders)
+			{
+				for (uint32_t p = 0; p < probeCount; ++p)
+				{
+					Renderer::CPU::CopyProbeTileBorder(atlas, irradianceTopLefts[p], Renderer::IRRADIANCE_PROBE_SIDE_LENGTH);
+				}
+			}
+
+			double sumInteriorError = 0.0;
+			double sumEdgeError = 0.0;
+			float maxInteriorError = 0.0f;
+			float maxEdgeError = 0.0f;
+			size_t edgeSampleCount = 0;
+			for (size_t i = 0; i < sampleCount; ++i)
+			{
+				const uint32_t p = sampleProbes[i];
+				const glm::vec2 texelCoordinate = Renderer::CPU::GetProbeTexelCoordinate(sampleDirections[i], p, probesPerRow, sideLength, Renderer::PROBE_PADDING);
+				const glm::vec3 sample = atlas.SampleLinear(texelCoordinate / atlasDimensions);
+				const float error = glm::length(sample - TestSignal(sampleDirections[i], p));
+
+				// Bilinear taps leave the square within half a texel of an edge
+				const glm::vec2 local = texelCoordinate - glm::vec2(irradianceTopLefts[p]);
+				const bool nearEdge = glm::min(local.x, local.y) < 0.5f || glm::max(local.x, local.y) > sideLength - 0.5f;
+				if (nearEdge)
+				{
+					sumEdgeError += error;
+					maxEdgeError = std::max(maxEdgeError, error);
+					++edgeSampleCount;
+				}
+				else
+				{
+					sumInteriorError += error;
+					maxInteriorError = std::max(maxInteriorError, error);
+				}
+			}
+			output << (copyBorders ? "Borders copied  " : "Borders unfilled") <<
+				"  Interior error mean/max: " << (sumInteriorError / static_cast<double>(sampleCount - edgeSampleCount)) << "/" << maxInteriorError <<
+				"  Edge error mean/max: " << (edgeSampleCount > 0 ? sumEdgeError / static_cast<double>(edgeSampleCount) : 0.0) << "/" << maxEdgeError <<
+				"  Edge samples: " << edgeSampleCount << "\n";
+		}
+	}
+
+	// The filter stage of the CPU reference on the demo scene, single threaded and across every hardware thread
+	DemoSceneFixture demoScene;
+	CreateDemoScene(demoScene);
+	const auto& scene = demoScene.Scene;
+
+	const Renderer::ProbeVolume volume = CreateDemoProbeVolume();
+	const auto& probePositions = volume.GetProbePositions();
+	constexpr uint32_t GATHER_COUNT = 8;
+	for (const uint32_t threadCount : { 1u, 0u })
+	{
+		Threading::TaskScheduler scheduler(threadCount);
+		Renderer::CPU::ProbeTraceSettings settings = {};
+		settings.LightDirectionWS = DemoSceneLayout::DEFAULT_LIGHT_DIRECTION_WS;
+		settings.pTaskScheduler = &scheduler;
+		Renderer::CPU::ProbeTracer tracer;
+		Renderer::CPU::ProbeTraceStats totals = {};
+		for (uint32_t g = 0; g < GATHER_COUNT; ++g)
+		{
+			settings.RayRotationSeed = g + 1;
+			const auto stats = tracer.TraceProbes(scene, probePositions, settings);
+			totals.ThreadCount = stats.ThreadCount;
+			totals.TraceMilliseconds += stats.TraceMilliseconds;
+			totals.FilterMilliseconds += stats.FilterMilliseconds;
+			totals.BlendMilliseconds += stats.BlendMilliseconds;
+		}
+		const double microsecondsPerProbe = 1000.0 / (static_cast<double>(probePositions.size()) * GATHER_COUNT);
+		output << "Demo scene  Probes: " << probePositions.size() << "  Threads: " << totals.ThreadCount <<
+			"  Per probe (us) trace/filter/blend: " << (totals.TraceMilliseconds * microsecondsPerProbe) << "/" <<
+			(totals.FilterMilliseconds * microsecondsPerProbe) << "/" << (totals.BlendMilliseconds * microsecondsPerProbe) <<
+			"  Filter share: " << (100.0 * totals.FilterMilliseconds / totals.GetTotalMilliseconds()) << "%\n";
+	}
+}
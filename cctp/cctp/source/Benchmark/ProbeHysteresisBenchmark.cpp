@@ -0,0 +1,116 @@
+#include "CpuPch.h"
+#include "Benchmark.h"
+#include "Renderer/ProbeVolume.h"
+#include "Renderer/ProbeStatistics.h"
+#include "Renderer/CPU/ProbeTracer.h"
+#include "Renderer/CPU/RaytracingScene.h"
+#include "Scene/Scenes/DemoSceneLayout.h"
+
+namespace
+{
+	// Mean absolute luminance difference of the irradiance atlases, relative to the mean luminance of the reference
+	double MeasureAtlasError(const Renderer::CPU::Texture2D<glm::vec3>& atlas, const Renderer::CPU::Texture2D<glm::vec3>& reference)
+	{
+		double sumDifference = 0.0;
+		double sumReference = 0.0;
+		for (size_t i = 0; i < reference.GetTexelCount(); ++i)
+		{
+			const float luminance = Renderer::CPU::Luminance(atlas.GetData()[i]);
+			const float referenceLuminance = Renderer::CPU::Luminance(reference.GetData()[i]);
+			sumDifference += std::abs(luminance - referenceLuminance);
+			sumReference += referenceLuminance;
+		}
+		return sumReference > 0.0 ? sumDifference / sumReference : 0.0;
+	}
+}
+
+void Benchmark::ProbeHysteresis(std::ostream& output)
+{
+	DemoSceneFixture demoScene;
+	CreateDemoScene(demoScene);
+	const auto& scene = demoScene.Scene;
+
+	const Renderer::ProbeVolume volume = CreateDemoProbeVolume();
+	const auto& probePositions = volume.GetProbePositions();
+	const glm::vec3 movedLightDirectionWS = glm::vec3(0.5f, -0.6f, -0.4f);
+	constexpr uint32_t WARM_UP_GATHER_COUNT = 20;
+	constexpr uint32_t FLICKER_GATHER_COUNT = 100;
+	constexpr uint32_t MAX_ADAPT_GATHER_COUNT = 100;
+	constexpr double CONVERGED_ERROR = 0.05;
+	constexpr float CONVERGED_CHANGE = 0.02f;
+
+	output << "Probes: " << volume.GetTotalProbeCount() << "  Rays per probe: " << Renderer::PROBE_RAY_COUNT << "\n";
+	for (const float hysteresis : { 0.0f, 0.9f, 0.97f })
+	{
+		Renderer::CPU::ProbeTraceSettings settings = {};
+		settings.LightDirectionWS = DemoSceneLayout::DEFAULT_LIGHT_DIRECTION_WS;
+		settings.Blend.Hysteresis = hysteresis;
+
+		// Light intensity jittering by up to 20% each gather stands in for the noise of too few rays. The spread of the mean probe luminance over
+		// the gathers is the flicker the blend leaves
+		Renderer::CPU::ProbeTracer tracer;
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> jitter(0.8f, 1.2f);
+		std::vector<double> meanLuminances;
+		double updateMilliseconds = 0.0;
+		for (uint32_t g = 0; g < WARM_UP_GATHER_COUNT + FLICKER_GATHER_COUNT; ++g)
+		{
+			settings.LightIntensity = jitter(random);
+			updateMilliseconds += tracer.TraceProbes(scene, probePositions, settings).GetTotalMilliseconds();
+			if (g >= WARM_UP_GATHER_COUNT)
+			{
+				const auto summary = Renderer::SummarizeProbeStatistics(tracer.GetProbeStatistics().data(), probePositions.size(), CONVERGED_CHANGE);
+				meanLuminances.push_back(std::accumulate(tracer.GetProbeStatistics().begin(), tracer.GetProbeStatistics().begin() + probePositions.size(), 0.0,
+					[](const double sum, const Renderer::ProbeStatistics& statistics) { return sum + statistics.MeanLuminance; }) / summary.ProbeCount);
+			}
+		}
+		const double mean = std::accumulate(meanLuminances.begin(), meanLuminances.end(), 0.0) / meanLuminances.size();
+		const double variance = std::accumulate(meanLuminances.begin(), meanLuminances.end(), 0.0,
+			[mean](const double sum, const double luminance) { return sum + (luminance - mean) * (luminance - mean); }) / meanLuminances.size();
+		const auto jitteredSummary = Renderer::SummarizeProbeStatistics(tracer.GetProbeStatistics().data(), probePositions.size(), CONVERGED_CHANGE);
+
+		// Settle under a steady light, then move the light and count the gathers until the atlas is within the converged error of gathering without
+		// a history through the same light changes, with and without fast adaptation to large changes
+		uint32_t adaptGatherCounts[2] = {};
+		size_t convergedProbeCount = 0;
+		size_t restartedProbeCount = 0;
+		for (const bool fastAdaptation : { true, false })
+		{
+			settings.LightIntensity = 1.0f;
+			settings.LightDirectionWS = DemoSceneLayout::DEFAULT_LIGHT_DIRECTION_WS;
+			settings.Blend.ChangeThreshold = fastAdaptation ? Renderer::PROBE_CHANGE_THRESHOLD : std::numeric_limits<float>::max();
+			Renderer::CPU::ProbeTraceSettings referenceSettings = settings;
+			referenceSettings.Blend.Hysteresis = 0.0f;
+			Renderer::CPU::ProbeTracer adaptTracer;
+			Renderer::CPU::ProbeTracer referenceTracer;
+			for (uint32_t g = 0; g < WARM_UP_GATHER_COUNT; ++g)
+			{
+				adaptTracer.TraceProbes(scene, probePositions, settings);
+				referenceTracer.TraceProbes(scene, probePositions, referenceSettings);
+			}
+			convergedProbeCount = Renderer::SummarizeProbeStatistics(adaptTracer.GetProbeStatistics().data(), probePositions.size(), CONVERGED_CHANGE).ConvergedProbeCount;
+
+			settings.LightDirectionWS = movedLightDirectionWS;
+			referenceSettings.LightDirectionWS = movedLightDirectionWS;
+			uint32_t& gatherCount = adaptGatherCounts[fastAdaptation ? 0 : 1];
+			while (gatherCount < MAX_ADAPT_GATHER_COUNT &&
+				(gatherCount == 0 || MeasureAtlasError(adaptTracer.GetIrradianceAtlas(), referenceTracer.GetIrradianceAtlas()) > CONVERGED_ERROR))
+			{
+				const auto stats = adaptTracer.TraceProbes(scene, probePositions, settings);
+				referenceTracer.TraceProbes(scene, probePositions, referenceSettings);
+				restartedProbeCount += (fastAdaptation && gatherCount == 0) ? stats.RestartedProbeCount : 0;
+				++gatherCount;
+			}
+		}
+
+		output << "Hysteresis: " << hysteresis <<
+			"  Flicker under 20% jitter (relative std dev): " << (std::sqrt(variance) / mean) <<
+			"  Mean change: " << jitteredSummary.MeanChange <<
+			"  Mean luminance variance: " << jitteredSummary.MeanLuminanceVariance <<
+			"  Converged under a steady light: " << convergedProbeCount << "/" << jitteredSummary.ProbeCount <<
+			"  Restarted by the light move: " << restartedProbeCount <<
+			"  Gathers to adapt to a moved light (fast adaptation/hysteresis only, " << MAX_ADAPT_GATHER_COUNT << " is never): " <<
+			adaptGatherCounts[0] << "/" << adaptGatherCounts[1] <<
+			"  Update (ms per gather): " << (updateMilliseconds / (WARM_UP_GATHER_COUNT + FLICKER_GATHER_COUNT)) << "\n";
+	}
+}
@@ -0,0 +1,173 @@
+#include "CpuPch.h"
+#include "Benchmark.h"
+#include "Math/Math.h"
+#include "Renderer/ProbePool.h"
+#include "Renderer/ProbeUpdateScheduler.h"
+#include "Renderer/CPU/ProbeTracer.h"
+#include "Renderer/CPU/RaytracingScene.h"
+#include "Scene/Scenes/DemoSceneLayout.h"
+
+namespace
+{
+	// Mean irradiance over the square of each probe's atlas tile
+	void GetTileMeans(const Renderer::CPU::ProbeTracer& tracer, const size_t probeCount, std::vector<glm::vec3>& means)
+	{
+		const uint32_t probesPerRow = tracer.GetAtlasLayout().GetProbesPerRow();
+		means.assign(probeCount, glm::vec3(0.0f));
+		for (uint32_t p = 0; p < static_cast<uint32_t>(probeCount); ++p)
+		{
+			const glm::ivec2 topLeft = glm::ivec2(Renderer::CPU::GetProbeTopLeftPosition(p, probesPerRow, static_cast<float>(Renderer::IRRADIANCE_PROBE_SIDE_LENGTH),
+				Renderer::PROBE_PADDING));
+			for (int32_t y = 0; y < static_cast<int32_t>(Renderer::IRRADIANCE_PROBE_SIDE_LENGTH); ++y)
+			{
+				for (int32_t x = 0; x < static_cast<int32_t>(Renderer::IRRADIANCE_PROBE_SIDE_LENGTH); ++x)
+				{
+					means[p] += tracer.GetIrradianceAtlas().Load(topLeft.x + x, topLeft.y + y);
+				}
+			}
+			means[p] /= static_cast<float>(Renderer::IRRADIANCE_PROBE_SIDE_LENGTH * Renderer::IRRADIANCE_PROBE_SIDE_LENGTH);
+		}
+	}
+
+	// Mean difference of the probes' tile means from the reference over the probes with the given flag, relative to the mean irradiance of every probe in
+	// the lit scene. Closing the door darkens the room, so the error is not taken relative to the dark reference
+	double MeasureTileMeanError(const std::vector<glm::vec3>& means, const std::vector<glm::vec3>& referenceMeans, const std::vector<uint8_t>& flags,
+		const uint8_t flag, const double meanIrradiance)
+	{
+		double sumDifference = 0.0;
+		size_t probeCount = 0;
+		for (size_t p = 0; p < means.size(); ++p)
+		{
+			if (flags[p] == flag)
+			{
+				const glm::vec3 difference = glm::abs(means[p] - referenceMeans[p]);
+				sumDifference += (difference.x + difference.y + difference.z) / 3.0;
+				++probeCount;
+			}
+		}
+		return (probeCount > 0) && (meanIrradiance > 0.0) ? (sumDifference / probeCount / meanIrradiance) : 0.0;
+	}
+}
+
+void Benchmark::ProbeInvalidation(std::ostream& output)
+{
+	DemoSceneFixture demoScene;
+	CreateDemoScene(demoScene);
+	auto& scene = demoScene.Scene;
+
+	Renderer::ProbePool pool;
+	pool.AddVolume(DemoSceneLayout::CreateProbeVolume());
+	const auto& volume = pool.GetVolume(0);
+	const auto& probePositions = volume.GetProbePositions();
+	const size_t probeCount = probePositions.size();
+
+	Renderer::CPU::ProbeTraceSettings traceSettings = {};
+	traceSettings.LightDirectionWS = DemoSceneLayout::DEFAULT_LIGHT_DIRECTION_WS;
+	traceSettings.pProbeStates = &volume.GetProbeStates();
+
+	// Only changed probes are updated, with a budget that never holds them back, against the reference retracing every probe each frame
+	Renderer::ProbeUpdateSchedulerSettings scheduleSettings = {};
+	scheduleSettings.ChangeDriven = true;
+	scheduleSettings.RayBudget = static_cast<uint32_t>(probeCount * Renderer::PROBE_RAY_COUNT);
+	const glm::vec3 cameraPositionWS = glm::vec3(0.0f, 2.0f, -3.0f);
+	Renderer::ProbeUpdateScheduler scheduler;
+	Renderer::CPU::ProbeTracer tracer;
+	Renderer::CPU::ProbeTracer referenceTracer;
+	uint32_t frame = 0;
+	const auto traceFrame = [&](size_t& rayCount, size_t& referenceRayCount)
+		{
+			++frame;
+			traceSettings.RayRotationSeed = frame;
+			const auto& schedule = scheduler.Schedule(pool, cameraPositionWS, tracer.GetProbeStatistics().data(), tracer.GetProbeStatistics().size(),
+				scheduleSettings);
+			if (!schedule.ProbeIndices.empty())
+			{
+				rayCount += tracer.TraceProbes(scene, probePositions, schedule.ProbeIndices, traceSettings).RayCount;
+			}
+			referenceRayCount += referenceTracer.TraceProbes(scene, probePositions, traceSettings).RayCount;
+			return schedule.ProbeIndices.size();
+		};
+
+	// A static scene settles once every probe has converged, after which nothing is traced
+	constexpr uint32_t MAX_SETTLE_FRAMES = 100;
+	constexpr uint32_t STATIC_FRAMES = 20;
+	size_t rayCount = 0;
+	size_t referenceRayCount = 0;
+	uint32_t settleFrames = 0;
+	while ((traceFrame(rayCount, referenceRayCount) > 0) && (settleFrames < MAX_SETTLE_FRAMES))
+	{
+		++settleFrames;
+	}
+	size_t staticRayCount = 0;
+	size_t staticReferenceRayCount = 0;
+	for (uint32_t i = 0; i < STATIC_FRAMES; ++i)
+	{
+		traceFrame(staticRayCount, staticReferenceRayCount);
+	}
+
+	std::vector<glm::vec3> means;
+	std::vector<glm::vec3> referenceMeans;
+	const std::vector<uint8_t> allProbeFlags(probeCount, 0);
+	GetTileMeans(tracer, probeCount, means);
+	GetTileMeans(referenceTracer, probeCount, referenceMeans);
+	double meanIrradiance = 0.0;
+	for (const auto& mean : referenceMeans)
+	{
+		meanIrradiance += (mean.x + mean.y + mean.z) / 3.0;
+	}
+	meanIrradiance /= static_cast<double>(probeCount);
+	output << "Probes: " << probeCount << "  Frames to settle from reset: " << settleFrames << "  Rays (changed only/every probe): " << rayCount << "/" <<
+		referenceRayCount << "\n";
+	output << "Static scene over " << STATIC_FRAMES << " frames  Rays (changed only/every probe): " << staticRayCount << "/" << staticReferenceRayCount <<
+		"  Irradiance error against every probe retraced (noise floor): " << MeasureTileMeanError(means, referenceMeans, allProbeFlags, 0, meanIrradiance) << "\n";
+
+	// The door slides shut, invalidating the probes whose rays reach the bounds it swept through each frame or the shadow those bounds cast
+	constexpr uint32_t DOOR_INSTANCE_ID = 7;
+	constexpr uint32_t DOOR_FRAMES = 30;
+	Transform doorTransform = demoScene.Transforms[DOOR_INSTANCE_ID];
+	const float doorStartX = doorTransform.Position.x;
+	std::vector<uint8_t> reachedProbeFlags(probeCount, 0);
+	std::vector<uint32_t> changedProbeIndices;
+	size_t doorRayCount = 0;
+	size_t doorReferenceRayCount = 0;
+	size_t sumChangedProbeCount = 0;
+	size_t maxChangedProbeCount = 0;
+	double invalidateMilliseconds = 0.0;
+	for (uint32_t i = 1; i <= DOOR_FRAMES; ++i)
+	{
+		BoundingBox sweptBounds = scene.GetTopLevelBvh().GetInstanceBoundsWS(DOOR_INSTANCE_ID);
+		doorTransform.Position.x = doorStartX * (1.0f - static_cast<float>(i) / static_cast<float>(DOOR_FRAMES));
+		scene.SetInstanceTransform(DOOR_INSTANCE_ID, Math::CalculateWorldMatrix(doorTransform));
+		scene.Update();
+		sweptBounds.Grow(scene.GetTopLevelBvh().GetInstanceBoundsWS(DOOR_INSTANCE_ID));
+
+		const auto start = std::chrono::high_resolution_clock::now();
+		changedProbeIndices.clear();
+		pool.GetProbesAffectedBy(sweptBounds, traceSettings.LightDirectionWS, Renderer::PROBE_MAX_RAY_DISTANCE, changedProbeIndices);
+		scheduler.InvalidateProbes(changedProbeIndices);
+		invalidateMilliseconds += GetElapsedMilliseconds(start);
+
+		sumChangedProbeCount += changedProbeIndices.size();
+		maxChangedProbeCount = std::max(maxChangedProbeCount, changedProbeIndices.size());
+		for (const uint32_t p : changedProbeIndices)
+		{
+			reachedProbeFlags[p] = 1;
+		}
+		traceFrame(doorRayCount, doorReferenceRayCount);
+	}
+	uint32_t doorSettleFrames = 0;
+	while ((traceFrame(doorRayCount, doorReferenceRayCount) > 0) && (doorSettleFrames < MAX_SETTLE_FRAMES))
+	{
+		++doorSettleFrames;
+	}
+
+	GetTileMeans(tracer, probeCount, means);
+	GetTileMeans(referenceTracer, probeCount, referenceMeans);
+	const auto reachedProbeCount = std::count(reachedProbeFlags.begin(), reachedProbeFlags.end(), uint8_t(1));
+	output << "Door closing over " << DOOR_FRAMES << " frames  Probes invalidated per frame (mean/max/all): " << (sumChangedProbeCount / DOOR_FRAMES) << "/" <<
+		maxChangedProbeCount << "/" << probeCount << "  Probes reached by the door: " << reachedProbeCount <<
+		"  Invalidate (ms per frame): " << (invalidateMilliseconds / DOOR_FRAMES) << "  Frames to settle after: " << doorSettleFrames << "\n";
+	output << "Rays until settled (changed only/every probe): " << doorRayCount << "/" << doorReferenceRayCount <<
+		"  Irradiance error against every probe retraced (reached/unreached probes): " << MeasureTileMeanError(means, referenceMeans, reachedProbeFlags, 1, meanIrradiance) <<
+		"/" << MeasureTileMeanError(means, referenceMeans, reachedProbeFlags, 0, meanIrradiance) << "\n";
+}
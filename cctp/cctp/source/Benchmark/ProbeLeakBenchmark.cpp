@@ -0,0 +1,247 @@
+#include "CpuPch.h"
+#include "Benchmark.h"
+#include "Math/SphericalHarmonics.h"
+#include "Renderer/Geometry.h"
+#include "Renderer/ProbePool.h"
+#include "Renderer/CPU/ProbeLookup.h"
+#include "Renderer/CPU/ProbeShading.h"
+#include "Renderer/CPU/ProbeTracer.h"
+#include "Renderer/CPU/RaytracingScene.h"
+
+namespace
+{
+	enum class VisibilityWeighting : uint8_t
+	{
+		None = 0,
+		MeanDistance,
+		Chebyshev
+	};
+
+	// Irradiance / pi at a surface point from the rays a probe would trace there, cosine weighted over the hemisphere around the normal as the probe
+	// filter weights them
+	glm::vec3 MeasureReferenceIrradiance(const Renderer::CPU::RaytracingScene& scene, const glm::vec3& point, const glm::vec3& normal,
+		const glm::vec3& lightVectorWS)
+	{
+		std::vector<glm::vec3> rayDirections;
+		std::vector<glm::vec4> rayData;
+		Renderer::CPU::TraceProbeReference(scene, point + normal * Renderer::SHADOW_BIAS, Renderer::CPU::PROBE_REFERENCE_RAY_COUNT, lightVectorWS, 1.0f,
+			rayDirections, rayData);
+		return Renderer::CPU::IntegrateProbeIrradiance(rayData.data(), rayDirections.data(), Renderer::CPU::PROBE_REFERENCE_RAY_COUNT, normal);
+	}
+
+	// Port of the octahedral path of Irradiance() in Shaders/PixelShader.hlsl with the visibility weighting selectable. Mean distance weighting is
+	// the weighting Irradiance() used before Chebyshev weighting, which loaded the mean distance of the nearest texel and tested it from the point itself
+	glm::vec3 IrradianceWithWeighting(const Renderer::CPU::ProbeShadingInputs& inputs, const glm::vec3& shadingPoint, const glm::vec3& shadingPointNormal,
+		const VisibilityWeighting weighting)
+	{
+		const glm::vec3 normal = glm::normalize(shadingPointNormal);
+		const Renderer::ProbeVolumeData& volume = (*inputs.pVolumeData)[Renderer::CPU::FindProbeVolume(*inputs.pVolumeData, shadingPoint)];
+		const uint32_t probesPerRow = inputs.pAtlasLayout->GetProbesPerRow();
+		const glm::vec2 irradianceAtlasDimensions = glm::vec2(inputs.pAtlasLayout->GetIrradianceAtlasDimensions());
+		const glm::vec2 visibilityAtlasDimensions = glm::vec2(inputs.pAtlasLayout->GetVisibilityAtlasDimensions());
+		const glm::vec3 visibilityPoint = (weighting == VisibilityWeighting::Chebyshev) ?
+			shadingPoint + normal * (volume.GridOriginAndSpacing.w * Renderer::PROBE_VISIBILITY_NORMAL_BIAS) : shadingPoint;
+
+		glm::vec3 sumIrradiance = glm::vec3(0.0f);
+		float sumWeight = 0.0f;
+		glm::ivec3 baseCoordinate;
+		glm::vec3 alpha;
+		Renderer::CPU::GetProbeCage(volume, shadingPoint, baseCoordinate, alpha);
+		for (int32_t c = 0; c < 8; ++c)
+		{
+			const glm::ivec3 offset = glm::ivec3(c & 1, (c >> 1) & 1, c >> 2);
+			const glm::ivec3 corner = glm::min(baseCoordinate + offset, glm::ivec3(volume.ProbeCounts) - 1);
+			const uint32_t i = Renderer::CPU::GetPoolProbeIndex(volume, corner);
+
+			const glm::vec3 probePosition = glm::vec3((*inputs.pProbePositions)[i]);
+			const glm::vec3 pointToProbe = probePosition - shadingPoint;
+			const glm::vec3 direction = pointToProbe / std::max(glm::length(pointToProbe), 0.0001f);
+			const glm::vec3 trilinear = glm::mix(1.0f - alpha, alpha, glm::vec3(offset));
+			float weight = trilinear.x * trilinear.y * trilinear.z;
+			weight *= Renderer::CPU::ProbeNormalWeight(direction, normal);
+
+			const glm::vec3 visibilityPointToProbe = probePosition - visibilityPoint;
+			const float visibilityDistance = glm::length(visibilityPointToProbe);
+			const glm::vec3 visibilityDirection = visibilityPointToProbe / std::max(visibilityDistance, 0.0001f);
+			if (weighting == VisibilityWeighting::MeanDistance)
+			{
+				const glm::vec2 visibilityTexelIndex = Renderer::CPU::GetProbeTexelCoordinate(-visibilityDirection, i, probesPerRow,
+					static_cast<float>(Renderer::VISIBILITY_PROBE_SIDE_LENGTH), Renderer::PROBE_PADDING);
+				const float meanDistance = inputs.pVisibilityAtlas->Load(visibilityTexelIndex).x;
+				if (meanDistance > 0.0f && meanDistance < Renderer::PROBE_MAX_RAY_DISTANCE && visibilityDistance > meanDistance)
+				{
+					weight *= (meanDistance / visibilityDistance) * (meanDistance / visibilityDistance);
+				}
+			}
+			else if (weighting == VisibilityWeighting::Chebyshev)
+			{
+				const glm::vec2 visibilityTexelIndex = Renderer::CPU::GetProbeTexelCoordinate(-visibilityDirection, i, probesPerRow,
+					static_cast<float>(Renderer::VISIBILITY_PROBE_SIDE_LENGTH), Renderer::PROBE_PADDING);
+				weight *= Renderer::CPU::ProbeVisibilityWeight(inputs.pVisibilityAtlas->SampleLinear(visibilityTexelIndex / visibilityAtlasDimensions), visibilityDistance);
+			}
+
+			const glm::vec2 irradianceTexelIndex = Renderer::CPU::GetProbeTexelCoordinate(normal, i, probesPerRow,
+				static_cast<float>(Renderer::IRRADIANCE_PROBE_SIDE_LENGTH), Renderer::PROBE_PADDING);
+			sumIrradiance += weight * inputs.pIrradianceAtlas->SampleLinear(irradianceTexelIndex / irradianceAtlasDimensions);
+			sumWeight += weight;
+		}
+		return sumWeight > 0.0f ? sumIrradiance / sumWeight : sumIrradiance;
+	}
+}
+
+void Benchmark::ProbeLightLeak(std::ostream& output)
+{
+	// Two rooms either side of a wall thinner than the probe spacing. The room at -x is closed on every side, so nothing lights it and any
+	// irradiance its surfaces receive has leaked through the wall from the probes of the sunlit room at +x
+	constexpr float WALL_THICKNESS = 0.1f;
+	std::vector<Renderer::Vertex1Pos1UV1Norm> vertices;
+	std::vector<uint32_t> indices;
+	Renderer::Geometry::GenerateCubeGeometry(vertices, indices, 1.0f);
+	Renderer::CPU::RaytracingScene scene;
+	const uint32_t cubeMesh = scene.AddMesh(vertices.data(), vertices.size(), indices.data(), indices.size());
+	const auto addBox = [&](const glm::vec3& minimum, const glm::vec3& maximum, const glm::vec3& albedo)
+		{
+			scene.AddInstance(cubeMesh, glm::translate(glm::identity<glm::mat4>(), (minimum + maximum) * 0.5f) *
+				glm::scale(glm::identity<glm::mat4>(), maximum - minimum), albedo);
+		};
+	const float halfWall = WALL_THICKNESS * 0.5f;
+	addBox(glm::vec3(-4.1f, -0.1f, -2.1f), glm::vec3(4.1f, 0.0f, 2.1f), glm::vec3(0.8f));
+	addBox(glm::vec3(-halfWall, 0.0f, -2.1f), glm::vec3(halfWall, 3.1f, 2.1f), glm::vec3(0.8f));
+	addBox(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(4.1f, 3.0f, 2.1f), glm::vec3(0.9f, 0.3f, 0.2f));
+	addBox(glm::vec3(-4.1f, 3.0f, -2.1f), glm::vec3(0.0f, 3.1f, 2.1f), glm::vec3(0.8f));
+	addBox(glm::vec3(-4.1f, 0.0f, -2.1f), glm::vec3(-4.0f, 3.0f, 2.1f), glm::vec3(0.8f));
+	addBox(glm::vec3(-4.0f, 0.0f, -2.1f), glm::vec3(0.0f, 3.0f, -2.0f), glm::vec3(0.8f));
+	addBox(glm::vec3(-4.0f, 0.0f, 2.0f), glm::vec3(0.0f, 3.0f, 2.1f), glm::vec3(0.8f));
+	scene.Update();
+	const glm::vec3 lightDirectionWS = glm::vec3(-0.3f, -1.0f, 0.4f);
+	const glm::vec3 lightVectorWS = -glm::normalize(lightDirectionWS);
+
+	// Probes on a grid whose cells straddle the wall, so every shading point near it blends probes from both rooms
+	Renderer::ProbePool pool;
+	pool.AddVolume(Renderer::ProbeVolume(glm::vec3(0.0f, 1.5f, 0.0f), glm::vec3(8.0f, 3.0f, 4.0f), 1.0f, 0.05f));
+	const auto& probePositions = pool.GetVolume(0).GetProbePositions();
+	const std::vector<uint32_t> probeStates(probePositions.size(), static_cast<uint32_t>(Renderer::ProbeState::Active));
+	std::vector<Renderer::ProbeVolumeData> volumeData;
+	pool.GetVolumeData(volumeData);
+
+	// Shading points on the floor and the wall within a probe spacing of the wall on each side, with the irradiance the point itself sees
+	constexpr size_t sidePointCount = 4096;
+	std::mt19937 generator(25);
+	std::uniform_real_distribution<float> unitDistribution(0.0f, 1.0f);
+	std::vector<glm::vec3> points;
+	std::vector<glm::vec3> pointNormals;
+	for (const float side : { -1.0f, 1.0f })
+	{
+		for (size_t i = 0; i < sidePointCount; ++i)
+		{
+			const float z = -1.9f + 3.8f * unitDistribution(generator);
+			if ((i & 1) == 0)
+			{
+				points.push_back(glm::vec3(side * (halfWall + 0.95f * unitDistribution(generator)), 0.0f, z));
+				pointNormals.push_back(glm::vec3(0.0f, 1.0f, 0.0f));
+			}
+			else
+			{
+				points.push_back(glm::vec3(side * halfWall, 0.05f + 2.9f * unitDistribution(generator), z));
+				pointNormals.push_back(glm::vec3(side, 0.0f, 0.0f));
+			}
+		}
+	}
+	const size_t pointCount = points.size();
+	std::vector<glm::vec3> referenceIrradiance(pointCount);
+	double sumLitReferenceLuminance = 0.0;
+	double sumDarkReferenceLuminance = 0.0;
+	for (size_t i = 0; i < pointCount; ++i)
+	{
+		referenceIrradiance[i] = MeasureReferenceIrradiance(scene, points[i], pointNormals[i], lightVectorWS);
+		(points[i].x > 0.0f ? sumLitReferenceLuminance : sumDarkReferenceLuminance) += Renderer::CPU::Luminance(referenceIrradiance[i]);
+	}
+	output << "Probes: " << probePositions.size() << "  Spacing: 1  Wall thickness: " << WALL_THICKNESS << "  Max ray distance: " << Renderer::PROBE_MAX_RAY_DISTANCE <<
+		"  Shading points per side: " << sidePointCount << "  Reference dark/lit luminance: " << (sumDarkReferenceLuminance / sidePointCount) << "/" <<
+		(sumLitReferenceLuminance / sidePointCount) << "\n";
+
+	// Leak is the mean luminance of the dark room's points relative to the lit room's reference, lit error the mean luminance error of the lit
+	// room's points relative to the same reference, so weighting that only darkens everything does not score well
+	constexpr uint32_t GATHER_COUNT = 32;
+	for (const auto encoding : { Renderer::ProbeEncoding::Octahedral, Renderer::ProbeEncoding::SphericalHarmonicsL1, Renderer::ProbeEncoding::SphericalHarmonicsL2 })
+	{
+		Renderer::CPU::ProbeTraceSettings settings = {};
+		settings.LightDirectionWS = lightDirectionWS;
+		settings.Encoding = encoding;
+		Renderer::CPU::ProbeTracer tracer;
+		for (uint32_t g = 0; g < GATHER_COUNT; ++g)
+		{
+			settings.RayRotationSeed = g + 1;
+			tracer.TraceProbes(scene, probePositions, settings);
+		}
+
+		volumeData[0].ScrollOffset.w = static_cast<int32_t>(encoding);
+		Renderer::CPU::ProbeShadingInputs inputs = {};
+		inputs.pVolumeData = &volumeData;
+		inputs.pProbePositions = &probePositions;
+		inputs.pProbeStates = &probeStates;
+		inputs.pAtlasLayout = &tracer.GetAtlasLayout();
+		inputs.pIrradianceAtlas = &tracer.GetIrradianceAtlas();
+		inputs.pVisibilityAtlas = &tracer.GetVisibilityAtlas();
+		inputs.pShCoefficients = &tracer.GetProbeShCoefficients();
+
+		const auto measure = [&](const char* pName, const auto& irradiance)
+			{
+				std::vector<glm::vec3> results(pointCount);
+				const auto start = std::chrono::high_resolution_clock::now();
+				for (size_t i = 0; i < pointCount; ++i)
+				{
+					results[i] = irradiance(points[i], pointNormals[i]);
+				}
+				const double nanoseconds = GetElapsedMilliseconds(start) * 1.0e6 / pointCount;
+
+				double sumDarkLuminance = 0.0;
+				double sumLitError = 0.0;
+				for (size_t i = 0; i < pointCount; ++i)
+				{
+					if (points[i].x > 0.0f)
+					{
+						sumLitError += std::abs(Renderer::CPU::Luminance(results[i]) - Renderer::CPU::Luminance(referenceIrradiance[i]));
+					}
+					else
+					{
+						sumDarkLuminance += Renderer::CPU::Luminance(results[i]);
+					}
+				}
+				output << "  " << pName << " leak/lit error/ns per point: " << (sumDarkLuminance / sumLitReferenceLuminance) << "/" <<
+					(sumLitError / sumLitReferenceLuminance) << "/" << nanoseconds;
+				return results;
+			};
+
+		const uint32_t shCoefficientCount = Renderer::GetProbeShCoefficientCount(encoding);
+		output << (shCoefficientCount == 0 ? "Octahedral" : (shCoefficientCount == Math::SH_L1_COEFFICIENT_COUNT ? "L1" : "L2"));
+		if (shCoefficientCount == 0)
+		{
+			for (const auto weighting : { VisibilityWeighting::None, VisibilityWeighting::MeanDistance, VisibilityWeighting::Chebyshev })
+			{
+				const char* pNames[] = { "No visibility", "Mean distance", "Chebyshev" };
+				measure(pNames[static_cast<uint8_t>(weighting)], [&](const glm::vec3& point, const glm::vec3& normal)
+					{
+						return IrradianceWithWeighting(inputs, point, normal, weighting);
+					});
+			}
+		}
+
+		// Irradiance() must give what the port gives with Chebyshev weighting
+		const auto results = measure("Irradiance()", [&](const glm::vec3& point, const glm::vec3& normal)
+			{
+				return Renderer::CPU::Irradiance(inputs, point, normal);
+			});
+		if (shCoefficientCount == 0)
+		{
+			size_t mismatchCount = 0;
+			for (size_t i = 0; i < pointCount; ++i)
+			{
+				const glm::vec3 difference = glm::abs(results[i] - IrradianceWithWeighting(inputs, points[i], pointNormals[i], VisibilityWeighting::Chebyshev));
+				mismatchCount += (std::max(difference.x, std::max(difference.y, difference.z)) > 1.0e-5f) ? 1 : 0;
+			}
+			output << "  Mismatches against the port: " << mismatchCount;
+		}
+		output << "\n";
+	}
+}
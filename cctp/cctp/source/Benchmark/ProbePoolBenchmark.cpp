@@ -0,0 +1,172 @@
+#include "CpuPch.h"
+#include "Benchmark.h"
+#include "Renderer/ProbePool.h"
+#include "Renderer/CPU/ProbeLookup.h"
+#include "Renderer/CPU/ProbeTracer.h"
+
+namespace
+{
+	// Counts shading points whose cage, found through the shader lookup, does not enclose them. Points outside every volume are skipped
+	size_t CountCageMismatches(const Renderer::ProbePool& pool, const std::vector<Renderer::ProbeVolumeData>& volumeData,
+		const std::vector<glm::vec3>& points)
+	{
+		size_t mismatchCount = 0;
+		std::array<uint32_t, 8> cageIndices;
+		for (const auto& point : points)
+		{
+			const int32_t v = Renderer::CPU::FindProbeVolume(volumeData, point);
+			const auto& volume = pool.GetVolume(static_cast<uint32_t>(v));
+			const glm::vec3 gridPosition = (point - volume.GetGridOrigin()) / volume.GetProbeSpacing();
+			const glm::vec3 gridMax = glm::vec3(glm::ivec3(volumeData[v].ProbeCounts) - 1);
+			if (gridPosition.x < 0.0f || gridPosition.y < 0.0f || gridPosition.z < 0.0f ||
+				gridPosition.x > gridMax.x || gridPosition.y > gridMax.y || gridPosition.z > gridMax.z)
+			{
+				continue;
+			}
+
+			BoundingBox cageBounds;
+			Renderer::CPU::GetProbeCageIndices(volumeData[v], point, cageIndices);
+			for (const uint32_t poolIndex : cageIndices)
+			{
+				cageBounds.Grow(volume.GetProbeGridPosition(poolIndex - pool.GetBaseProbeIndex(static_cast<uint32_t>(v))));
+			}
+			const float tolerance = volume.GetProbeSpacing() * 0.001f;
+			if (point.x < cageBounds.Min.x - tolerance || point.y < cageBounds.Min.y - tolerance || point.z < cageBounds.Min.z - tolerance ||
+				point.x > cageBounds.Max.x + tolerance || point.y > cageBounds.Max.y + tolerance || point.z > cageBounds.Max.z + tolerance)
+			{
+				++mismatchCount;
+			}
+		}
+		return mismatchCount;
+	}
+}
+
+void Benchmark::ProbePoolLookup(std::ostream& output)
+{
+	// A dense volume over a level with cascades around the camera, well past what the per frame constant buffer could hold
+	const glm::vec3 levelPosition = glm::vec3(0.0f, 2.0f, 0.0f);
+	glm::vec3 cameraPosition = glm::vec3(-3.0f, 1.5f, -4.0f);
+	auto start = std::chrono::high_resolution_clock::now();
+	Renderer::ProbePool pool;
+	pool.AddVolume(Renderer::ProbeVolume(levelPosition, glm::vec3(10.0f), 0.25f, 0.05f));
+	const uint32_t firstCascadeIndex = pool.AddCascades(cameraPosition, glm::vec3(8.0f), 0.5f, 3, 0.05f);
+	const double buildMilliseconds = GetElapsedMilliseconds(start);
+
+	Renderer::CPU::ProbePoolValidationStats validationStats;
+	Renderer::CPU::ValidateProbePool(pool, validationStats);
+	output << "Volumes: " << pool.GetVolumeCount() << "  Probes: " << pool.GetTotalProbeCount() <<
+		"  Build (ms): " << buildMilliseconds <<
+		"  Probe data (KB): " << (pool.GetTotalProbeCount() * (sizeof(glm::vec4) + sizeof(uint32_t)) / 1024) <<
+		"  Validate (ms): " << validationStats.Milliseconds <<
+		"  Validation errors: " << validationStats.GetErrorCount() << "\n";
+
+	// Every probe must have a tile of its own inside the atlases, which a single row of tiles could not fit within the largest texture width
+	const Renderer::ProbeAtlasLayout atlasLayout(pool.GetTotalProbeCount(),
+		glm::ivec3(pool.GetVolume(0).GetProbeCountX(), pool.GetVolume(0).GetProbeCountY(), pool.GetVolume(0).GetProbeCountZ()));
+	const glm::uvec2 visibilityAtlasDimensions = atlasLayout.GetVisibilityAtlasDimensions();
+	std::vector<uint8_t> tileUsed(static_cast<size_t>(atlasLayout.GetProbeCapacity()), 0);
+	size_t tileErrorCount = 0;
+	for (uint32_t p = 0; p < pool.GetTotalProbeCount(); ++p)
+	{
+		const glm::vec2 topLeft = Renderer::CPU::GetProbeTopLeftPosition(p, atlasLayout.GetProbesPerRow(),
+			static_cast<float>(Renderer::VISIBILITY_PROBE_SIDE_LENGTH), Renderer::PROBE_PADDING);
+		const glm::uvec2 tile = (glm::uvec2(topLeft) - Renderer::PROBE_PADDING) / (Renderer::VISIBILITY_PROBE_SIDE_LENGTH + 2 * Renderer::PROBE_PADDING);
+		const size_t tileIndex = static_cast<size_t>(tile.y) * atlasLayout.GetProbesPerRow() + tile.x;
+		if (topLeft.x < Renderer::PROBE_PADDING || topLeft.y < Renderer::PROBE_PADDING ||
+			topLeft.x + Renderer::VISIBILITY_PROBE_SIDE_LENGTH + Renderer::PROBE_PADDING > visibilityAtlasDimensions.x ||
+			topLeft.y + Renderer::VISIBILITY_PROBE_SIDE_LENGTH + Renderer::PROBE_PADDING > visibilityAtlasDimensions.y ||
+			tileIndex >= tileUsed.size() || tileUsed[tileIndex]++ > 0)
+		{
+			++tileErrorCount;
+		}
+	}
+	output << "Atlas probes per row: " << atlasLayout.GetProbesPerRow() << "  Rows: " << atlasLayout.GetRowCount() <<
+		"  Irradiance atlas: " << atlasLayout.GetIrradianceAtlasDimensions().x << "x" << atlasLayout.GetIrradianceAtlasDimensions().y <<
+		"  Visibility atlas: " << visibilityAtlasDimensions.x << "x" << visibilityAtlasDimensions.y <<
+		"  Single row visibility width: " << (static_cast<size_t>(pool.GetTotalProbeCount()) * (Renderer::VISIBILITY_PROBE_SIDE_LENGTH + 2 * Renderer::PROBE_PADDING)) <<
+		"  Max texture dimension: " << Renderer::MAX_ATLAS_DIMENSION <<
+		"  Tile errors: " << tileErrorCount << "\n";
+
+	// Fly the camera through the level. Only volumes that changed since the last upload have their probe range uploaded
+	constexpr uint32_t frameCount = 200;
+	std::vector<uint64_t> uploadFrameIndices(pool.GetVolumeCount(), 0);
+	size_t uploadedProbeCount = 0;
+	double updateMilliseconds = 0.0;
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		cameraPosition += glm::vec3(0.04f, 0.005f, 0.03f);
+		start = std::chrono::high_resolution_clock::now();
+		for (uint32_t v = firstCascadeIndex; v < pool.GetVolumeCount(); ++v)
+		{
+			pool.GetVolume(v).GetVolumePosition() = cameraPosition;
+		}
+		pool.Update();
+		updateMilliseconds += GetElapsedMilliseconds(start);
+
+		for (uint32_t v = 0; v < pool.GetVolumeCount(); ++v)
+		{
+			const auto& volume = pool.GetVolume(v);
+			if (volume.HasChangedSince(uploadFrameIndices[v]))
+			{
+				uploadedProbeCount += volume.GetTotalProbeCount();
+			}
+			uploadFrameIndices[v] = volume.GetFrameIndex();
+		}
+	}
+	Renderer::CPU::ValidateProbePool(pool, validationStats);
+	output << "Camera frames: " << frameCount <<
+		"  Update (us per frame): " << (updateMilliseconds * 1000.0 / frameCount) <<
+		"  Probes uploaded per frame (changed volumes/whole pool): " << (uploadedProbeCount / frameCount) << "/" << pool.GetTotalProbeCount() <<
+		"  Validation errors after scrolling: " << validationStats.GetErrorCount() << "\n";
+
+	// Shading points spread over and around the level, some outside every volume
+	std::mt19937 generator(13);
+	std::uniform_real_distribution<float> distribution(-12.0f, 12.0f);
+	std::vector<glm::vec3> points(1 << 20);
+	for (auto& point : points)
+	{
+		point = levelPosition + glm::vec3(distribution(generator), distribution(generator), distribution(generator));
+	}
+	std::vector<Renderer::ProbeVolumeData> volumeData;
+	pool.GetVolumeData(volumeData);
+
+	start = std::chrono::high_resolution_clock::now();
+	uint64_t checksum = 0;
+	std::array<uint32_t, 8> cageIndices;
+	for (const auto& point : points)
+	{
+		const int32_t v = Renderer::CPU::FindProbeVolume(volumeData, point);
+		Renderer::CPU::GetProbeCageIndices(volumeData[v], point, cageIndices);
+		checksum += cageIndices[0] + cageIndices[7];
+	}
+	const double lookupMilliseconds = GetElapsedMilliseconds(start);
+
+	// The previous shading loop visited every probe for every shading point. Time it on a slice of the points
+	const std::vector<glm::vec4> allPositions = [&pool]()
+	{
+		std::vector<glm::vec4> positions;
+		for (uint32_t v = 0; v < pool.GetVolumeCount(); ++v)
+		{
+			positions.insert(positions.end(), pool.GetVolume(v).GetProbePositions().begin(), pool.GetVolume(v).GetProbePositions().end());
+		}
+		return positions;
+	}();
+	constexpr size_t loopPointCount = 256;
+	start = std::chrono::high_resolution_clock::now();
+	float weightSum = 0.0f;
+	for (size_t p = 0; p < loopPointCount; ++p)
+	{
+		for (const auto& position : allPositions)
+		{
+			const float distance = glm::length(glm::vec3(position) - points[p]);
+			weightSum += std::min(distance, 1.0f) / std::max(distance, 0.001f);
+		}
+	}
+	const double loopMilliseconds = GetElapsedMilliseconds(start);
+
+	output << "Shading points: " << points.size() <<
+		"  Probes visited per point (all/cage): " << allPositions.size() << "/8" <<
+		"  Lookup (ns per point, all/cage): " << (loopMilliseconds * 1e6 / loopPointCount) << "/" << (lookupMilliseconds * 1e6 / points.size()) <<
+		"  Cages not enclosing their point: " << CountCageMismatches(pool, volumeData, points) <<
+		"  Checksum: " << (checksum + static_cast<uint64_t>(weightSum)) % 1000 << "\n";
+}
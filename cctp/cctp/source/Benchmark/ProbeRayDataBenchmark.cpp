@@ -0,0 +1,186 @@
+#include "CpuPch.h"
+#include "Benchmark.h"
+#include "Renderer/ProbePool.h"
+#include "Renderer/ProbeRayTable.h"
+#include "Renderer/CPU/ProbeFilter.h"
+#include "Renderer/CPU/ProbeShading.h"
+#include "Renderer/CPU/ProbeTracer.h"
+#include "Renderer/CPU/RaytracingScene.h"
+#include "Scene/Scenes/DemoSceneLayout.h"
+
+namespace
+{
+	// Texel of a direction in a probe's square as the previous RayGen stored each ray, truncated, with directions on the far edges kept in the square
+	glm::ivec2 GetRayTexel(const glm::vec3& direction, const uint32_t sideLength)
+	{
+		const glm::vec2 coordinate = Renderer::CPU::GetProbeTexelCoordinate(direction, 0, 1, static_cast<float>(sideLength), 0);
+		return glm::min(glm::ivec2(coordinate), glm::ivec2(static_cast<int32_t>(sideLength) - 1));
+	}
+}
+
+void Benchmark::ProbeRayData(std::ostream& output)
+{
+	constexpr uint32_t rayCounts[] = { 16, 32, 64, 128, 256 };
+	const auto& table = Renderer::GetProbeRayTable();
+
+	// Storing each ray in the texel its direction falls in drops every ray that lands in a texel another ray already wrote, and leaves every texel no ray
+	// lands in to the blur. Counted over every rotation of the table
+	output << "Ray per texel storage over " << Renderer::PROBE_RAY_ROTATION_COUNT << " rotations (mean rays lost/irradiance texels reached/visibility texels reached of " <<
+		(Renderer::IRRADIANCE_PROBE_SIDE_LENGTH * Renderer::IRRADIANCE_PROBE_SIDE_LENGTH) << "/" <<
+		(Renderer::VISIBILITY_PROBE_SIDE_LENGTH * Renderer::VISIBILITY_PROBE_SIDE_LENGTH) << "):";
+	for (const uint32_t rayCount : rayCounts)
+	{
+		size_t sumIrradianceTexels = 0;
+		size_t sumVisibilityTexels = 0;
+		std::vector<uint8_t> irradianceTexels;
+		std::vector<uint8_t> visibilityTexels;
+		for (const glm::mat3& rotation : table.GetRotations())
+		{
+			irradianceTexels.assign(Renderer::IRRADIANCE_PROBE_SIDE_LENGTH * Renderer::IRRADIANCE_PROBE_SIDE_LENGTH, 0);
+			visibilityTexels.assign(Renderer::VISIBILITY_PROBE_SIDE_LENGTH * Renderer::VISIBILITY_PROBE_SIDE_LENGTH, 0);
+			for (uint32_t r = 0; r < rayCount; ++r)
+			{
+				const glm::vec3 direction = glm::normalize(rotation * Renderer::CPU::SphericalFibonacci(static_cast<float>(r), static_cast<float>(rayCount)));
+				const glm::ivec2 irradianceTexel = GetRayTexel(direction, Renderer::IRRADIANCE_PROBE_SIDE_LENGTH);
+				const glm::ivec2 visibilityTexel = GetRayTexel(direction, Renderer::VISIBILITY_PROBE_SIDE_LENGTH);
+				irradianceTexels[irradianceTexel.y * Renderer::IRRADIANCE_PROBE_SIDE_LENGTH + irradianceTexel.x] = 1;
+				visibilityTexels[visibilityTexel.y * Renderer::VISIBILITY_PROBE_SIDE_LENGTH + visibilityTexel.x] = 1;
+			}
+			sumIrradianceTexels += std::count(irradianceTexels.begin(), irradianceTexels.end(), uint8_t(1));
+			sumVisibilityTexels += std::count(visibilityTexels.begin(), visibilityTexels.end(), uint8_t(1));
+		}
+		const double rotationCount = static_cast<double>(Renderer::PROBE_RAY_ROTATION_COUNT);
+		output << "  " << rayCount << ": " << (rayCount - sumIrradianceTexels / rotationCount) << "/" << (sumIrradianceTexels / rotationCount) << "/" <<
+			(sumVisibilityTexels / rotationCount);
+	}
+	output << "\n";
+
+	DemoSceneFixture demoScene;
+	CreateDemoScene(demoScene);
+	const auto& scene = demoScene.Scene;
+	const Renderer::ProbeVolume volume = DemoSceneLayout::CreateProbeVolume();
+	const auto& probePositions = volume.GetProbePositions();
+	const glm::vec3 lightVectorWS = -glm::normalize(DemoSceneLayout::DEFAULT_LIGHT_DIRECTION_WS);
+
+	// One probe's tiles, border included, filtered from each ray count and from densely traced reference rays
+	constexpr uint32_t PROBE_STRIDE = 4;
+	const glm::ivec2 topLeft = glm::ivec2(static_cast<int32_t>(Renderer::PROBE_PADDING));
+	const uint32_t irradianceTileSideLength = Renderer::IRRADIANCE_PROBE_SIDE_LENGTH + 2 * Renderer::PROBE_PADDING;
+	const uint32_t visibilityTileSideLength = Renderer::VISIBILITY_PROBE_SIDE_LENGTH + 2 * Renderer::PROBE_PADDING;
+	Renderer::CPU::Texture2D<glm::vec3> irradiance(irradianceTileSideLength, irradianceTileSideLength);
+	Renderer::CPU::Texture2D<glm::vec2> visibility(visibilityTileSideLength, visibilityTileSideLength);
+	Renderer::CPU::Texture2D<glm::vec3> referenceIrradiance(irradianceTileSideLength, irradianceTileSideLength);
+	Renderer::CPU::Texture2D<glm::vec2> referenceVisibility(visibilityTileSideLength, visibilityTileSideLength);
+
+	struct RayCountResult
+	{
+		double IrradianceError = 0.0;
+		double VisibilityError = 0.0;
+		double RayPerTexelIrradianceError = 0.0;
+		size_t RayPerTexelCount = 0;
+		double TraceMilliseconds = 0.0;
+		double FilterMilliseconds = 0.0;
+	};
+	std::array<RayCountResult, std::size(rayCounts)> results = {};
+
+	std::vector<glm::vec4> rayData;
+	std::vector<glm::vec3> rayDirections;
+	std::vector<glm::vec3> referenceDirections;
+	double sumReferenceIrradiance = 0.0;
+	uint32_t probeCount = 0;
+	for (size_t p = 0; p < probePositions.size(); p += PROBE_STRIDE)
+	{
+		const glm::vec3& origin = probePositions[p];
+		Renderer::CPU::TraceProbeReference(scene, origin, Renderer::CPU::PROBE_REFERENCE_RAY_COUNT, lightVectorWS, 1.0f, referenceDirections, rayData);
+		Renderer::CPU::FilterProbeRays(rayData.data(), referenceDirections.data(), Renderer::CPU::PROBE_REFERENCE_RAY_COUNT, referenceIrradiance, topLeft, Renderer::IRRADIANCE_PROBE_SIDE_LENGTH);
+		Renderer::CPU::FilterProbeRays(rayData.data(), referenceDirections.data(), Renderer::CPU::PROBE_REFERENCE_RAY_COUNT, referenceVisibility, topLeft, Renderer::VISIBILITY_PROBE_SIDE_LENGTH);
+		for (uint32_t y = 0; y < Renderer::IRRADIANCE_PROBE_SIDE_LENGTH; ++y)
+		{
+			for (uint32_t x = 0; x < Renderer::IRRADIANCE_PROBE_SIDE_LENGTH; ++x)
+			{
+				const glm::vec3 value = referenceIrradiance.Load(topLeft.x + x, topLeft.y + y);
+				sumReferenceIrradiance += (value.x + value.y + value.z) / 3.0;
+			}
+		}
+
+		// Each probe traces with the rotation its first update uses
+		const glm::mat3& rotation = table.GetRotations()[Renderer::GetProbeRayRotationIndex(1, static_cast<uint32_t>(p))];
+		for (size_t c = 0; c < std::size(rayCounts); ++c)
+		{
+			const uint32_t rayCount = rayCounts[c];
+			RayCountResult& result = results[c];
+			rayDirections.resize(rayCount);
+			for (uint32_t r = 0; r < rayCount; ++r)
+			{
+				rayDirections[r] = glm::normalize(rotation * Renderer::CPU::SphericalFibonacci(static_cast<float>(r), static_cast<float>(rayCount)));
+			}
+
+			auto start = std::chrono::high_resolution_clock::now();
+			rayData.resize(rayCount);
+			for (uint32_t r = 0; r < rayCount; ++r)
+			{
+				rayData[r] = Renderer::CPU::TraceProbeRay(scene, origin, rayDirections[r], lightVectorWS, 1.0f);
+			}
+			result.TraceMilliseconds += GetElapsedMilliseconds(start);
+
+			start = std::chrono::high_resolution_clock::now();
+			Renderer::CPU::FilterProbeRays(rayData.data(), rayDirections.data(), rayCount, irradiance, topLeft, Renderer::IRRADIANCE_PROBE_SIDE_LENGTH);
+			Renderer::CPU::FilterProbeRays(rayData.data(), rayDirections.data(), rayCount, visibility, topLeft, Renderer::VISIBILITY_PROBE_SIDE_LENGTH);
+			result.FilterMilliseconds += GetElapsedMilliseconds(start);
+
+			for (uint32_t y = 0; y < Renderer::IRRADIANCE_PROBE_SIDE_LENGTH; ++y)
+			{
+				for (uint32_t x = 0; x < Renderer::IRRADIANCE_PROBE_SIDE_LENGTH; ++x)
+				{
+					const glm::vec3 difference = glm::abs(irradiance.Load(topLeft.x + x, topLeft.y + y) - referenceIrradiance.Load(topLeft.x + x, topLeft.y + y));
+					result.IrradianceError += (difference.x + difference.y + difference.z) / 3.0;
+				}
+			}
+			for (uint32_t y = 0; y < Renderer::VISIBILITY_PROBE_SIDE_LENGTH; ++y)
+			{
+				for (uint32_t x = 0; x < Renderer::VISIBILITY_PROBE_SIDE_LENGTH; ++x)
+				{
+					result.VisibilityError += std::abs(visibility.Load(topLeft.x + x, topLeft.y + y).x - referenceVisibility.Load(topLeft.x + x, topLeft.y + y).x);
+				}
+			}
+
+			// A texel holding the radiance of the last ray stored in it, as irradiance texels did before they were blurred
+			for (uint32_t r = 0; r < rayCount; ++r)
+			{
+				const glm::ivec2 texel = topLeft + GetRayTexel(rayDirections[r], Renderer::IRRADIANCE_PROBE_SIDE_LENGTH);
+				irradiance.Store(texel.x, texel.y, glm::vec3(rayData[r]));
+			}
+			std::vector<uint8_t> reachedTexels(Renderer::IRRADIANCE_PROBE_SIDE_LENGTH * Renderer::IRRADIANCE_PROBE_SIDE_LENGTH, 0);
+			for (uint32_t r = 0; r < rayCount; ++r)
+			{
+				const glm::ivec2 offset = GetRayTexel(rayDirections[r], Renderer::IRRADIANCE_PROBE_SIDE_LENGTH);
+				uint8_t& reached = reachedTexels[offset.y * Renderer::IRRADIANCE_PROBE_SIDE_LENGTH + offset.x];
+				if (reached == 0)
+				{
+					reached = 1;
+					const glm::ivec2 texel = topLeft + offset;
+					const glm::vec3 difference = glm::abs(irradiance.Load(texel.x, texel.y) - referenceIrradiance.Load(texel.x, texel.y));
+					result.RayPerTexelIrradianceError += (difference.x + difference.y + difference.z) / 3.0;
+					++result.RayPerTexelCount;
+				}
+			}
+		}
+		++probeCount;
+	}
+
+	// Irradiance errors are relative to the mean reference irradiance, visibility errors are the mean distance error in metres
+	const double irradianceTexelCount = static_cast<double>(probeCount) * Renderer::IRRADIANCE_PROBE_SIDE_LENGTH * Renderer::IRRADIANCE_PROBE_SIDE_LENGTH;
+	const double visibilityTexelCount = static_cast<double>(probeCount) * Renderer::VISIBILITY_PROBE_SIDE_LENGTH * Renderer::VISIBILITY_PROBE_SIDE_LENGTH;
+	const double meanIrradiance = sumReferenceIrradiance / irradianceTexelCount;
+	output << "Demo scene probes: " << probeCount << " of " << probePositions.size() << "  Reference rays: " << Renderer::CPU::PROBE_REFERENCE_RAY_COUNT <<
+		"  Rays traced per update: " << Renderer::PROBE_RAY_COUNT << "\n";
+	for (size_t c = 0; c < std::size(rayCounts); ++c)
+	{
+		const RayCountResult& result = results[c];
+		output << "Rays: " << rayCounts[c] <<
+			"  Irradiance error (filtered/ray per reached texel): " << (result.IrradianceError / irradianceTexelCount / meanIrradiance) << "/" <<
+			(result.RayPerTexelIrradianceError / result.RayPerTexelCount / meanIrradiance) <<
+			"  Visibility error (m): " << (result.VisibilityError / visibilityTexelCount) <<
+			"  Trace/filter (us per probe): " << (result.TraceMilliseconds * 1.0e3 / probeCount) << "/" << (result.FilterMilliseconds * 1.0e3 / probeCount) << "\n";
+	}
+}
@@ -0,0 +1,90 @@
+#include "CpuPch.h"
+#include "Benchmark.h"
+#include "Renderer/ProbeRayTable.h"
+#include "Renderer/CPU/ProbeFilter.h"
+#include "Renderer/CPU/ProbeTracer.h"
+
+void Benchmark::ProbeRayTable(std::ostream& output)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	const Renderer::ProbeRayTable table;
+	const double generateMilliseconds = GetElapsedMilliseconds(start);
+
+	// Direction of every ray of every probe as RayGen computed them per probe and ray, against reading them from the table
+	constexpr uint32_t PROBE_COUNT = 100000;
+	uint64_t checksum = 0;
+	start = std::chrono::high_resolution_clock::now();
+	for (uint32_t p = 0; p < PROBE_COUNT; ++p)
+	{
+		for (uint32_t r = 0; r < Renderer::PROBE_RAY_COUNT; ++r)
+		{
+			const glm::vec3 direction = glm::normalize(Renderer::CPU::SphericalFibonacci(static_cast<float>(r), static_cast<float>(Renderer::PROBE_RAY_COUNT)));
+			checksum += static_cast<uint64_t>(direction.x > 0.0f) + static_cast<uint64_t>(direction.y > 0.0f) + static_cast<uint64_t>(direction.z > 0.0f) + p;
+		}
+	}
+	const double computeMilliseconds = GetElapsedMilliseconds(start);
+
+	uint64_t tableChecksum = 0;
+	start = std::chrono::high_resolution_clock::now();
+	for (uint32_t p = 0; p < PROBE_COUNT; ++p)
+	{
+		for (uint32_t r = 0; r < Renderer::PROBE_RAY_COUNT; ++r)
+		{
+			const glm::vec3& direction = table.GetRay(0, r).Direction;
+			tableChecksum += static_cast<uint64_t>(direction.x > 0.0f) + static_cast<uint64_t>(direction.y > 0.0f) + static_cast<uint64_t>(direction.z > 0.0f) + p;
+		}
+	}
+	const double tableMilliseconds = GetElapsedMilliseconds(start);
+
+	const double rayCount = static_cast<double>(PROBE_COUNT) * Renderer::PROBE_RAY_COUNT;
+	output << "Rays: " << Renderer::PROBE_RAY_COUNT << "  Rotations: " << Renderer::PROBE_RAY_ROTATION_COUNT <<
+		"  Table (KB): " << (sizeof(table.GetRays()) / 1024) <<
+		"  Generate (ms): " << generateMilliseconds <<
+		"  Ray setup (ns per ray, computed/table): " << (computeMilliseconds * 1.0e6 / rayCount) << "/" << (tableMilliseconds * 1.0e6 / rayCount) <<
+		"  Checksums match: " << (checksum == tableChecksum ? "yes" : "no") << "\n";
+
+	// How closely a probe's rays over a number of updates cover the directions of its visibility texels, as the largest and mean angle from a texel's
+	// direction to the nearest ray. Every ray is filtered into every texel, but the sharp visibility weighting leans on the nearest rays. Unrotated
+	// rays leave the same gaps every update, while rotated rays close them within a few updates
+	std::vector<glm::vec3> texelDirections;
+	for (int32_t y = 0; y < static_cast<int32_t>(Renderer::VISIBILITY_PROBE_SIDE_LENGTH); ++y)
+	{
+		for (int32_t x = 0; x < static_cast<int32_t>(Renderer::VISIBILITY_PROBE_SIDE_LENGTH); ++x)
+		{
+			texelDirections.push_back(Renderer::CPU::GetProbeTexelDirection(glm::ivec2(x, y), static_cast<int32_t>(Renderer::VISIBILITY_PROBE_SIDE_LENGTH)));
+		}
+	}
+
+	for (const uint32_t updateCount : { 1u, 4u, 16u, 64u })
+	{
+		float maxAngles[2] = {};
+		double meanAngles[2] = {};
+		for (const bool rotate : { false, true })
+		{
+			std::vector<float> nearestCosines(texelDirections.size(), -1.0f);
+			for (uint32_t u = 1; u <= updateCount; ++u)
+			{
+				const uint32_t rotationIndex = Renderer::GetProbeRayRotationIndex(rotate ? u : 0, 0);
+				for (uint32_t r = 0; r < Renderer::PROBE_RAY_COUNT; ++r)
+				{
+					const glm::vec3& direction = table.GetRay(rotationIndex, r).Direction;
+					for (size_t t = 0; t < texelDirections.size(); ++t)
+					{
+						nearestCosines[t] = std::max(nearestCosines[t], glm::dot(texelDirections[t], direction));
+					}
+				}
+			}
+
+			for (const float cosine : nearestCosines)
+			{
+				const float angle = glm::degrees(std::acos(std::clamp(cosine, -1.0f, 1.0f)));
+				maxAngles[rotate ? 1 : 0] = std::max(maxAngles[rotate ? 1 : 0], angle);
+				meanAngles[rotate ? 1 : 0] += angle / static_cast<double>(nearestCosines.size());
+			}
+		}
+
+		output << "Updates: " << updateCount <<
+			"  Degrees from a visibility texel to the nearest ray, mean/max (unrotated): " << meanAngles[0] << "/" << maxAngles[0] <<
+			"  (rotated): " << meanAngles[1] << "/" << maxAngles[1] << "\n";
+	}
+}
@@ -0,0 +1,106 @@
+#include "CpuPch.h"
+#include "Benchmark.h"
+#include "Math/Math.h"
+#include "Renderer/ProbeVolume.h"
+#include "Renderer/CPU/ProbeClassifier.h"
+#include "Renderer/CPU/ProbeRelocation.h"
+#include "Renderer/CPU/RaytracingScene.h"
+#include "Scene/Scenes/DemoSceneLayout.h"
+#include "Threading/TaskScheduler.h"
+
+namespace
+{
+	size_t CountInsideProbes(const Renderer::CPU::RaytracingScene& scene, const Renderer::ProbeVolume& volume,
+		const std::vector<uint32_t>& probeIndices, Threading::TaskScheduler& scheduler)
+	{
+		Renderer::CPU::ProbeClassificationSettings settings = {};
+		settings.pTaskScheduler = &scheduler;
+		auto probeStates = volume.GetProbeStates();
+		return Renderer::CPU::ClassifyProbes(scene, volume.GetProbePositions(), probeIndices, settings, probeStates).InsideGeometryCount;
+	}
+}
+
+void Benchmark::ProbeRelocation(std::ostream& output)
+{
+	DemoSceneFixture demoScene;
+	CreateDemoScene(demoScene);
+	auto& scene = demoScene.Scene;
+
+	Threading::TaskScheduler scheduler(1);
+	Renderer::CPU::ProbeRelocationSettings settings = {};
+	settings.pTaskScheduler = &scheduler;
+
+	// Probes buried in geometry before and after relocation, for the demo scene volume and denser volumes over the same space
+	output << "Threads: 1\n";
+	for (const float spacing : { DemoSceneLayout::PROBE_VOLUME_PROBE_SPACING, 0.83f, 0.7f, DENSE_PROBE_VOLUME_SPACING })
+	{
+		Renderer::ProbeVolume volume = CreateDemoProbeVolume(spacing);
+		std::vector<uint32_t> probeIndices(volume.GetTotalProbeCount());
+		std::iota(probeIndices.begin(), probeIndices.end(), 0);
+
+		// Grid positions must match the placed positions before relocation
+		size_t gridMismatchCount = 0;
+		for (const uint32_t p : probeIndices)
+		{
+			gridMismatchCount += (glm::vec3(volume.GetProbePositions()[p]) != volume.GetProbeGridPosition(p)) ? 1 : 0;
+		}
+
+		const size_t insideCount = CountInsideProbes(scene, volume, probeIndices, scheduler);
+		auto relocationOffsets = volume.GetProbeRelocationOffsets();
+		const auto stats = Renderer::CPU::RelocateProbes(scene, volume, probeIndices, settings, relocationOffsets);
+		volume.SetProbeRelocationOffsets(relocationOffsets);
+		const size_t relocatedInsideCount = CountInsideProbes(scene, volume, probeIndices, scheduler);
+
+		output << "Probes: " << volume.GetTotalProbeCount() << "  Spacing: " << spacing <<
+			"  Relocate (ms): " << stats.Milliseconds <<
+			"  Relocated: " << stats.RelocatedProbeCount <<
+			"  Inside geometry (grid/relocated): " << insideCount << "/" << relocatedInsideCount <<
+			"  Grid position mismatches: " << gridMismatchCount << "\n";
+	}
+
+	// The door sliding shut in front of a dense volume. Relocating only the probes near the door must give the offsets relocating every probe gives
+	{
+		constexpr uint32_t doorInstanceID = 7;
+		constexpr uint32_t frameCount = 50;
+		Renderer::ProbeVolume volume = CreateDemoProbeVolume();
+		std::vector<uint32_t> allProbeIndices(volume.GetTotalProbeCount());
+		std::iota(allProbeIndices.begin(), allProbeIndices.end(), 0);
+		auto incrementalOffsets = volume.GetProbeRelocationOffsets();
+		Renderer::CPU::RelocateProbes(scene, volume, allProbeIndices, settings, incrementalOffsets);
+		auto fullOffsets = incrementalOffsets;
+
+		Transform doorTransform = demoScene.Transforms[doorInstanceID];
+		const float doorStartX = doorTransform.Position.x;
+		size_t incrementalProbeCount = 0;
+		size_t mismatchCount = 0;
+		double incrementalMilliseconds = 0.0;
+		double fullMilliseconds = 0.0;
+		std::vector<uint32_t> probeIndices;
+		for (uint32_t frame = 1; frame <= frameCount; ++frame)
+		{
+			BoundingBox doorBounds = scene.GetTopLevelBvh().GetInstanceBoundsWS(doorInstanceID);
+			doorTransform.Position.x = doorStartX * (1.0f - static_cast<float>(frame) / static_cast<float>(frameCount));
+			scene.SetInstanceTransform(doorInstanceID, Math::CalculateWorldMatrix(doorTransform));
+			scene.Update();
+			doorBounds.Grow(scene.GetTopLevelBvh().GetInstanceBoundsWS(doorInstanceID));
+
+			const auto start = std::chrono::high_resolution_clock::now();
+			probeIndices.clear();
+			volume.GetProbesNear(doorBounds, volume.GetProbeSpacing() * 2.0f, probeIndices);
+			Renderer::CPU::RelocateProbes(scene, volume, probeIndices, settings, incrementalOffsets);
+			incrementalMilliseconds += GetElapsedMilliseconds(start);
+			incrementalProbeCount += probeIndices.size();
+
+			fullMilliseconds += Renderer::CPU::RelocateProbes(scene, volume, allProbeIndices, settings, fullOffsets).Milliseconds;
+			for (size_t p = 0; p < fullOffsets.size(); ++p)
+			{
+				mismatchCount += (incrementalOffsets[p] != fullOffsets[p]) ? 1 : 0;
+			}
+		}
+
+		output << "Door closing over " << frameCount << " frames  Probes: " << volume.GetTotalProbeCount() <<
+			"  Probes relocated per frame (all/near door): " << volume.GetTotalProbeCount() << "/" << (incrementalProbeCount / frameCount) <<
+			"  Relocate (ms per frame, all/near door): " << (fullMilliseconds / frameCount) << "/" << (incrementalMilliseconds / frameCount) <<
+			"  Offset mismatches: " << mismatchCount << "\n";
+	}
+}
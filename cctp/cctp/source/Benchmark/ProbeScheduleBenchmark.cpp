@@ -0,0 +1,137 @@
+#include "CpuPch.h"
+#include "Benchmark.h"
+#include "Renderer/ProbePool.h"
+#include "Renderer/ProbeUpdateScheduler.h"
+#include "Renderer/CPU/ProbeTracer.h"
+#include "Renderer/CPU/RaytracingScene.h"
+#include "Scene/Scenes/DemoSceneLayout.h"
+
+namespace
+{
+	struct FrameStats
+	{
+		std::vector<double> Milliseconds;
+		std::vector<size_t> RayCounts;
+		uint64_t MaxAge = 0;
+		double SumMeanAge = 0.0;
+
+		void Write(std::ostream& output, const double spikeMilliseconds) const
+		{
+			const double mean = std::accumulate(Milliseconds.begin(), Milliseconds.end(), 0.0) / Milliseconds.size();
+			const auto spikeCount = std::count_if(Milliseconds.begin(), Milliseconds.end(), [spikeMilliseconds](const double ms) { return ms > spikeMilliseconds; });
+			output << "Update (ms per frame, mean/max): " << mean << "/" << *std::max_element(Milliseconds.begin(), Milliseconds.end()) <<
+				"  Frames over " << spikeMilliseconds << " ms: " << spikeCount << "/" << Milliseconds.size() <<
+				"  Rays per frame (mean/max): " << (std::accumulate(RayCounts.begin(), RayCounts.end(), size_t(0)) / RayCounts.size()) << "/" <<
+				*std::max_element(RayCounts.begin(), RayCounts.end()) <<
+				"  Probe age (frames, mean/max): " << (SumMeanAge / Milliseconds.size()) << "/" << MaxAge;
+		}
+	};
+}
+
+void Benchmark::ProbeSchedule(std::ostream& output)
+{
+	DemoSceneFixture demoScene;
+	CreateDemoScene(demoScene);
+	const auto& scene = demoScene.Scene;
+
+	Renderer::ProbePool pool;
+	pool.AddVolume(CreateDemoProbeVolume());
+	const auto& volume = pool.GetVolume(0);
+	const auto& probePositions = volume.GetProbePositions();
+	std::vector<uint32_t> allProbeIndices(probePositions.size());
+	std::iota(allProbeIndices.begin(), allProbeIndices.end(), 0);
+
+	Renderer::CPU::ProbeTraceSettings traceSettings = {};
+	traceSettings.LightDirectionWS = DemoSceneLayout::DEFAULT_LIGHT_DIRECTION_WS;
+	traceSettings.pProbeStates = &volume.GetProbeStates();
+
+	// The camera walks a circle through the volume. The periodic update retraces every probe each gather period, as the main loop did at 60 frames a
+	// second with a 0.1 second gather rate, and the scheduler spreads the same number of rays over every frame
+	constexpr uint32_t FRAME_COUNT = 120;
+	constexpr uint32_t GATHER_PERIOD_FRAMES = 6;
+	const auto getCameraPosition = [&](const uint32_t frame)
+		{
+			const float angle = glm::two_pi<float>() * static_cast<float>(frame) / static_cast<float>(FRAME_COUNT);
+			return DemoSceneLayout::PROBE_VOLUME_START_POSITION + glm::vec3(std::cos(angle), 0.0f, std::sin(angle)) * 1.5f;
+		};
+
+	Renderer::CPU::ProbeTracer periodicTracer;
+	periodicTracer.TraceProbes(scene, probePositions, traceSettings);
+	FrameStats periodic;
+	for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame)
+	{
+		const bool gather = (frame % GATHER_PERIOD_FRAMES) == 0;
+		const auto stats = gather ? periodicTracer.TraceProbes(scene, probePositions, traceSettings) : Renderer::CPU::ProbeTraceStats{};
+		periodic.Milliseconds.push_back(stats.GetTotalMilliseconds());
+		periodic.RayCounts.push_back(stats.RayCount);
+		const uint64_t age = frame % GATHER_PERIOD_FRAMES;
+		periodic.MaxAge = std::max<uint64_t>(periodic.MaxAge, GATHER_PERIOD_FRAMES - 1);
+		periodic.SumMeanAge += static_cast<double>(age);
+	}
+	const double spikeMilliseconds = 2.0 * std::accumulate(periodic.Milliseconds.begin(), periodic.Milliseconds.end(), 0.0) / FRAME_COUNT;
+
+	output << "Probes: " << probePositions.size() << "  Frames: " << FRAME_COUNT << "  Gather period (frames): " << GATHER_PERIOD_FRAMES << "\n";
+	output << "Periodic  ";
+	periodic.Write(output, spikeMilliseconds);
+	output << "\n";
+
+	// Scheduled with the periodic update's mean ray count per frame as a ray budget, and with its mean time per frame as a microsecond budget
+	const double periodicMeanMilliseconds = std::accumulate(periodic.Milliseconds.begin(), periodic.Milliseconds.end(), 0.0) / FRAME_COUNT;
+	for (const auto budgetMode : { Renderer::ProbeUpdateBudgetMode::Rays, Renderer::ProbeUpdateBudgetMode::Microseconds })
+	{
+		Renderer::ProbeUpdateSchedulerSettings scheduleSettings = {};
+		scheduleSettings.BudgetMode = budgetMode;
+		scheduleSettings.RayBudget = static_cast<uint32_t>(probePositions.size() * Renderer::PROBE_RAY_COUNT / GATHER_PERIOD_FRAMES);
+		scheduleSettings.MicrosecondBudget = static_cast<float>(periodicMeanMilliseconds * 1000.0);
+
+		Renderer::CPU::ProbeTracer tracer;
+		tracer.TraceProbes(scene, probePositions, traceSettings);
+		Renderer::ProbeUpdateScheduler scheduler;
+		scheduler.Schedule(pool, getCameraPosition(0), nullptr, 0, scheduleSettings);
+		FrameStats scheduled;
+		double scheduleMilliseconds = 0.0;
+		for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame)
+		{
+			const auto& schedule = scheduler.Schedule(pool, getCameraPosition(frame), tracer.GetProbeStatistics().data(), probePositions.size(), scheduleSettings);
+			const auto stats = tracer.TraceProbes(scene, probePositions, schedule.ProbeIndices, traceSettings);
+			scheduler.ReportUpdateCost(stats.RayCount, stats.GetTotalMilliseconds() * 1000.0);
+			scheduled.Milliseconds.push_back(stats.GetTotalMilliseconds());
+			scheduled.RayCounts.push_back(stats.RayCount);
+			scheduled.MaxAge = std::max(scheduled.MaxAge, schedule.MaxAge);
+			scheduled.SumMeanAge += schedule.MeanAge;
+			scheduleMilliseconds += schedule.Milliseconds;
+		}
+
+		output << (budgetMode == Renderer::ProbeUpdateBudgetMode::Rays ? "Scheduled (ray budget " : "Scheduled (microsecond budget ");
+		output << (budgetMode == Renderer::ProbeUpdateBudgetMode::Rays ? static_cast<double>(scheduleSettings.RayBudget) : static_cast<double>(scheduleSettings.MicrosecondBudget)) << ")  ";
+		scheduled.Write(output, spikeMilliseconds);
+		output << "  Schedule (ms per frame): " << (scheduleMilliseconds / FRAME_COUNT) << "\n";
+	}
+
+	// The cost of scheduling alone over a pool the size of a level with cascades around the camera
+	Renderer::ProbePool largePool;
+	largePool.AddVolume(Renderer::ProbeVolume(glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(10.0f), 0.25f, 0.05f));
+	largePool.AddCascades(glm::vec3(-3.0f, 1.5f, -4.0f), glm::vec3(8.0f), 0.5f, 3, 0.05f);
+	std::vector<Renderer::ProbeStatistics> largeStatistics(largePool.GetTotalProbeCount());
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> change(0.0f, 0.1f);
+	for (auto& statistics : largeStatistics)
+	{
+		statistics.Change = change(random);
+	}
+
+	Renderer::ProbeUpdateScheduler largeScheduler;
+	Renderer::ProbeUpdateSchedulerSettings largeSettings = {};
+	double largeScheduleMilliseconds = 0.0;
+	uint64_t largeMaxAge = 0;
+	for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame)
+	{
+		const auto& schedule = largeScheduler.Schedule(largePool, glm::vec3(-3.0f, 1.5f, -4.0f), largeStatistics.data(), largeStatistics.size(), largeSettings);
+		largeScheduleMilliseconds += schedule.Milliseconds;
+		largeMaxAge = std::max(largeMaxAge, schedule.MaxAge);
+	}
+	output << "Probes: " << largePool.GetTotalProbeCount() << "  Ray budget: " << largeSettings.RayBudget <<
+		"  Schedule (ms per frame): " << (largeScheduleMilliseconds / FRAME_COUNT) <<
+		"  Frames for one full rotation: " << (largePool.GetTotalProbeCount() * Renderer::PROBE_RAY_COUNT / largeSettings.RayBudget) <<
+		"  Max probe age (frames): " << largeMaxAge << "\n";
+}
@@ -0,0 +1,113 @@
+#include "CpuPch.h"
+#include "Benchmark.h"
+#include "Renderer/ProbeVolume.h"
+#include "Renderer/CPU/ProbeTracer.h"
+#include "Renderer/CPU/RaytracingScene.h"
+#include "Scene/Scenes/DemoSceneLayout.h"
+#include "Threading/TaskScheduler.h"
+
+namespace
+{
+	struct PathResult
+	{
+		size_t TracedProbeCount = 0;
+		double UpdateMilliseconds = 0.0;
+		double TraceMilliseconds = 0.0;
+	};
+
+	// Moves the volume along the path one point per frame, clearing and tracing the probes each frame resets as a renderer would before shading with them
+	PathResult RunPath(const Renderer::CPU::RaytracingScene& scene, const std::vector<glm::vec3>& path,
+		Renderer::ProbeVolume& volume, Renderer::CPU::ProbeTracer& tracer)
+	{
+		Threading::TaskScheduler scheduler(1);
+		Renderer::CPU::ProbeTraceSettings settings = {};
+		settings.LightDirectionWS = DemoSceneLayout::DEFAULT_LIGHT_DIRECTION_WS;
+		settings.pTaskScheduler = &scheduler;
+
+		PathResult result = {};
+		uint64_t tracedFrameIndex = 0;
+		std::vector<uint32_t> probeIndices;
+		for (const auto& position : path)
+		{
+			const auto start = std::chrono::high_resolution_clock::now();
+			volume.GetVolumePosition() = position;
+			volume.Update();
+			result.UpdateMilliseconds += Benchmark::GetElapsedMilliseconds(start);
+
+			probeIndices.clear();
+			volume.GetProbesResetSince(tracedFrameIndex, probeIndices);
+			tracedFrameIndex = volume.GetFrameIndex();
+			if (!probeIndices.empty())
+			{
+				tracer.ClearProbes(probeIndices);
+				result.TraceMilliseconds += tracer.TraceProbes(scene, volume.GetProbePositions(), probeIndices, settings).GetTotalMilliseconds();
+				result.TracedProbeCount += probeIndices.size();
+			}
+		}
+		return result;
+	}
+
+	template<typename T>
+	size_t CountTexelMismatches(const Renderer::CPU::Texture2D<T>& a, const Renderer::CPU::Texture2D<T>& b)
+	{
+		size_t mismatchCount = 0;
+		for (uint32_t y = 0; y < a.GetHeight(); ++y)
+		{
+			for (uint32_t x = 0; x < a.GetWidth(); ++x)
+			{
+				if (a.Load(static_cast<int32_t>(x), static_cast<int32_t>(y)) != b.Load(static_cast<int32_t>(x), static_cast<int32_t>(y)))
+				{
+					++mismatchCount;
+				}
+			}
+		}
+		return mismatchCount;
+	}
+}
+
+void Benchmark::ProbeVolumeScroll(std::ostream& output)
+{
+	DemoSceneFixture demoScene;
+	CreateDemoScene(demoScene);
+	const auto& scene = demoScene.Scene;
+
+	// A camera flying through the scene at a steady speed, one point per frame
+	auto startVolume = DemoSceneLayout::CreateProbeVolume();
+	const glm::vec3 startPosition = startVolume.GetVolumePosition();
+	for (const float frameDistance : { 0.01f, 0.05f, 0.25f })
+	{
+		std::vector<glm::vec3> path;
+		for (float distance = 0.0f; distance <= 20.0f; distance += frameDistance)
+		{
+			path.push_back(startPosition + glm::vec3(distance - 10.0f, 0.0f, distance * 0.25f));
+		}
+
+		// A fixed volume moved with the camera resets every probe on every frame it moves
+		auto fixedVolume = DemoSceneLayout::CreateProbeVolume();
+		Renderer::CPU::ProbeTracer fixedTracer;
+		const auto fixed = RunPath(scene, path, fixedVolume, fixedTracer);
+
+		auto scrollingVolume = DemoSceneLayout::CreateProbeVolume();
+		scrollingVolume.SetScrolling(true);
+		Renderer::CPU::ProbeTracer scrollingTracer;
+		const auto scrolling = RunPath(scene, path, scrollingVolume, scrollingTracer);
+
+		// Probes kept across scrolls must hold what tracing the final volume from scratch produces
+		Renderer::CPU::ProbeTracer referenceTracer;
+		Threading::TaskScheduler scheduler(1);
+		Renderer::CPU::ProbeTraceSettings settings = {};
+		settings.LightDirectionWS = DemoSceneLayout::DEFAULT_LIGHT_DIRECTION_WS;
+		settings.pTaskScheduler = &scheduler;
+		referenceTracer.TraceProbes(scene, scrollingVolume.GetProbePositions(), settings);
+		const size_t mismatchCount =
+			CountTexelMismatches(scrollingTracer.GetIrradianceAtlas(), referenceTracer.GetIrradianceAtlas()) +
+			CountTexelMismatches(scrollingTracer.GetVisibilityAtlas(), referenceTracer.GetVisibilityAtlas());
+
+		output << "Frames: " << path.size() << "  Distance per frame: " << frameDistance <<
+			"  Probes traced (fixed/scrolling): " << fixed.TracedProbeCount << "/" << scrolling.TracedProbeCount <<
+			"  Trace (ms, fixed/scrolling): " << fixed.TraceMilliseconds << "/" << scrolling.TraceMilliseconds <<
+			"  Update (us per frame, fixed/scrolling): " << (fixed.UpdateMilliseconds * 1000.0 / path.size()) << "/" <<
+			(scrolling.UpdateMilliseconds * 1000.0 / path.size()) <<
+			"  Texels differing from a full trace: " << mismatchCount << "\n";
+	}
+}
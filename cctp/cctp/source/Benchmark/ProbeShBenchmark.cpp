@@ -0,0 +1,290 @@
+#include "CpuPch.h"
+#include "Benchmark.h"
+#include "Math/PackedFloat.h"
+#include "Math/SphericalHarmonics.h"
+#include "Renderer/ProbePool.h"
+#include "Renderer/CPU/ProbeShading.h"
+#include "Renderer/CPU/ProbeTracer.h"
+#include "Renderer/CPU/RaytracingScene.h"
+#include "Scene/Scenes/DemoSceneLayout.h"
+
+namespace
+{
+	constexpr uint32_t SH_FLOAT_COUNT = Renderer::PROBE_SH_MAX_COEFFICIENT_COUNT * Renderer::PROBE_SH_CHANNEL_COUNT;
+
+	// Irradiance / pi and hit distance a probe sees in each direction, with irradiance integrated over many more rays than a gather traces
+	void MeasureReference(const Renderer::CPU::RaytracingScene& scene, const glm::vec3& origin, const glm::vec3& lightVectorWS,
+		const std::vector<glm::vec3>& directions, std::vector<glm::vec3>& irradiance, std::vector<float>& distances)
+	{
+		std::vector<glm::vec3> rayDirections;
+		std::vector<glm::vec4> rayData;
+		Renderer::CPU::TraceProbeReference(scene, origin, Renderer::CPU::PROBE_REFERENCE_RAY_COUNT, lightVectorWS, 1.0f, rayDirections, rayData);
+
+		irradiance.resize(directions.size());
+		distances.resize(directions.size());
+		for (size_t d = 0; d < directions.size(); ++d)
+		{
+			irradiance[d] = Renderer::CPU::IntegrateProbeIrradiance(rayData.data(), rayDirections.data(), Renderer::CPU::PROBE_REFERENCE_RAY_COUNT, directions[d]);
+			distances[d] = Renderer::CPU::TraceProbeRay(scene, origin, directions[d], lightVectorWS, 1.0f).w;
+		}
+	}
+}
+
+void Benchmark::ProbeSphericalHarmonics(std::ostream& output)
+{
+	// Memory per probe. An octahedral probe owns a tile, border included, in the irradiance and visibility atlases and in the filtered textures.
+	// A spherical harmonic probe stores its coefficients as halves and needs no filtered textures. Both encodings trace into the ray data buffer
+	constexpr size_t irradianceTileBytes = (Renderer::IRRADIANCE_PROBE_SIDE_LENGTH + 2 * Renderer::PROBE_PADDING) * (Renderer::IRRADIANCE_PROBE_SIDE_LENGTH + 2 * Renderer::PROBE_PADDING) * 4;
+	constexpr size_t visibilityTileBytes = (Renderer::VISIBILITY_PROBE_SIDE_LENGTH + 2 * Renderer::PROBE_PADDING) * (Renderer::VISIBILITY_PROBE_SIDE_LENGTH + 2 * Renderer::PROBE_PADDING) * 4;
+	constexpr size_t octahedralBytes = irradianceTileBytes + visibilityTileBytes;
+	constexpr size_t l1Bytes = Math::SH_L1_COEFFICIENT_COUNT * Renderer::PROBE_SH_CHANNEL_COUNT * sizeof(uint16_t);
+	constexpr size_t l2Bytes = Math::SH_L2_COEFFICIENT_COUNT * Renderer::PROBE_SH_CHANNEL_COUNT * sizeof(uint16_t);
+	output << "Bytes per probe  Octahedral atlases: " << octahedralBytes << " (" << (2 * octahedralBytes) << " with filtered)" <<
+		"  L1: " << l1Bytes << "  L2: " << l2Bytes << " (" << (Renderer::PROBE_SH_STRIDE * sizeof(uint32_t)) << " reserved in the buffer)" <<
+		"  Ray data: " << (Renderer::PROBE_RAY_COUNT * sizeof(glm::vec4)) <<
+		"  Reduction L1/L2: " << (static_cast<double>(octahedralBytes) / l1Bytes) << "x/" << (static_cast<double>(octahedralBytes) / l2Bytes) << "x\n";
+
+	std::mt19937 generator(21);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+	// Kernels on random coefficients and directions
+	constexpr size_t directionCount = 1 << 18;
+	std::vector<glm::vec3> directions(directionCount);
+	for (auto& direction : directions)
+	{
+		direction = glm::normalize(glm::vec3(distribution(generator), distribution(generator), distribution(generator)) + glm::vec3(0.0f, 0.0f, 1.0e-3f));
+	}
+	std::vector<float> coefficients(SH_FLOAT_COUNT);
+	for (auto& coefficient : coefficients)
+	{
+		coefficient = distribution(generator);
+	}
+
+	for (const uint32_t coefficientCount : { Math::SH_L1_COEFFICIENT_COUNT, Math::SH_L2_COEFFICIENT_COUNT })
+	{
+		std::vector<float> referenceValues(directionCount * Renderer::PROBE_SH_CHANNEL_COUNT);
+		auto start = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < directionCount; ++i)
+		{
+			for (uint32_t k = 0; k < Renderer::PROBE_SH_CHANNEL_COUNT; ++k)
+			{
+				referenceValues[k * directionCount + i] = Math::EvaluateSh(coefficients.data(), coefficientCount, Renderer::PROBE_SH_CHANNEL_COUNT, k, directions[i]);
+			}
+		}
+		const double singleNanoseconds = GetElapsedMilliseconds(start) * 1.0e6 / directionCount;
+
+		std::vector<float> values(directionCount * Renderer::PROBE_SH_CHANNEL_COUNT);
+		start = std::chrono::high_resolution_clock::now();
+		Math::EvaluateSh(coefficients.data(), coefficientCount, Renderer::PROBE_SH_CHANNEL_COUNT, directions.data(), directionCount, values.data(), false);
+		const double scalarNanoseconds = GetElapsedMilliseconds(start) * 1.0e6 / directionCount;
+		size_t mismatchCount = memcmp(values.data(), referenceValues.data(), values.size() * sizeof(float)) != 0 ? 1 : 0;
+
+		start = std::chrono::high_resolution_clock::now();
+		Math::EvaluateSh(coefficients.data(), coefficientCount, Renderer::PROBE_SH_CHANNEL_COUNT, directions.data(), directionCount, values.data(), true);
+		const double simdNanoseconds = GetElapsedMilliseconds(start) * 1.0e6 / directionCount;
+		for (size_t i = 0; i < values.size(); ++i)
+		{
+			mismatchCount += memcmp(&values[i], &referenceValues[i], sizeof(float)) != 0 ? 1 : 0;
+		}
+
+		// Projection of a gather's rays, one probe's worth at a time
+		constexpr size_t projectedProbeCount = directionCount / Renderer::PROBE_RAY_COUNT;
+		const float weight = 4.0f * glm::pi<float>() / static_cast<float>(Renderer::PROBE_RAY_COUNT);
+		std::vector<float> scalarCoefficients(projectedProbeCount * SH_FLOAT_COUNT, 0.0f);
+		std::vector<float> simdCoefficients(projectedProbeCount * SH_FLOAT_COUNT, 0.0f);
+		const size_t probeValueCount = Renderer::PROBE_RAY_COUNT * Renderer::PROBE_SH_CHANNEL_COUNT;
+		start = std::chrono::high_resolution_clock::now();
+		for (size_t p = 0; p < projectedProbeCount; ++p)
+		{
+			Math::ProjectSh(directions.data() + p * Renderer::PROBE_RAY_COUNT, referenceValues.data() + p * probeValueCount, Renderer::PROBE_RAY_COUNT,
+				Renderer::PROBE_SH_CHANNEL_COUNT, weight, coefficientCount, scalarCoefficients.data() + p * SH_FLOAT_COUNT, false);
+		}
+		const double scalarProjectNanoseconds = GetElapsedMilliseconds(start) * 1.0e6 / projectedProbeCount;
+		start = std::chrono::high_resolution_clock::now();
+		for (size_t p = 0; p < projectedProbeCount; ++p)
+		{
+			Math::ProjectSh(directions.data() + p * Renderer::PROBE_RAY_COUNT, referenceValues.data() + p * probeValueCount, Renderer::PROBE_RAY_COUNT,
+				Renderer::PROBE_SH_CHANNEL_COUNT, weight, coefficientCount, simdCoefficients.data() + p * SH_FLOAT_COUNT, true);
+		}
+		const double simdProjectNanoseconds = GetElapsedMilliseconds(start) * 1.0e6 / projectedProbeCount;
+		float maxProjectDifference = 0.0f;
+		float maxCoefficient = 0.0f;
+		for (size_t i = 0; i < scalarCoefficients.size(); ++i)
+		{
+			maxProjectDifference = std::max(maxProjectDifference, std::abs(simdCoefficients[i] - scalarCoefficients[i]));
+			maxCoefficient = std::max(maxCoefficient, std::abs(scalarCoefficients[i]));
+		}
+
+		output << (coefficientCount == Math::SH_L1_COEFFICIENT_COUNT ? "L1" : "L2") <<
+			"  Evaluate " << Renderer::PROBE_SH_CHANNEL_COUNT << " channels (ns per direction, single/scalar batch/SIMD batch): " <<
+			singleNanoseconds << "/" << scalarNanoseconds << "/" << simdNanoseconds << "  Mismatches: " << mismatchCount <<
+			"  Project " << Renderer::PROBE_RAY_COUNT << " rays (ns per probe, scalar/SIMD): " << scalarProjectNanoseconds << "/" << simdProjectNanoseconds <<
+			"  Max SIMD difference: " << (maxCoefficient > 0.0f ? maxProjectDifference / maxCoefficient : 0.0f) << " of the largest coefficient\n";
+	}
+
+	// The octahedral lookup the shaders make per probe in place of an evaluation: a bilinear irradiance sample and a visibility load
+	{
+		const glm::ivec3 probeCounts = glm::ivec3(16, 16, 16);
+		const Renderer::ProbeAtlasLayout atlasLayout(static_cast<size_t>(probeCounts.x * probeCounts.y * probeCounts.z), probeCounts);
+		Renderer::CPU::Texture2D<glm::vec3> irradianceAtlas(atlasLayout.GetIrradianceAtlasDimensions().x, atlasLayout.GetIrradianceAtlasDimensions().y);
+		Renderer::CPU::Texture2D<glm::vec2> visibilityAtlas(atlasLayout.GetVisibilityAtlasDimensions().x, atlasLayout.GetVisibilityAtlasDimensions().y);
+		irradianceAtlas.Clear(glm::vec3(0.5f));
+		visibilityAtlas.Clear(glm::vec2(0.5f, 0.25f));
+		const uint32_t probesPerRow = atlasLayout.GetProbesPerRow();
+		const glm::vec2 irradianceAtlasDimensions = glm::vec2(atlasLayout.GetIrradianceAtlasDimensions());
+
+		glm::vec3 checksum = glm::vec3(0.0f);
+		const auto start = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < directionCount; ++i)
+		{
+			const auto p = static_cast<uint32_t>(i % atlasLayout.GetProbeCapacity());
+			const glm::vec2 irradianceTexel = Renderer::CPU::GetProbeTexelCoordinate(directions[i], p, probesPerRow,
+				static_cast<float>(Renderer::IRRADIANCE_PROBE_SIDE_LENGTH), Renderer::PROBE_PADDING);
+			const glm::vec2 visibilityTexel = Renderer::CPU::GetProbeTexelCoordinate(-directions[i], p, probesPerRow,
+				static_cast<float>(Renderer::VISIBILITY_PROBE_SIDE_LENGTH), Renderer::PROBE_PADDING);
+			checksum += irradianceAtlas.SampleLinear(irradianceTexel / irradianceAtlasDimensions) * visibilityAtlas.Load(visibilityTexel).x;
+		}
+		const double octahedralNanoseconds = GetElapsedMilliseconds(start) * 1.0e6 / directionCount;
+		output << "Octahedral  Irradiance sample and visibility load (ns per direction): " << octahedralNanoseconds <<
+			"  Checksum: " << static_cast<uint64_t>(checksum.x + checksum.y + checksum.z) % 1000 << "\n";
+	}
+
+	// Accuracy on the demo scene. Probes of each encoding are traced for the same gathers and compared against irradiance integrated over many more
+	// rays in the directions of surface normals, and against the distance to the geometry in those directions
+	DemoSceneFixture demoScene;
+	CreateDemoScene(demoScene);
+	const auto& scene = demoScene.Scene;
+
+	Renderer::ProbePool pool;
+	pool.AddVolume(CreateDemoProbeVolume(DENSE_PROBE_VOLUME_SPACING, glm::vec3(2.5f)));
+	const auto& probePositions = pool.GetVolume(0).GetProbePositions();
+	const auto probeCount = static_cast<uint32_t>(probePositions.size());
+	const glm::vec3 lightVectorWS = -glm::normalize(DemoSceneLayout::DEFAULT_LIGHT_DIRECTION_WS);
+	constexpr uint32_t GATHER_COUNT = 64;
+
+	constexpr uint32_t normalCount = 64;
+	std::vector<glm::vec3> normals(normalCount);
+	for (uint32_t n = 0; n < normalCount; ++n)
+	{
+		normals[n] = Renderer::CPU::SphericalFibonacci(static_cast<float>(n) + 0.5f, static_cast<float>(normalCount));
+	}
+	std::vector<std::vector<glm::vec3>> referenceIrradiance(probeCount);
+	std::vector<std::vector<float>> referenceDistances(probeCount);
+	for (uint32_t p = 0; p < probeCount; ++p)
+	{
+		MeasureReference(scene, glm::vec3(probePositions[p]), lightVectorWS, normals, referenceIrradiance[p], referenceDistances[p]);
+	}
+
+	// Shading points inside the probe grid with random normals, to time Irradiance() reading each encoding
+	constexpr size_t pointCount = 1 << 16;
+	std::vector<Renderer::ProbeVolumeData> volumeData;
+	pool.GetVolumeData(volumeData);
+	const glm::vec3 gridOrigin = glm::vec3(volumeData[0].GridOriginAndSpacing);
+	const glm::vec3 gridSize = glm::vec3(glm::ivec3(volumeData[0].ProbeCounts) - 1) * volumeData[0].GridOriginAndSpacing.w;
+	std::uniform_real_distribution<float> unitDistribution(0.0f, 1.0f);
+	std::vector<glm::vec3> points(pointCount);
+	std::vector<glm::vec3> pointNormals(pointCount);
+	for (size_t i = 0; i < pointCount; ++i)
+	{
+		points[i] = gridOrigin + glm::vec3(unitDistribution(generator), unitDistribution(generator), unitDistribution(generator)) * gridSize;
+		pointNormals[i] = directions[i];
+	}
+	const std::vector<uint32_t> probeStates(probeCount, static_cast<uint32_t>(Renderer::ProbeState::Active));
+
+	output << "Probes: " << probeCount << "  Gathers: " << GATHER_COUNT << "  Rays per probe: " << Renderer::PROBE_RAY_COUNT <<
+		"  Reference rays per probe: 2048  Directions compared per probe: " << normalCount << "\n";
+	for (const auto encoding : { Renderer::ProbeEncoding::Octahedral, Renderer::ProbeEncoding::SphericalHarmonicsL1, Renderer::ProbeEncoding::SphericalHarmonicsL2 })
+	{
+		Renderer::CPU::ProbeTraceSettings settings = {};
+		settings.LightDirectionWS = DemoSceneLayout::DEFAULT_LIGHT_DIRECTION_WS;
+		settings.Encoding = encoding;
+		Renderer::CPU::ProbeTracer tracer;
+		double traceMilliseconds = 0.0;
+		double blendMilliseconds = 0.0;
+		for (uint32_t g = 0; g < GATHER_COUNT; ++g)
+		{
+			settings.RayRotationSeed = g + 1;
+			const auto stats = tracer.TraceProbes(scene, probePositions, settings);
+			traceMilliseconds += stats.TraceMilliseconds;
+			blendMilliseconds += stats.FilterMilliseconds + stats.BlendMilliseconds;
+		}
+
+		// Coefficients as the GPU stores them, rounded to halves
+		std::vector<float> halfCoefficients = tracer.GetProbeShCoefficients();
+		for (auto& coefficient : halfCoefficients)
+		{
+			coefficient = Math::HalfToFloat(Math::FloatToHalf(coefficient));
+		}
+
+		const uint32_t shCoefficientCount = Renderer::GetProbeShCoefficientCount(encoding);
+		const auto& atlasLayout = tracer.GetAtlasLayout();
+		const glm::vec2 irradianceAtlasDimensions = glm::vec2(atlasLayout.GetIrradianceAtlasDimensions());
+		double sumReferenceLuminance = 0.0;
+		double sumLuminanceError = 0.0;
+		double sumHalfLuminanceError = 0.0;
+		double sumDistanceError = 0.0;
+		for (uint32_t p = 0; p < probeCount; ++p)
+		{
+			const float* pCoefficients = tracer.GetProbeShCoefficients().data() + static_cast<size_t>(p) * SH_FLOAT_COUNT;
+			const float* pHalfCoefficients = halfCoefficients.data() + static_cast<size_t>(p) * SH_FLOAT_COUNT;
+			for (uint32_t n = 0; n < normalCount; ++n)
+			{
+				glm::vec3 irradiance = glm::vec3(0.0f);
+				glm::vec3 halfIrradiance = glm::vec3(0.0f);
+				float distance = 0.0f;
+				if (shCoefficientCount > 0)
+				{
+					for (uint32_t k = 0; k < 3; ++k)
+					{
+						irradiance[k] = std::max(Math::EvaluateSh(pCoefficients, shCoefficientCount, Renderer::PROBE_SH_CHANNEL_COUNT, k, normals[n]), 0.0f);
+						halfIrradiance[k] = std::max(Math::EvaluateSh(pHalfCoefficients, shCoefficientCount, Renderer::PROBE_SH_CHANNEL_COUNT, k, normals[n]), 0.0f);
+					}
+					distance = std::max(Math::EvaluateSh(pCoefficients, shCoefficientCount, Renderer::PROBE_SH_CHANNEL_COUNT, 3, normals[n]), 0.0f);
+				}
+				else
+				{
+					const glm::vec2 irradianceTexel = Renderer::CPU::GetProbeTexelCoordinate(normals[n], p, atlasLayout.GetProbesPerRow(),
+						static_cast<float>(Renderer::IRRADIANCE_PROBE_SIDE_LENGTH), Renderer::PROBE_PADDING);
+					const glm::vec2 visibilityTexel = Renderer::CPU::GetProbeTexelCoordinate(normals[n], p, atlasLayout.GetProbesPerRow(),
+						static_cast<float>(Renderer::VISIBILITY_PROBE_SIDE_LENGTH), Renderer::PROBE_PADDING);
+					irradiance = tracer.GetIrradianceAtlas().SampleLinear(irradianceTexel / irradianceAtlasDimensions);
+					halfIrradiance = irradiance;
+					distance = tracer.GetVisibilityAtlas().Load(visibilityTexel).x;
+				}
+
+				const float referenceLuminance = Renderer::CPU::Luminance(referenceIrradiance[p][n]);
+				sumReferenceLuminance += referenceLuminance;
+				sumLuminanceError += std::abs(Renderer::CPU::Luminance(irradiance) - referenceLuminance);
+				sumHalfLuminanceError += std::abs(Renderer::CPU::Luminance(halfIrradiance) - referenceLuminance);
+				sumDistanceError += std::abs(distance - referenceDistances[p][n]);
+			}
+		}
+
+		// Whole shading points lit by the eight probe cage
+		Renderer::CPU::ProbeShadingInputs inputs = {};
+		volumeData[0].ScrollOffset.w = static_cast<int32_t>(encoding);
+		inputs.pVolumeData = &volumeData;
+		inputs.pProbePositions = &probePositions;
+		inputs.pProbeStates = &probeStates;
+		inputs.pAtlasLayout = &atlasLayout;
+		inputs.pIrradianceAtlas = &tracer.GetIrradianceAtlas();
+		inputs.pVisibilityAtlas = &tracer.GetVisibilityAtlas();
+		inputs.pShCoefficients = &tracer.GetProbeShCoefficients();
+		glm::vec3 checksum = glm::vec3(0.0f);
+		const auto start = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < pointCount; ++i)
+		{
+			checksum += Renderer::CPU::Irradiance(inputs, points[i], pointNormals[i]);
+		}
+		const double shadingNanoseconds = GetElapsedMilliseconds(start) * 1.0e6 / pointCount;
+
+		const double sampleCount = static_cast<double>(probeCount) * normalCount;
+		output << (shCoefficientCount == 0 ? "Octahedral" : (shCoefficientCount == Math::SH_L1_COEFFICIENT_COUNT ? "L1" : "L2")) <<
+			"  Irradiance error: " << (sumReferenceLuminance > 0.0 ? sumLuminanceError / sumReferenceLuminance * 100.0 : 0.0) << "%" <<
+			" (" << (sumReferenceLuminance > 0.0 ? sumHalfLuminanceError / sumReferenceLuminance * 100.0 : 0.0) << "% stored as halves)" <<
+			"  Mean distance error: " << (sumDistanceError / sampleCount) <<
+			"  Trace/filter and blend (ms): " << traceMilliseconds << "/" << blendMilliseconds <<
+			"  Irradiance() (ns per point): " << shadingNanoseconds <<
+			"  Checksum: " << static_cast<uint64_t>(checksum.x + checksum.y + checksum.z) % 1000 << "\n";
+	}
+}
@@ -0,0 +1,115 @@
+#include "CpuPch.h"
+#include "Benchmark.h"
+#include "Math/Transform.h"
+#include "Renderer/ProbeVolume.h"
+
+namespace
+{
+	// The previous layout, a full transform per probe, updated probe by probe
+	void UpdateProbeTransforms(std::vector<Transform>& transforms, const glm::vec3& position, const glm::vec3& extents, const float spacing,
+		const size_t countX, const size_t countY, const size_t countZ)
+	{
+		for (size_t x = 0; x < countX; ++x)
+		{
+			for (size_t y = 0; y < countY; ++y)
+			{
+				for (size_t z = 0; z < countZ; ++z)
+				{
+					transforms[x + countX * (y + countY * z)].Position = position + glm::vec3((x * spacing) - ((extents.x - spacing) / 2.0f),
+						(y * spacing) - ((extents.y - spacing) / 2.0f),
+						(z * spacing) - ((extents.z - spacing) / 2.0f));
+				}
+			}
+		}
+	}
+}
+
+void Benchmark::ProbeVolumeUpdate(std::ostream& output)
+{
+	// Probes processed per measurement, spread over repeated updates of smaller volumes
+	constexpr size_t probeBudget = 20000000;
+	constexpr float spacing = 1.0f;
+
+	output << "Threads: 1\n";
+	for (const size_t sideProbeCount : { 7, 22, 47 })
+	{
+		const glm::vec3 extents = glm::vec3(static_cast<float>(sideProbeCount) * spacing);
+		Renderer::ProbeVolume volume(glm::vec3(0.0f, 0.0f, 0.0f), extents, spacing, 0.05f);
+		const size_t probeCount = volume.GetTotalProbeCount();
+		const size_t repeatCount = std::max<size_t>(1, probeBudget / probeCount);
+
+		// Upload destination standing in for a mapped upload heap
+		std::vector<glm::vec4> uploadBuffer(probeCount);
+
+		// Array of structures: update transforms, then repack the positions one probe at a time
+		std::vector<Transform> transforms(probeCount);
+		auto start = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < repeatCount; ++i)
+		{
+			UpdateProbeTransforms(transforms, glm::vec3(static_cast<float>(i), 0.0f, 0.0f), extents, spacing,
+				volume.GetProbeCountX(), volume.GetProbeCountY(), volume.GetProbeCountZ());
+		}
+		const double aosUpdateMilliseconds = GetElapsedMilliseconds(start) / static_cast<double>(repeatCount);
+
+		start = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < repeatCount; ++i)
+		{
+			for (size_t p = 0; p < probeCount; ++p)
+			{
+				uploadBuffer[p] = glm::vec4(transforms[p].Position.x, transforms[p].Position.y, transforms[p].Position.z, 1.0f);
+			}
+		}
+		const double aosUploadMilliseconds = GetElapsedMilliseconds(start) / static_cast<double>(repeatCount);
+
+		// Structure of arrays: moving the volume offsets every position in place, and positions are copied as one block
+		start = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < repeatCount; ++i)
+		{
+			volume.GetVolumePosition().x = static_cast<float>(i + 1);
+			volume.Update();
+		}
+		const double soaUpdateMilliseconds = GetElapsedMilliseconds(start) / static_cast<double>(repeatCount);
+
+		start = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < repeatCount; ++i)
+		{
+			memcpy(uploadBuffer.data(), volume.GetProbePositions().data(), probeCount * sizeof(glm::vec4));
+		}
+		const double soaUploadMilliseconds = GetElapsedMilliseconds(start) / static_cast<double>(repeatCount);
+
+		// Frames where the volume did not move skip both the update and the upload
+		uint64_t uploadFrameIndex = 0;
+		size_t uploadCount = 0;
+		start = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < repeatCount; ++i)
+		{
+			volume.Update();
+			if (volume.HasChangedSince(uploadFrameIndex))
+			{
+				memcpy(uploadBuffer.data(), volume.GetProbePositions().data(), probeCount * sizeof(glm::vec4));
+				++uploadCount;
+			}
+			uploadFrameIndex = volume.GetFrameIndex();
+		}
+		const double unchangedMilliseconds = GetElapsedMilliseconds(start) / static_cast<double>(repeatCount);
+
+		// Both layouts must place every probe at the same position
+		UpdateProbeTransforms(transforms, volume.GetVolumePosition(), extents, spacing,
+			volume.GetProbeCountX(), volume.GetProbeCountY(), volume.GetProbeCountZ());
+		size_t mismatchCount = 0;
+		for (size_t p = 0; p < probeCount; ++p)
+		{
+			if (glm::vec3(volume.GetProbePositions()[p]) != transforms[p].Position)
+			{
+				++mismatchCount;
+			}
+		}
+
+		output << "Probes: " << probeCount <<
+			"  Update (us, AoS/SoA): " << (aosUpdateMilliseconds * 1000.0) << "/" << (soaUpdateMilliseconds * 1000.0) <<
+			"  Upload (us, AoS/SoA): " << (aosUploadMilliseconds * 1000.0) << "/" << (soaUploadMilliseconds * 1000.0) <<
+			"  Unchanged frame (us): " << (unchangedMilliseconds * 1000.0) << "  Uploads: " << uploadCount << "/" << repeatCount <<
+			"  Bytes per probe (AoS/SoA): " << sizeof(Transform) << "/" << (sizeof(glm::vec4) * 2 + sizeof(uint32_t)) <<
+			"  Mismatches: " << mismatchCount << "\n";
+	}
+}
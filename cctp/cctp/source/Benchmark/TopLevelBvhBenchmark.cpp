@@ -0,0 +1,144 @@
+#include "CpuPch.h"
+#include "Benchmark.h"
+#include "Renderer/Geometry.h"
+#include "Renderer/CPU/TopLevelBvh.h"
+
+namespace
+{
+	// Trace throughput of random rays through the instance bounds
+	double MeasureMraysPerSecond(const Renderer::CPU::TopLevelBvh& tlas, const BoundingBox& bounds, const size_t rayCount)
+	{
+		std::mt19937 generator(3);
+		std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+		const auto start = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < rayCount; ++i)
+		{
+			Renderer::CPU::Ray ray = {};
+			ray.Origin = bounds.Min + bounds.GetExtents() * glm::vec3(distribution(generator), distribution(generator), distribution(generator));
+			ray.Direction = glm::normalize(glm::vec3(distribution(generator), distribution(generator), distribution(generator)) * 2.0f - 1.0f + 1e-4f);
+
+			Renderer::CPU::RayHit hit;
+			tlas.Intersect(ray, hit, false, false);
+		}
+		return static_cast<double>(rayCount) / (Benchmark::GetElapsedMilliseconds(start) * 1000.0);
+	}
+}
+
+void Benchmark::TopLevelBvhUpdate(std::ostream& output)
+{
+	constexpr uint32_t frameCount = 120;
+	constexpr size_t traceRayCount = 50000;
+
+	// Shared bottom level structures
+	std::vector<Renderer::Vertex1Pos1UV1Norm> vertices;
+	std::vector<uint32_t> indices;
+	Renderer::Geometry::GenerateCubeGeometry(vertices, indices, 1.0f);
+	Renderer::CPU::Bvh cubeBlas;
+	cubeBlas.Build(vertices.data(), vertices.size(), indices.data(), indices.size());
+
+	vertices.clear();
+	indices.clear();
+	Renderer::Geometry::GenerateSphereGeometry(vertices, indices, 0.5f, 32, 32);
+	Renderer::CPU::Bvh sphereBlas;
+	sphereBlas.Build(vertices.data(), vertices.size(), indices.data(), indices.size());
+
+	// A sliding door, as in the demo scene, refits every frame without degrading the tree enough to rebuild
+	{
+		Renderer::CPU::TopLevelBvh tlas;
+		const glm::mat4 doorScale = glm::scale(glm::identity<glm::mat4>(), glm::vec3(5.0f, 5.0f, 0.5f));
+		for (uint32_t i = 0; i < 7; ++i)
+		{
+			tlas.AddInstance(cubeBlas, glm::translate(glm::identity<glm::mat4>(), glm::vec3(static_cast<float>(i) - 3.0f, 0.0f, 0.0f)));
+		}
+		const uint32_t doorID = tlas.AddInstance(cubeBlas, glm::translate(glm::identity<glm::mat4>(), glm::vec3(5.0f, 1.75f, -2.65f)) * doorScale);
+		tlas.Update();
+
+		double updateMilliseconds = 0.0;
+		for (uint32_t frame = 0; frame < frameCount; ++frame)
+		{
+			const float doorX = 5.0f * static_cast<float>(frame) / static_cast<float>(frameCount - 1);
+			tlas.SetInstanceTransform(doorID, glm::translate(glm::identity<glm::mat4>(), glm::vec3(doorX, 1.75f, -2.65f)) * doorScale);
+			updateMilliseconds += tlas.Update().UpdateMilliseconds;
+		}
+
+		const auto& stats = tlas.GetStats();
+		output << "Sliding door  Instances: " << stats.InstanceCount <<
+			"  Update (ms avg): " << (updateMilliseconds / frameCount) <<
+			"  Refits: " << stats.RefitCount <<
+			"  Rebuilds: " << stats.RebuildCount <<
+			"  SAH cost (built/now): " << stats.BuildSahCost << "/" << stats.SahCost << "\n";
+	}
+
+	// Grids of instances with a fraction drifting away every frame
+	for (uint32_t gridSide : { 10u, 22u })
+	{
+		for (float movedFraction : { 0.001f, 0.01f, 0.1f })
+		{
+			std::mt19937 generator(gridSide);
+			std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+			Renderer::CPU::TopLevelBvh refitTlas;
+			std::vector<glm::vec3> positions;
+			for (uint32_t z = 0; z < gridSide; ++z)
+			{
+				for (uint32_t y = 0; y < gridSide; ++y)
+				{
+					for (uint32_t x = 0; x < gridSide; ++x)
+					{
+						positions.push_back(glm::vec3(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)));
+						const auto& blas = ((x + y + z) % 2 == 0) ? cubeBlas : sphereBlas;
+						refitTlas.AddInstance(blas, glm::translate(glm::identity<glm::mat4>(), positions.back()) *
+							glm::scale(glm::identity<glm::mat4>(), glm::vec3(0.4f)));
+					}
+				}
+			}
+			refitTlas.Update();
+
+			const size_t instanceCount = positions.size();
+			const size_t movedCount = std::max<size_t>(1, static_cast<size_t>(static_cast<float>(instanceCount) * movedFraction));
+			std::vector<glm::vec3> velocities(movedCount);
+			for (auto& velocity : velocities)
+			{
+				velocity = glm::vec3(distribution(generator), distribution(generator), distribution(generator)) * 0.05f;
+			}
+
+			// Every update refits, rebuilding only past the cost threshold
+			double refitMilliseconds = 0.0;
+			double rebuildMilliseconds = 0.0;
+			Renderer::CPU::TopLevelBvh rebuildTlas = refitTlas;
+			for (uint32_t frame = 0; frame < frameCount; ++frame)
+			{
+				for (size_t i = 0; i < movedCount; ++i)
+				{
+					const auto instanceID = static_cast<uint32_t>((i * 7919) % instanceCount);
+					positions[instanceID] += velocities[i];
+					const glm::mat4 transformMatrix = glm::translate(glm::identity<glm::mat4>(), positions[instanceID]) *
+						glm::scale(glm::identity<glm::mat4>(), glm::vec3(0.4f));
+					refitTlas.SetInstanceTransform(instanceID, transformMatrix);
+					rebuildTlas.SetInstanceTransform(instanceID, transformMatrix);
+				}
+
+				refitMilliseconds += refitTlas.Update().UpdateMilliseconds;
+				rebuildMilliseconds += rebuildTlas.Rebuild().UpdateMilliseconds;
+			}
+
+			BoundingBox bounds;
+			for (uint32_t i = 0; i < instanceCount; ++i)
+			{
+				bounds.Grow(refitTlas.GetInstanceBoundsWS(i));
+			}
+
+			const auto& stats = refitTlas.GetStats();
+			output << "Instances: " << instanceCount <<
+				"  Moved per frame: " << movedCount <<
+				"  Update (ms avg): " << (refitMilliseconds / frameCount) <<
+				"  Rebuild every frame (ms avg): " << (rebuildMilliseconds / frameCount) <<
+				"  Refits: " << stats.RefitCount <<
+				"  Rebuilds: " << (stats.RebuildCount - 1) <<
+				"  SAH cost (updated/rebuilt): " << stats.SahCost << "/" << rebuildTlas.GetStats().SahCost <<
+				"  Mrays/s (updated/rebuilt): " << MeasureMraysPerSecond(refitTlas, bounds, traceRayCount) <<
+				"/" << MeasureMraysPerSecond(rebuildTlas, bounds, traceRayCount) << "\n";
+		}
+	}
+}
\ No newline at end of file
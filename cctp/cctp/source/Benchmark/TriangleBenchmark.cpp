@@ -0,0 +1,238 @@
+#include "CpuPch.h"
+#include "Benchmark.h"
+#include "Math/Simd.h"
+#include "Renderer/Geometry.h"
+#include "Renderer/CPU/TriangleIntersection.h"
+
+namespace
+{
+	struct TestMesh
+	{
+		std::string Name;
+		// Meshes without open edges must be hit by every ray from their centre
+		bool Closed = false;
+		std::vector<Renderer::Vertex1Pos1UV1Norm> Vertices;
+		std::vector<uint32_t> Indices;
+		std::vector<Renderer::CPU::BvhTriangle> Triangles;
+		std::vector<Renderer::CPU::TrianglePack<4>> Packs4;
+		std::vector<Renderer::CPU::TrianglePack<8>> Packs8;
+		BoundingBox Bounds;
+	};
+
+	struct Kernel
+	{
+		std::string Name;
+		// Finds the closest hit of the ray against every triangle of the mesh
+		std::function<void(const TestMesh&, const Renderer::CPU::Ray&, Renderer::CPU::RayHit&)> Intersect;
+	};
+
+	void PrepareTestMesh(TestMesh& mesh)
+	{
+		std::vector<uint32_t> primitiveIndices;
+		for (size_t i = 0; i < mesh.Indices.size(); i += 3)
+		{
+			Renderer::CPU::BvhTriangle triangle = {};
+			triangle.V0 = mesh.Vertices[mesh.Indices[i]].Position;
+			triangle.V1 = mesh.Vertices[mesh.Indices[i + 1]].Position;
+			triangle.V2 = mesh.Vertices[mesh.Indices[i + 2]].Position;
+			mesh.Triangles.push_back(triangle);
+			mesh.Bounds.Grow(triangle.V0);
+			mesh.Bounds.Grow(triangle.V1);
+			mesh.Bounds.Grow(triangle.V2);
+			primitiveIndices.push_back(static_cast<uint32_t>(i / 3));
+		}
+		Renderer::CPU::AppendTrianglePacks(mesh.Triangles.data(), primitiveIndices.data(), mesh.Triangles.size(), mesh.Packs4);
+		Renderer::CPU::AppendTrianglePacks(mesh.Triangles.data(), primitiveIndices.data(), mesh.Triangles.size(), mesh.Packs8);
+	}
+
+	std::vector<Kernel> CreateKernels()
+	{
+		using namespace Renderer::CPU;
+
+		auto scalar = [](const TriangleTest test)
+		{
+			return [test](const TestMesh& mesh, const Ray& ray, RayHit& hit)
+			{
+				const TriangleRay triangleRay = CreateTriangleRay(ray.Origin, ray.Direction);
+				for (size_t i = 0; i < mesh.Triangles.size(); ++i)
+				{
+					const auto& triangle = mesh.Triangles[i];
+					float t;
+					glm::vec2 barycentrics;
+					const bool intersected = (test == TriangleTest::Watertight) ?
+						IntersectTriangleWatertight(triangleRay, triangle.V0, triangle.V1, triangle.V2, false, t, barycentrics) :
+						IntersectTriangle(ray.Origin, ray.Direction, triangle.V0, triangle.V1, triangle.V2, false, t, barycentrics);
+					if (intersected && t >= ray.TMin && t < hit.T)
+					{
+						hit.T = t;
+						hit.Barycentrics = barycentrics;
+						hit.PrimitiveIndex = static_cast<uint32_t>(i);
+					}
+				}
+			};
+		};
+
+		auto packed = [](const TriangleTest test, const auto& packs)
+		{
+			return [test, packs](const TestMesh& mesh, const Ray& ray, RayHit& hit)
+			{
+				const TriangleRay triangleRay = CreateTriangleRay(ray.Origin, ray.Direction);
+				for (const auto& pack : mesh.*packs)
+				{
+					float t;
+					glm::vec2 barycentrics;
+					const int32_t lane = IntersectTrianglePack(pack, triangleRay, test, false, ray.TMin, hit.T, t, barycentrics);
+					if (lane >= 0)
+					{
+						hit.T = t;
+						hit.Barycentrics = barycentrics;
+						hit.PrimitiveIndex = pack.PrimitiveIndices[lane];
+					}
+				}
+			};
+		};
+
+		const std::string wideName = Math::SupportsAvx2() ? "AVX2 x8" : "SSE 2x4";
+		return
+		{
+			{ "Scalar Moller-Trumbore", scalar(TriangleTest::MollerTrumbore) },
+			{ "Scalar watertight", scalar(TriangleTest::Watertight) },
+			{ "SSE x4 Moller-Trumbore", packed(TriangleTest::MollerTrumbore, &TestMesh::Packs4) },
+			{ "SSE x4 watertight", packed(TriangleTest::Watertight, &TestMesh::Packs4) },
+			{ wideName + " Moller-Trumbore", packed(TriangleTest::MollerTrumbore, &TestMesh::Packs8) },
+			{ wideName + " watertight", packed(TriangleTest::Watertight, &TestMesh::Packs8) }
+		};
+	}
+
+	// Rays from the centre of a closed mesh through the midpoint of every edge shared by two triangles, the rays most likely to slip through a crack
+	std::vector<Renderer::CPU::Ray> CreateEdgeRays(const TestMesh& mesh)
+	{
+		// Edges are matched by vertex position as meshes duplicate vertices along hard edges
+		auto getEdgeKey = [](glm::vec3 a, glm::vec3 b)
+		{
+			if (std::tie(b.x, b.y, b.z) < std::tie(a.x, a.y, a.z))
+			{
+				std::swap(a, b);
+			}
+			return std::array<float, 6>{ a.x, a.y, a.z, b.x, b.y, b.z };
+		};
+
+		std::map<std::array<float, 6>, uint32_t> edgeTriangleCounts;
+		for (const auto& triangle : mesh.Triangles)
+		{
+			++edgeTriangleCounts[getEdgeKey(triangle.V0, triangle.V1)];
+			++edgeTriangleCounts[getEdgeKey(triangle.V1, triangle.V2)];
+			++edgeTriangleCounts[getEdgeKey(triangle.V2, triangle.V0)];
+		}
+
+		const glm::vec3 centre = mesh.Bounds.GetCentre();
+		std::vector<Renderer::CPU::Ray> rays;
+		for (const auto& [key, triangleCount] : edgeTriangleCounts)
+		{
+			const glm::vec3 midpoint = (glm::vec3(key[0], key[1], key[2]) + glm::vec3(key[3], key[4], key[5])) * 0.5f;
+			if (triangleCount == 2 && midpoint != centre)
+			{
+				Renderer::CPU::Ray ray = {};
+				ray.Origin = centre;
+				ray.Direction = glm::normalize(midpoint - centre);
+				rays.push_back(ray);
+			}
+		}
+		return rays;
+	}
+}
+
+void Benchmark::TriangleIntersection(std::ostream& output)
+{
+	// Brute force tests performed per kernel and mesh
+	constexpr size_t testBudget = 20000000;
+
+	std::vector<TestMesh> meshes(5);
+	meshes[0].Name = "Cube";
+	meshes[0].Closed = true;
+	Renderer::Geometry::GenerateCubeGeometry(meshes[0].Vertices, meshes[0].Indices, 1.0f);
+	meshes[1].Name = "Sphere 32x32";
+	meshes[1].Closed = true;
+	Renderer::Geometry::GenerateSphereGeometry(meshes[1].Vertices, meshes[1].Indices, 1.0f, 32, 32);
+	meshes[2].Name = "Sphere 256x128";
+	meshes[2].Closed = true;
+	Renderer::Geometry::GenerateSphereGeometry(meshes[2].Vertices, meshes[2].Indices, 1.0f, 256, 128);
+	meshes[3].Name = "Triangle soup 100k";
+	Renderer::Geometry::GenerateTriangleSoupGeometry(meshes[3].Vertices, meshes[3].Indices, 100000, 10.0f, 0.1f, 1);
+	meshes[4].Name = "Triangle soup 1M";
+	Renderer::Geometry::GenerateTriangleSoupGeometry(meshes[4].Vertices, meshes[4].Indices, 1000000, 10.0f, 0.1f, 2);
+
+	const auto kernels = CreateKernels();
+	for (auto& mesh : meshes)
+	{
+		PrepareTestMesh(mesh);
+		output << mesh.Name << "  Triangles: " << mesh.Triangles.size() << "\n";
+
+		// Random rays starting inside the mesh bounds
+		std::mt19937 generator(11);
+		std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+		std::vector<Renderer::CPU::Ray> rays(std::max<size_t>(16, testBudget / mesh.Triangles.size()));
+		for (auto& ray : rays)
+		{
+			ray.Origin = mesh.Bounds.Min + mesh.Bounds.GetExtents() * glm::vec3(distribution(generator), distribution(generator), distribution(generator));
+			ray.Direction = glm::normalize(glm::vec3(distribution(generator), distribution(generator), distribution(generator)) * 2.0f - 1.0f + 1e-4f);
+		}
+		const auto edgeRays = mesh.Closed ? CreateEdgeRays(mesh) : std::vector<Renderer::CPU::Ray>();
+
+		std::vector<Renderer::CPU::RayHit> referenceHits;
+		for (const auto& kernel : kernels)
+		{
+			std::vector<Renderer::CPU::RayHit> hits(rays.size());
+			const auto start = std::chrono::high_resolution_clock::now();
+			for (size_t i = 0; i < rays.size(); ++i)
+			{
+				hits[i].T = rays[i].TMax;
+				kernel.Intersect(mesh, rays[i], hits[i]);
+			}
+			const double milliseconds = GetElapsedMilliseconds(start);
+
+			// Compare closest hits against the scalar Moller-Trumbore kernel, the test used by the binary bvh
+			if (referenceHits.empty())
+			{
+				referenceHits = hits;
+			}
+			size_t mismatchCount = 0;
+			float maxRelativeError = 0.0f;
+			for (size_t i = 0; i < hits.size(); ++i)
+			{
+				if (hits[i].PrimitiveIndex != referenceHits[i].PrimitiveIndex)
+				{
+					++mismatchCount;
+				}
+				else if (hits[i].PrimitiveIndex != Renderer::CPU::INVALID_ID)
+				{
+					maxRelativeError = std::max(maxRelativeError, std::abs(hits[i].T - referenceHits[i].T) / std::max(referenceHits[i].T, 1e-6f));
+				}
+			}
+
+			// Every ray through a shared edge must hit one of its triangles
+			size_t leakCount = 0;
+			for (const auto& ray : edgeRays)
+			{
+				Renderer::CPU::RayHit hit = {};
+				hit.T = ray.TMax;
+				kernel.Intersect(mesh, ray, hit);
+				if (hit.PrimitiveIndex == Renderer::CPU::INVALID_ID)
+				{
+					++leakCount;
+				}
+			}
+
+			const double testCount = static_cast<double>(rays.size()) * static_cast<double>(mesh.Triangles.size());
+			output << std::left << std::setw(28) << kernel.Name << std::right <<
+				"  Mtests/s: " << (testCount / (milliseconds * 1000.0)) <<
+				"  Mismatches: " << mismatchCount << "/" << rays.size() <<
+				"  Max t error: " << maxRelativeError;
+			if (mesh.Closed)
+			{
+				output << "  Edge leaks: " << leakCount << "/" << edgeRays.size();
+			}
+			output << "\n";
+		}
+	}
+}
@@ -0,0 +1,241 @@
+#include "CpuPch.h"
+#include "Benchmark.h"
+#include "Math/Simd.h"
+#include "Renderer/Geometry.h"
+#include "Renderer/GIConstants.h"
+#include "Renderer/CPU/WideBvh.h"
+#include "Renderer/CPU/ProbeTracer.h"
+#include "Renderer/CPU/RaytracingScene.h"
+#include "Scene/Scenes/DemoSceneLayout.h"
+
+namespace
+{
+	// Packets of the probe ray directions shot from random points inside the bounds, as probes placed through a scene
+	std::vector<Renderer::CPU::RayPacket> CreatePackets(const BoundingBox& bounds, const size_t packetCount, const uint32_t seed)
+	{
+		std::mt19937 generator(seed);
+		std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+		std::vector<Renderer::CPU::RayPacket> packets(packetCount);
+		for (auto& packet : packets)
+		{
+			packet.Origin = bounds.Min + bounds.GetExtents() * glm::vec3(distribution(generator), distribution(generator), distribution(generator));
+			packet.RayCount = Renderer::CPU::RayPacket::MaxRayCount;
+			for (uint32_t i = 0; i < packet.RayCount; ++i)
+			{
+				packet.Directions[i] = glm::normalize(Renderer::CPU::SphericalFibonacci(static_cast<float>(i), static_cast<float>(packet.RayCount)));
+			}
+		}
+		return packets;
+	}
+
+	// Packets holding random directions from random origins, which share no traversal
+	std::vector<Renderer::CPU::RayPacket> CreateIncoherentPackets(const BoundingBox& bounds, const size_t packetCount, const uint32_t seed)
+	{
+		std::mt19937 generator(seed);
+		std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+		std::vector<Renderer::CPU::RayPacket> packets(packetCount);
+		for (auto& packet : packets)
+		{
+			packet.Origin = bounds.Min + bounds.GetExtents() * glm::vec3(distribution(generator), distribution(generator), distribution(generator));
+			packet.RayCount = 1;
+			packet.Directions[0] = glm::normalize(glm::vec3(distribution(generator), distribution(generator), distribution(generator)) * 2.0f - 1.0f + 1e-4f);
+		}
+		return packets;
+	}
+
+	// Traces every ray of the packets with trace(packet, hits), returning single thread Mrays/s. Hits are kept for validation
+	template<typename TraceFunction>
+	double MeasureMraysPerSecond(const std::vector<Renderer::CPU::RayPacket>& packets, std::vector<Renderer::CPU::RayHit>& hits, TraceFunction&& trace)
+	{
+		hits.assign(packets.size() * Renderer::CPU::RayPacket::MaxRayCount, Renderer::CPU::RayHit());
+
+		size_t rayCount = 0;
+		const auto start = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < packets.size(); ++i)
+		{
+			trace(packets[i], &hits[i * Renderer::CPU::RayPacket::MaxRayCount]);
+			rayCount += packets[i].RayCount;
+		}
+		return static_cast<double>(rayCount) / (Benchmark::GetElapsedMilliseconds(start) * 1000.0);
+	}
+
+	// Wide bvhs use the watertight triangle test, so distances differ from the binary bvh by rounding and a few rays hitting edges or at grazing angles differ
+	size_t CountHitMismatches(const std::vector<Renderer::CPU::RayHit>& hits, const std::vector<Renderer::CPU::RayHit>& referenceHits)
+	{
+		size_t mismatchCount = 0;
+		for (size_t i = 0; i < hits.size(); ++i)
+		{
+			if (std::abs(hits[i].T - referenceHits[i].T) > 1e-4f * referenceHits[i].T || hits[i].InstanceID != referenceHits[i].InstanceID)
+			{
+				++mismatchCount;
+			}
+		}
+		return mismatchCount;
+	}
+
+	template<uint32_t Width>
+	void PrintStats(std::ostream& output, const Renderer::CPU::WideBvh<Width>& bvh)
+	{
+		const auto& stats = bvh.GetStats();
+		output << "BVH" << Width <<
+			"  Collapse (ms): " << stats.BuildMilliseconds <<
+			"  Nodes: " << stats.NodeCount <<
+			"  Leaves: " << stats.LeafCount <<
+			"  Children/node: " << stats.AverageChildCount <<
+			"  Depth: " << stats.MaxDepth <<
+			"  Memory (MB): " << (static_cast<double>(bvh.GetMemoryBytes()) / (1024.0 * 1024.0)) << "\n";
+	}
+}
+
+void Benchmark::WideBvhTrace(std::ostream& output)
+{
+	using namespace Renderer::CPU;
+
+	constexpr size_t packetCount = 4000;
+	constexpr size_t incoherentRayCount = 100000;
+
+	output << "AVX2: " << (Math::SupportsAvx2() ? "yes" : "no, BVH8 box tests fall back to SSE") << "  Threads: 1\n";
+
+	// Single meshes of increasing size
+	struct Mesh
+	{
+		const char* Name;
+		std::vector<Renderer::Vertex1Pos1UV1Norm> Vertices;
+		std::vector<uint32_t> Indices;
+	};
+	std::vector<Mesh> meshes(3);
+	meshes[0].Name = "Sphere 64x32";
+	Renderer::Geometry::GenerateSphereGeometry(meshes[0].Vertices, meshes[0].Indices, 1.0f, 64, 32);
+	meshes[1].Name = "Sphere 1024x512";
+	Renderer::Geometry::GenerateSphereGeometry(meshes[1].Vertices, meshes[1].Indices, 1.0f, 1024, 512);
+	meshes[2].Name = "Triangle soup";
+	Renderer::Geometry::GenerateTriangleSoupGeometry(meshes[2].Vertices, meshes[2].Indices, 1000000, 10.0f, 0.1f, 1);
+
+	for (const auto& mesh : meshes)
+	{
+		Bvh bvh;
+		bvh.Build(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices.data(), mesh.Indices.size());
+		Bvh4 bvh4;
+		bvh4.Build(bvh);
+		Bvh8 bvh8;
+		bvh8.Build(bvh);
+
+		output << mesh.Name << "  Triangles: " << bvh.GetStats().PrimitiveCount << "  Binary nodes: " << bvh.GetStats().NodeCount << "\n";
+		PrintStats(output, bvh4);
+		PrintStats(output, bvh8);
+
+		auto traceSingle = [](const auto& accelerationStructure)
+		{
+			return [&accelerationStructure](const RayPacket& packet, RayHit* pHits)
+			{
+				for (uint32_t i = 0; i < packet.RayCount; ++i)
+				{
+					pHits[i].T = packet.TMax;
+					accelerationStructure.Intersect(packet.Origin, packet.Directions[i], packet.TMin, false, false, pHits[i]);
+				}
+			};
+		};
+		auto tracePacket = [](const auto& accelerationStructure)
+		{
+			return [&accelerationStructure](const RayPacket& packet, RayHit* pHits)
+			{
+				for (uint32_t i = 0; i < packet.RayCount; ++i)
+				{
+					pHits[i].T = packet.TMax;
+				}
+				accelerationStructure.IntersectPacket(packet, packet.GetRayMask(), false, false, pHits);
+			};
+		};
+
+		// Incoherent rays only use single ray traversal
+		{
+			const auto packets = CreateIncoherentPackets(bvh.GetBounds(), incoherentRayCount, 5);
+			std::vector<RayHit> referenceHits;
+			std::vector<RayHit> hits;
+			const double binaryMrays = MeasureMraysPerSecond(packets, referenceHits, traceSingle(bvh));
+			const double bvh4Mrays = MeasureMraysPerSecond(packets, hits, traceSingle(bvh4));
+			size_t mismatchCount = CountHitMismatches(hits, referenceHits);
+			const double bvh8Mrays = MeasureMraysPerSecond(packets, hits, traceSingle(bvh8));
+			mismatchCount += CountHitMismatches(hits, referenceHits);
+
+			output << "Incoherent rays: " << packets.size() <<
+				"  Mrays/s per core (binary/BVH4/BVH8): " << binaryMrays << "/" << bvh4Mrays << "/" << bvh8Mrays <<
+				"  Mismatches: " << mismatchCount << "\n";
+		}
+
+		// Probe rays trace as single rays and as packets sharing their origin
+		{
+			const auto packets = CreatePackets(bvh.GetBounds(), packetCount, 9);
+			std::vector<RayHit> referenceHits;
+			std::vector<RayHit> hits;
+			const double binaryMrays = MeasureMraysPerSecond(packets, referenceHits, traceSingle(bvh));
+			const double bvh4Mrays = MeasureMraysPerSecond(packets, hits, traceSingle(bvh4));
+			size_t mismatchCount = CountHitMismatches(hits, referenceHits);
+			const double bvh8Mrays = MeasureMraysPerSecond(packets, hits, traceSingle(bvh8));
+			mismatchCount += CountHitMismatches(hits, referenceHits);
+			const double bvh4PacketMrays = MeasureMraysPerSecond(packets, hits, tracePacket(bvh4));
+			mismatchCount += CountHitMismatches(hits, referenceHits);
+			const double bvh8PacketMrays = MeasureMraysPerSecond(packets, hits, tracePacket(bvh8));
+			mismatchCount += CountHitMismatches(hits, referenceHits);
+
+			output << "Probe rays: " << packets.size() * RayPacket::MaxRayCount <<
+				"  Mrays/s per core (binary/BVH4/BVH8): " << binaryMrays << "/" << bvh4Mrays << "/" << bvh8Mrays <<
+				"  Packets (BVH4/BVH8): " << bvh4PacketMrays << "/" << bvh8PacketMrays <<
+				"  Mismatches: " << mismatchCount << "\n";
+		}
+	}
+
+	// Every probe ray of the demo scene through the two level structure
+	{
+		DemoSceneFixture demoScene;
+		CreateDemoScene(demoScene);
+		const auto& scene = demoScene.Scene;
+		const auto probeVolume = DemoSceneLayout::CreateProbeVolume();
+
+		std::vector<RayPacket> packets(probeVolume.GetTotalProbeCount());
+		for (size_t p = 0; p < packets.size(); ++p)
+		{
+			packets[p].Origin = glm::vec3(probeVolume.GetProbePositions()[p]);
+			packets[p].TMax = Renderer::PROBE_MAX_RAY_DISTANCE;
+			packets[p].RayCount = Renderer::PROBE_RAY_COUNT;
+			for (uint32_t i = 0; i < packets[p].RayCount; ++i)
+			{
+				packets[p].Directions[i] = glm::normalize(SphericalFibonacci(static_cast<float>(i), static_cast<float>(Renderer::PROBE_RAY_COUNT)));
+			}
+		}
+
+		// Repeat the update for a stable timing
+		constexpr uint32_t repeatCount = 20;
+		std::vector<RayPacket> repeatedPackets;
+		for (uint32_t i = 0; i < repeatCount; ++i)
+		{
+			repeatedPackets.insert(repeatedPackets.end(), packets.begin(), packets.end());
+		}
+
+		std::vector<RayHit> referenceHits;
+		std::vector<RayHit> hits;
+		const double singleMrays = MeasureMraysPerSecond(repeatedPackets, referenceHits, [&](const RayPacket& packet, RayHit* pHits)
+			{
+				for (uint32_t i = 0; i < packet.RayCount; ++i)
+				{
+					Ray ray = {};
+					ray.Origin = packet.Origin;
+					ray.Direction = packet.Directions[i];
+					ray.TMin = packet.TMin;
+					ray.TMax = packet.TMax;
+					scene.Intersect(ray, pHits[i], true);
+				}
+			});
+		const double packetMrays = MeasureMraysPerSecond(repeatedPackets, hits, [&](const RayPacket& packet, RayHit* pHits)
+			{
+				scene.IntersectPacket(packet, pHits, true);
+			});
+
+		output << "Demo scene  Probes: " << packets.size() <<
+			"  Rays per update: " << packets.size() * Renderer::PROBE_RAY_COUNT <<
+			"  Mrays/s per core (binary single rays/BVH8 packets): " << singleMrays << "/" << packetMrays <<
+			"  Mismatches: " << CountHitMismatches(hits, referenceHits) << "\n";
+	}
+}
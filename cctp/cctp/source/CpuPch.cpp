@@ -0,0 +1 @@
+#include "CpuPch.h"
\ No newline at end of file
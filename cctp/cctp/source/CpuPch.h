@@ -0,0 +1,50 @@
+#pragma once
+
+// Precompiled header of the platform independent CPU code: the probe field, its CPU reference, the benchmarks and the headless
+// target. Includes no Windows, D3D12 or ImGui headers, so the code built with it compiles on any platform
+
+// Glm
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLM_FORCE_RADIANS
+#include "Math/glm/vec2.hpp"
+#include "Math/glm/vec3.hpp"
+#include "Math/glm/vec4.hpp"
+#include "Math/glm/mat3x3.hpp"
+#include "Math/glm/mat4x4.hpp"
+#include "Math/glm/ext/matrix_transform.hpp"
+#include "Math/glm/ext/matrix_clip_space.hpp"
+#include "Math/glm/gtc/quaternion.hpp"
+#include "Math/glm/gtx/euler_angles.hpp"
+
+// Standard
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <iostream>
+#include <functional>
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include <limits>
+#include <atomic>
+#include <thread>
+#include <sstream>
+#include <random>
+#include <bit>
+#include <map>
+#include <iomanip>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <numeric>
+
+// Macros
+#ifdef _DEBUG
+#define DEBUG_LOG(x) std::cout << x << "\n";
+#else
+#define DEBUG_LOG(x)
+#endif
\ No newline at end of file
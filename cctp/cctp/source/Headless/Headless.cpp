@@ -0,0 +1,159 @@
+#include "CpuPch.h"
+#include "Headless.h"
+#include "Benchmark/Benchmark.h"
+#include "Math/Transform.h"
+#include "Renderer/Material.h"
+#include "Renderer/ProbeVolume.h"
+#include "Renderer/BakedProbeFile.h"
+#include "Renderer/CPU/RaytracingScene.h"
+#include "Renderer/CPU/ProbeTracer.h"
+#include "Renderer/CPU/ProbeClassifier.h"
+#include "Renderer/CPU/ProbeRelocation.h"
+#include "Scene/Scenes/DemoSceneLayout.h"
+#include "Threading/TaskScheduler.h"
+
+void PrintProbeTraceStats(const Renderer::CPU::ProbeTraceStats& stats)
+{
+	std::cout << "Threads: " << stats.ThreadCount <<
+		"  Trace (ms): " << stats.TraceMilliseconds <<
+		"  Filter (ms): " << stats.FilterMilliseconds <<
+		"  Mrays/s: " << stats.GetMraysPerSecond() <<
+		"  Mrays/s per thread: " << (stats.GetMraysPerSecond() / stats.ThreadCount) <<
+		"  Rays saved by inactive probes: " << stats.SkippedRayCount << "\n";
+}
+
+int Headless::Run(const std::vector<std::string>& arguments)
+{
+	// Parse arguments
+	uint32_t maxThreadCount = std::max(1u, std::thread::hardware_concurrency());
+	std::filesystem::path outputDirectory;
+	std::string benchmarkName;
+	std::filesystem::path bakePath;
+	bool compressBake = false;
+
+	for (size_t i = 0; i < arguments.size(); ++i)
+	{
+		const std::string& argument = arguments[i];
+		const bool hasValue = (i + 1) < arguments.size();
+		if (argument == "-threads" && hasValue)
+		{
+			maxThreadCount = std::max(1u, static_cast<uint32_t>(std::strtoul(arguments[++i].c_str(), nullptr, 10)));
+		}
+		else if (argument == "-out" && hasValue)
+		{
+			outputDirectory = arguments[++i];
+		}
+		else if (argument == "-benchmark" && hasValue)
+		{
+			benchmarkName = arguments[++i];
+		}
+		else if (argument == "-bake" && hasValue)
+		{
+			bakePath = arguments[++i];
+		}
+		else if (argument == "-compress")
+		{
+			compressBake = true;
+		}
+	}
+
+	if (!benchmarkName.empty())
+	{
+		if (!Benchmark::Run(benchmarkName, std::cout))
+		{
+			std::cout << "ERROR: Unknown benchmark " << benchmarkName << ". Available benchmarks:\n";
+			for (const auto& entry : Benchmark::GetEntries())
+			{
+				std::cout << entry.Name << ": " << entry.Description << "\n";
+			}
+			return 1;
+		}
+		return 0;
+	}
+
+	// Create the demo scene geometry and probe volume on the CPU
+	std::vector<Transform> transforms;
+	std::vector<Renderer::Material> materials;
+	DemoSceneLayout::CreateSceneInstances(transforms, materials);
+
+	Renderer::CPU::RaytracingScene scene;
+	DemoSceneLayout::CreateRaytracingScene(transforms, materials, scene);
+
+	auto probeVolume = DemoSceneLayout::CreateProbeVolume();
+
+	std::cout << "Probe count: " << probeVolume.GetTotalProbeCount() << "\n";
+	std::cout << "Rays per update: " << probeVolume.GetTotalProbeCount() * Renderer::PROBE_RAY_COUNT << "\n";
+
+	// Move probes out of nearby geometry, then deactivate probes still buried in geometry or away from every surface
+	std::vector<uint32_t> probeIndices(probeVolume.GetTotalProbeCount());
+	std::iota(probeIndices.begin(), probeIndices.end(), 0);
+	auto relocationOffsets = probeVolume.GetProbeRelocationOffsets();
+	const auto relocationStats = Renderer::CPU::RelocateProbes(scene, probeVolume, probeIndices, {}, relocationOffsets);
+	probeVolume.SetProbeRelocationOffsets(relocationOffsets);
+	std::cout << "Relocation (ms): " << relocationStats.Milliseconds << "  Relocated probes: " << relocationStats.RelocatedProbeCount << "\n";
+
+	auto probeStates = probeVolume.GetProbeStates();
+	const auto classificationStats = Renderer::CPU::ClassifyProbes(scene, probeVolume.GetProbePositions(), probeIndices, {}, probeStates);
+	probeVolume.SetProbeStates(probeStates);
+	std::cout << "Classification (ms): " << classificationStats.Milliseconds <<
+		"  Inside geometry: " << classificationStats.InsideGeometryCount <<
+		"  Far from surfaces: " << classificationStats.FarFromSurfaceCount <<
+		"  Active probes: " << (classificationStats.ProbeCount - classificationStats.GetInactiveProbeCount()) << "\n";
+
+	// Time a full volume update at increasing thread counts to show scaling
+	Renderer::CPU::ProbeTracer tracer;
+	Renderer::CPU::ProbeTraceSettings settings = {};
+	settings.LightDirectionWS = DemoSceneLayout::DEFAULT_LIGHT_DIRECTION_WS;
+	settings.LightIntensity = 1.0f;
+	settings.pProbeStates = &probeVolume.GetProbeStates();
+
+	for (uint32_t threadCount = 1; ; threadCount = std::min(threadCount * 2, maxThreadCount))
+	{
+		Threading::TaskScheduler scheduler(threadCount);
+		settings.pTaskScheduler = &scheduler;
+		PrintProbeTraceStats(tracer.TraceProbes(scene, probeVolume.GetProbePositions(), settings));
+		settings.pTaskScheduler = nullptr;
+
+		if (threadCount == maxThreadCount)
+		{
+			break;
+		}
+	}
+
+	if (!outputDirectory.empty())
+	{
+		if (!tracer.SaveAtlases(outputDirectory))
+		{
+			std::cout << "ERROR: Failed to write probe atlases to " << outputDirectory << "\n";
+			return 1;
+		}
+		std::cout << "Probe atlases written to " << outputDirectory << "\n";
+	}
+
+	if (!bakePath.empty())
+	{
+		// Converge every probe before baking, continuing the history of the gathers above
+		auto startTime = std::chrono::high_resolution_clock::now();
+		Threading::TaskScheduler scheduler(maxThreadCount);
+		settings.pTaskScheduler = &scheduler;
+		for (uint32_t g = 0; g < Renderer::BAKE_GATHER_COUNT; ++g)
+		{
+			settings.RayRotationSeed = g + 1;
+			tracer.TraceProbes(scene, probeVolume.GetProbePositions(), settings);
+		}
+		const double traceMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+		Renderer::BakedProbeAtlases atlases;
+		const glm::ivec3 gridProbeCounts = glm::ivec3(probeVolume.GetProbeCountX(), probeVolume.GetProbeCountY(), probeVolume.GetProbeCountZ());
+		tracer.GetBakedProbes(0, gridProbeCounts, atlases);
+		if (!probeVolume.SaveBakedProbes(bakePath, atlases, compressBake ? Renderer::BakedProbeCompression::PlanarDeltaRunLength : Renderer::BakedProbeCompression::None))
+		{
+			std::cout << "ERROR: Failed to write baked probes to " << bakePath << "\n";
+			return 1;
+		}
+		std::cout << "Baked probes written to " << bakePath << " (" << std::filesystem::file_size(bakePath) << " bytes) after " << Renderer::BAKE_GATHER_COUNT <<
+			" gathers in " << traceMilliseconds << " ms\n";
+	}
+
+	return 0;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace Headless
+{
+	// Runs the CPU probe field update on the demo scene without creating a window or a D3D12 device.
+	// Supported arguments: -threads <count> limits the worker thread count, -out <directory> writes the probe atlases,
+	// -bake <file> converges the probes and writes them as a baked probe file, compressed with -compress,
+	// -benchmark <name|all> runs benchmarks instead of the probe update.
+	// Prints to standard output and returns the process exit code
+	int Run(const std::vector<std::string>& arguments);
+}
@@ -0,0 +1,8 @@
+#include "CpuPch.h"
+#include "Headless.h"
+
+// Entry point of the headless target, built without Windows or D3D12 by CMakeLists.txt
+int main(int argc, char** argv)
+{
+	return Headless::Run(std::vector<std::string>(argv + 1, argv + argc));
+}
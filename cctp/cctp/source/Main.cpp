@@ -6,6 +6,11 @@
 #include "Math/Math.h"
 
 #include "Scene/Scenes/DemoScene.h"
+#include "Benchmark/Benchmark.h"
+#include "Renderer/CPU/ProbeTracer.h"
+#include "Renderer/ProbeStatistics.h"
+#include "Renderer/ProbeUpdateScheduler.h"
+#include "Renderer/BakedProbeFile.h"
 
 #include "Renderer/RootSignature.h"
 #include "Renderer/SamplerType.h"
@@ -196,45 +201,7 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 	Renderer::AddSRVDescriptorToShaderVisibleHeap(nullptr, &sceneBVHSRVDesc, Renderer::SCENE_BVH_SRV_DESCRIPTOR_INDEX);
 
 	// Create GBuffer
-	// Raytracing output texture (irradiance)
-	Microsoft::WRL::ComPtr<ID3D12Resource> raytraceOutputResource;
-
-	auto raytraceOutputTextureResourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R11G11B10_FLOAT,
-		static_cast<UINT64>(Renderer::RAYTRACE_IRRADIANCE_OUTPUT_DIMS.x), static_cast<UINT64>(Renderer::RAYTRACE_IRRADIANCE_OUTPUT_DIMS.y));
-	raytraceOutputTextureResourceDesc.MipLevels = 1;
-	raytraceOutputTextureResourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
-	auto raytraceOutputTextureHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-	if (FAILED(Renderer::GetDevice()->CreateCommittedResource(&raytraceOutputTextureHeapProperties,
-		D3D12_HEAP_FLAG_NONE,
-		&raytraceOutputTextureResourceDesc,
-		D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-		nullptr,
-		IID_PPV_ARGS(&raytraceOutputResource))))
-	{
-		assert(false && "Failed to create raytrace output texture resource.");
-	}
-	Renderer::AddUAVDescriptorToShaderVisibleHeap(raytraceOutputResource.Get(), nullptr, Renderer::RAYTRACE_IRRADIANCE_UAV_DESCRIPTOR_INDEX);
-	Renderer::AddSRVDescriptorToShaderVisibleHeap(raytraceOutputResource.Get(), nullptr, Renderer::RAYTRACE_IRRADIANCE_SRV_DESCRIPTOR_INDEX);
-
-	// Raytracing output 2 texture (visibility)
-	Microsoft::WRL::ComPtr<ID3D12Resource> raytraceOutput2Resource;
-
-	auto raytraceOutput2TextureResourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R16G16_FLOAT,
-		static_cast<UINT64>(Renderer::RAYTRACE_VISIBILITY_OUTPUT_DIMS.x), static_cast<UINT64>(Renderer::RAYTRACE_VISIBILITY_OUTPUT_DIMS.y));
-	raytraceOutput2TextureResourceDesc.MipLevels = 1;
-	raytraceOutput2TextureResourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
-	auto raytraceOutput2TextureHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-	if (FAILED(Renderer::GetDevice()->CreateCommittedResource(&raytraceOutput2TextureHeapProperties,
-		D3D12_HEAP_FLAG_NONE,
-		&raytraceOutput2TextureResourceDesc,
-		D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-		nullptr,
-		IID_PPV_ARGS(&raytraceOutput2Resource))))
-	{
-		assert(false && "Failed to create raytrace output 2 texture resource.");
-	}
-	Renderer::AddUAVDescriptorToShaderVisibleHeap(raytraceOutput2Resource.Get(), nullptr, Renderer::RAYTRACE_VISIBILITY_UAV_DESCRIPTOR_INDEX);
-	Renderer::AddSRVDescriptorToShaderVisibleHeap(raytraceOutput2Resource.Get(), nullptr, Renderer::RAYTRACE_VISIBILITY_SRV_DESCRIPTOR_INDEX);
+	// Probe irradiance and visibility atlases are created by Renderer::ReserveProbeAtlases once the probe count is known
 
 	// Scene texture
 	Microsoft::WRL::ComPtr<ID3D12Resource> sceneBufferResource;
@@ -346,12 +313,16 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 	CD3DX12_STATE_OBJECT_DESC rtpsoDesc = {};
 	rtpsoDesc.SetStateObjectType(D3D12_STATE_OBJECT_TYPE_RAYTRACING_PIPELINE);
 
-	// Add ray gen shader
+	// Add ray gen shaders. The library also holds the shaders filtering the traced rays into texels and blending them into the atlases
 	constexpr LPCWSTR rayGenExportName = L"RayGen";
+	constexpr LPCWSTR probeFilterExportName = L"ProbeFilter";
+	constexpr LPCWSTR probeBlendExportName = L"ProbeBlend";
 	CD3DX12_DXIL_LIBRARY_SUBOBJECT rayGenLibSubobject = {};
 	auto rayGenBytecode = CD3DX12_SHADER_BYTECODE(rayGenBuffer.GetBufferPointer(), rayGenBuffer.GetBufferLength());
 	rayGenLibSubobject.SetDXILLibrary(&rayGenBytecode);
 	rayGenLibSubobject.DefineExport(rayGenExportName);
+	rayGenLibSubobject.DefineExport(probeFilterExportName);
+	rayGenLibSubobject.DefineExport(probeBlendExportName);
 	rayGenLibSubobject.AddToStateObject(rtpsoDesc);
 
 	// Add miss shader
@@ -390,7 +361,7 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 	// Create ray gen shader local root signature
 	RootSignature rayGenRootSignature;
 
-	D3D12_DESCRIPTOR_RANGE rayGenDescriptorRanges[3];
+	D3D12_DESCRIPTOR_RANGE rayGenDescriptorRanges[5];
 
 	rayGenDescriptorRanges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
 	rayGenDescriptorRanges[0].NumDescriptors = 1;
@@ -398,17 +369,34 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 	rayGenDescriptorRanges[0].RegisterSpace = 0;
 	rayGenDescriptorRanges[0].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
 
+	// The probe ray data buffer
 	rayGenDescriptorRanges[1].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
 	rayGenDescriptorRanges[1].NumDescriptors = 1;
 	rayGenDescriptorRanges[1].BaseShaderRegister = 0;
 	rayGenDescriptorRanges[1].RegisterSpace = 0;
 	rayGenDescriptorRanges[1].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
 
-	rayGenDescriptorRanges[2].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
-	rayGenDescriptorRanges[2].NumDescriptors = 1;
+	// Probe positions and states. The table starts at the scene bvh
+	rayGenDescriptorRanges[2].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+	rayGenDescriptorRanges[2].NumDescriptors = 2;
 	rayGenDescriptorRanges[2].BaseShaderRegister = 1;
 	rayGenDescriptorRanges[2].RegisterSpace = 0;
-	rayGenDescriptorRanges[2].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+	rayGenDescriptorRanges[2].OffsetInDescriptorsFromTableStart = Renderer::PROBE_POSITIONS_SRV_DESCRIPTOR_INDEX - Renderer::SCENE_BVH_SRV_DESCRIPTOR_INDEX;
+
+	// Probe statistics, the irradiance and visibility atlases gathers are blended into, the spherical harmonic coefficients and the irradiance and
+	// visibility textures rays are filtered into
+	rayGenDescriptorRanges[3].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+	rayGenDescriptorRanges[3].NumDescriptors = 6;
+	rayGenDescriptorRanges[3].BaseShaderRegister = 2;
+	rayGenDescriptorRanges[3].RegisterSpace = 0;
+	rayGenDescriptorRanges[3].OffsetInDescriptorsFromTableStart = Renderer::PROBE_STATISTICS_UAV_DESCRIPTOR_INDEX - Renderer::SCENE_BVH_SRV_DESCRIPTOR_INDEX;
+
+	// Pool indices of the probes scheduled for the dispatch and the probe ray table
+	rayGenDescriptorRanges[4].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+	rayGenDescriptorRanges[4].NumDescriptors = 2;
+	rayGenDescriptorRanges[4].BaseShaderRegister = 3;
+	rayGenDescriptorRanges[4].RegisterSpace = 0;
+	rayGenDescriptorRanges[4].OffsetInDescriptorsFromTableStart = Renderer::PROBE_UPDATE_INDICES_SRV_DESCRIPTOR_INDEX - Renderer::SCENE_BVH_SRV_DESCRIPTOR_INDEX;
 
 	rayGenRootSignature.AddRootDescriptorTableParameter(rayGenDescriptorRanges, _countof(rayGenDescriptorRanges), D3D12_SHADER_VISIBILITY_ALL);
 	rayGenRootSignature.AddRootDescriptorParameter(D3D12_ROOT_PARAMETER_TYPE_CBV, 0, 0, D3D12_SHADER_VISIBILITY_ALL);
@@ -419,9 +407,11 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 	rayGenRootSignatureSubObject.SetRootSignature(rayGenRootSignature.GetRootSignature());
 	rayGenRootSignatureSubObject.AddToStateObject(rtpsoDesc);
 
-	// Create association sub object for ray gen shader and ray gen root signature
+	// Create association sub object for ray gen shaders and ray gen root signature
 	CD3DX12_SUBOBJECT_TO_EXPORTS_ASSOCIATION_SUBOBJECT rayGenAssociationSubObject = {};
 	rayGenAssociationSubObject.AddExport(rayGenExportName);
+	rayGenAssociationSubObject.AddExport(probeFilterExportName);
+	rayGenAssociationSubObject.AddExport(probeBlendExportName);
 	rayGenAssociationSubObject.SetSubobjectToAssociate(rayGenRootSignatureSubObject);
 	rayGenAssociationSubObject.AddToStateObject(rtpsoDesc);
 
@@ -495,7 +485,13 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 	constexpr uint32_t missShaderRecordSize = D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES;
 	constexpr uint32_t hitGroupShaderRecordSize = ALIGN_TO(D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + 1, D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT);
 
-	constexpr uint32_t shaderTableSize = rayGenShaderRecordSize + ALIGN_TO(missShaderRecordSize, 64) + ALIGN_TO(hitGroupShaderRecordSize, 64);
+	// Ray gen, probe filter and probe blend records. Records are 64 bytes, so each starts on the 64 byte table alignment
+	constexpr uint32_t rayGenShaderTableSize = 3 * rayGenShaderRecordSize;
+
+	// The miss record is padded to the 64 byte table alignment, so the hit group record follows it on the next 64 bytes
+	constexpr uint32_t hitGroupRecordOffset = rayGenShaderTableSize + ALIGN_TO(missShaderRecordSize, 64);
+
+	constexpr uint32_t shaderTableSize = hitGroupRecordOffset + ALIGN_TO(hitGroupShaderRecordSize, 64);
 
 	// Create shader table GPU memory
 	Microsoft::WRL::ComPtr<ID3D12Resource> shaderTable;
@@ -525,35 +521,39 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 
 	// Populate shader table
 
-	// Shader record 0: Ray gen
-	// Shader identifier + descriptor table + root descriptor
-	memcpy(pShaderTableStart, 
-		raytracingPipelineStateObjectProperties->GetShaderIdentifier(rayGenExportName),
-		D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
-	*(uint64_t*)(pShaderTableStart + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES) = 
-		(Renderer::GetShaderVisibleDescriptorHeap()->GetGPUDescriptorHandle(Renderer::RAYTRACE_IRRADIANCE_UAV_DESCRIPTOR_INDEX).ptr - 8); // This is a Pointer to the start of a descriptor range (UAV x 2) 
-																																		  // in a descriptor table
-																																		  
-	*(D3D12_GPU_VIRTUAL_ADDRESS*)(pShaderTableStart + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + 8) = Renderer::GetPerFrameConstantBufferGPUVirtualAddress();
+	// Shader records 0 to 2: Ray gen, probe filter and probe blend
+	// Shader identifier + descriptor table + root descriptor. The three share the ray gen root signature
+	const LPCWSTR rayGenRecordExportNames[] = { rayGenExportName, probeFilterExportName, probeBlendExportName };
+	for (uint32_t i = 0; i < _countof(rayGenRecordExportNames); ++i)
+	{
+		uint8_t* pRayGenRecord = pShaderTableStart + (i * rayGenShaderRecordSize);
+		memcpy(pRayGenRecord,
+			raytracingPipelineStateObjectProperties->GetShaderIdentifier(rayGenRecordExportNames[i]),
+			D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
+		*(uint64_t*)(pRayGenRecord + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES) =
+			(Renderer::GetShaderVisibleDescriptorHeap()->GetGPUDescriptorHandle(Renderer::PROBE_RAY_DATA_UAV_DESCRIPTOR_INDEX).ptr - 8); // This is a Pointer to the start of a descriptor range (UAV x 1)
+																																			  // in a descriptor table
+		*(D3D12_GPU_VIRTUAL_ADDRESS*)(pRayGenRecord + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + 8) = Renderer::GetPerFrameConstantBufferGPUVirtualAddress();
+	}
 
-	// Shader record 1: Miss
+	// Shader record 3: Miss
 	// Shader identifier
-	memcpy(pShaderTableStart + rayGenShaderRecordSize,
+	memcpy(pShaderTableStart + rayGenShaderTableSize,
 		raytracingPipelineStateObjectProperties->GetShaderIdentifier(missExportName),
 		D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
 
-	// Shader record 2: Hit group
+	// Shader record 4: Hit group
 	// Shader identifier + root descriptor + root descriptor + root descriptor + descriptor table
-	memcpy(pShaderTableStart + rayGenShaderRecordSize + (missShaderRecordSize + 32), // Adding 32 bytes of padding to miss shader record for 64 byte table allignment requirement
+	memcpy(pShaderTableStart + hitGroupRecordOffset,
 		raytracingPipelineStateObjectProperties->GetShaderIdentifier(hitGroupExportName),
 		D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
-	*(D3D12_GPU_VIRTUAL_ADDRESS*)(pShaderTableStart + rayGenShaderRecordSize + (missShaderRecordSize + 32) + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES) =
+	*(D3D12_GPU_VIRTUAL_ADDRESS*)(pShaderTableStart + hitGroupRecordOffset + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES) =
 		Renderer::GetMaterialConstantBufferGPUVirtualAddress();
-	*(D3D12_GPU_VIRTUAL_ADDRESS*)(pShaderTableStart + rayGenShaderRecordSize + (missShaderRecordSize + 32) + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + 8) =
+	*(D3D12_GPU_VIRTUAL_ADDRESS*)(pShaderTableStart + hitGroupRecordOffset + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + 8) =
 		Renderer::GetPerFrameConstantBufferGPUVirtualAddress();
-	*(D3D12_GPU_VIRTUAL_ADDRESS*)(pShaderTableStart + rayGenShaderRecordSize + (missShaderRecordSize + 32) + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + 8 + 8) =
+	*(D3D12_GPU_VIRTUAL_ADDRESS*)(pShaderTableStart + hitGroupRecordOffset + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + 8 + 8) =
 		Renderer::GetPerPassConstantBufferGPUVirtualAddress();
-	*(uint64_t*)(pShaderTableStart + rayGenShaderRecordSize + (missShaderRecordSize + 32) + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + 8 + 8 + 8) =
+	*(uint64_t*)(pShaderTableStart + hitGroupRecordOffset + D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + 8 + 8 + 8) =
 		(Renderer::GetShaderVisibleDescriptorHeap()->GetGPUDescriptorHandle(Renderer::SHADOW_MAP_SRV_DESCRIPTOR_INDEX).ptr);
 
 	// Begin demo scene
@@ -562,7 +562,6 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 	// Enter main loop
 	bool quit = false;
 	auto lastFrameTime = std::chrono::high_resolution_clock::now();
-	auto lastGIGatherTime = std::chrono::high_resolution_clock::now();
 	while (!quit)
 	{
 		// Calculate frame delta time
@@ -581,6 +580,31 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 		// Tick demo scene
 		demoScene->Tick(frameTimeF);
 
+		// Grow the probe buffers and atlases before the frame records commands reading them
+		static auto& probePool = demoScene->GetProbePool();
+		if (!Renderer::ReserveProbeBuffers(probePool.GetTotalProbeCount()))
+		{
+			assert(false && "Failed to reserve probe buffers.");
+		}
+		const glm::ivec3 gridProbeCounts = glm::ivec3(probePool.GetVolume(0).GetProbeCountX(), probePool.GetVolume(0).GetProbeCountY(), probePool.GetVolume(0).GetProbeCountZ());
+		if (!Renderer::ReserveProbeAtlases(probePool.GetTotalProbeCount(), gridProbeCounts))
+		{
+			assert(false && "Failed to reserve probe atlases.");
+		}
+
+		// Start the scene's probe volume from its baked probes, when a bake for its grid exists, instead of converging from black
+		static bool bakedProbesLoaded = false;
+		if (!bakedProbesLoaded)
+		{
+			bakedProbesLoaded = true;
+			Renderer::BakedProbeFile bakedProbeFile;
+			if (probePool.GetVolume(0).LoadBakedProbes(DemoSceneLayout::BAKED_PROBE_FILE_PATH, bakedProbeFile) &&
+				!Renderer::UploadBakedProbes(bakedProbeFile.GetData(), probePool.GetBaseProbeIndex(0)))
+			{
+				assert(false && "Failed to upload baked probes.");
+			}
+		}
+
 		// Start a frame for the swap chain, retrieving the current back buffer index to render to
 		auto* pSwapChain = swapChain.get();
 		Renderer::Commands::StartFrame(pSwapChain);
@@ -591,10 +615,38 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 		// Set descriptor heaps
 		Renderer::Commands::SetDescriptorHeaps();
 
-		// Update per frame constants
+		// Upload the probe range of each volume that changed since its last upload. Adding or removing volumes can recreate the probe buffers,
+		// so every volume is uploaded after the pool layout changes
 		static auto& probeVolume = demoScene->GetProbeVolume();
+		static std::vector<uint64_t> probeUploadFrameIndices;
+		static uint64_t probeUploadLayoutVersion = 0;
+		if (probePool.GetLayoutVersion() != probeUploadLayoutVersion)
+		{
+			probeUploadFrameIndices.assign(probePool.GetVolumeCount(), 0);
+			probeUploadLayoutVersion = probePool.GetLayoutVersion();
+		}
+		for (uint32_t v = 0; v < probePool.GetVolumeCount(); ++v)
+		{
+			const auto& volume = probePool.GetVolume(v);
+			if (volume.HasChangedSince(probeUploadFrameIndices[v]))
+			{
+				Renderer::Commands::UpdateProbeBuffers(volume.GetProbePositions(), volume.GetProbeStates(), probePool.GetBaseProbeIndex(v));
+			}
+			probeUploadFrameIndices[v] = volume.GetFrameIndex();
+		}
+
+		// Update per frame constants
 		static const auto& lightDirection = demoScene->GetLightDirectionWS();
-		Renderer::Commands::UpdatePerFrameConstants(probeVolume.GetProbeTransforms(), lightDirection, demoScene->GetLightIntensity(), demoScene->GetProbeVolume().GetProbeSpacing());
+		static std::vector<Renderer::ProbeVolumeData> probeVolumeData;
+		static Renderer::ProbeBlendSettings probeBlendSettings = {};
+		probePool.GetVolumeData(probeVolumeData);
+
+		// A new seed each frame traces every probe update with a new random rotation of the probe rays. Seed zero leaves them unrotated
+		static bool rotateProbeRays = true;
+		static uint32_t probeRayRotationSeed = 0;
+		probeRayRotationSeed = rotateProbeRays ? std::max(probeRayRotationSeed + 1, 1u) : 0;
+		Renderer::Commands::UpdatePerFrameConstants(probeVolumeData, probePool.GetTotalProbeCount(), lightDirection, demoScene->GetLightIntensity(), probeVolume.GetProbeSpacing(),
+			probeBlendSettings, probeRayRotationSeed);
 
 		//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		//// Render shadow map pass
@@ -643,39 +695,83 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 		//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 		// Raytrace global illumination probe field
 		// Check raytracing is enabled
-		static float GIGatherRateSeconds = 0.1f;
+		static Renderer::ProbeUpdateScheduler probeUpdateScheduler;
+		static Renderer::ProbeUpdateSchedulerSettings probeUpdateSchedulerSettings = {};
 		static bool dispatchRays = true;
+
+		// Probes whose rays reach the space a moved instance swept through, or the shadow it casts from the light, see the change. The rest of the
+		// field keeps its lighting
+		static std::vector<uint32_t> changedProbeIndices;
+		changedProbeIndices.clear();
+		for (const auto& change : demoScene->GetInstanceChanges())
+		{
+			probePool.GetProbesAffectedBy(change.GetSweptBoundsWS(), lightDirection, Renderer::PROBE_MAX_RAY_DISTANCE, changedProbeIndices);
+		}
+		probeUpdateScheduler.InvalidateProbes(changedProbeIndices);
+
+		// The light reaches every probe
+		static glm::vec3 scheduledLightDirection = lightDirection;
+		static float scheduledLightIntensity = demoScene->GetLightIntensity();
+		if ((lightDirection != scheduledLightDirection) || (demoScene->GetLightIntensity() != scheduledLightIntensity))
+		{
+			probeUpdateScheduler.InvalidateAllProbes();
+			scheduledLightDirection = lightDirection;
+			scheduledLightIntensity = demoScene->GetLightIntensity();
+		}
+
 		if (dispatchRays)
 		{
-			// Check if enough time has elapsed since last GI gather
-			std::chrono::duration<float, std::milli> GITime = currentTime - lastGIGatherTime;
-			if (GITime.count() >= (GIGatherRateSeconds * 1000.0f))
+			// Feed the GPU time of the last completed dispatch back to the scheduler, so microsecond budgets convert to rays
+			double raytraceMilliseconds = 0.0;
+			uint32_t raytraceDispatchWidth = 0;
+			if (Renderer::GetRaytraceTiming(raytraceMilliseconds, raytraceDispatchWidth))
 			{
-				// Store time that this gather is happening on
-				lastGIGatherTime = currentTime;
+				probeUpdateScheduler.ReportUpdateCost(static_cast<size_t>(raytraceDispatchWidth) * Renderer::PROBE_RAY_COUNT, raytraceMilliseconds * 1000.0);
+			}
+
+			// Trace the frame's budget of probes instead of every probe at once. Probes placed at new positions hold stale data, so are scheduled
+			// first. A scrolling volume only places the newly exposed planes of probes.
+			// Nothing is traced on frames without scheduled probes, as when only changed probes are updated and nothing changed
+			const size_t probeStatisticsCount = std::min<size_t>(probePool.GetTotalProbeCount(), Renderer::GetProbeAtlasLayout().GetProbeCapacity());
+			const auto& probeUpdateSchedule = probeUpdateScheduler.Schedule(probePool, demoScene->GetMainCamera().Position, Renderer::GetProbeStatistics(),
+				probeStatisticsCount, probeUpdateSchedulerSettings);
+			if (!probeUpdateSchedule.ProbeIndices.empty())
+			{
+				Renderer::Commands::UpdateProbeUpdateIndices(probeUpdateSchedule.ProbeIndices);
 
 				// Rebuild acceleration structures
 				Renderer::Commands::RebuildTlas(demoScene->GetTlas());
 
-				// Describe dispatch rays
+				// Describe dispatch rays. Each ray gen thread traces one scheduled probe
 				D3D12_DISPATCH_RAYS_DESC dispatchRaysDesc = {};
-				dispatchRaysDesc.Width = 1;
+				dispatchRaysDesc.Width = static_cast<UINT>(probeUpdateSchedule.ProbeIndices.size());
 				dispatchRaysDesc.Height = 1;
 				dispatchRaysDesc.Depth = 1;
 
 				dispatchRaysDesc.RayGenerationShaderRecord.StartAddress = shaderTable->GetGPUVirtualAddress();
 				dispatchRaysDesc.RayGenerationShaderRecord.SizeInBytes = rayGenShaderRecordSize;
 
-				dispatchRaysDesc.MissShaderTable.StartAddress = shaderTable->GetGPUVirtualAddress() + rayGenShaderRecordSize;
+				dispatchRaysDesc.MissShaderTable.StartAddress = shaderTable->GetGPUVirtualAddress() + rayGenShaderTableSize;
 				dispatchRaysDesc.MissShaderTable.StrideInBytes = missShaderRecordSize;
 				dispatchRaysDesc.MissShaderTable.SizeInBytes = missShaderRecordSize;
 
-				dispatchRaysDesc.HitGroupTable.StartAddress = shaderTable->GetGPUVirtualAddress() + rayGenShaderRecordSize + ALIGN_TO(dispatchRaysDesc.MissShaderTable.SizeInBytes, 64);
+				dispatchRaysDesc.HitGroupTable.StartAddress = shaderTable->GetGPUVirtualAddress() + hitGroupRecordOffset;
 				dispatchRaysDesc.HitGroupTable.StrideInBytes = hitGroupShaderRecordSize;
 				dispatchRaysDesc.HitGroupTable.SizeInBytes = hitGroupShaderRecordSize;
 
+				// Filter each scheduled probe's rays with a thread per texel of its visibility tile, borders included, which covers its irradiance tile
+				D3D12_DISPATCH_RAYS_DESC filterDispatchRaysDesc = dispatchRaysDesc;
+				filterDispatchRaysDesc.Width = (Renderer::VISIBILITY_PROBE_SIDE_LENGTH + 2 * Renderer::PROBE_PADDING) * (Renderer::VISIBILITY_PROBE_SIDE_LENGTH + 2 * Renderer::PROBE_PADDING);
+				filterDispatchRaysDesc.Height = static_cast<UINT>(probeUpdateSchedule.ProbeIndices.size());
+				filterDispatchRaysDesc.RayGenerationShaderRecord.StartAddress = shaderTable->GetGPUVirtualAddress() + rayGenShaderRecordSize;
+
+				// Blend each scheduled probe's filtered gather into the atlases with a thread per probe
+				D3D12_DISPATCH_RAYS_DESC blendDispatchRaysDesc = dispatchRaysDesc;
+				blendDispatchRaysDesc.RayGenerationShaderRecord.StartAddress = shaderTable->GetGPUVirtualAddress() + (2 * rayGenShaderRecordSize);
+
 				// Dispatch rays
-				Renderer::Commands::Raytrace(dispatchRaysDesc, raytracingPipelineStateObject.Get(), raytraceOutputResource.Get(), raytraceOutput2Resource.Get());
+				Renderer::Commands::Raytrace(dispatchRaysDesc, filterDispatchRaysDesc, blendDispatchRaysDesc, raytracingPipelineStateObject.Get(),
+					Renderer::GetProbeIrradianceAtlas(), Renderer::GetProbeVisibilityAtlas());
 			}
 		}
 		//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -774,11 +870,12 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 		{
 			ImGui::Begin("Irradiance probe texture", &showIrradianceRaytraceOutput, ImGuiWindowFlags_HorizontalScrollbar | ImGuiWindowFlags_AlwaysVerticalScrollbar);
 			static float zoom = 10.0f;
+			const glm::uvec2 irradianceAtlasDimensions = Renderer::GetProbeAtlasLayout().GetIrradianceAtlasDimensions();
 			ImGui::DragFloat("Zoom", &zoom);
 			if (zoom < 1.0f) zoom = 1.0f;
 			ImGui::Image((void*)Renderer::GetShaderVisibleDescriptorHeap()->
 				GetGPUDescriptorHandle(Renderer::RAYTRACE_IRRADIANCE_SRV_DESCRIPTOR_INDEX).ptr, 
-				ImVec2(Renderer::RAYTRACE_IRRADIANCE_OUTPUT_DIMS.x * zoom, Renderer::RAYTRACE_IRRADIANCE_OUTPUT_DIMS.y * zoom));
+				ImVec2(static_cast<float>(irradianceAtlasDimensions.x) * zoom, static_cast<float>(irradianceAtlasDimensions.y) * zoom));
 			ImGui::End();
 		}
 
@@ -787,11 +884,22 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 		{
 			ImGui::Begin("Visibility probe texture", &showVisibilityRaytraceOutput, ImGuiWindowFlags_HorizontalScrollbar | ImGuiWindowFlags_AlwaysVerticalScrollbar);
 			static float zoom = 7.0f;
+			const glm::uvec2 visibilityAtlasDimensions = Renderer::GetProbeAtlasLayout().GetVisibilityAtlasDimensions();
 			ImGui::DragFloat("Zoom", &zoom);
 			if (zoom < 1.0f) zoom = 1.0f;
 			ImGui::Image((void*)Renderer::GetShaderVisibleDescriptorHeap()->
 				GetGPUDescriptorHandle(Renderer::RAYTRACE_VISIBILITY_SRV_DESCRIPTOR_INDEX).ptr, 
-				ImVec2(Renderer::RAYTRACE_VISIBILITY_OUTPUT_DIMS.x * zoom, Renderer::RAYTRACE_VISIBILITY_OUTPUT_DIMS.y * zoom));
+				ImVec2(static_cast<float>(visibilityAtlasDimensions.x) * zoom, static_cast<float>(visibilityAtlasDimensions.y) * zoom));
+			ImGui::End();
+		}
+
+		// Benchmark output
+		static bool showBenchmarkResults = false;
+		static std::string benchmarkResults;
+		if (showBenchmarkResults)
+		{
+			ImGui::Begin("Benchmark results", &showBenchmarkResults, ImGuiWindowFlags_HorizontalScrollbar);
+			ImGui::TextUnformatted(benchmarkResults.c_str());
 			ImGui::End();
 		}
 
@@ -811,8 +919,27 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 		{
 			ImGui::Text("Global illumination");
 			ImGui::Separator();
-			ImGui::InputFloat("Probe update rate (s)", &GIGatherRateSeconds);
 			ImGui::Checkbox("Enable raytracing", &dispatchRays);
+			static int probeUpdateBudgetMode = 0;
+			ImGui::Combo("Probe update budget", &probeUpdateBudgetMode, "Rays\0Microseconds\0");
+			probeUpdateSchedulerSettings.BudgetMode = static_cast<Renderer::ProbeUpdateBudgetMode>(probeUpdateBudgetMode);
+			if (probeUpdateSchedulerSettings.BudgetMode == Renderer::ProbeUpdateBudgetMode::Rays)
+			{
+				static int probeUpdateRayBudget = static_cast<int>(Renderer::PROBE_UPDATE_RAY_BUDGET);
+				ImGui::DragInt("Rays per frame", &probeUpdateRayBudget, 256.0f, static_cast<int>(Renderer::PROBE_RAY_COUNT), 1 << 22);
+				probeUpdateSchedulerSettings.RayBudget = static_cast<uint32_t>(std::max(probeUpdateRayBudget, 0));
+			}
+			else
+			{
+				ImGui::DragFloat("Microseconds per frame", &probeUpdateSchedulerSettings.MicrosecondBudget, 10.0f, 10.0f, 100000.0f);
+			}
+			ImGui::DragFloat("Probe distance falloff", &probeUpdateSchedulerSettings.DistanceFalloff, 0.1f, 0.1f, 100.0f);
+			ImGui::DragFloat("Probe distance weight", &probeUpdateSchedulerSettings.DistanceWeight, 0.1f, 0.0f, 100.0f);
+			ImGui::DragFloat("Probe change weight", &probeUpdateSchedulerSettings.ChangeWeight, 0.1f, 0.0f, 100.0f);
+			ImGui::Checkbox("Only update changed probes", &probeUpdateSchedulerSettings.ChangeDriven);
+			ImGui::Checkbox("Rotate probe rays", &rotateProbeRays);
+			ImGui::SliderFloat("Probe hysteresis", &probeBlendSettings.Hysteresis, 0.0f, 0.999f);
+			ImGui::SliderFloat("Probe change threshold", &probeBlendSettings.ChangeThreshold, 0.01f, 1.0f);
 			ImGui::Separator();
 
 			ImGui::Text("Light");
@@ -826,15 +953,83 @@ int WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPS
 			ImGui::Checkbox("Show irradiance probe texture", &showIrradianceRaytraceOutput);
 			ImGui::Checkbox("Show visibility probe texture", &showVisibilityRaytraceOutput);
 			ImGui::Checkbox("Visualize probe volume", &visualizeProbeVolume);
+			ImGui::Checkbox("Probe volume follows camera", &demoScene->GetProbeVolumeFollowsCamera());
+			ImGui::Checkbox("Probe cascades around camera", &demoScene->GetProbeCascadesEnabled());
+			ImGui::Text("Probe volumes: %u  Probes: %u", probePool.GetVolumeCount(), probePool.GetTotalProbeCount());
 			ImGui::DragFloat3("Probe volume position", &demoScene->GetProbeVolumePositionWS().x, 0.1f);
-			probeVolume.Update();
+
+			// Spherical harmonic probes take a fraction of an atlas tile's memory, at the cost of sharper lighting and occlusion
+			auto probeEncoding = static_cast<int>(probeVolume.GetProbeEncoding());
+			if (ImGui::Combo("Probe encoding", &probeEncoding, "Octahedral\0Spherical harmonics L1\0Spherical harmonics L2\0"))
+			{
+				probeVolume.SetProbeEncoding(static_cast<Renderer::ProbeEncoding>(probeEncoding));
+				probeUpdateScheduler.InvalidateAllProbes();
+			}
 			ImGui::Separator();
 
 			ImGui::Text("Stats");
 			ImGui::Separator();
 			ImGui::Checkbox("Show performance stats", &displayPerformanceStatsWindow);
+
+			// Why the scheduler picked this frame's probes
+			const auto& probeUpdateSchedule = probeUpdateScheduler.GetSchedule();
+			ImGui::Text("Scheduled probes: %zu/%zu  Rays: %zu/%u  Inactive: %zu  Reset: %zu  Deferred resets: %zu  Invalidated: %zu  Settled: %zu",
+				probeUpdateSchedule.ProbeIndices.size(), probeUpdateSchedule.CandidateProbeCount, probeUpdateSchedule.RayCount, probeUpdateSchedule.RayBudget,
+				probeUpdateSchedule.InactiveProbeCount, probeUpdateSchedule.ResetProbeCount, probeUpdateSchedule.DeferredResetProbeCount,
+				probeUpdateSchedule.InvalidatedProbeCount, probeUpdateSchedule.SettledProbeCount);
+			ImGui::Text("Probe age (frames, mean/scheduled/max): %.1f/%.1f/%llu  Min scheduled priority: %.3g  Schedule (ms): %.3f  Update (us per ray): %.4f",
+				probeUpdateSchedule.MeanAge, probeUpdateSchedule.MeanScheduledAge, static_cast<unsigned long long>(probeUpdateSchedule.MaxAge),
+				probeUpdateSchedule.MinScheduledPriority, probeUpdateSchedule.Milliseconds, probeUpdateSchedule.MicrosecondsPerRay);
+
+			// Probes whose last gather barely moved their history have converged, and could be traced with fewer rays
+			static float probeConvergedChange = 0.02f;
+			ImGui::DragFloat("Probe converged change", &probeConvergedChange, 0.001f, 0.0f, 1.0f);
+			if (const auto* pProbeStatistics = Renderer::GetProbeStatistics())
+			{
+				const size_t probeCount = std::min<size_t>(probePool.GetTotalProbeCount(), Renderer::GetProbeAtlasLayout().GetProbeCapacity());
+				const auto summary = Renderer::SummarizeProbeStatistics(pProbeStatistics, probeCount, probeConvergedChange);
+				ImGui::Text("Probes with history: %zu  Converged: %zu  Mean change: %.4f  Mean variance: %.6f", summary.ProbeCount, summary.ConvergedProbeCount,
+					summary.MeanChange, summary.MeanLuminanceVariance);
+			}
 			ImGui::Separator();
 
+			ImGui::Text("CPU reference");
+			ImGui::Separator();
+			static Renderer::CPU::ProbeTracer cpuProbeTracer;
+			static Renderer::CPU::ProbeTraceStats cpuProbeTraceStats = {};
+			if (ImGui::Button("Trace probes on CPU"))
+			{
+				Renderer::CPU::ProbeTraceSettings cpuProbeTraceSettings = {};
+				cpuProbeTraceSettings.LightDirectionWS = demoScene->GetLightDirectionWS();
+				cpuProbeTraceSettings.LightIntensity = demoScene->GetLightIntensity();
+				cpuProbeTraceSettings.pProbeStates = &probeVolume.GetProbeStates();
+				cpuProbeTraceSettings.Blend = probeBlendSettings;
+				cpuProbeTraceSettings.RayRotationSeed = probeRayRotationSeed;
+				cpuProbeTraceSettings.Encoding = probeVolume.GetProbeEncoding();
+				cpuProbeTraceStats = cpuProbeTracer.TraceProbes(demoScene->GetCPURaytracingScene(), probeVolume.GetProbePositions(), cpuProbeTraceSettings);
+			}
+			ImGui::Text("Threads: %u  Trace (ms): %.3f  Filter (ms): %.3f  Blend (ms): %.3f  Mrays/s: %.2f", cpuProbeTraceStats.ThreadCount,
+				cpuProbeTraceStats.TraceMilliseconds, cpuProbeTraceStats.FilterMilliseconds, cpuProbeTraceStats.BlendMilliseconds, cpuProbeTraceStats.GetMraysPerSecond());
+			ImGui::Text("Inactive probes: %zu  Rays saved per update: %zu", cpuProbeTraceStats.SkippedProbeCount, cpuProbeTraceStats.SkippedRayCount);
+			ImGui::Text("Restarted histories: %zu  Mean change: %.4f", cpuProbeTraceStats.RestartedProbeCount, cpuProbeTraceStats.MeanChange);
+			ImGui::Separator();
+
+			ImGui::EndMenu();
+		}
+
+		if (ImGui::BeginMenu("Benchmarks"))
+		{
+			// Benchmarks run on the main thread and stall the frame until complete
+			for (const auto& entry : Benchmark::GetEntries())
+			{
+				if (ImGui::MenuItem(entry.Name, entry.Description))
+				{
+					std::ostringstream output;
+					Benchmark::Run(entry.Name, output);
+					benchmarkResults = output.str();
+					showBenchmarkResults = true;
+				}
+			}
 			ImGui::EndMenu();
 		}
 
@@ -0,0 +1,31 @@
+#pragma once
+
+// Axis aligned bounding box. Default constructed boxes are empty and grow to fit points and other boxes
+struct BoundingBox
+{
+	glm::vec3 Min{ std::numeric_limits<float>::max() };
+	glm::vec3 Max{ -std::numeric_limits<float>::max() };
+
+	void Grow(const glm::vec3& point) { Min = glm::min(Min, point); Max = glm::max(Max, point); }
+	void Grow(const BoundingBox& box) { Min = glm::min(Min, box.Min); Max = glm::max(Max, box.Max); }
+	bool IsEmpty() const { return Min.x > Max.x || Min.y > Max.y || Min.z > Max.z; }
+	glm::vec3 GetExtents() const { return Max - Min; }
+	glm::vec3 GetCentre() const { return (Min + Max) * 0.5f; }
+
+	float GetSurfaceArea() const
+	{
+		if (IsEmpty())
+		{
+			return 0.0f;
+		}
+		const glm::vec3 extents = GetExtents();
+		return 2.0f * (extents.x * extents.y + extents.y * extents.z + extents.z * extents.x);
+	}
+
+	bool Overlaps(const BoundingBox& box) const
+	{
+		return Min.x <= box.Max.x && Max.x >= box.Min.x &&
+			Min.y <= box.Max.y && Max.y >= box.Min.y &&
+			Min.z <= box.Max.z && Max.z >= box.Min.z;
+	}
+};
@@ -1,6 +1,7 @@
-#include "Pch.h"
+#include "CpuPch.h"
 #include "Math.h"
 #include "Transform.h"
+#include "BoundingBox.h"
 
 glm::mat4 Math::CalculateWorldMatrix(const Transform& transform)
 {
@@ -60,3 +61,22 @@ glm::vec3 Math::FindLookAtRotation(const glm::vec3& currentPosition, const glm::
 	return eulerRotation;
 }
 
+BoundingBox Math::TransformBoundingBox(const BoundingBox& box, const glm::mat4& transformMatrix)
+{
+	if (box.IsEmpty())
+	{
+		return box;
+	}
+
+	// Transform the centre and project the extents onto each world axis
+	const glm::vec3 centre = glm::vec3(transformMatrix * glm::vec4(box.GetCentre(), 1.0f));
+	const glm::vec3 halfExtents = box.GetExtents() * 0.5f;
+	const glm::vec3 transformedHalfExtents = glm::abs(glm::vec3(transformMatrix[0])) * halfExtents.x +
+		glm::abs(glm::vec3(transformMatrix[1])) * halfExtents.y +
+		glm::abs(glm::vec3(transformMatrix[2])) * halfExtents.z;
+
+	BoundingBox result;
+	result.Min = centre - transformedHalfExtents;
+	result.Max = centre + transformedHalfExtents;
+	return result;
+}
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 struct Transform;
+struct BoundingBox;
 
 namespace Math
 {
@@ -10,4 +11,6 @@ namespace Math
 	glm::mat4 CalculateOrthographicProjectionMatrix(const float width, const float height, const float nearClipPlane, const float farClipPlane);
 	glm::vec3 RotateVector(const glm::vec3& rotation, const glm::vec3& vector);
 	glm::vec3 FindLookAtRotation(const glm::vec3& currentPosition, const glm::vec3& targetPosition, const glm::vec3& up);
+	// Returns the axis aligned box enclosing the transformed box
+	BoundingBox TransformBoundingBox(const BoundingBox& box, const glm::mat4& transformMatrix);
 }
\ No newline at end of file
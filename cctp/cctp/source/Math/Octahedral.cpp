@@ -0,0 +1,172 @@
+#include "CpuPch.h"
+#include "Octahedral.h"
+#include "Simd.h"
+
+glm::vec2 Math::SignNotZero(const glm::vec2& v)
+{
+	return glm::vec2((v.x >= 0.0f) ? 1.0f : -1.0f, (v.y >= 0.0f) ? 1.0f : -1.0f);
+}
+
+glm::vec2 Math::OctEncode(const glm::vec3& v)
+{
+	float l1norm = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+	glm::vec2 result = glm::vec2(v.x, v.y) * (1.0f / l1norm);
+	if (v.z < 0.0f)
+	{
+		result = (1.0f - glm::abs(glm::vec2(result.y, result.x))) * SignNotZero(result);
+	}
+	return result;
+}
+
+glm::vec3 Math::OctDecode(const glm::vec2& o)
+{
+	glm::vec3 v = glm::vec3(o.x, o.y, 1.0f - std::abs(o.x) - std::abs(o.y));
+	if (v.z < 0.0f)
+	{
+		glm::vec2 xy = (1.0f - glm::abs(glm::vec2(v.y, v.x))) * SignNotZero(glm::vec2(v.x, v.y));
+		v.x = xy.x;
+		v.y = xy.y;
+	}
+	return glm::normalize(v);
+}
+
+// The AVX2 kernels repeat the scalar operations in the same order without fused multiply adds, so results match bit for bit
+
+SIMD_AVX2 __m256 AbsOctahedral(const __m256 v)
+{
+	return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v);
+}
+
+SIMD_AVX2 __m256 SignNotZeroOctahedral(const __m256 v)
+{
+	return _mm256_blendv_ps(_mm256_set1_ps(-1.0f), _mm256_set1_ps(1.0f), _mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_GE_OQ));
+}
+
+SIMD_AVX2 void OctEncodeAvx2(const __m256 x, const __m256 y, const __m256 z, __m256& resultX, __m256& resultY)
+{
+	const __m256 l1norm = _mm256_add_ps(_mm256_add_ps(AbsOctahedral(x), AbsOctahedral(y)), AbsOctahedral(z));
+	const __m256 inverseL1norm = _mm256_div_ps(_mm256_set1_ps(1.0f), l1norm);
+	const __m256 encodedX = _mm256_mul_ps(x, inverseL1norm);
+	const __m256 encodedY = _mm256_mul_ps(y, inverseL1norm);
+
+	// Fold the lower hemisphere over the diagonals
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 foldedX = _mm256_mul_ps(_mm256_sub_ps(one, AbsOctahedral(encodedY)), SignNotZeroOctahedral(encodedX));
+	const __m256 foldedY = _mm256_mul_ps(_mm256_sub_ps(one, AbsOctahedral(encodedX)), SignNotZeroOctahedral(encodedY));
+	const __m256 lowerHemisphere = _mm256_cmp_ps(z, _mm256_setzero_ps(), _CMP_LT_OQ);
+	resultX = _mm256_blendv_ps(encodedX, foldedX, lowerHemisphere);
+	resultY = _mm256_blendv_ps(encodedY, foldedY, lowerHemisphere);
+}
+
+SIMD_AVX2 void OctDecodeAvx2(const __m256 octX, const __m256 octY, __m256& resultX, __m256& resultY, __m256& resultZ)
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 z = _mm256_sub_ps(_mm256_sub_ps(one, AbsOctahedral(octX)), AbsOctahedral(octY));
+
+	// Unfold the lower hemisphere
+	const __m256 unfoldedX = _mm256_mul_ps(_mm256_sub_ps(one, AbsOctahedral(octY)), SignNotZeroOctahedral(octX));
+	const __m256 unfoldedY = _mm256_mul_ps(_mm256_sub_ps(one, AbsOctahedral(octX)), SignNotZeroOctahedral(octY));
+	const __m256 lowerHemisphere = _mm256_cmp_ps(z, _mm256_setzero_ps(), _CMP_LT_OQ);
+	const __m256 x = _mm256_blendv_ps(octX, unfoldedX, lowerHemisphere);
+	const __m256 y = _mm256_blendv_ps(octY, unfoldedY, lowerHemisphere);
+
+	// As glm::normalize, v * (1 / sqrt(dot(v, v)))
+	const __m256 lengthSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+	const __m256 inverseLength = _mm256_div_ps(one, _mm256_sqrt_ps(lengthSquared));
+	resultX = _mm256_mul_ps(x, inverseLength);
+	resultY = _mm256_mul_ps(y, inverseLength);
+	resultZ = _mm256_mul_ps(z, inverseLength);
+}
+
+// Processes whole groups of eight, returning the number processed
+SIMD_AVX2 size_t OctEncodeTexelsAvx2(const glm::vec3* pDirections, const size_t count, const bool texels, const glm::vec2& topLeft, const float sideLength,
+	glm::vec2* pResults)
+{
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 side = _mm256_set1_ps(sideLength);
+	const __m256 left = _mm256_set1_ps(topLeft.x);
+	const __m256 top = _mm256_set1_ps(topLeft.y);
+
+	const size_t groupedCount = count - count % 8;
+	for (size_t i = 0; i < groupedCount; i += 8)
+	{
+		__m256 x, y, z;
+		Math::LoadFloat3x8(pDirections + i, x, y, z);
+		__m256 octX, octY;
+		OctEncodeAvx2(x, y, z, octX, octY);
+		if (texels)
+		{
+			octX = _mm256_add_ps(left, _mm256_mul_ps(_mm256_mul_ps(_mm256_add_ps(octX, one), half), side));
+			octY = _mm256_add_ps(top, _mm256_mul_ps(_mm256_mul_ps(_mm256_add_ps(octY, one), half), side));
+		}
+		Math::StoreFloat2x8(octX, octY, pResults + i);
+	}
+	return groupedCount;
+}
+
+SIMD_AVX2 size_t OctDecodeTexelsAvx2(const glm::vec2* pCoordinates, const size_t count, const bool texels, const glm::vec2& topLeft, const float sideLength,
+	glm::vec3* pDirections)
+{
+	const __m256 two = _mm256_set1_ps(2.0f);
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 side = _mm256_set1_ps(sideLength);
+	const __m256 left = _mm256_set1_ps(topLeft.x);
+	const __m256 top = _mm256_set1_ps(topLeft.y);
+
+	const size_t groupedCount = count - count % 8;
+	for (size_t i = 0; i < groupedCount; i += 8)
+	{
+		__m256 octX, octY;
+		Math::LoadFloat2x8(pCoordinates + i, octX, octY);
+		if (texels)
+		{
+			octX = _mm256_sub_ps(_mm256_mul_ps(_mm256_div_ps(_mm256_sub_ps(octX, left), side), two), one);
+			octY = _mm256_sub_ps(_mm256_mul_ps(_mm256_div_ps(_mm256_sub_ps(octY, top), side), two), one);
+		}
+		__m256 x, y, z;
+		OctDecodeAvx2(octX, octY, x, y, z);
+		Math::StoreFloat3x8(x, y, z, pDirections + i);
+	}
+	return groupedCount;
+}
+
+void Math::OctEncode(const glm::vec3* pDirections, const size_t count, glm::vec2* pOctCoords, const bool allowAvx2)
+{
+	const size_t first = (allowAvx2 && SupportsAvx2()) ? OctEncodeTexelsAvx2(pDirections, count, false, glm::vec2(0.0f, 0.0f), 0.0f, pOctCoords) : 0;
+	for (size_t i = first; i < count; ++i)
+	{
+		pOctCoords[i] = OctEncode(pDirections[i]);
+	}
+}
+
+void Math::OctDecode(const glm::vec2* pOctCoords, const size_t count, glm::vec3* pDirections, const bool allowAvx2)
+{
+	const size_t first = (allowAvx2 && SupportsAvx2()) ? OctDecodeTexelsAvx2(pOctCoords, count, false, glm::vec2(0.0f, 0.0f), 0.0f, pDirections) : 0;
+	for (size_t i = first; i < count; ++i)
+	{
+		pDirections[i] = OctDecode(pOctCoords[i]);
+	}
+}
+
+void Math::OctEncodeTexels(const glm::vec3* pDirections, const size_t count, const glm::vec2& topLeft, const float sideLength, glm::vec2* pTexelCoordinates,
+	const bool allowAvx2)
+{
+	const size_t first = (allowAvx2 && SupportsAvx2()) ? OctEncodeTexelsAvx2(pDirections, count, true, topLeft, sideLength, pTexelCoordinates) : 0;
+	for (size_t i = first; i < count; ++i)
+	{
+		// Same operations as GetProbeTexelCoordinate
+		const glm::vec2 normalizedOctCoordZeroOne = (OctEncode(pDirections[i]) + 1.0f) * 0.5f;
+		pTexelCoordinates[i] = topLeft + normalizedOctCoordZeroOne * sideLength;
+	}
+}
+
+void Math::OctDecodeTexels(const glm::vec2* pTexelCoordinates, const size_t count, const glm::vec2& topLeft, const float sideLength, glm::vec3* pDirections,
+	const bool allowAvx2)
+{
+	const size_t first = (allowAvx2 && SupportsAvx2()) ? OctDecodeTexelsAvx2(pTexelCoordinates, count, true, topLeft, sideLength, pDirections) : 0;
+	for (size_t i = first; i < count; ++i)
+	{
+		pDirections[i] = OctDecode((pTexelCoordinates[i] - topLeft) / sideLength * 2.0f - 1.0f);
+	}
+}
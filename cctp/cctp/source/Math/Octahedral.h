@@ -0,0 +1,26 @@
+#pragma once
+
+// CPU versions of the functions in Shaders/Octahedral.hlsl
+namespace Math
+{
+	glm::vec2 SignNotZero(const glm::vec2& v);
+
+	// Majercik et al. https://jcgt.org/published/0008/02/01/
+	// Assumes that v is a unit vector. The result is an octahedral vector on the [-1, +1] square
+	glm::vec2 OctEncode(const glm::vec3& v);
+
+	// Majercik et al. https://jcgt.org/published/0008/02/01/
+	// Returns a unit vector. Argument o is an octahedral vector packed via OctEncode, on the [-1, +1] square
+	glm::vec3 OctDecode(const glm::vec2& o);
+
+	// Batch versions over arrays, with results bit identical to the functions above. AVX2 kernels are used when supported unless allowAvx2 is cleared
+	void OctEncode(const glm::vec3* pDirections, const size_t count, glm::vec2* pOctCoords, const bool allowAvx2 = true);
+	void OctDecode(const glm::vec2* pOctCoords, const size_t count, glm::vec3* pDirections, const bool allowAvx2 = true);
+
+	// Texel coordinates of directions in a probe's octahedral square of sideLength texels starting at topLeft, as GetProbeTexelCoordinate in Common.hlsl
+	void OctEncodeTexels(const glm::vec3* pDirections, const size_t count, const glm::vec2& topLeft, const float sideLength, glm::vec2* pTexelCoordinates,
+		const bool allowAvx2 = true);
+	// Directions of texel coordinates in a probe's octahedral square, the inverse of OctEncodeTexels. Texel centres are at half texel offsets
+	void OctDecodeTexels(const glm::vec2* pTexelCoordinates, const size_t count, const glm::vec2& topLeft, const float sideLength, glm::vec3* pDirections,
+		const bool allowAvx2 = true);
+}
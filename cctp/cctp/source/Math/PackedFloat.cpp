@@ -0,0 +1,361 @@
+#include "CpuPch.h"
+#include "PackedFloat.h"
+#include "Simd.h"
+
+// Shifts right, rounding to nearest with ties to even
+uint32_t ShiftRightRoundEven(const uint32_t value, const uint32_t shift)
+{
+	if (shift == 0)
+	{
+		return value;
+	}
+	if (shift >= 32)
+	{
+		return 0;
+	}
+	const uint32_t result = value >> shift;
+	const uint32_t remainder = value & ((1u << shift) - 1);
+	const uint32_t half = 1u << (shift - 1);
+	return result + (((remainder > half) || ((remainder == half) && ((result & 1) != 0))) ? 1 : 0);
+}
+
+// Encodes the bits of a finite positive float as a float with five exponent bits and the mantissa bits. Rounding can carry into the exponent and
+// values too large give exponents past the format's, which callers clamp
+uint32_t PackFloatMagnitude(const uint32_t bits, const uint32_t mantissaBits)
+{
+	const int32_t exponent = static_cast<int32_t>(bits >> 23) - 127 + 15;
+	const uint32_t mantissa = bits & 0x007FFFFF;
+	if (exponent > 0)
+	{
+		return ShiftRightRoundEven((static_cast<uint32_t>(exponent) << 23) | mantissa, 23 - mantissaBits);
+	}
+
+	// Denormal, with the implicit leading one shifted below the smallest exponent
+	return ShiftRightRoundEven(mantissa | 0x00800000, (23 - mantissaBits) + static_cast<uint32_t>(1 - exponent));
+}
+
+float UnpackFloatMagnitude(const uint32_t packed, const uint32_t mantissaBits)
+{
+	const uint32_t exponent = packed >> mantissaBits;
+	const uint32_t mantissa = packed & ((1u << mantissaBits) - 1);
+	if (exponent == 0)
+	{
+		return std::ldexp(static_cast<float>(mantissa), -14 - static_cast<int32_t>(mantissaBits));
+	}
+	if (exponent == 31)
+	{
+		// Infinity, or a quiet NaN keeping the payload
+		return std::bit_cast<float>(0x7F800000 | ((mantissa == 0) ? 0 : (0x00400000 | (mantissa << (23 - mantissaBits)))));
+	}
+	return std::bit_cast<float>(((exponent - 15 + 127) << 23) | (mantissa << (23 - mantissaBits)));
+}
+
+uint32_t PackUnsignedSmallFloat(const float value, const uint32_t mantissaBits)
+{
+	const uint32_t bits = std::bit_cast<uint32_t>(value);
+	const uint32_t maxFinite = (0x1Eu << mantissaBits) | ((1u << mantissaBits) - 1);
+	if ((bits & 0x7F800000) == 0x7F800000)
+	{
+		// Positive infinity is clamped like any other large value. NaN and negative infinity are stored as zero
+		return (bits == 0x7F800000) ? maxFinite : 0;
+	}
+	if ((bits & 0x80000000) != 0)
+	{
+		return 0;
+	}
+	return std::min(PackFloatMagnitude(bits, mantissaBits), maxFinite);
+}
+
+uint32_t Math::PackR11G11B10Float(const glm::vec3& value)
+{
+	return PackUnsignedSmallFloat(value.x, 6) | (PackUnsignedSmallFloat(value.y, 6) << 11) | (PackUnsignedSmallFloat(value.z, 5) << 22);
+}
+
+glm::vec3 Math::UnpackR11G11B10Float(const uint32_t packed)
+{
+	return glm::vec3(
+		UnpackFloatMagnitude(packed & 0x7FF, 6),
+		UnpackFloatMagnitude((packed >> 11) & 0x7FF, 6),
+		UnpackFloatMagnitude(packed >> 22, 5));
+}
+
+// Stores NaN and values below zero as zero
+float ClampR9G9B9E5Channel(const float value)
+{
+	return (value > 0.0f) ? std::min(value, Math::R9G9B9E5_SHAREDEXP_MAX) : 0.0f;
+}
+
+uint32_t Math::PackR9G9B9E5SharedExp(const glm::vec3& value)
+{
+	const glm::vec3 clamped(ClampR9G9B9E5Channel(value.x), ClampR9G9B9E5Channel(value.y), ClampR9G9B9E5Channel(value.z));
+	const float maxChannel = std::max(std::max(clamped.x, clamped.y), clamped.z);
+
+	// The shared exponent is floor(log2(maxChannel)) + 16, read from the float's exponent. Mantissas are scaled by 2^(24 - exponent), so the largest
+	// channel has nine bits. Rounding the largest channel up to 512 moves it to the next exponent
+	uint32_t exponent = static_cast<uint32_t>(std::max(static_cast<int32_t>(std::bit_cast<uint32_t>(maxChannel) >> 23) - 127, -16) + 16);
+	float scale = std::bit_cast<float>((127 + 24 - exponent) << 23);
+	if (std::floor(maxChannel * scale + 0.5f) == 512.0f)
+	{
+		++exponent;
+		scale *= 0.5f;
+	}
+
+	const auto red = static_cast<uint32_t>(std::floor(clamped.x * scale + 0.5f));
+	const auto green = static_cast<uint32_t>(std::floor(clamped.y * scale + 0.5f));
+	const auto blue = static_cast<uint32_t>(std::floor(clamped.z * scale + 0.5f));
+	return red | (green << 9) | (blue << 18) | (exponent << 27);
+}
+
+glm::vec3 Math::UnpackR9G9B9E5SharedExp(const uint32_t packed)
+{
+	const float scale = std::bit_cast<float>(((packed >> 27) + 127 - 24) << 23);
+	return glm::vec3(
+		static_cast<float>(packed & 0x1FF) * scale,
+		static_cast<float>((packed >> 9) & 0x1FF) * scale,
+		static_cast<float>((packed >> 18) & 0x1FF) * scale);
+}
+
+uint32_t Math::PackR16G16Float(const glm::vec2& value)
+{
+	return static_cast<uint32_t>(FloatToHalf(value.x)) | (static_cast<uint32_t>(FloatToHalf(value.y)) << 16);
+}
+
+glm::vec2 Math::UnpackR16G16Float(const uint32_t packed)
+{
+	return glm::vec2(HalfToFloat(static_cast<uint16_t>(packed & 0xFFFF)), HalfToFloat(static_cast<uint16_t>(packed >> 16)));
+}
+
+uint16_t Math::FloatToHalf(const float value)
+{
+	const uint32_t bits = std::bit_cast<uint32_t>(value);
+	const uint32_t sign = (bits >> 16) & 0x8000;
+	const uint32_t magnitude = bits & 0x7FFFFFFF;
+	if (magnitude >= 0x7F800000)
+	{
+		// Infinity, or a quiet NaN keeping the high bits of the payload
+		return static_cast<uint16_t>(sign | 0x7C00 | ((magnitude > 0x7F800000) ? (0x0200 | ((magnitude >> 13) & 0x03FF)) : 0));
+	}
+	// Values rounding past the largest half become infinity
+	return static_cast<uint16_t>(sign | std::min(PackFloatMagnitude(magnitude, 10), 0x7C00u));
+}
+
+float Math::HalfToFloat(const uint16_t half)
+{
+	const float magnitude = UnpackFloatMagnitude(half & 0x7FFFu, 10);
+	return std::bit_cast<float>(std::bit_cast<uint32_t>(magnitude) | (static_cast<uint32_t>(half & 0x8000) << 16));
+}
+
+// The AVX2 kernels repeat the scalar operations in the same order without fused multiply adds, so results match bit for bit
+
+SIMD_AVX2 __m256i ShiftRightRoundEvenAvx2(const __m256i value, const __m256i shift)
+{
+	// Adding half minus one, plus one more when the truncated result is odd, carries into the result exactly when the scalar rounding rounds up.
+	// Shifts are between 1 and 31
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i result = _mm256_srlv_epi32(value, shift);
+	const __m256i halfMinusOne = _mm256_sub_epi32(_mm256_sllv_epi32(one, _mm256_sub_epi32(shift, one)), one);
+	return _mm256_srlv_epi32(_mm256_add_epi32(_mm256_add_epi32(value, halfMinusOne), _mm256_and_si256(result, one)), shift);
+}
+
+SIMD_AVX2 __m256i PackUnsignedSmallFloatAvx2(const __m256 value, const uint32_t mantissaBits)
+{
+	const __m256i bits = _mm256_castps_si256(value);
+	const auto normalShift = static_cast<int32_t>(23 - mantissaBits);
+
+	// Normal results rebias the exponent in place. Denormal results shift the mantissa and its implicit one down by the distance below the smallest
+	// exponent, which is limited to 31 because every shift past 24 already gives zero
+	const __m256i normal = ShiftRightRoundEvenAvx2(_mm256_sub_epi32(bits, _mm256_set1_epi32(112 << 23)), _mm256_set1_epi32(normalShift));
+	const __m256i denormalShift = _mm256_min_epi32(_mm256_sub_epi32(_mm256_set1_epi32(normalShift + 113), _mm256_srli_epi32(bits, 23)), _mm256_set1_epi32(31));
+	const __m256i denormal = ShiftRightRoundEvenAvx2(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x00800000)),
+		denormalShift);
+	const __m256i isNormal = _mm256_cmpgt_epi32(bits, _mm256_set1_epi32((113 << 23) - 1));
+	const __m256i maxFinite = _mm256_set1_epi32(static_cast<int32_t>((0x1Eu << mantissaBits) | ((1u << mantissaBits) - 1)));
+	const __m256i magnitude = _mm256_min_epu32(_mm256_blendv_epi8(denormal, normal, isNormal), maxFinite);
+
+	// Infinity is clamped with the normal values. Negative values and NaN are stored as zero
+	const __m256i storable = _mm256_and_si256(_mm256_cmpgt_epi32(bits, _mm256_set1_epi32(-1)), _mm256_cmpgt_epi32(_mm256_set1_epi32(0x7F800001), bits));
+	return _mm256_and_si256(magnitude, storable);
+}
+
+SIMD_AVX2 __m256 UnpackFloatMagnitudeAvx2(const __m256i packed, const uint32_t mantissaBits)
+{
+	const __m256i exponent = _mm256_srli_epi32(packed, static_cast<int>(mantissaBits));
+	const __m256i mantissa = _mm256_and_si256(packed, _mm256_set1_epi32(static_cast<int32_t>((1u << mantissaBits) - 1)));
+	const __m256i shiftedMantissa = _mm256_slli_epi32(mantissa, static_cast<int>(23 - mantissaBits));
+
+	const __m256i normal = _mm256_or_si256(_mm256_slli_epi32(_mm256_add_epi32(exponent, _mm256_set1_epi32(127 - 15)), 23), shiftedMantissa);
+	const __m256i denormal = _mm256_castps_si256(_mm256_mul_ps(_mm256_cvtepi32_ps(mantissa), _mm256_set1_ps(std::ldexp(1.0f, -14 - static_cast<int32_t>(mantissaBits)))));
+	const __m256i quiet = _mm256_andnot_si256(_mm256_cmpeq_epi32(mantissa, _mm256_setzero_si256()), _mm256_set1_epi32(0x00400000));
+	const __m256i special = _mm256_or_si256(_mm256_set1_epi32(0x7F800000), _mm256_or_si256(quiet, shiftedMantissa));
+
+	__m256i result = _mm256_blendv_epi8(normal, denormal, _mm256_cmpeq_epi32(exponent, _mm256_setzero_si256()));
+	result = _mm256_blendv_epi8(result, special, _mm256_cmpeq_epi32(exponent, _mm256_set1_epi32(31)));
+	return _mm256_castsi256_ps(result);
+}
+
+// Processes whole groups of eight, returning the number processed
+SIMD_AVX2 size_t PackR11G11B10FloatAvx2(const glm::vec3* pValues, const size_t count, uint32_t* pPacked)
+{
+	const size_t groupedCount = count - count % 8;
+	for (size_t i = 0; i < groupedCount; i += 8)
+	{
+		__m256 red, green, blue;
+		Math::LoadFloat3x8(pValues + i, red, green, blue);
+		const __m256i packed = _mm256_or_si256(_mm256_or_si256(PackUnsignedSmallFloatAvx2(red, 6), _mm256_slli_epi32(PackUnsignedSmallFloatAvx2(green, 6), 11)),
+			_mm256_slli_epi32(PackUnsignedSmallFloatAvx2(blue, 5), 22));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(pPacked + i), packed);
+	}
+	return groupedCount;
+}
+
+SIMD_AVX2 size_t UnpackR11G11B10FloatAvx2(const uint32_t* pPacked, const size_t count, glm::vec3* pValues)
+{
+	const __m256i channelMask = _mm256_set1_epi32(0x7FF);
+	const size_t groupedCount = count - count % 8;
+	for (size_t i = 0; i < groupedCount; i += 8)
+	{
+		const __m256i packed = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pPacked + i));
+		Math::StoreFloat3x8(
+			UnpackFloatMagnitudeAvx2(_mm256_and_si256(packed, channelMask), 6),
+			UnpackFloatMagnitudeAvx2(_mm256_and_si256(_mm256_srli_epi32(packed, 11), channelMask), 6),
+			UnpackFloatMagnitudeAvx2(_mm256_srli_epi32(packed, 22), 5),
+			pValues + i);
+	}
+	return groupedCount;
+}
+
+SIMD_AVX2 __m256i PackR9G9B9E5ChannelAvx2(const __m256 value, const __m256 scale)
+{
+	return _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_add_ps(_mm256_mul_ps(value, scale), _mm256_set1_ps(0.5f))));
+}
+
+// Max returns its second operand when either is NaN, so NaN is stored as zero as in ClampR9G9B9E5Channel
+SIMD_AVX2 __m256 ClampR9G9B9E5ChannelAvx2(const __m256 value)
+{
+	return _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), _mm256_set1_ps(Math::R9G9B9E5_SHAREDEXP_MAX));
+}
+
+SIMD_AVX2 size_t PackR9G9B9E5SharedExpAvx2(const glm::vec3* pValues, const size_t count, uint32_t* pPacked)
+{
+	const size_t groupedCount = count - count % 8;
+	for (size_t i = 0; i < groupedCount; i += 8)
+	{
+		__m256 red, green, blue;
+		Math::LoadFloat3x8(pValues + i, red, green, blue);
+		red = ClampR9G9B9E5ChannelAvx2(red);
+		green = ClampR9G9B9E5ChannelAvx2(green);
+		blue = ClampR9G9B9E5ChannelAvx2(blue);
+		const __m256 maxChannel = _mm256_max_ps(_mm256_max_ps(red, green), blue);
+
+		__m256i exponent = _mm256_add_epi32(_mm256_max_epi32(_mm256_sub_epi32(_mm256_srli_epi32(_mm256_castps_si256(maxChannel), 23), _mm256_set1_epi32(127)),
+			_mm256_set1_epi32(-16)), _mm256_set1_epi32(16));
+		__m256 scale = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_sub_epi32(_mm256_set1_epi32(127 + 24), exponent), 23));
+		const __m256i roundsUp = _mm256_castps_si256(_mm256_cmp_ps(_mm256_floor_ps(_mm256_add_ps(_mm256_mul_ps(maxChannel, scale), _mm256_set1_ps(0.5f))),
+			_mm256_set1_ps(512.0f), _CMP_EQ_OQ));
+		exponent = _mm256_sub_epi32(exponent, roundsUp);
+		scale = _mm256_blendv_ps(scale, _mm256_mul_ps(scale, _mm256_set1_ps(0.5f)), _mm256_castsi256_ps(roundsUp));
+
+		const __m256i packed = _mm256_or_si256(
+			_mm256_or_si256(PackR9G9B9E5ChannelAvx2(red, scale), _mm256_slli_epi32(PackR9G9B9E5ChannelAvx2(green, scale), 9)),
+			_mm256_or_si256(_mm256_slli_epi32(PackR9G9B9E5ChannelAvx2(blue, scale), 18), _mm256_slli_epi32(exponent, 27)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(pPacked + i), packed);
+	}
+	return groupedCount;
+}
+
+SIMD_AVX2 size_t UnpackR9G9B9E5SharedExpAvx2(const uint32_t* pPacked, const size_t count, glm::vec3* pValues)
+{
+	const __m256i mantissaMask = _mm256_set1_epi32(0x1FF);
+	const size_t groupedCount = count - count % 8;
+	for (size_t i = 0; i < groupedCount; i += 8)
+	{
+		const __m256i packed = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pPacked + i));
+		const __m256 scale = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(_mm256_srli_epi32(packed, 27), _mm256_set1_epi32(127 - 24)), 23));
+		Math::StoreFloat3x8(
+			_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(packed, mantissaMask)), scale),
+			_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(packed, 9), mantissaMask)), scale),
+			_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(packed, 18), mantissaMask)), scale),
+			pValues + i);
+	}
+	return groupedCount;
+}
+
+// Two channel texels are converted as a stream of floats. Each pair of halves is a packed value with red in the low half
+SIMD_AVX2_F16C size_t PackR16G16FloatAvx2(const glm::vec2* pValues, const size_t count, uint32_t* pPacked)
+{
+	const auto* pFloats = reinterpret_cast<const float*>(pValues);
+	const size_t groupedCount = count - count % 8;
+	for (size_t i = 0; i < groupedCount; i += 8)
+	{
+		const __m128i low = _mm256_cvtps_ph(_mm256_loadu_ps(pFloats + 2 * i), _MM_FROUND_TO_NEAREST_INT);
+		const __m128i high = _mm256_cvtps_ph(_mm256_loadu_ps(pFloats + 2 * i + 8), _MM_FROUND_TO_NEAREST_INT);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(pPacked + i), _mm256_set_m128i(high, low));
+	}
+	return groupedCount;
+}
+
+SIMD_AVX2_F16C size_t UnpackR16G16FloatAvx2(const uint32_t* pPacked, const size_t count, glm::vec2* pValues)
+{
+	auto* pFloats = reinterpret_cast<float*>(pValues);
+	const size_t groupedCount = count - count % 8;
+	for (size_t i = 0; i < groupedCount; i += 8)
+	{
+		_mm256_storeu_ps(pFloats + 2 * i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pPacked + i))));
+		_mm256_storeu_ps(pFloats + 2 * i + 8, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pPacked + i + 4))));
+	}
+	return groupedCount;
+}
+
+void Math::PackR11G11B10Float(const glm::vec3* pValues, const size_t count, uint32_t* pPacked, const bool allowAvx2)
+{
+	const size_t first = (allowAvx2 && SupportsAvx2()) ? PackR11G11B10FloatAvx2(pValues, count, pPacked) : 0;
+	for (size_t i = first; i < count; ++i)
+	{
+		pPacked[i] = PackR11G11B10Float(pValues[i]);
+	}
+}
+
+void Math::UnpackR11G11B10Float(const uint32_t* pPacked, const size_t count, glm::vec3* pValues, const bool allowAvx2)
+{
+	const size_t first = (allowAvx2 && SupportsAvx2()) ? UnpackR11G11B10FloatAvx2(pPacked, count, pValues) : 0;
+	for (size_t i = first; i < count; ++i)
+	{
+		pValues[i] = UnpackR11G11B10Float(pPacked[i]);
+	}
+}
+
+void Math::PackR9G9B9E5SharedExp(const glm::vec3* pValues, const size_t count, uint32_t* pPacked, const bool allowAvx2)
+{
+	const size_t first = (allowAvx2 && SupportsAvx2()) ? PackR9G9B9E5SharedExpAvx2(pValues, count, pPacked) : 0;
+	for (size_t i = first; i < count; ++i)
+	{
+		pPacked[i] = PackR9G9B9E5SharedExp(pValues[i]);
+	}
+}
+
+void Math::UnpackR9G9B9E5SharedExp(const uint32_t* pPacked, const size_t count, glm::vec3* pValues, const bool allowAvx2)
+{
+	const size_t first = (allowAvx2 && SupportsAvx2()) ? UnpackR9G9B9E5SharedExpAvx2(pPacked, count, pValues) : 0;
+	for (size_t i = first; i < count; ++i)
+	{
+		pValues[i] = UnpackR9G9B9E5SharedExp(pPacked[i]);
+	}
+}
+
+void Math::PackR16G16Float(const glm::vec2* pValues, const size_t count, uint32_t* pPacked, const bool allowAvx2)
+{
+	const size_t first = (allowAvx2 && SupportsAvx2() && SupportsF16c()) ? PackR16G16FloatAvx2(pValues, count, pPacked) : 0;
+	for (size_t i = first; i < count; ++i)
+	{
+		pPacked[i] = PackR16G16Float(pValues[i]);
+	}
+}
+
+void Math::UnpackR16G16Float(const uint32_t* pPacked, const size_t count, glm::vec2* pValues, const bool allowAvx2)
+{
+	const size_t first = (allowAvx2 && SupportsAvx2() && SupportsF16c()) ? UnpackR16G16FloatAvx2(pPacked, count, pValues) : 0;
+	for (size_t i = first; i < count; ++i)
+	{
+		pValues[i] = UnpackR16G16Float(pPacked[i]);
+	}
+}
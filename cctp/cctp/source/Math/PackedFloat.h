@@ -0,0 +1,37 @@
+#pragma once
+
+// Conversions between floats and the packed float formats of the probe atlases, following the D3D float conversion rules.
+// Values round to nearest even. Negative values and NaN are stored as zero by the unsigned small floats, and values above their largest finite value are
+// clamped to it, so bright lighting saturates instead of turning into infinity
+namespace Math
+{
+	// Largest value of DXGI_FORMAT_R9G9B9E5_SHAREDEXP, (511 / 512) * 2^16
+	constexpr float R9G9B9E5_SHAREDEXP_MAX = 65408.0f;
+
+	// DXGI_FORMAT_R11G11B10_FLOAT. Red in bits 0-10, green in bits 11-21 and blue in bits 22-31
+	uint32_t PackR11G11B10Float(const glm::vec3& value);
+	glm::vec3 UnpackR11G11B10Float(const uint32_t packed);
+
+	// DXGI_FORMAT_R9G9B9E5_SHAREDEXP. Nine bit mantissas for red, green and blue from bit 0 and a five bit exponent they share in bits 27-31.
+	// Follows the D3D conversion, which rounds the mantissas half up against the exponent of the largest channel, so channels much darker than the
+	// largest lose precision
+	uint32_t PackR9G9B9E5SharedExp(const glm::vec3& value);
+	glm::vec3 UnpackR9G9B9E5SharedExp(const uint32_t packed);
+
+	// DXGI_FORMAT_R16G16_FLOAT. Red in the low half. Follows IEEE half precision, so values too large for a half become infinity
+	uint32_t PackR16G16Float(const glm::vec2& value);
+	glm::vec2 UnpackR16G16Float(const uint32_t packed);
+
+	// NaN keeps its sign and the high bits of its payload and becomes quiet, as the F16C instructions convert it
+	uint16_t FloatToHalf(const float value);
+	float HalfToFloat(const uint16_t half);
+
+	// Batch versions over arrays, with results bit identical to the functions above. AVX2 kernels, and F16C for the halves, are used when supported
+	// unless allowAvx2 is cleared
+	void PackR11G11B10Float(const glm::vec3* pValues, const size_t count, uint32_t* pPacked, const bool allowAvx2 = true);
+	void UnpackR11G11B10Float(const uint32_t* pPacked, const size_t count, glm::vec3* pValues, const bool allowAvx2 = true);
+	void PackR9G9B9E5SharedExp(const glm::vec3* pValues, const size_t count, uint32_t* pPacked, const bool allowAvx2 = true);
+	void UnpackR9G9B9E5SharedExp(const uint32_t* pPacked, const size_t count, glm::vec3* pValues, const bool allowAvx2 = true);
+	void PackR16G16Float(const glm::vec2* pValues, const size_t count, uint32_t* pPacked, const bool allowAvx2 = true);
+	void UnpackR16G16Float(const uint32_t* pPacked, const size_t count, glm::vec2* pValues, const bool allowAvx2 = true);
+}
@@ -0,0 +1,63 @@
+#include "CpuPch.h"
+#include "Simd.h"
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+bool DetectAvx2Support()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	std::array<int, 4> registers;
+	__cpuid(registers.data(), 0);
+	if (registers[0] < 7)
+	{
+		return false;
+	}
+
+	// FMA, OSXSAVE and AVX
+	__cpuid(registers.data(), 1);
+	constexpr int featureBits = (1 << 12) | (1 << 27) | (1 << 28);
+	if ((registers[2] & featureBits) != featureBits)
+	{
+		return false;
+	}
+
+	// The operating system saves the ymm registers on context switches
+	if ((_xgetbv(0) & 0x6) != 0x6)
+	{
+		return false;
+	}
+
+	// AVX2
+	__cpuidex(registers.data(), 7, 0);
+	return (registers[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+bool DetectF16cSupport()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	// F16C, OSXSAVE and AVX, with the operating system saving the ymm registers
+	std::array<int, 4> registers;
+	__cpuid(registers.data(), 1);
+	constexpr int featureBits = (1 << 27) | (1 << 28) | (1 << 29);
+	return ((registers[2] & featureBits) == featureBits) && ((_xgetbv(0) & 0x6) == 0x6);
+#else
+	return __builtin_cpu_supports("f16c");
+#endif
+}
+
+bool Math::SupportsAvx2()
+{
+	static const bool supported = DetectAvx2Support();
+	return supported;
+}
+
+bool Math::SupportsF16c()
+{
+	static const bool supported = DetectF16cSupport();
+	return supported;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <immintrin.h>
+
+// Marks functions that use AVX2 and FMA intrinsics. They must only be called after checking Math::SupportsAvx2.
+// MSVC compiles these intrinsics without the instruction set being enabled for the whole project, other compilers enable it per function
+// Functions marked SIMD_AVX2_F16C also convert between floats and halves, and must also check Math::SupportsF16c
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SIMD_AVX2
+#define SIMD_AVX2_F16C
+#else
+#define SIMD_AVX2 __attribute__((target("avx2,fma")))
+#define SIMD_AVX2_F16C __attribute__((target("avx2,fma,f16c")))
+#endif
+
+namespace Math
+{
+	// True when the CPU and operating system support AVX2 and FMA. Checked once
+	bool SupportsAvx2();
+	// True when the CPU supports the F16C half conversions. Checked once
+	bool SupportsF16c();
+
+	// Splits eight packed float3 into a register per component
+	inline SIMD_AVX2 void LoadFloat3x8(const glm::vec3* pValues, __m256& x, __m256& y, __m256& z)
+	{
+		const auto* pFloats = reinterpret_cast<const float*>(pValues);
+		const __m256 m03 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(pFloats)), _mm_loadu_ps(pFloats + 12), 1);
+		const __m256 m14 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(pFloats + 4)), _mm_loadu_ps(pFloats + 16), 1);
+		const __m256 m25 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(pFloats + 8)), _mm_loadu_ps(pFloats + 20), 1);
+		const __m256 xy = _mm256_shuffle_ps(m14, m25, _MM_SHUFFLE(2, 1, 3, 2));
+		const __m256 yz = _mm256_shuffle_ps(m03, m14, _MM_SHUFFLE(1, 0, 2, 1));
+		x = _mm256_shuffle_ps(m03, xy, _MM_SHUFFLE(2, 0, 3, 0));
+		y = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+		z = _mm256_shuffle_ps(yz, m25, _MM_SHUFFLE(3, 0, 3, 1));
+	}
+
+	inline SIMD_AVX2 void StoreFloat3x8(const __m256 x, const __m256 y, const __m256 z, glm::vec3* pValues)
+	{
+		const __m256 rxy = _mm256_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+		const __m256 ryz = _mm256_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));
+		const __m256 rzx = _mm256_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));
+		const __m256 r03 = _mm256_shuffle_ps(rxy, rzx, _MM_SHUFFLE(2, 0, 2, 0));
+		const __m256 r14 = _mm256_shuffle_ps(ryz, rxy, _MM_SHUFFLE(3, 1, 2, 0));
+		const __m256 r25 = _mm256_shuffle_ps(rzx, ryz, _MM_SHUFFLE(3, 1, 3, 1));
+
+		auto* pFloats = reinterpret_cast<float*>(pValues);
+		_mm_storeu_ps(pFloats, _mm256_castps256_ps128(r03));
+		_mm_storeu_ps(pFloats + 4, _mm256_castps256_ps128(r14));
+		_mm_storeu_ps(pFloats + 8, _mm256_castps256_ps128(r25));
+		_mm_storeu_ps(pFloats + 12, _mm256_extractf128_ps(r03, 1));
+		_mm_storeu_ps(pFloats + 16, _mm256_extractf128_ps(r14, 1));
+		_mm_storeu_ps(pFloats + 20, _mm256_extractf128_ps(r25, 1));
+	}
+
+	// Splits eight packed float2 into a register per component
+	inline SIMD_AVX2 void LoadFloat2x8(const glm::vec2* pValues, __m256& x, __m256& y)
+	{
+		const auto* pFloats = reinterpret_cast<const float*>(pValues);
+		const __m256 low = _mm256_loadu_ps(pFloats);
+		const __m256 high = _mm256_loadu_ps(pFloats + 8);
+		x = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0)));
+		y = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+
+	inline SIMD_AVX2 void StoreFloat2x8(const __m256 x, const __m256 y, glm::vec2* pValues)
+	{
+		const __m256 low = _mm256_unpacklo_ps(x, y);
+		const __m256 high = _mm256_unpackhi_ps(x, y);
+		auto* pFloats = reinterpret_cast<float*>(pValues);
+		_mm256_storeu_ps(pFloats, _mm256_permute2f128_ps(low, high, 0x20));
+		_mm256_storeu_ps(pFloats + 8, _mm256_permute2f128_ps(low, high, 0x31));
+	}
+}
@@ -0,0 +1,198 @@
+#include "CpuPch.h"
+#include "SphericalHarmonics.h"
+#include "Simd.h"
+
+// Band constants of the basis functions
+constexpr float SH_Y00 = 0.282095f;
+constexpr float SH_Y1 = 0.488603f;
+constexpr float SH_Y2 = 1.092548f;
+constexpr float SH_Y20 = 0.315392f;
+constexpr float SH_Y22 = 0.546274f;
+
+void Math::EvaluateShBasis(const glm::vec3& direction, const uint32_t coefficientCount, float* pBasis)
+{
+	assert((coefficientCount == SH_L1_COEFFICIENT_COUNT || coefficientCount == SH_L2_COEFFICIENT_COUNT) && "Only bands up to one or two are supported.");
+
+	const float x = direction.x;
+	const float y = direction.y;
+	const float z = direction.z;
+	pBasis[0] = SH_Y00;
+	pBasis[1] = SH_Y1 * y;
+	pBasis[2] = SH_Y1 * z;
+	pBasis[3] = SH_Y1 * x;
+	if (coefficientCount == SH_L2_COEFFICIENT_COUNT)
+	{
+		pBasis[4] = SH_Y2 * x * y;
+		pBasis[5] = SH_Y2 * y * z;
+		pBasis[6] = SH_Y20 * (3.0f * z * z - 1.0f);
+		pBasis[7] = SH_Y2 * x * z;
+		pBasis[8] = SH_Y22 * (x * x - y * y);
+	}
+}
+
+void Math::ConvolveShCosineLobe(float* pCoefficients, const uint32_t coefficientCount, const uint32_t channelCount, const uint32_t firstChannel,
+	const uint32_t convolvedChannelCount)
+{
+	// The cosine lobe's band factors pi, 2 pi / 3 and pi / 4, divided by pi
+	for (uint32_t c = 0; c < coefficientCount; ++c)
+	{
+		const float bandFactor = c == 0 ? 1.0f : (c < SH_L1_COEFFICIENT_COUNT ? 2.0f / 3.0f : 0.25f);
+		for (uint32_t k = firstChannel; k < firstChannel + convolvedChannelCount; ++k)
+		{
+			pCoefficients[c * channelCount + k] *= bandFactor;
+		}
+	}
+}
+
+float Math::EvaluateShWithBasis(const float* pCoefficients, const float* pBasis, const uint32_t coefficientCount, const uint32_t channelCount, const uint32_t channel)
+{
+	float value = 0.0f;
+	for (uint32_t c = 0; c < coefficientCount; ++c)
+	{
+		value += pBasis[c] * pCoefficients[c * channelCount + channel];
+	}
+	return value;
+}
+
+float Math::EvaluateSh(const float* pCoefficients, const uint32_t coefficientCount, const uint32_t channelCount, const uint32_t channel, const glm::vec3& direction)
+{
+	float basis[SH_L2_COEFFICIENT_COUNT];
+	EvaluateShBasis(direction, coefficientCount, basis);
+	return EvaluateShWithBasis(pCoefficients, basis, coefficientCount, channelCount, channel);
+}
+
+// The AVX2 kernels compute the basis with the scalar operations in the same order without fused multiply adds
+
+SIMD_AVX2 void ShBasisAvx2(const __m256 x, const __m256 y, const __m256 z, const uint32_t coefficientCount, __m256* pBasis)
+{
+	const __m256 y1 = _mm256_set1_ps(SH_Y1);
+	pBasis[0] = _mm256_set1_ps(SH_Y00);
+	pBasis[1] = _mm256_mul_ps(y1, y);
+	pBasis[2] = _mm256_mul_ps(y1, z);
+	pBasis[3] = _mm256_mul_ps(y1, x);
+	if (coefficientCount == Math::SH_L2_COEFFICIENT_COUNT)
+	{
+		const __m256 y2 = _mm256_set1_ps(SH_Y2);
+		pBasis[4] = _mm256_mul_ps(_mm256_mul_ps(y2, x), y);
+		pBasis[5] = _mm256_mul_ps(_mm256_mul_ps(y2, y), z);
+		pBasis[6] = _mm256_mul_ps(_mm256_set1_ps(SH_Y20), _mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(3.0f), z), z), _mm256_set1_ps(1.0f)));
+		pBasis[7] = _mm256_mul_ps(_mm256_mul_ps(y2, x), z);
+		pBasis[8] = _mm256_mul_ps(_mm256_set1_ps(SH_Y22), _mm256_sub_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)));
+	}
+}
+
+// Processes whole groups of eight, returning the number processed. Each lane keeps its own sums, which are added together once every group is in
+SIMD_AVX2 size_t ProjectShAvx2(const glm::vec3* pDirections, const float* pValues, const size_t count, const uint32_t channelCount, const float weight,
+	const uint32_t coefficientCount, float* pCoefficients)
+{
+	const size_t groupedCount = count - count % 8;
+	if (groupedCount == 0)
+	{
+		return 0;
+	}
+
+	__m256 sums[Math::SH_L2_COEFFICIENT_COUNT * Math::SH_MAX_CHANNEL_COUNT];
+	for (uint32_t j = 0; j < coefficientCount * channelCount; ++j)
+	{
+		sums[j] = _mm256_setzero_ps();
+	}
+
+	const __m256 weights = _mm256_set1_ps(weight);
+	for (size_t i = 0; i < groupedCount; i += 8)
+	{
+		__m256 x, y, z;
+		Math::LoadFloat3x8(pDirections + i, x, y, z);
+		__m256 basis[Math::SH_L2_COEFFICIENT_COUNT];
+		ShBasisAvx2(x, y, z, coefficientCount, basis);
+
+		__m256 values[Math::SH_MAX_CHANNEL_COUNT];
+		for (uint32_t k = 0; k < channelCount; ++k)
+		{
+			values[k] = _mm256_loadu_ps(pValues + k * count + i);
+		}
+
+		for (uint32_t c = 0; c < coefficientCount; ++c)
+		{
+			const __m256 weightedBasis = _mm256_mul_ps(basis[c], weights);
+			for (uint32_t k = 0; k < channelCount; ++k)
+			{
+				sums[c * channelCount + k] = _mm256_add_ps(sums[c * channelCount + k], _mm256_mul_ps(weightedBasis, values[k]));
+			}
+		}
+	}
+
+	for (uint32_t j = 0; j < coefficientCount * channelCount; ++j)
+	{
+		alignas(32) float lanes[8];
+		_mm256_store_ps(lanes, sums[j]);
+		float sum = 0.0f;
+		for (const float lane : lanes)
+		{
+			sum += lane;
+		}
+		pCoefficients[j] += sum;
+	}
+	return groupedCount;
+}
+
+SIMD_AVX2 size_t EvaluateShAvx2(const float* pCoefficients, const uint32_t coefficientCount, const uint32_t channelCount, const glm::vec3* pDirections,
+	const size_t count, float* pValues)
+{
+	const size_t groupedCount = count - count % 8;
+	for (size_t i = 0; i < groupedCount; i += 8)
+	{
+		__m256 x, y, z;
+		Math::LoadFloat3x8(pDirections + i, x, y, z);
+		__m256 basis[Math::SH_L2_COEFFICIENT_COUNT];
+		ShBasisAvx2(x, y, z, coefficientCount, basis);
+
+		for (uint32_t k = 0; k < channelCount; ++k)
+		{
+			__m256 value = _mm256_setzero_ps();
+			for (uint32_t c = 0; c < coefficientCount; ++c)
+			{
+				value = _mm256_add_ps(value, _mm256_mul_ps(basis[c], _mm256_set1_ps(pCoefficients[c * channelCount + k])));
+			}
+			_mm256_storeu_ps(pValues + k * count + i, value);
+		}
+	}
+	return groupedCount;
+}
+
+void Math::ProjectSh(const glm::vec3* pDirections, const float* pValues, const size_t count, const uint32_t channelCount, const float weight,
+	const uint32_t coefficientCount, float* pCoefficients, const bool allowAvx2)
+{
+	assert(channelCount <= SH_MAX_CHANNEL_COUNT && "Too many channels.");
+
+	const size_t first = (allowAvx2 && SupportsAvx2()) ? ProjectShAvx2(pDirections, pValues, count, channelCount, weight, coefficientCount, pCoefficients) : 0;
+	for (size_t i = first; i < count; ++i)
+	{
+		float basis[SH_L2_COEFFICIENT_COUNT];
+		EvaluateShBasis(pDirections[i], coefficientCount, basis);
+		for (uint32_t c = 0; c < coefficientCount; ++c)
+		{
+			const float weightedBasis = basis[c] * weight;
+			for (uint32_t k = 0; k < channelCount; ++k)
+			{
+				pCoefficients[c * channelCount + k] += weightedBasis * pValues[k * count + i];
+			}
+		}
+	}
+}
+
+void Math::EvaluateSh(const float* pCoefficients, const uint32_t coefficientCount, const uint32_t channelCount, const glm::vec3* pDirections, const size_t count,
+	float* pValues, const bool allowAvx2)
+{
+	assert(channelCount <= SH_MAX_CHANNEL_COUNT && "Too many channels.");
+
+	const size_t first = (allowAvx2 && SupportsAvx2()) ? EvaluateShAvx2(pCoefficients, coefficientCount, channelCount, pDirections, count, pValues) : 0;
+	for (size_t i = first; i < count; ++i)
+	{
+		float basis[SH_L2_COEFFICIENT_COUNT];
+		EvaluateShBasis(pDirections[i], coefficientCount, basis);
+		for (uint32_t k = 0; k < channelCount; ++k)
+		{
+			pValues[k * count + i] = EvaluateShWithBasis(pCoefficients, basis, coefficientCount, channelCount, k);
+		}
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+// Real spherical harmonics up to band two, with the basis constants and ordering of Sloan, "Stupid Spherical Harmonics (SH) Tricks".
+// CPU versions of the functions in Shaders/Common.hlsl.
+// Coefficients of a function with several channels are stored coefficient major, channelCount floats per coefficient. Values of the batch functions
+// are stored channel major, count floats per channel, so each channel of a batch loads as a whole. AVX2 kernels are used by the batch functions when
+// supported unless allowAvx2 is cleared
+namespace Math
+{
+	// Coefficient counts of bands zero to one (L1) and zero to two (L2)
+	constexpr uint32_t SH_L1_COEFFICIENT_COUNT = 4;
+	constexpr uint32_t SH_L2_COEFFICIENT_COUNT = 9;
+	// The most channels the batch functions take
+	constexpr uint32_t SH_MAX_CHANNEL_COUNT = 8;
+
+	// Writes the coefficientCount basis functions, 4 or 9, of a unit direction
+	void EvaluateShBasis(const glm::vec3& direction, const uint32_t coefficientCount, float* pBasis);
+
+	// Adds count samples of a function into its coefficients, each sample weighted by weight. Directions spread evenly over the sphere are weighted
+	// by 4 pi / count for a Monte Carlo projection. The AVX2 kernel sums each coefficient in eight lanes and adds the lanes together at the end,
+	// so it matches the scalar projection to rounding rather than bit for bit
+	void ProjectSh(const glm::vec3* pDirections, const float* pValues, const size_t count, const uint32_t channelCount, const float weight,
+		const uint32_t coefficientCount, float* pCoefficients, const bool allowAvx2 = true);
+
+	// Convolves channels of a projected radiance with the clamped cosine lobe and divides by pi, Ramamoorthi and Hanrahan,
+	// "An Efficient Representation for Irradiance Environment Maps". Evaluating the result at a normal gives irradiance / pi, which the shaders add
+	// in place of an octahedral irradiance texel. Channels [firstChannel, firstChannel + convolvedChannelCount) are convolved
+	void ConvolveShCosineLobe(float* pCoefficients, const uint32_t coefficientCount, const uint32_t channelCount, const uint32_t firstChannel,
+		const uint32_t convolvedChannelCount);
+
+	// Value of one channel of a function at the direction the basis functions were evaluated for, so several functions can share the basis
+	float EvaluateShWithBasis(const float* pCoefficients, const float* pBasis, const uint32_t coefficientCount, const uint32_t channelCount, const uint32_t channel);
+
+	// Value of one channel of a function at a unit direction
+	float EvaluateSh(const float* pCoefficients, const uint32_t coefficientCount, const uint32_t channelCount, const uint32_t channel, const glm::vec3& direction);
+
+	// Every channel of a function at count directions, with results bit identical to the function above
+	void EvaluateSh(const float* pCoefficients, const uint32_t coefficientCount, const uint32_t channelCount, const glm::vec3* pDirections, const size_t count,
+		float* pValues, const bool allowAvx2 = true);
+}
@@ -18,31 +18,5 @@
 #include "imgui/imgui_impl_win32.h"
 #include "imgui/imgui_impl_dx12.h"
 
-// Glm
-#define GLM_FORCE_DEPTH_ZERO_TO_ONE
-#define GLM_FORCE_RADIANS
-#include "Math/glm/vec2.hpp"
-#include "Math/glm/vec3.hpp"
-#include "Math/glm/vec4.hpp"
-#include "Math/glm/mat3x3.hpp"
-#include "Math/glm/mat4x4.hpp"
-#include "Math/glm/ext/matrix_transform.hpp"
-#include "Math/glm/ext/matrix_clip_space.hpp"
-#include "Math/glm/gtc/quaternion.hpp"
-#include "Math/glm/gtx/euler_angles.hpp"
-
-// Standard
-#include <iostream>
-#include <functional>
-#include <array>
-#include <chrono>
-#include <filesystem>
-#include <fstream>
-#include <vector>
-
-// Macros
-#ifdef _DEBUG
-#define DEBUG_LOG(x) std::cout << x << "\n";
-#else
-#define DEBUG_LOG(x)
-#endif
\ No newline at end of file
+// Glm, standard headers and macros
+#include "CpuPch.h"
\ No newline at end of file
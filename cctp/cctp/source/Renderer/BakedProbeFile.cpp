@@ -0,0 +1,376 @@
+#include "CpuPch.h"
+#include "BakedProbeFile.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Compressed sections are split into a plane per byte of each value. Every section holds 4 byte values
+constexpr size_t BAKED_PROBE_PLANE_COUNT = 4;
+// Run length coding control bytes below this start a literal run of one more byte than their value. Others repeat the next byte their value minus
+// BAKED_PROBE_REPEAT_BIAS times
+constexpr uint32_t BAKED_PROBE_LITERAL_CONTROL_COUNT = 128;
+constexpr uint32_t BAKED_PROBE_REPEAT_BIAS = 126;
+constexpr size_t BAKED_PROBE_MAX_REPEAT = 255 - BAKED_PROBE_REPEAT_BIAS;
+
+uint64_t AlignBakedProbeOffset(const uint64_t offset, const uint64_t alignment)
+{
+	return ((offset + alignment - 1) / alignment) * alignment;
+}
+
+void CompressBakedProbeSection(const uint8_t* pData, const size_t size, std::vector<uint8_t>& compressed)
+{
+	// Delta code each plane so smooth runs of values become runs of equal bytes
+	const size_t valueCount = size / BAKED_PROBE_PLANE_COUNT;
+	std::vector<uint8_t> deltas(size);
+	for (size_t plane = 0; plane < BAKED_PROBE_PLANE_COUNT; ++plane)
+	{
+		uint8_t previous = 0;
+		for (size_t i = 0; i < valueCount; ++i)
+		{
+			const uint8_t value = pData[i * BAKED_PROBE_PLANE_COUNT + plane];
+			deltas[plane * valueCount + i] = static_cast<uint8_t>(value - previous);
+			previous = value;
+		}
+	}
+
+	compressed.clear();
+	size_t i = 0;
+	while (i < size)
+	{
+		size_t repeatCount = 1;
+		while ((i + repeatCount < size) && (repeatCount < BAKED_PROBE_MAX_REPEAT) && (deltas[i + repeatCount] == deltas[i]))
+		{
+			++repeatCount;
+		}
+		if (repeatCount >= 2)
+		{
+			compressed.push_back(static_cast<uint8_t>(BAKED_PROBE_REPEAT_BIAS + repeatCount));
+			compressed.push_back(deltas[i]);
+			i += repeatCount;
+			continue;
+		}
+
+		// Bytes are taken literally up to the next run worth repeating
+		const size_t literalStart = i;
+		while ((i < size) && (i - literalStart < BAKED_PROBE_LITERAL_CONTROL_COUNT))
+		{
+			if ((i + 2 < size) && (deltas[i] == deltas[i + 1]) && (deltas[i] == deltas[i + 2]))
+			{
+				break;
+			}
+			++i;
+		}
+		compressed.push_back(static_cast<uint8_t>(i - literalStart - 1));
+		compressed.insert(compressed.end(), deltas.begin() + literalStart, deltas.begin() + i);
+	}
+}
+
+bool DecompressBakedProbeSection(const uint8_t* pCompressed, const size_t compressedSize, std::vector<uint8_t>& data)
+{
+	// Undo the run length coding into the deltas, then the delta coding into the planes
+	std::vector<uint8_t> deltas(data.size());
+	size_t size = 0;
+	size_t i = 0;
+	while (i < compressedSize)
+	{
+		const uint32_t control = pCompressed[i++];
+		if (control < BAKED_PROBE_LITERAL_CONTROL_COUNT)
+		{
+			const size_t literalCount = control + 1;
+			if ((i + literalCount > compressedSize) || (size + literalCount > deltas.size()))
+			{
+				return false;
+			}
+			std::copy(pCompressed + i, pCompressed + i + literalCount, deltas.begin() + size);
+			i += literalCount;
+			size += literalCount;
+		}
+		else
+		{
+			const size_t repeatCount = control - BAKED_PROBE_REPEAT_BIAS;
+			if ((i >= compressedSize) || (size + repeatCount > deltas.size()))
+			{
+				return false;
+			}
+			std::fill(deltas.begin() + size, deltas.begin() + size + repeatCount, pCompressed[i++]);
+			size += repeatCount;
+		}
+	}
+	if (size != deltas.size())
+	{
+		return false;
+	}
+
+	const size_t valueCount = data.size() / BAKED_PROBE_PLANE_COUNT;
+	for (size_t plane = 0; plane < BAKED_PROBE_PLANE_COUNT; ++plane)
+	{
+		uint8_t value = 0;
+		for (size_t j = 0; j < valueCount; ++j)
+		{
+			value = static_cast<uint8_t>(value + deltas[plane * valueCount + j]);
+			data[j * BAKED_PROBE_PLANE_COUNT + plane] = value;
+		}
+	}
+	return true;
+}
+
+// Sizes of the sections of a volume once decompressed
+std::array<uint64_t, static_cast<size_t>(Renderer::BakedProbeSection::Count)> GetBakedProbeSectionSizes(const Renderer::BakedProbeVolume& volume)
+{
+	const uint64_t probeCount = volume.GetProbeCount();
+	return {
+		sizeof(Renderer::BakedProbeVolume),
+		probeCount * sizeof(uint32_t),
+		probeCount * sizeof(glm::vec4),
+		probeCount * sizeof(Renderer::ProbeStatistics),
+		static_cast<uint64_t>(volume.AtlasLayout.z) * volume.GetAtlasDimensions(Renderer::IRRADIANCE_PROBE_SIDE_LENGTH).y,
+		static_cast<uint64_t>(volume.AtlasLayout.w) * volume.GetAtlasDimensions(Renderer::VISIBILITY_PROBE_SIDE_LENGTH).y
+	};
+}
+
+glm::uvec2 Renderer::BakedProbeVolume::GetAtlasDimensions(const uint32_t singleProbeSideLength) const
+{
+	return glm::uvec2(AtlasLayout.x, AtlasLayout.y) * (singleProbeSideLength + 2 * PROBE_PADDING);
+}
+
+void Renderer::BakedProbeAtlases::Reserve(const glm::ivec3& gridProbeCounts)
+{
+	const size_t probeCount = static_cast<size_t>(gridProbeCounts.x) * gridProbeCounts.y * gridProbeCounts.z;
+	Layout = ProbeAtlasLayout(probeCount, gridProbeCounts);
+
+	// Both formats store a texel in 4 bytes
+	const glm::uvec2 irradianceDimensions = Layout.GetIrradianceAtlasDimensions();
+	const glm::uvec2 visibilityDimensions = Layout.GetVisibilityAtlasDimensions();
+	IrradianceRowPitch = static_cast<uint32_t>(AlignBakedProbeOffset(irradianceDimensions.x * sizeof(uint32_t), BAKED_PROBE_ROW_PITCH_ALIGNMENT));
+	VisibilityRowPitch = static_cast<uint32_t>(AlignBakedProbeOffset(visibilityDimensions.x * sizeof(uint32_t), BAKED_PROBE_ROW_PITCH_ALIGNMENT));
+	IrradianceAtlas.assign(static_cast<size_t>(IrradianceRowPitch) * irradianceDimensions.y, 0);
+	VisibilityAtlas.assign(static_cast<size_t>(VisibilityRowPitch) * visibilityDimensions.y, 0);
+	Statistics.assign(probeCount, ProbeStatistics());
+}
+
+bool Renderer::WriteBakedProbeFile(const std::filesystem::path& path, const BakedProbeData& data, const BakedProbeCompression compression)
+{
+	const auto sizes = GetBakedProbeSectionSizes(*data.pVolume);
+	const std::array<const uint8_t*, static_cast<size_t>(BakedProbeSection::Count)> sections =
+	{
+		reinterpret_cast<const uint8_t*>(data.pVolume),
+		reinterpret_cast<const uint8_t*>(data.pProbeStates),
+		reinterpret_cast<const uint8_t*>(data.pRelocationOffsets),
+		reinterpret_cast<const uint8_t*>(data.pStatistics),
+		data.pIrradianceAtlas,
+		data.pVisibilityAtlas
+	};
+
+	// Sections that do not get smaller are stored uncompressed, so they can still be used in place
+	BakedProbeFileHeader header;
+	std::array<std::vector<uint8_t>, static_cast<size_t>(BakedProbeSection::Count)> compressedSections;
+	uint64_t offset = AlignBakedProbeOffset(sizeof(BakedProbeFileHeader), BAKED_PROBE_SECTION_ALIGNMENT);
+	for (size_t s = 0; s < sections.size(); ++s)
+	{
+		auto& entry = header.Sections[s];
+		entry.Offset = offset;
+		entry.UncompressedSize = sizes[s];
+		entry.Size = sizes[s];
+		if (compression == BakedProbeCompression::PlanarDeltaRunLength)
+		{
+			CompressBakedProbeSection(sections[s], sizes[s], compressedSections[s]);
+			if (compressedSections[s].size() < sizes[s])
+			{
+				entry.Compression = compression;
+				entry.Size = compressedSections[s].size();
+			}
+		}
+		offset = AlignBakedProbeOffset(offset + entry.Size, BAKED_PROBE_SECTION_ALIGNMENT);
+	}
+	header.FileSize = offset;
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	const std::vector<char> padding(BAKED_PROBE_SECTION_ALIGNMENT, 0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	uint64_t position = sizeof(header);
+	for (size_t s = 0; s < sections.size(); ++s)
+	{
+		const auto& entry = header.Sections[s];
+		file.write(padding.data(), static_cast<std::streamsize>(entry.Offset - position));
+		const uint8_t* pSection = (entry.Compression == BakedProbeCompression::None) ? sections[s] : compressedSections[s].data();
+		file.write(reinterpret_cast<const char*>(pSection), static_cast<std::streamsize>(entry.Size));
+		position = entry.Offset + entry.Size;
+	}
+	file.write(padding.data(), static_cast<std::streamsize>(header.FileSize - position));
+
+	return file.good();
+}
+
+Renderer::BakedProbeFile::~BakedProbeFile()
+{
+	Close();
+}
+
+bool Renderer::BakedProbeFile::Open(const std::filesystem::path& path)
+{
+	Close();
+
+#if defined(_WIN32)
+	FileHandle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	LARGE_INTEGER fileSize = {};
+	if ((FileHandle == INVALID_HANDLE_VALUE) || !GetFileSizeEx(FileHandle, &fileSize) || (fileSize.QuadPart < static_cast<LONGLONG>(sizeof(BakedProbeFileHeader))))
+	{
+		Close();
+		return false;
+	}
+
+	MappingHandle = CreateFileMappingW(FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	pMapping = MappingHandle != nullptr ? static_cast<const uint8_t*>(MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+	if (pMapping == nullptr)
+	{
+		Close();
+		return false;
+	}
+	FileSize = static_cast<uint64_t>(fileSize.QuadPart);
+#else
+	const int fileDescriptor = open(path.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+	{
+		return false;
+	}
+
+	struct stat fileStatus = {};
+	void* pMapped = MAP_FAILED;
+	if ((fstat(fileDescriptor, &fileStatus) == 0) && (fileStatus.st_size >= static_cast<off_t>(sizeof(BakedProbeFileHeader))))
+	{
+		pMapped = mmap(nullptr, static_cast<size_t>(fileStatus.st_size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	}
+	// The mapping keeps the file open
+	close(fileDescriptor);
+	if (pMapped == MAP_FAILED)
+	{
+		return false;
+	}
+	pMapping = static_cast<const uint8_t*>(pMapped);
+	FileSize = static_cast<uint64_t>(fileStatus.st_size);
+#endif
+
+	if (!Validate())
+	{
+		DEBUG_LOG("ERROR: Invalid baked probe file " + path.string() + ".");
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void Renderer::BakedProbeFile::Close()
+{
+#if defined(_WIN32)
+	if (pMapping != nullptr)
+	{
+		UnmapViewOfFile(pMapping);
+	}
+	if (MappingHandle != nullptr)
+	{
+		CloseHandle(MappingHandle);
+		MappingHandle = nullptr;
+	}
+	if (FileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(FileHandle);
+		FileHandle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (pMapping != nullptr)
+	{
+		munmap(const_cast<uint8_t*>(pMapping), static_cast<size_t>(FileSize));
+	}
+#endif
+
+	pMapping = nullptr;
+	FileSize = 0;
+	for (auto& section : DecompressedSections)
+	{
+		section = std::vector<uint8_t>();
+	}
+	Data = BakedProbeData();
+}
+
+bool Renderer::BakedProbeFile::Validate()
+{
+	const auto& header = GetHeader();
+	if ((header.Magic != BAKED_PROBE_FILE_MAGIC) || (header.Version != BAKED_PROBE_FILE_VERSION) || (header.FileSize != FileSize))
+	{
+		return false;
+	}
+
+	for (const auto& entry : header.Sections)
+	{
+		if ((entry.Offset % BAKED_PROBE_SECTION_ALIGNMENT != 0) || (entry.Offset < sizeof(BakedProbeFileHeader)) || (entry.Offset > FileSize) ||
+			(entry.Size > FileSize - entry.Offset))
+		{
+			return false;
+		}
+		if ((entry.Compression == BakedProbeCompression::None) ? (entry.Size != entry.UncompressedSize) :
+			(entry.Compression != BakedProbeCompression::PlanarDeltaRunLength))
+		{
+			return false;
+		}
+	}
+
+	// The volume gives the size of every other section
+	if (header.Sections[static_cast<size_t>(BakedProbeSection::Volume)].UncompressedSize != sizeof(BakedProbeVolume))
+	{
+		return false;
+	}
+	Data.pVolume = reinterpret_cast<const BakedProbeVolume*>(GetSection(BakedProbeSection::Volume));
+	if (Data.pVolume == nullptr)
+	{
+		return false;
+	}
+
+	const BakedProbeVolume& volume = *Data.pVolume;
+	if ((volume.ProbeCounts.x <= 0) || (volume.ProbeCounts.y <= 0) || (volume.ProbeCounts.z <= 0) ||
+		(static_cast<uint64_t>(volume.AtlasLayout.x) * volume.AtlasLayout.y < volume.GetProbeCount()) ||
+		(volume.AtlasLayout.z % BAKED_PROBE_ROW_PITCH_ALIGNMENT != 0) || (volume.AtlasLayout.w % BAKED_PROBE_ROW_PITCH_ALIGNMENT != 0) ||
+		(volume.AtlasLayout.z < volume.GetAtlasDimensions(IRRADIANCE_PROBE_SIDE_LENGTH).x * sizeof(uint32_t)) ||
+		(volume.AtlasLayout.w < volume.GetAtlasDimensions(VISIBILITY_PROBE_SIDE_LENGTH).x * sizeof(uint32_t)))
+	{
+		return false;
+	}
+
+	const auto sizes = GetBakedProbeSectionSizes(volume);
+	for (size_t s = 0; s < sizes.size(); ++s)
+	{
+		if (header.Sections[s].UncompressedSize != sizes[s])
+		{
+			return false;
+		}
+	}
+
+	Data.pProbeStates = reinterpret_cast<const uint32_t*>(GetSection(BakedProbeSection::ProbeStates));
+	Data.pRelocationOffsets = reinterpret_cast<const glm::vec4*>(GetSection(BakedProbeSection::RelocationOffsets));
+	Data.pStatistics = reinterpret_cast<const ProbeStatistics*>(GetSection(BakedProbeSection::Statistics));
+	Data.pIrradianceAtlas = GetSection(BakedProbeSection::IrradianceAtlas);
+	Data.pVisibilityAtlas = GetSection(BakedProbeSection::VisibilityAtlas);
+	return (Data.pProbeStates != nullptr) && (Data.pRelocationOffsets != nullptr) && (Data.pStatistics != nullptr) &&
+		(Data.pIrradianceAtlas != nullptr) && (Data.pVisibilityAtlas != nullptr);
+}
+
+const uint8_t* Renderer::BakedProbeFile::GetSection(const BakedProbeSection section)
+{
+	const auto& entry = GetHeader().Sections[static_cast<size_t>(section)];
+	if (entry.Compression == BakedProbeCompression::None)
+	{
+		return pMapping + entry.Offset;
+	}
+
+	auto& decompressed = DecompressedSections[static_cast<size_t>(section)];
+	decompressed.resize(static_cast<size_t>(entry.UncompressedSize));
+	return DecompressBakedProbeSection(pMapping + entry.Offset, static_cast<size_t>(entry.Size), decompressed) ? decompressed.data() : nullptr;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "Renderer/GIConstants.h"
+#include "Renderer/ProbeAtlasLayout.h"
+
+namespace Renderer
+{
+	// "PRBK" in file byte order
+	constexpr uint32_t BAKED_PROBE_FILE_MAGIC = 0x4B425250;
+	// Incremented whenever the file layout, or a structure stored in it, changes. Files of other versions are rejected
+	constexpr uint32_t BAKED_PROBE_FILE_VERSION = 2;
+	// Sections start on D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT from the start of the file and atlas rows are D3D12_TEXTURE_DATA_PITCH_ALIGNMENT apart, so
+	// a mapped atlas section is a placed footprint that copies into an upload buffer as is
+	constexpr uint64_t BAKED_PROBE_SECTION_ALIGNMENT = 512;
+	constexpr uint32_t BAKED_PROBE_ROW_PITCH_ALIGNMENT = 256;
+	// Gathers traced before baking, with the probe rays rotated each gather so they reach every texel of each probe
+	constexpr uint32_t BAKE_GATHER_COUNT = 64;
+
+	enum class BakedProbeSection : uint32_t
+	{
+		Volume,
+		ProbeStates,
+		RelocationOffsets,
+		Statistics,
+		IrradianceAtlas,
+		VisibilityAtlas,
+		Count
+	};
+
+	enum class BakedProbeCompression : uint32_t
+	{
+		None = 0,
+		// Bytes are split into planes by their place in each 4 byte value, delta coded along each plane and run length coded. The exponent bytes of
+		// neighbouring texels repeat, and the padding and the tiles of inactive probes are zero. Decompressed into memory on load
+		PlanarDeltaRunLength = 1
+	};
+
+	struct BakedProbeSectionEntry
+	{
+		BakedProbeCompression Compression = BakedProbeCompression::None;
+		uint32_t Reserved = 0;
+		// Offset from the start of the file and size of the section as stored, then the size once decompressed
+		uint64_t Offset = 0;
+		uint64_t Size = 0;
+		uint64_t UncompressedSize = 0;
+	};
+
+	// Starts a baked probe file, followed by one section of each type. Every value is little endian
+	struct BakedProbeFileHeader
+	{
+		uint32_t Magic = BAKED_PROBE_FILE_MAGIC;
+		uint32_t Version = BAKED_PROBE_FILE_VERSION;
+		uint64_t FileSize = 0;
+		std::array<BakedProbeSectionEntry, static_cast<size_t>(BakedProbeSection::Count)> Sections = {};
+	};
+
+	// The grid a volume was baked with and the layout of its atlas sections
+	struct BakedProbeVolume
+	{
+		glm::vec4 GridOriginAndSpacing = glm::vec4(0.0f); // Stores the position of grid coordinate zero (xyz) and probe spacing (w)
+		glm::ivec4 ProbeCounts = glm::ivec4(0); // Stores probe counts (xyz)
+		glm::uvec4 AtlasLayout = glm::uvec4(0); // Stores probes per atlas row (x), atlas row count (y) and the irradiance (z) and visibility (w) row pitches in bytes
+
+		size_t GetProbeCount() const { return static_cast<size_t>(ProbeCounts.x) * ProbeCounts.y * ProbeCounts.z; }
+		glm::uvec2 GetAtlasDimensions(const uint32_t singleProbeSideLength) const;
+	};
+
+	// A baked volume's probe data indexed by volume probe index. Atlases hold the probes' tiles laid out as in the probe pool atlases, from tile zero,
+	// in DXGI_FORMAT_R11G11B10_FLOAT for irradiance and DXGI_FORMAT_R16G16_FLOAT for visibility, with rows the volume's row pitches apart
+	struct BakedProbeData
+	{
+		const BakedProbeVolume* pVolume = nullptr;
+		const uint32_t* pProbeStates = nullptr;
+		const glm::vec4* pRelocationOffsets = nullptr;
+		const ProbeStatistics* pStatistics = nullptr;
+		const uint8_t* pIrradianceAtlas = nullptr;
+		const uint8_t* pVisibilityAtlas = nullptr;
+	};
+
+	// Atlas tiles and statistics of a volume being baked, in the layout and formats they are stored and uploaded in
+	struct BakedProbeAtlases
+	{
+		// Lays the atlases out for every probe of the grid, with rows aligned to grid slices as in the probe pool atlases, and zeroes every texel and
+		// statistic
+		void Reserve(const glm::ivec3& gridProbeCounts);
+
+		ProbeAtlasLayout Layout;
+		uint32_t IrradianceRowPitch = 0;
+		uint32_t VisibilityRowPitch = 0;
+		std::vector<uint8_t> IrradianceAtlas;
+		std::vector<uint8_t> VisibilityAtlas;
+		std::vector<ProbeStatistics> Statistics;
+	};
+
+	// Writes the volume and its probe data, compressing the sections when requested. Returns false if the file could not be written
+	bool WriteBakedProbeFile(const std::filesystem::path& path, const BakedProbeData& data, const BakedProbeCompression compression);
+
+	// A baked probe file mapped into memory. Uncompressed sections are used in place without being read or converted, so opening a file costs the
+	// mapping and the validation of its header, and pages are only read from disk as they are used
+	class BakedProbeFile
+	{
+	public:
+		BakedProbeFile() = default;
+		~BakedProbeFile();
+		BakedProbeFile(const BakedProbeFile&) = delete;
+		BakedProbeFile& operator=(const BakedProbeFile&) = delete;
+
+		// Maps the file and checks that its header and sections describe a complete volume. Compressed sections are decompressed. Returns false, leaving
+		// the file closed, if the file is missing or invalid
+		bool Open(const std::filesystem::path& path);
+		void Close();
+
+		bool IsOpen() const { return pMapping != nullptr; }
+		// Valid while the file is open
+		const BakedProbeData& GetData() const { return Data; }
+		const BakedProbeFileHeader& GetHeader() const { return *reinterpret_cast<const BakedProbeFileHeader*>(pMapping); }
+		const auto& GetFileSize() const { return FileSize; }
+
+	private:
+		bool Validate();
+		const uint8_t* GetSection(const BakedProbeSection section);
+
+	private:
+		const uint8_t* pMapping = nullptr;
+		uint64_t FileSize = 0;
+#if defined(_WIN32)
+		HANDLE FileHandle = INVALID_HANDLE_VALUE;
+		HANDLE MappingHandle = nullptr;
+#endif
+		std::array<std::vector<uint8_t>, static_cast<size_t>(BakedProbeSection::Count)> DecompressedSections;
+		BakedProbeData Data;
+	};
+}
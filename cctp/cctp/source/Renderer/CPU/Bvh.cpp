@@ -0,0 +1,545 @@
+#include "CpuPch.h"
+#include "Bvh.h"
+#include "TriangleIntersection.h"
+#include "Threading/TaskScheduler.h"
+
+// Nodes with more primitives fit and bin their primitives in parallel ranges of this size
+constexpr uint32_t BVH_BUILD_RANGE_PRIMITIVE_COUNT = 16384;
+// Nodes with at most this many primitives are built into a subtree by a single task
+constexpr uint32_t BVH_SUBTREE_TASK_PRIMITIVE_COUNT = 4096;
+
+struct BvhBin
+{
+	BoundingBox Bounds;
+	uint32_t PrimitiveCount = 0;
+};
+
+// Bins along each axis
+using BvhBins = std::array<std::array<BvhBin, Renderer::CPU::Bvh::MaxBinCount>, 3>;
+
+// Maps primitive centroids to bins spread evenly over the centroid bounds of a node
+struct BvhBinning
+{
+	BoundingBox CentroidBounds;
+	uint32_t BinCount = 0;
+	// Zero along axes where all centroids coincide
+	glm::vec3 BinScale = glm::vec3(0.0f, 0.0f, 0.0f);
+
+	uint32_t GetBinIndex(const glm::vec3& centroid, const int32_t axis) const
+	{
+		return std::min(static_cast<uint32_t>((centroid[axis] - CentroidBounds.Min[axis]) * BinScale[axis]), BinCount - 1);
+	}
+};
+
+struct BvhBuildContext
+{
+	const Renderer::CPU::BvhBuildSettings* pSettings = nullptr;
+	std::vector<Renderer::CPU::BvhNode>* pNodes = nullptr;
+	// Partitioned in place rather than through an index list so each node reads a contiguous range of memory
+	std::vector<Renderer::CPU::BvhBuildPrimitive>* pPrimitives = nullptr;
+	// Scratch bins reused by every node, only the bins in use are cleared
+	BvhBins Bins;
+	uint32_t MaxDepth = 0;
+};
+
+// Shared by the tasks of a parallel build. Nodes are allocated up front and handed out by advancing NodeCount
+struct BvhParallelBuildContext
+{
+	const Renderer::CPU::BvhBuildSettings* pSettings = nullptr;
+	std::vector<Renderer::CPU::BvhNode>* pNodes = nullptr;
+	std::vector<Renderer::CPU::BvhBuildPrimitive>* pPrimitives = nullptr;
+	Threading::TaskScheduler* pScheduler = nullptr;
+	Threading::TaskGroup Group;
+	std::atomic<uint32_t> NodeCount = 0;
+	std::atomic<uint32_t> MaxDepth = 0;
+};
+
+void FitBvhPrimitives(const Renderer::CPU::BvhBuildPrimitive* pPrimitives, const size_t count, BoundingBox& bounds, BoundingBox& centroidBounds)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		bounds.Grow(pPrimitives[i].Bounds);
+		centroidBounds.Grow(pPrimitives[i].Centroid);
+	}
+}
+
+BvhBinning CreateBvhBinning(const BoundingBox& centroidBounds, const uint32_t primitiveCount, const Renderer::CPU::BvhBuildSettings& settings)
+{
+	// Small nodes use fewer bins as the sweep would otherwise dominate their cost
+	BvhBinning binning;
+	binning.CentroidBounds = centroidBounds;
+	binning.BinCount = std::clamp(std::min(settings.BinCount, primitiveCount), 2u, Renderer::CPU::Bvh::MaxBinCount);
+	const glm::vec3 centroidExtents = centroidBounds.GetExtents();
+	for (int32_t axis = 0; axis < 3; ++axis)
+	{
+		if (centroidExtents[axis] > 0.0f)
+		{
+			binning.BinScale[axis] = static_cast<float>(binning.BinCount) * (1.0f - 1e-5f) / centroidExtents[axis];
+		}
+	}
+	return binning;
+}
+
+// Bins the centroids along all three axes in a single pass
+void BinBvhPrimitives(const Renderer::CPU::BvhBuildPrimitive* pPrimitives, const size_t count, const BvhBinning& binning, BvhBins& bins)
+{
+	for (auto& axisBins : bins)
+	{
+		std::fill(axisBins.begin(), axisBins.begin() + binning.BinCount, BvhBin());
+	}
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const auto& primitive = pPrimitives[i];
+		for (int32_t axis = 0; axis < 3; ++axis)
+		{
+			auto& bin = bins[axis][binning.GetBinIndex(primitive.Centroid, axis)];
+			bin.Bounds.Grow(primitive.Bounds);
+			++bin.PrimitiveCount;
+		}
+	}
+}
+
+// Chooses the split of a node from its bins and partitions its primitives to match. Returns the number of primitives moved to the left child,
+// or zero when the node should stay a leaf
+uint32_t PartitionBvhNode(Renderer::CPU::BvhBuildPrimitive* pPrimitives, const uint32_t count, const BoundingBox& bounds, const BvhBinning& binning,
+	const BvhBins& bins, const Renderer::CPU::BvhBuildSettings& settings)
+{
+	const uint32_t binCount = binning.BinCount;
+
+	// Sweep the bins from both sides to find the split plane with the lowest surface area cost
+	float bestCost = std::numeric_limits<float>::max();
+	int32_t bestAxis = -1;
+	uint32_t bestSplit = 0;
+	for (int32_t axis = 0; axis < 3; ++axis)
+	{
+		if (binning.BinScale[axis] == 0.0f)
+		{
+			continue;
+		}
+
+		std::array<float, Renderer::CPU::Bvh::MaxBinCount> leftAreas;
+		std::array<uint32_t, Renderer::CPU::Bvh::MaxBinCount> leftCounts;
+		BoundingBox leftBounds;
+		uint32_t leftCount = 0;
+		for (uint32_t bin = 0; bin < binCount - 1; ++bin)
+		{
+			leftBounds.Grow(bins[axis][bin].Bounds);
+			leftCount += bins[axis][bin].PrimitiveCount;
+			leftAreas[bin] = leftBounds.GetSurfaceArea();
+			leftCounts[bin] = leftCount;
+		}
+
+		BoundingBox rightBounds;
+		uint32_t rightCount = 0;
+		for (uint32_t bin = binCount - 1; bin > 0; --bin)
+		{
+			rightBounds.Grow(bins[axis][bin].Bounds);
+			rightCount += bins[axis][bin].PrimitiveCount;
+
+			if (leftCounts[bin - 1] == 0 || rightCount == 0)
+			{
+				continue;
+			}
+
+			const float cost = leftAreas[bin - 1] * static_cast<float>(leftCounts[bin - 1]) + rightBounds.GetSurfaceArea() * static_cast<float>(rightCount);
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = bin;
+			}
+		}
+	}
+
+	if (bestAxis < 0)
+	{
+		// All centroids coincide. Split in half when the node is too large for a leaf
+		return (count <= settings.MaxLeafPrimitiveCount) ? 0 : count / 2;
+	}
+
+	const float splitCost = settings.TraversalCost + settings.IntersectionCost * bestCost / std::max(bounds.GetSurfaceArea(), std::numeric_limits<float>::min());
+	const float leafCost = settings.IntersectionCost * static_cast<float>(count);
+	if (splitCost >= leafCost && count <= settings.MaxLeafPrimitiveCount)
+	{
+		return 0;
+	}
+
+	auto* pMiddle = std::partition(pPrimitives, pPrimitives + count, [&](const Renderer::CPU::BvhBuildPrimitive& primitive)
+		{
+			return binning.GetBinIndex(primitive.Centroid, bestAxis) < bestSplit;
+		});
+	return static_cast<uint32_t>(pMiddle - pPrimitives);
+}
+
+void SubdivideBvhNode(BvhBuildContext& context, const uint32_t nodeIndex, const uint32_t depth)
+{
+	auto& nodes = *context.pNodes;
+	const auto& settings = *context.pSettings;
+	const uint32_t first = nodes[nodeIndex].LeftFirst;
+	const uint32_t count = nodes[nodeIndex].PrimitiveCount;
+	auto* pPrimitives = context.pPrimitives->data() + first;
+
+	// Fit the node to its primitives. Split planes are placed within the bounds of the primitive centroids
+	BoundingBox bounds;
+	BoundingBox centroidBounds;
+	FitBvhPrimitives(pPrimitives, count, bounds, centroidBounds);
+	nodes[nodeIndex].BoundsMin = bounds.Min;
+	nodes[nodeIndex].BoundsMax = bounds.Max;
+
+	context.MaxDepth = std::max(context.MaxDepth, depth);
+	if (count <= 1 || depth + 1 >= Renderer::CPU::Bvh::MaxTreeDepth)
+	{
+		return;
+	}
+
+	const BvhBinning binning = CreateBvhBinning(centroidBounds, count, settings);
+	BinBvhPrimitives(pPrimitives, count, binning, context.Bins);
+	const uint32_t leftCount = PartitionBvhNode(pPrimitives, count, bounds, binning, context.Bins, settings);
+	if (leftCount == 0)
+	{
+		return;
+	}
+
+	// Children are allocated as a pair
+	const auto leftIndex = static_cast<uint32_t>(nodes.size());
+	nodes.emplace_back();
+	nodes.emplace_back();
+	nodes[leftIndex].LeftFirst = first;
+	nodes[leftIndex].PrimitiveCount = leftCount;
+	nodes[leftIndex + 1].LeftFirst = first + leftCount;
+	nodes[leftIndex + 1].PrimitiveCount = count - leftCount;
+	nodes[nodeIndex].LeftFirst = leftIndex;
+	nodes[nodeIndex].PrimitiveCount = 0;
+
+	SubdivideBvhNode(context, leftIndex, depth + 1);
+	SubdivideBvhNode(context, leftIndex + 1, depth + 1);
+}
+
+// Builds the subtree below a node of a parallel build into nodes of its own, then copies them into the shared nodes in one contiguous block
+void BuildBvhSubtree(BvhParallelBuildContext& context, const uint32_t nodeIndex, const uint32_t depth)
+{
+	auto& nodes = *context.pNodes;
+
+	std::vector<Renderer::CPU::BvhNode> subtreeNodes;
+	subtreeNodes.reserve(static_cast<size_t>(nodes[nodeIndex].PrimitiveCount) * 2 - 1);
+	subtreeNodes.push_back(nodes[nodeIndex]);
+
+	BvhBuildContext subtreeContext = {};
+	subtreeContext.pSettings = context.pSettings;
+	subtreeContext.pNodes = &subtreeNodes;
+	subtreeContext.pPrimitives = context.pPrimitives;
+	SubdivideBvhNode(subtreeContext, 0, depth);
+
+	// The subtree root stays at nodeIndex, the rest move to the allocated block
+	const uint32_t offset = context.NodeCount.fetch_add(static_cast<uint32_t>(subtreeNodes.size() - 1), std::memory_order_relaxed) - 1;
+	for (size_t i = 0; i < subtreeNodes.size(); ++i)
+	{
+		auto node = subtreeNodes[i];
+		if (!node.IsLeaf())
+		{
+			node.LeftFirst += offset;
+		}
+		nodes[(i == 0) ? nodeIndex : offset + i] = node;
+	}
+
+	uint32_t maxDepth = context.MaxDepth.load(std::memory_order_relaxed);
+	while (subtreeContext.MaxDepth > maxDepth && !context.MaxDepth.compare_exchange_weak(maxDepth, subtreeContext.MaxDepth, std::memory_order_relaxed))
+	{
+	}
+}
+
+// Splits large nodes with parallel fitting and binning, handing the left child to another task. Nodes small enough become subtree tasks
+void SubdivideBvhNodeParallel(BvhParallelBuildContext& context, const uint32_t nodeIndex, const uint32_t depth)
+{
+	auto& nodes = *context.pNodes;
+	const auto& settings = *context.pSettings;
+	auto& scheduler = *context.pScheduler;
+	const uint32_t first = nodes[nodeIndex].LeftFirst;
+	const uint32_t count = nodes[nodeIndex].PrimitiveCount;
+	auto* pPrimitives = context.pPrimitives->data() + first;
+
+	if (count <= BVH_SUBTREE_TASK_PRIMITIVE_COUNT)
+	{
+		BuildBvhSubtree(context, nodeIndex, depth);
+		return;
+	}
+
+	// Bounds are merged from every range, which gives the same result as fitting serially
+	const size_t rangeCount = (count + BVH_BUILD_RANGE_PRIMITIVE_COUNT - 1) / BVH_BUILD_RANGE_PRIMITIVE_COUNT;
+	std::vector<std::pair<BoundingBox, BoundingBox>> rangeBounds(rangeCount);
+	scheduler.ParallelFor(count, BVH_BUILD_RANGE_PRIMITIVE_COUNT, [&](const size_t begin, const size_t end)
+		{
+			auto& [bounds, centroidBounds] = rangeBounds[begin / BVH_BUILD_RANGE_PRIMITIVE_COUNT];
+			FitBvhPrimitives(pPrimitives + begin, end - begin, bounds, centroidBounds);
+		});
+
+	BoundingBox bounds;
+	BoundingBox centroidBounds;
+	for (const auto& range : rangeBounds)
+	{
+		bounds.Grow(range.first);
+		centroidBounds.Grow(range.second);
+	}
+	nodes[nodeIndex].BoundsMin = bounds.Min;
+	nodes[nodeIndex].BoundsMax = bounds.Max;
+
+	uint32_t maxDepth = context.MaxDepth.load(std::memory_order_relaxed);
+	while (depth > maxDepth && !context.MaxDepth.compare_exchange_weak(maxDepth, depth, std::memory_order_relaxed))
+	{
+	}
+	if (depth + 1 >= Renderer::CPU::Bvh::MaxTreeDepth)
+	{
+		return;
+	}
+
+	const BvhBinning binning = CreateBvhBinning(centroidBounds, count, settings);
+	std::vector<BvhBins> rangeBins(rangeCount);
+	scheduler.ParallelFor(count, BVH_BUILD_RANGE_PRIMITIVE_COUNT, [&](const size_t begin, const size_t end)
+		{
+			BinBvhPrimitives(pPrimitives + begin, end - begin, binning, rangeBins[begin / BVH_BUILD_RANGE_PRIMITIVE_COUNT]);
+		});
+
+	BvhBins& bins = rangeBins[0];
+	for (size_t range = 1; range < rangeCount; ++range)
+	{
+		for (int32_t axis = 0; axis < 3; ++axis)
+		{
+			for (uint32_t bin = 0; bin < binning.BinCount; ++bin)
+			{
+				bins[axis][bin].Bounds.Grow(rangeBins[range][axis][bin].Bounds);
+				bins[axis][bin].PrimitiveCount += rangeBins[range][axis][bin].PrimitiveCount;
+			}
+		}
+	}
+
+	const uint32_t leftCount = PartitionBvhNode(pPrimitives, count, bounds, binning, bins, settings);
+	if (leftCount == 0)
+	{
+		return;
+	}
+
+	const uint32_t leftIndex = context.NodeCount.fetch_add(2, std::memory_order_relaxed);
+	nodes[leftIndex].LeftFirst = first;
+	nodes[leftIndex].PrimitiveCount = leftCount;
+	nodes[leftIndex + 1].LeftFirst = first + leftCount;
+	nodes[leftIndex + 1].PrimitiveCount = count - leftCount;
+	nodes[nodeIndex].LeftFirst = leftIndex;
+	nodes[nodeIndex].PrimitiveCount = 0;
+
+	scheduler.Submit(context.Group, [&context, leftIndex, depth]() { SubdivideBvhNodeParallel(context, leftIndex, depth + 1); });
+	SubdivideBvhNodeParallel(context, leftIndex + 1, depth + 1);
+}
+
+uint32_t Renderer::CPU::BuildBvhNodes(std::vector<BvhBuildPrimitive>& primitives, const BvhBuildSettings& settings, std::vector<BvhNode>& nodes)
+{
+	nodes.clear();
+	if (primitives.empty())
+	{
+		return 0;
+	}
+
+	// A binary tree over n leaves has at most 2n - 1 nodes
+	const size_t maxNodeCount = primitives.size() * 2 - 1;
+
+	if (primitives.size() <= BVH_SUBTREE_TASK_PRIMITIVE_COUNT)
+	{
+		BvhBuildContext context = {};
+		context.pSettings = &settings;
+		context.pNodes = &nodes;
+		context.pPrimitives = &primitives;
+
+		nodes.reserve(maxNodeCount);
+		nodes.emplace_back();
+		nodes[0].LeftFirst = 0;
+		nodes[0].PrimitiveCount = static_cast<uint32_t>(primitives.size());
+		SubdivideBvhNode(context, 0, 0);
+		nodes.shrink_to_fit();
+		return context.MaxDepth;
+	}
+
+	// Splits of the upper levels bin in parallel, which becomes a task per subtree further down. Splits do not depend on the thread count,
+	// so the tree matches a single threaded build apart from the order of its nodes
+	BvhParallelBuildContext context;
+	context.pSettings = &settings;
+	context.pNodes = &nodes;
+	context.pPrimitives = &primitives;
+	context.pScheduler = (settings.pTaskScheduler != nullptr) ? settings.pTaskScheduler : &Threading::TaskScheduler::GetDefault();
+	context.NodeCount = 1;
+
+	nodes.resize(maxNodeCount);
+	nodes[0].LeftFirst = 0;
+	nodes[0].PrimitiveCount = static_cast<uint32_t>(primitives.size());
+	SubdivideBvhNodeParallel(context, 0, 0);
+	context.pScheduler->Wait(context.Group);
+	nodes.resize(context.NodeCount);
+	nodes.shrink_to_fit();
+
+	return context.MaxDepth;
+}
+
+void Renderer::CPU::CalculateBvhStats(const std::vector<BvhNode>& nodes, const BvhBuildSettings& settings, BvhBuildStats& stats)
+{
+	stats.NodeCount = nodes.size();
+	stats.LeafCount = 0;
+	stats.MaxLeafPrimitiveCount = 0;
+	stats.SahCost = 0.0f;
+	if (nodes.empty())
+	{
+		return;
+	}
+
+	// Surface area heuristic cost of the whole tree relative to the root
+	float cost = 0.0f;
+	for (const auto& node : nodes)
+	{
+		BoundingBox bounds;
+		bounds.Min = node.BoundsMin;
+		bounds.Max = node.BoundsMax;
+		const float area = bounds.GetSurfaceArea();
+
+		if (node.IsLeaf())
+		{
+			cost += settings.IntersectionCost * static_cast<float>(node.PrimitiveCount) * area;
+			++stats.LeafCount;
+			stats.MaxLeafPrimitiveCount = std::max(stats.MaxLeafPrimitiveCount, node.PrimitiveCount);
+		}
+		else
+		{
+			cost += settings.TraversalCost * area;
+		}
+	}
+
+	BoundingBox rootBounds;
+	rootBounds.Min = nodes[0].BoundsMin;
+	rootBounds.Max = nodes[0].BoundsMax;
+	const float rootArea = rootBounds.GetSurfaceArea();
+	stats.SahCost = (rootArea > 0.0f) ? cost / rootArea : 0.0f;
+}
+
+bool Renderer::CPU::IntersectBvhNodeBounds(const BvhNode& node, const glm::vec3& origin, const glm::vec3& inverseDirection, const float tMin, const float tMax,
+	float& tEntry)
+{
+	const glm::vec3 t0 = (node.BoundsMin - origin) * inverseDirection;
+	const glm::vec3 t1 = (node.BoundsMax - origin) * inverseDirection;
+	const glm::vec3 tNear = glm::min(t0, t1);
+	const glm::vec3 tFar = glm::max(t0, t1);
+
+	tEntry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, tMin));
+	const float tExit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+	return tEntry <= tExit;
+}
+
+const Renderer::CPU::BvhBuildStats& Renderer::CPU::Bvh::Build(const Vertex1Pos1UV1Norm* pVertices, const size_t vertexCount, const uint32_t* pIndices, const size_t indexCount,
+	const BvhBuildSettings& settings)
+{
+	return Build(pVertices, sizeof(Vertex1Pos1UV1Norm), vertexCount, pIndices, indexCount, settings);
+}
+
+const Renderer::CPU::BvhBuildStats& Renderer::CPU::Bvh::Build(const void* pVertexData, const size_t vertexStride, [[maybe_unused]] const size_t vertexCount,
+	const uint32_t* pIndices, const size_t indexCount,
+	const BvhBuildSettings& settings)
+{
+	assert(indexCount % 3 == 0 && "Bvh meshes must be triangle lists.");
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	Nodes.clear();
+	Triangles.clear();
+	PrimitiveIndices.clear();
+	Stats = {};
+
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+	{
+		return Stats;
+	}
+
+	const auto* pVertexBytes = static_cast<const uint8_t*>(pVertexData);
+	auto getPosition = [&](const uint32_t vertexIndex)
+	{
+		assert(vertexIndex < vertexCount && "Bvh index buffer references a vertex out of range.");
+		glm::vec3 position;
+		memcpy(&position, pVertexBytes + vertexIndex * vertexStride, sizeof(glm::vec3));
+		return position;
+	};
+
+	auto& scheduler = (settings.pTaskScheduler != nullptr) ? *settings.pTaskScheduler : Threading::TaskScheduler::GetDefault();
+
+	// Gather triangle bounds
+	std::vector<BvhBuildPrimitive> primitives(triangleCount);
+	scheduler.ParallelFor(triangleCount, BVH_BUILD_RANGE_PRIMITIVE_COUNT, [&](const size_t begin, const size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				auto& primitive = primitives[i];
+				primitive.Bounds.Grow(getPosition(pIndices[i * 3]));
+				primitive.Bounds.Grow(getPosition(pIndices[i * 3 + 1]));
+				primitive.Bounds.Grow(getPosition(pIndices[i * 3 + 2]));
+				primitive.Centroid = primitive.Bounds.GetCentre();
+				primitive.Index = static_cast<uint32_t>(i);
+			}
+		});
+
+	Stats.MaxDepth = BuildBvhNodes(primitives, settings, Nodes);
+
+	// Store triangles in leaf order
+	Triangles.resize(triangleCount);
+	PrimitiveIndices.resize(triangleCount);
+	scheduler.ParallelFor(triangleCount, BVH_BUILD_RANGE_PRIMITIVE_COUNT, [&](const size_t begin, const size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				const uint32_t triangleIndex = primitives[i].Index;
+				Triangles[i].V0 = getPosition(pIndices[triangleIndex * 3]);
+				Triangles[i].V1 = getPosition(pIndices[triangleIndex * 3 + 1]);
+				Triangles[i].V2 = getPosition(pIndices[triangleIndex * 3 + 2]);
+				PrimitiveIndices[i] = triangleIndex;
+			}
+		});
+
+	Stats.PrimitiveCount = triangleCount;
+	CalculateBvhStats(Nodes, settings, Stats);
+	Stats.BuildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	return Stats;
+}
+
+bool Renderer::CPU::Bvh::Intersect(const glm::vec3& origin, const glm::vec3& direction, const float tMin, const bool cullBackFaces, const bool anyHit, RayHit& hit) const
+{
+	bool hitFound = false;
+	TraverseBvh(Nodes, origin, direction, tMin, hit, [&](const BvhNode& leaf)
+		{
+			for (uint32_t i = leaf.LeftFirst; i < leaf.LeftFirst + leaf.PrimitiveCount; ++i)
+			{
+				float t;
+				glm::vec2 barycentrics;
+				if (IntersectTriangle(origin, direction, Triangles[i].V0, Triangles[i].V1, Triangles[i].V2, cullBackFaces, t, barycentrics) &&
+					t >= tMin && t < hit.T)
+				{
+					hit.T = t;
+					hit.Barycentrics = barycentrics;
+					hit.PrimitiveIndex = PrimitiveIndices[i];
+					hitFound = true;
+
+					if (anyHit)
+					{
+						return true;
+					}
+				}
+			}
+			return false;
+		});
+
+	return hitFound;
+}
+
+BoundingBox Renderer::CPU::Bvh::GetBounds() const
+{
+	BoundingBox bounds;
+	if (!Nodes.empty())
+	{
+		bounds.Min = Nodes[0].BoundsMin;
+		bounds.Max = Nodes[0].BoundsMax;
+	}
+	return bounds;
+}
\ No newline at end of file
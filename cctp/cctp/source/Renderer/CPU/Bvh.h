@@ -0,0 +1,189 @@
+#pragma once
+
+#include "Ray.h"
+#include "Math/BoundingBox.h"
+#include "Renderer/Vertices/Vertex1Pos1UV1Norm.h"
+
+namespace Threading
+{
+	class TaskScheduler;
+}
+
+namespace Renderer
+{
+	namespace CPU
+	{
+		// 32 byte node so two siblings share a 64 byte cache line. Children of an interior node are stored next to each other
+		struct BvhNode
+		{
+			glm::vec3 BoundsMin = glm::vec3(0.0f, 0.0f, 0.0f);
+			// Index of the left child for interior nodes, the right child follows it. Index of the first primitive for leaves
+			uint32_t LeftFirst = 0;
+			glm::vec3 BoundsMax = glm::vec3(0.0f, 0.0f, 0.0f);
+			// Zero for interior nodes
+			uint32_t PrimitiveCount = 0;
+
+			bool IsLeaf() const { return PrimitiveCount > 0; }
+		};
+		static_assert(sizeof(BvhNode) == 32, "BvhNode is expected to be 32 bytes.");
+
+		struct BvhTriangle
+		{
+			glm::vec3 V0 = glm::vec3(0.0f, 0.0f, 0.0f);
+			glm::vec3 V1 = glm::vec3(0.0f, 0.0f, 0.0f);
+			glm::vec3 V2 = glm::vec3(0.0f, 0.0f, 0.0f);
+		};
+
+		struct BvhBuildSettings
+		{
+			// Number of candidate split planes evaluated along each axis, up to Bvh::MaxBinCount
+			uint32_t BinCount = 16;
+			// Nodes with more primitives are always split, unless all primitive centroids coincide
+			uint32_t MaxLeafPrimitiveCount = 8;
+			// Surface area heuristic costs of visiting a node and intersecting a primitive
+			float TraversalCost = 1.0f;
+			float IntersectionCost = 1.0f;
+			// Scheduler large builds are spread across. Null uses the default scheduler with a thread per hardware thread
+			Threading::TaskScheduler* pTaskScheduler = nullptr;
+		};
+
+		struct BvhBuildStats
+		{
+			size_t PrimitiveCount = 0;
+			size_t NodeCount = 0;
+			size_t LeafCount = 0;
+			uint32_t MaxDepth = 0;
+			uint32_t MaxLeafPrimitiveCount = 0;
+			// Expected cost of tracing a ray through the tree relative to intersecting a single primitive
+			float SahCost = 0.0f;
+			double BuildMilliseconds = 0.0;
+
+			float GetAverageLeafPrimitiveCount() const { return (LeafCount > 0) ? static_cast<float>(PrimitiveCount) / static_cast<float>(LeafCount) : 0.0f; }
+		};
+
+		// Bounds of a primitive to build a tree over. Index identifies the primitive once the builder has reordered them
+		struct BvhBuildPrimitive
+		{
+			BoundingBox Bounds;
+			glm::vec3 Centroid = glm::vec3(0.0f, 0.0f, 0.0f);
+			uint32_t Index = 0;
+		};
+
+		// Builds nodes over the primitives with the binned surface area heuristic, reordering the primitives so each leaf references a contiguous range.
+		// The root is the first node and children always follow their parent. Returns the depth of the tree
+		uint32_t BuildBvhNodes(std::vector<BvhBuildPrimitive>& primitives, const BvhBuildSettings& settings, std::vector<BvhNode>& nodes);
+		// Fills the node, leaf and surface area heuristic cost stats of a tree
+		void CalculateBvhStats(const std::vector<BvhNode>& nodes, const BvhBuildSettings& settings, BvhBuildStats& stats);
+		// Slab test returning the entry distance of the ray into the node bounds
+		bool IntersectBvhNodeBounds(const BvhNode& node, const glm::vec3& origin, const glm::vec3& inverseDirection, const float tMin, const float tMax, float& tEntry);
+
+		// Bounding volume hierarchy over the triangles of a single mesh built with the binned surface area heuristic.
+		// The CPU equivalent of a BottomLevelAccelerationStructure
+		class Bvh
+		{
+		public:
+			static constexpr uint32_t MaxBinCount = 32;
+			// Deeper nodes are made leaves, which bounds the traversal stack
+			static constexpr uint32_t MaxTreeDepth = 64;
+
+			// Builds from the vertex and index data of a Mesh
+			const BvhBuildStats& Build(const Vertex1Pos1UV1Norm* pVertices, const size_t vertexCount, const uint32_t* pIndices, const size_t indexCount,
+				const BvhBuildSettings& settings = {});
+			// Builds from any vertex layout with a float3 position at the start of each vertex, as D3D12_RAYTRACING_GEOMETRY_TRIANGLES_DESC
+			const BvhBuildStats& Build(const void* pVertexData, const size_t vertexStride, const size_t vertexCount, const uint32_t* pIndices, const size_t indexCount,
+				const BvhBuildSettings& settings = {});
+
+			// Finds the closest triangle hit between tMin and hit.T, writing T, Barycentrics and PrimitiveIndex of the hit. Returns on the first hit found when anyHit is set.
+			// Back facing triangles are skipped when cullBackFaces is set
+			bool Intersect(const glm::vec3& origin, const glm::vec3& direction, const float tMin, const bool cullBackFaces, const bool anyHit, RayHit& hit) const;
+
+			bool IsEmpty() const { return Nodes.empty(); }
+			BoundingBox GetBounds() const;
+			const auto& GetNodes() const { return Nodes; }
+			const auto& GetTriangles() const { return Triangles; }
+			const auto& GetPrimitiveIndices() const { return PrimitiveIndices; }
+			const BvhBuildStats& GetStats() const { return Stats; }
+			size_t GetMemoryBytes() const { return Nodes.size() * sizeof(BvhNode) + Triangles.size() * (sizeof(BvhTriangle) + sizeof(uint32_t)); }
+
+		private:
+			std::vector<BvhNode> Nodes;
+			// Triangle positions in leaf order, leaves reference a contiguous range
+			std::vector<BvhTriangle> Triangles;
+			// Index of each triangle in the source index buffer, in leaf order
+			std::vector<uint32_t> PrimitiveIndices;
+			BvhBuildStats Stats;
+		};
+	
+		// Visits the leaves hit by the ray, nearest first, skipping nodes behind the closest hit in hit.T.
+		// intersectLeaf(const BvhNode& leaf) tests the leaf primitives, shortening hit.T on a hit, and returns true to end traversal
+		template<typename LeafFunction>
+		void TraverseBvh(const std::vector<BvhNode>& nodes, const glm::vec3& origin, const glm::vec3& direction, const float tMin, const RayHit& hit,
+			LeafFunction&& intersectLeaf)
+		{
+			if (nodes.empty())
+			{
+				return;
+			}
+
+			const glm::vec3 inverseDirection = 1.0f / direction;
+
+			float tEntry;
+			if (!IntersectBvhNodeBounds(nodes[0], origin, inverseDirection, tMin, hit.T, tEntry))
+			{
+				return;
+			}
+
+			// Nodes still to visit along with their entry distance
+			std::array<uint32_t, Bvh::MaxTreeDepth> stackNodes;
+			std::array<float, Bvh::MaxTreeDepth> stackEntries;
+			uint32_t stackSize = 0;
+			uint32_t nodeIndex = 0;
+
+			while (true)
+			{
+				const auto& node = nodes[nodeIndex];
+				if (node.IsLeaf())
+				{
+					if (intersectLeaf(node))
+					{
+						return;
+					}
+				}
+				else
+				{
+					// Visit the nearest child first
+					float leftEntry;
+					float rightEntry;
+					const bool leftHit = IntersectBvhNodeBounds(nodes[node.LeftFirst], origin, inverseDirection, tMin, hit.T, leftEntry);
+					const bool rightHit = IntersectBvhNodeBounds(nodes[node.LeftFirst + 1], origin, inverseDirection, tMin, hit.T, rightEntry);
+
+					if (leftHit && rightHit)
+					{
+						const bool leftFirst = leftEntry <= rightEntry;
+						stackNodes[stackSize] = leftFirst ? node.LeftFirst + 1 : node.LeftFirst;
+						stackEntries[stackSize] = leftFirst ? rightEntry : leftEntry;
+						++stackSize;
+						nodeIndex = leftFirst ? node.LeftFirst : node.LeftFirst + 1;
+						continue;
+					}
+					else if (leftHit || rightHit)
+					{
+						nodeIndex = leftHit ? node.LeftFirst : node.LeftFirst + 1;
+						continue;
+					}
+				}
+
+				// Pop the next node that is not behind the closest hit
+				do
+				{
+					if (stackSize == 0)
+					{
+						return;
+					}
+					--stackSize;
+				} while (stackEntries[stackSize] >= hit.T);
+				nodeIndex = stackNodes[stackSize];
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "CpuPch.h"
+#include "ProbeClassifier.h"
+#include "ProbeTracer.h"
+#include "RaytracingScene.h"
+#include "Renderer/ProbeVolume.h"
+#include "Threading/TaskScheduler.h"
+
+enum class ProbeClassification : uint8_t
+{
+	Active,
+	InsideGeometry,
+	FarFromSurface
+};
+
+Renderer::CPU::ProbeClassificationStats Renderer::CPU::ClassifyProbes(const RaytracingScene& scene, const std::vector<glm::vec4>& probePositions,
+	const std::vector<uint32_t>& probeIndices, const ProbeClassificationSettings& settings, std::vector<uint32_t>& probeStates)
+{
+	assert(probeStates.size() == probePositions.size() && "Every probe must have a state.");
+
+	const auto startTime = std::chrono::high_resolution_clock::now();
+
+	// Probes are classified with the directions they are traced with
+	RayPacket packet = {};
+	packet.RayCount = std::min(RayPacket::MaxRayCount, PROBE_RAY_COUNT);
+	for (uint32_t i = 0; i < packet.RayCount; ++i)
+	{
+		packet.Directions[i] = glm::normalize(SphericalFibonacci(static_cast<float>(i), static_cast<float>(packet.RayCount)));
+	}
+
+	std::vector<ProbeClassification> classifications(probeIndices.size());
+	auto& scheduler = (settings.pTaskScheduler != nullptr) ? *settings.pTaskScheduler : Threading::TaskScheduler::GetDefault();
+	scheduler.ParallelFor(probeIndices.size(), 16, [&](const size_t begin, const size_t end)
+		{
+			RayPacket probePacket = packet;
+			std::array<RayHit, RayPacket::MaxRayCount> hits;
+			for (size_t i = begin; i < end; ++i)
+			{
+				probePacket.Origin = glm::vec3(probePositions[probeIndices[i]]);
+				std::fill(hits.begin(), hits.end(), RayHit());
+				scene.IntersectPacket(probePacket, hits.data(), false);
+
+				uint32_t backfaceCount = 0;
+				float closestFrontfaceT = std::numeric_limits<float>::max();
+				for (uint32_t r = 0; r < probePacket.RayCount; ++r)
+				{
+					if (!hits[r].IsHit())
+					{
+						continue;
+					}
+
+					if (glm::dot(scene.GetHitNormalWS(hits[r]), probePacket.Directions[r]) > 0.0f)
+					{
+						++backfaceCount;
+					}
+					else
+					{
+						closestFrontfaceT = std::min(closestFrontfaceT, hits[r].T);
+					}
+				}
+
+				if (static_cast<float>(backfaceCount) > settings.BackfaceRatioThreshold * static_cast<float>(probePacket.RayCount))
+				{
+					classifications[i] = ProbeClassification::InsideGeometry;
+				}
+				else if (closestFrontfaceT > settings.MaxSurfaceDistance)
+				{
+					classifications[i] = ProbeClassification::FarFromSurface;
+				}
+				else
+				{
+					classifications[i] = ProbeClassification::Active;
+				}
+			}
+		});
+
+	ProbeClassificationStats stats = {};
+	stats.ProbeCount = probeIndices.size();
+	for (size_t i = 0; i < probeIndices.size(); ++i)
+	{
+		stats.InsideGeometryCount += (classifications[i] == ProbeClassification::InsideGeometry) ? 1 : 0;
+		stats.FarFromSurfaceCount += (classifications[i] == ProbeClassification::FarFromSurface) ? 1 : 0;
+		probeStates[probeIndices[i]] = static_cast<uint32_t>((classifications[i] == ProbeClassification::Active) ? ProbeState::Active : ProbeState::Inactive);
+	}
+
+	stats.Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	return stats;
+}
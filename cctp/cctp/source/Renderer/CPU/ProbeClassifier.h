@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Renderer/GIConstants.h"
+
+namespace Threading
+{
+	class TaskScheduler;
+}
+
+namespace Renderer
+{
+	namespace CPU
+	{
+		class RaytracingScene;
+
+		struct ProbeClassificationSettings
+		{
+			// Probes seeing back faces along more than this fraction of their rays are inside geometry
+			float BackfaceRatioThreshold = 0.25f;
+			// Probes with no front face closer than this gather no light. Defaults to the probe ray length, so only probes that miss with every
+			// ray and contribute nothing to shading are deactivated by distance
+			float MaxSurfaceDistance = PROBE_MAX_RAY_DISTANCE;
+			// Scheduler the probes are spread across. Null uses the default scheduler with a thread per hardware thread
+			Threading::TaskScheduler* pTaskScheduler = nullptr;
+		};
+
+		struct ProbeClassificationStats
+		{
+			size_t ProbeCount = 0;
+			size_t InsideGeometryCount = 0;
+			size_t FarFromSurfaceCount = 0;
+			double Milliseconds = 0.0;
+
+			size_t GetInactiveProbeCount() const { return InsideGeometryCount + FarFromSurfaceCount; }
+		};
+
+		// Marks each listed probe active or inactive in probeStates by tracing the probe ray directions without back face culling and unbounded
+		// in length. A probe inside a closed mesh sees mostly back faces. A probe in open space far from any surface misses every probe ray
+		ProbeClassificationStats ClassifyProbes(const RaytracingScene& scene, const std::vector<glm::vec4>& probePositions, const std::vector<uint32_t>& probeIndices,
+			const ProbeClassificationSettings& settings, std::vector<uint32_t>& probeStates);
+	}
+}
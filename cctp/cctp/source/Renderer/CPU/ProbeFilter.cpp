@@ -0,0 +1,125 @@
+#include "CpuPch.h"
+#include "ProbeFilter.h"
+#include "Math/Octahedral.h"
+#include "Renderer/GIConstants.h"
+
+static_assert(Renderer::PROBE_PADDING <= Renderer::IRRADIANCE_PROBE_SIDE_LENGTH, "Texels are wrapped across at most one edge of the octahedral square.");
+
+glm::ivec2 Renderer::CPU::WrapOctahedralTexel(const glm::ivec2& texel, const int32_t sideLength)
+{
+	glm::ivec2 wrapped = texel;
+	if (wrapped.x < 0)
+	{
+		wrapped = glm::ivec2(-1 - wrapped.x, sideLength - 1 - wrapped.y);
+	}
+	else if (wrapped.x >= sideLength)
+	{
+		wrapped = glm::ivec2(2 * sideLength - 1 - wrapped.x, sideLength - 1 - wrapped.y);
+	}
+
+	if (wrapped.y < 0)
+	{
+		wrapped = glm::ivec2(sideLength - 1 - wrapped.x, -1 - wrapped.y);
+	}
+	else if (wrapped.y >= sideLength)
+	{
+		wrapped = glm::ivec2(sideLength - 1 - wrapped.x, 2 * sideLength - 1 - wrapped.y);
+	}
+	return wrapped;
+}
+
+glm::vec3 Renderer::CPU::GetProbeTexelDirection(const glm::ivec2& texel, const int32_t sideLength)
+{
+	const glm::vec2 octCoord = ((glm::vec2(WrapOctahedralTexel(texel, sideLength)) + 0.5f) / static_cast<float>(sideLength)) * 2.0f - 1.0f;
+	return Math::OctDecode(octCoord);
+}
+
+template<typename T>
+void CopyProbeTileBorderTexels(Renderer::CPU::Texture2D<T>& atlas, const glm::ivec2& probeTopLeft, const uint32_t singleProbeSideLength)
+{
+	const auto sideLength = static_cast<int32_t>(singleProbeSideLength);
+	const auto padding = static_cast<int32_t>(Renderer::PROBE_PADDING);
+	const auto copyTexel = [&](const int32_t x, const int32_t y)
+	{
+		const glm::ivec2 source = probeTopLeft + Renderer::CPU::WrapOctahedralTexel(glm::ivec2(x, y), sideLength);
+		atlas.Store(probeTopLeft.x + x, probeTopLeft.y + y, atlas.Load(source.x, source.y));
+	};
+
+	// Top and bottom padding rows across the full width, corners included
+	for (int32_t p = 0; p < padding; ++p)
+	{
+		for (int32_t x = -padding; x < sideLength + padding; ++x)
+		{
+			copyTexel(x, -padding + p);
+			copyTexel(x, sideLength + p);
+		}
+	}
+
+	// Left and right padding columns beside the square's rows
+	for (int32_t y = 0; y < sideLength; ++y)
+	{
+		for (int32_t p = 0; p < padding; ++p)
+		{
+			copyTexel(-padding + p, y);
+			copyTexel(sideLength + p, y);
+		}
+	}
+}
+
+// Sums the rays into every texel of the probe's square, each weighted by the weight of the cosine between the ray and the texel's direction, then
+// fills the borders. Rays facing away from a texel add nothing to it, and texels no ray faces take the fallback
+template<typename T, typename Weight, typename Value>
+void FilterProbeRayTexels(const glm::vec4* pRayData, const glm::vec3* pRayDirections, const uint32_t rayCount, Renderer::CPU::Texture2D<T>& output,
+	const glm::ivec2& probeTopLeft, const uint32_t singleProbeSideLength, const T& fallback, Weight&& weight, Value&& value)
+{
+	const auto sideLength = static_cast<int32_t>(singleProbeSideLength);
+	for (int32_t y = 0; y < sideLength; ++y)
+	{
+		for (int32_t x = 0; x < sideLength; ++x)
+		{
+			const glm::vec3 texelDirection = Renderer::CPU::GetProbeTexelDirection(glm::ivec2(x, y), sideLength);
+			T sum = T(0.0f);
+			float sumWeight = 0.0f;
+			for (uint32_t r = 0; r < rayCount; ++r)
+			{
+				const float cosine = glm::dot(texelDirection, pRayDirections[r]);
+				if (cosine > 0.0f)
+				{
+					const float rayWeight = weight(cosine);
+					sum += rayWeight * value(pRayData[r]);
+					sumWeight += rayWeight;
+				}
+			}
+			output.Store(probeTopLeft.x + x, probeTopLeft.y + y, sumWeight > 0.0f ? sum / sumWeight : fallback);
+		}
+	}
+
+	CopyProbeTileBorderTexels(output, probeTopLeft, singleProbeSideLength);
+}
+
+void Renderer::CPU::FilterProbeRays(const glm::vec4* pRayData, const glm::vec3* pRayDirections, const uint32_t rayCount, Texture2D<glm::vec3>& output,
+	const glm::ivec2& probeTopLeft, const uint32_t singleProbeSideLength)
+{
+	FilterProbeRayTexels(pRayData, pRayDirections, rayCount, output, probeTopLeft, singleProbeSideLength, glm::vec3(0.0f),
+		[](const float cosine) { return cosine; },
+		[](const glm::vec4& rayData) { return glm::vec3(rayData); });
+}
+
+void Renderer::CPU::FilterProbeRays(const glm::vec4* pRayData, const glm::vec3* pRayDirections, const uint32_t rayCount, Texture2D<glm::vec2>& output,
+	const glm::ivec2& probeTopLeft, const uint32_t singleProbeSideLength)
+{
+	FilterProbeRayTexels(pRayData, pRayDirections, rayCount, output, probeTopLeft, singleProbeSideLength,
+		glm::vec2(PROBE_MAX_RAY_DISTANCE, PROBE_MAX_RAY_DISTANCE * PROBE_MAX_RAY_DISTANCE),
+		[](const float cosine) { return std::pow(cosine, PROBE_VISIBILITY_SHARPNESS); },
+		[](const glm::vec4& rayData) { return glm::vec2(rayData.w, rayData.w * rayData.w); });
+}
+
+void Renderer::CPU::CopyProbeTileBorder(Texture2D<glm::vec3>& atlas, const glm::ivec2& probeTopLeft, const uint32_t singleProbeSideLength)
+{
+	CopyProbeTileBorderTexels(atlas, probeTopLeft, singleProbeSideLength);
+}
+
+void Renderer::CPU::CopyProbeTileBorder(Texture2D<glm::vec2>& atlas, const glm::ivec2& probeTopLeft, const uint32_t singleProbeSideLength)
+{
+	CopyProbeTileBorderTexels(atlas, probeTopLeft, singleProbeSideLength);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Texture2D.h"
+
+namespace Renderer
+{
+	namespace CPU
+	{
+		// CPU versions of the probe filter functions in Shaders/Common.hlsl
+		glm::ivec2 WrapOctahedralTexel(const glm::ivec2& texel, const int32_t sideLength);
+		glm::vec3 GetProbeTexelDirection(const glm::ivec2& texel, const int32_t sideLength);
+
+		// CPU reference of the ProbeFilter ray generation shader in Shaders/RayGen.hlsl for one probe. Filters the probe's rays, the radiance (rgb) and
+		// hit distance (a) of each of the ray count directions, into every texel of the probe's square of the output, then fills the square's borders.
+		// Irradiance texels take the radiance weighted by the cosine to the texel's direction, visibility texels the distance and square distance
+		// weighted by that cosine raised to PROBE_VISIBILITY_SHARPNESS, as FilterIrradianceTexel and FilterVisibilityTexel do. Any ray count filters
+		// into any side length. The top left is that of the probe's square inside its borders
+		void FilterProbeRays(const glm::vec4* pRayData, const glm::vec3* pRayDirections, const uint32_t rayCount, Texture2D<glm::vec3>& output,
+			const glm::ivec2& probeTopLeft, const uint32_t singleProbeSideLength);
+		void FilterProbeRays(const glm::vec4* pRayData, const glm::vec3* pRayDirections, const uint32_t rayCount, Texture2D<glm::vec2>& output,
+			const glm::ivec2& probeTopLeft, const uint32_t singleProbeSideLength);
+
+		// Copies the texels across the edges of a probe's octahedral square into the PROBE_PADDING texels of border around it
+		void CopyProbeTileBorder(Texture2D<glm::vec3>& atlas, const glm::ivec2& probeTopLeft, const uint32_t singleProbeSideLength);
+		void CopyProbeTileBorder(Texture2D<glm::vec2>& atlas, const glm::ivec2& probeTopLeft, const uint32_t singleProbeSideLength);
+	}
+}
@@ -0,0 +1,116 @@
+#include "CpuPch.h"
+#include "ProbeLookup.h"
+#include "Renderer/ProbePool.h"
+
+int32_t Renderer::CPU::FindProbeVolume(const std::vector<ProbeVolumeData>& volumeData, const glm::vec3& position)
+{
+	for (size_t i = 0; i < volumeData.size(); ++i)
+	{
+		const auto& volume = volumeData[i];
+		const glm::vec3 gridPosition = (position - glm::vec3(volume.GridOriginAndSpacing)) / volume.GridOriginAndSpacing.w;
+		const glm::vec3 gridMax = glm::vec3(glm::ivec3(volume.ProbeCounts) - 1);
+		if (gridPosition.x >= 0.0f && gridPosition.y >= 0.0f && gridPosition.z >= 0.0f &&
+			gridPosition.x <= gridMax.x && gridPosition.y <= gridMax.y && gridPosition.z <= gridMax.z)
+		{
+			return static_cast<int32_t>(i);
+		}
+	}
+	return static_cast<int32_t>(volumeData.size()) - 1;
+}
+
+uint32_t Renderer::CPU::GetPoolProbeIndex(const ProbeVolumeData& volume, const glm::ivec3& gridCoordinate)
+{
+	auto wrap = [](const int32_t coordinate, const int32_t count)
+	{
+		return ((coordinate % count) + count) % count;
+	};
+	const int32_t x = wrap(gridCoordinate.x + volume.ScrollOffset.x, volume.ProbeCounts.x);
+	const int32_t y = wrap(gridCoordinate.y + volume.ScrollOffset.y, volume.ProbeCounts.y);
+	const int32_t z = wrap(gridCoordinate.z + volume.ScrollOffset.z, volume.ProbeCounts.z);
+	return static_cast<uint32_t>(volume.ProbeCounts.w + x + volume.ProbeCounts.x * (y + volume.ProbeCounts.y * z));
+}
+
+void Renderer::CPU::GetProbeCage(const ProbeVolumeData& volume, const glm::vec3& position, glm::ivec3& baseCoordinate, glm::vec3& alpha)
+{
+	// Volumes one probe thick along an axis have a cage of one probe along it
+	const glm::vec3 gridPosition = (position - glm::vec3(volume.GridOriginAndSpacing)) / volume.GridOriginAndSpacing.w;
+	const glm::ivec3 maxBaseCoordinate = glm::max(glm::ivec3(volume.ProbeCounts) - 2, glm::ivec3(0));
+	baseCoordinate = glm::clamp(glm::ivec3(glm::floor(gridPosition)), glm::ivec3(0), maxBaseCoordinate);
+	alpha = glm::clamp(gridPosition - glm::vec3(baseCoordinate), glm::vec3(0.0f), glm::vec3(1.0f));
+}
+
+void Renderer::CPU::GetProbeCageIndices(const ProbeVolumeData& volume, const glm::vec3& position, std::array<uint32_t, 8>& probeIndices)
+{
+	glm::ivec3 baseCoordinate;
+	glm::vec3 alpha;
+	GetProbeCage(volume, position, baseCoordinate, alpha);
+	const glm::ivec3 maxCoordinate = glm::ivec3(volume.ProbeCounts) - 1;
+	for (int32_t i = 0; i < 8; ++i)
+	{
+		const glm::ivec3 corner = glm::min(baseCoordinate + glm::ivec3(i & 1, (i >> 1) & 1, i >> 2), maxCoordinate);
+		probeIndices[i] = GetPoolProbeIndex(volume, corner);
+	}
+}
+
+bool Renderer::CPU::ValidateProbePool(const ProbePool& pool, ProbePoolValidationStats& stats)
+{
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	stats = {};
+	stats.VolumeCount = pool.GetVolumeCount();
+	stats.ProbeCount = pool.GetTotalProbeCount();
+
+	std::vector<ProbeVolumeData> volumeData;
+	pool.GetVolumeData(volumeData);
+	if (volumeData.size() > MAX_PROBE_VOLUME_COUNT)
+	{
+		++stats.RangeErrorCount;
+	}
+
+	// Ranges must tile the pool in volume order
+	uint32_t expectedBaseProbeIndex = 0;
+	for (uint32_t v = 0; v < pool.GetVolumeCount(); ++v)
+	{
+		const auto& volume = pool.GetVolume(v);
+		const glm::ivec4 expectedProbeCounts(static_cast<int32_t>(volume.GetProbeCountX()), static_cast<int32_t>(volume.GetProbeCountY()),
+			static_cast<int32_t>(volume.GetProbeCountZ()), static_cast<int32_t>(expectedBaseProbeIndex));
+		if (pool.GetBaseProbeIndex(v) != expectedBaseProbeIndex || volumeData[v].ProbeCounts != expectedProbeCounts ||
+			volume.GetProbePositions().size() != volume.GetTotalProbeCount() || volume.GetProbeStates().size() != volume.GetTotalProbeCount())
+		{
+			++stats.RangeErrorCount;
+		}
+		expectedBaseProbeIndex += static_cast<uint32_t>(volume.GetTotalProbeCount());
+	}
+	if (expectedBaseProbeIndex != pool.GetTotalProbeCount())
+	{
+		++stats.RangeErrorCount;
+	}
+
+	// Each probe must be a corner of the cage around its own grid position, and the position must not fall to a volume looked up after its own.
+	// Volume bounds are tested a hundredth of a probe spacing in from the probe, towards the grid centre, as probes on the grid faces lie on the bounds
+	std::array<uint32_t, 8> cageIndices;
+	for (uint32_t v = 0; v < pool.GetVolumeCount(); ++v)
+	{
+		const auto& volume = pool.GetVolume(v);
+		const glm::vec3 gridCentre = volume.GetGridOrigin() +
+			(glm::vec3(glm::ivec3(volumeData[v].ProbeCounts) - 1) * (volume.GetProbeSpacing() * 0.5f));
+		for (uint32_t i = 0; i < static_cast<uint32_t>(volume.GetTotalProbeCount()); ++i)
+		{
+			const glm::vec3 gridPosition = volume.GetProbeGridPosition(i);
+			GetProbeCageIndices(volumeData[v], gridPosition, cageIndices);
+			if (std::find(cageIndices.begin(), cageIndices.end(), pool.GetBaseProbeIndex(v) + i) == cageIndices.end())
+			{
+				++stats.CageErrorCount;
+			}
+
+			const glm::vec3 toCentre = gridCentre - gridPosition;
+			const glm::vec3 insidePosition = gridPosition + glm::sign(toCentre) * (volume.GetProbeSpacing() * 0.01f);
+			if (FindProbeVolume(volumeData, insidePosition) > static_cast<int32_t>(v))
+			{
+				++stats.VolumeErrorCount;
+			}
+		}
+	}
+
+	stats.Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	return stats.GetErrorCount() == 0;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Renderer/GIConstants.h"
+
+namespace Renderer
+{
+	class ProbePool;
+
+	namespace CPU
+	{
+		// CPU reference of the probe volume lookup in Shaders/Common.hlsl. Finding the volume for a shading point tests at most
+		// MAX_PROBE_VOLUME_COUNT grids and finding its probes is arithmetic on the grid, so the cost does not grow with the probe count
+
+		// Index of the first volume whose probe grid contains the position, or the last volume when none do, so points outside every volume
+		// are lit by the clamped cage of the coarsest volume. Returns -1 without volumes
+		int32_t FindProbeVolume(const std::vector<ProbeVolumeData>& volumeData, const glm::vec3& position);
+		// Pool index of the probe at a grid coordinate counted from the volume's minimum corner, wrapped toroidally by the scroll offset
+		uint32_t GetPoolProbeIndex(const ProbeVolumeData& volume, const glm::ivec3& gridCoordinate);
+		// Grid coordinate of the minimum corner probe of the cell containing the position, clamped to the grid, and the position's offset from
+		// that probe in probe spacings, clamped to [0, 1]
+		void GetProbeCage(const ProbeVolumeData& volume, const glm::vec3& position, glm::ivec3& baseCoordinate, glm::vec3& alpha);
+		// Pool indices of the eight probes of the cell containing the position. Corner i is at the base coordinate plus (i & 1, (i >> 1) & 1, i >> 2)
+		void GetProbeCageIndices(const ProbeVolumeData& volume, const glm::vec3& position, std::array<uint32_t, 8>& probeIndices);
+
+		struct ProbePoolValidationStats
+		{
+			size_t VolumeCount = 0;
+			size_t ProbeCount = 0;
+			// Volumes whose probe range or shader data disagree with the volume
+			size_t RangeErrorCount = 0;
+			// Probes missing from the cage looked up at their own grid position
+			size_t CageErrorCount = 0;
+			// Probes whose grid position resolves to a later volume than their own
+			size_t VolumeErrorCount = 0;
+			double Milliseconds = 0.0;
+
+			size_t GetErrorCount() const { return RangeErrorCount + CageErrorCount + VolumeErrorCount; }
+		};
+
+		// Checks the pool's probe ranges and shader volume data against its volumes, then looks every probe up through the shader lookup from its
+		// grid position. Returns true if no errors were found
+		bool ValidateProbePool(const ProbePool& pool, ProbePoolValidationStats& stats);
+	}
+}
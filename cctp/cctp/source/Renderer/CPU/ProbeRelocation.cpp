@@ -0,0 +1,108 @@
+#include "CpuPch.h"
+#include "ProbeRelocation.h"
+#include "ProbeTracer.h"
+#include "RaytracingScene.h"
+#include "Renderer/GIConstants.h"
+#include "Renderer/ProbeVolume.h"
+#include "Threading/TaskScheduler.h"
+
+Renderer::CPU::ProbeRelocationStats Renderer::CPU::RelocateProbes(const RaytracingScene& scene, const ProbeVolume& volume, const std::vector<uint32_t>& probeIndices,
+	const ProbeRelocationSettings& settings, std::vector<glm::vec4>& relocationOffsets)
+{
+	assert(relocationOffsets.size() == volume.GetTotalProbeCount() && "Every probe must have a relocation offset.");
+
+	const auto startTime = std::chrono::high_resolution_clock::now();
+
+	const float spacing = volume.GetProbeSpacing();
+	const float minFrontfaceDistance = settings.MinFrontfaceDistance * spacing;
+	const float maxOffset = settings.MaxOffset * spacing;
+
+	// Probes are relocated with the directions they are traced with
+	RayPacket packet = {};
+	packet.TMax = spacing;
+	packet.RayCount = std::min(RayPacket::MaxRayCount, PROBE_RAY_COUNT);
+	for (uint32_t i = 0; i < packet.RayCount; ++i)
+	{
+		packet.Directions[i] = glm::normalize(SphericalFibonacci(static_cast<float>(i), static_cast<float>(packet.RayCount)));
+	}
+
+	std::atomic<size_t> relocatedProbeCount = 0;
+	auto& scheduler = (settings.pTaskScheduler != nullptr) ? *settings.pTaskScheduler : Threading::TaskScheduler::GetDefault();
+	scheduler.ParallelFor(probeIndices.size(), 16, [&](const size_t begin, const size_t end)
+		{
+			RayPacket probePacket = packet;
+			std::array<RayHit, RayPacket::MaxRayCount> hits;
+			size_t rangeRelocatedProbeCount = 0;
+			for (size_t i = begin; i < end; ++i)
+			{
+				const glm::vec3 gridPosition = volume.GetProbeGridPosition(probeIndices[i]);
+				glm::vec3 offset = glm::vec3(0.0f);
+				for (uint32_t iteration = 0; iteration < settings.IterationCount; ++iteration)
+				{
+					probePacket.Origin = gridPosition + offset;
+					scene.IntersectPacket(probePacket, hits.data(), false);
+
+					uint32_t backfaceCount = 0;
+					float closestBackfaceT = std::numeric_limits<float>::max();
+					float closestFrontfaceT = std::numeric_limits<float>::max();
+					glm::vec3 closestBackfaceDirection = glm::vec3(0.0f);
+					glm::vec3 closestFrontfaceDirection = glm::vec3(0.0f);
+					for (uint32_t r = 0; r < probePacket.RayCount; ++r)
+					{
+						if (!hits[r].IsHit())
+						{
+							continue;
+						}
+
+						if (glm::dot(scene.GetHitNormalWS(hits[r]), probePacket.Directions[r]) > 0.0f)
+						{
+							++backfaceCount;
+							if (hits[r].T < closestBackfaceT)
+							{
+								closestBackfaceT = hits[r].T;
+								closestBackfaceDirection = probePacket.Directions[r];
+							}
+						}
+						else if (hits[r].T < closestFrontfaceT)
+						{
+							closestFrontfaceT = hits[r].T;
+							closestFrontfaceDirection = probePacket.Directions[r];
+						}
+					}
+
+					// Move through the closest back face to the outside of the geometry, or away from a front face that is too close
+					glm::vec3 step = glm::vec3(0.0f);
+					if (static_cast<float>(backfaceCount) > settings.BackfaceRatioThreshold * static_cast<float>(probePacket.RayCount))
+					{
+						step = closestBackfaceDirection * (closestBackfaceT + minFrontfaceDistance);
+					}
+					else if (closestFrontfaceT < minFrontfaceDistance)
+					{
+						step = closestFrontfaceDirection * (closestFrontfaceT - minFrontfaceDistance);
+					}
+					else
+					{
+						break;
+					}
+
+					// Probes that would leave their cell stay where they are, the classification pass deactivates them if they are inside geometry
+					const glm::vec3 relocatedOffset = offset + step;
+					if (std::max({ std::abs(relocatedOffset.x), std::abs(relocatedOffset.y), std::abs(relocatedOffset.z) }) > maxOffset)
+					{
+						break;
+					}
+					offset = relocatedOffset;
+				}
+
+				relocationOffsets[probeIndices[i]] = glm::vec4(offset, 0.0f);
+				rangeRelocatedProbeCount += (offset != glm::vec3(0.0f)) ? 1 : 0;
+			}
+			relocatedProbeCount += rangeRelocatedProbeCount;
+		});
+
+	ProbeRelocationStats stats = {};
+	stats.ProbeCount = probeIndices.size();
+	stats.RelocatedProbeCount = relocatedProbeCount;
+	stats.Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	return stats;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+namespace Threading
+{
+	class TaskScheduler;
+}
+
+namespace Renderer
+{
+	class ProbeVolume;
+
+	namespace CPU
+	{
+		class RaytracingScene;
+
+		struct ProbeRelocationSettings
+		{
+			// Probes seeing back faces along more than this fraction of their rays are inside geometry and are moved out through the closest back face
+			float BackfaceRatioThreshold = 0.25f;
+			// Probes are moved until the closest front face is at least this fraction of the probe spacing away
+			float MinFrontfaceDistance = 0.2f;
+			// Offsets are kept within this fraction of the probe spacing along each axis so probes stay inside their grid cell
+			float MaxOffset = 0.45f;
+			// Each iteration traces from the probe's relocated position and moves it further if needed
+			uint32_t IterationCount = 3;
+			// Scheduler the probes are spread across. Null uses the default scheduler with a thread per hardware thread
+			Threading::TaskScheduler* pTaskScheduler = nullptr;
+		};
+
+		struct ProbeRelocationStats
+		{
+			size_t ProbeCount = 0;
+			size_t RelocatedProbeCount = 0;
+			double Milliseconds = 0.0;
+		};
+
+		// Writes the relocation offset of each listed probe into relocationOffsets, computed from the closest front and back face hits of the probe ray
+		// directions traced from its grid position. Rays reach one probe spacing, so only geometry within a spacing of a probe's relocated position,
+		// and so within two spacings of its grid position, affects its offset
+		ProbeRelocationStats RelocateProbes(const RaytracingScene& scene, const ProbeVolume& volume, const std::vector<uint32_t>& probeIndices,
+			const ProbeRelocationSettings& settings, std::vector<glm::vec4>& relocationOffsets);
+	}
+}
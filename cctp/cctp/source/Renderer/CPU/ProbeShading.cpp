@@ -0,0 +1,125 @@
+#include "CpuPch.h"
+#include "ProbeShading.h"
+#include "ProbeLookup.h"
+#include "ProbeTracer.h"
+#include "Renderer/ProbeVolume.h"
+#include "Math/SphericalHarmonics.h"
+
+float ProbeShadingSquare(const float x)
+{
+	return x * x;
+}
+
+glm::vec3 Renderer::CPU::Irradiance(const ProbeShadingInputs& inputs, const glm::vec3& shadingPoint, const glm::vec3& shadingPointNormal)
+{
+	const glm::vec3 normal = glm::normalize(shadingPointNormal);
+	glm::vec3 sumIrradiance = glm::vec3(0.0f, 0.0f, 0.0f);
+	float sumWeight = 0.0f;
+
+	// Light the point from the first volume containing it, or the coarsest volume when none do
+	const int32_t volumeIndex = FindProbeVolume(*inputs.pVolumeData, shadingPoint);
+	if (volumeIndex < 0)
+	{
+		return sumIrradiance;
+	}
+	const ProbeVolumeData& volume = (*inputs.pVolumeData)[volumeIndex];
+
+	const Texture2D<glm::vec3>& irradianceAtlas = *inputs.pIrradianceAtlas;
+	const Texture2D<glm::vec2>& visibilityAtlas = *inputs.pVisibilityAtlas;
+	const uint32_t atlasProbeCapacity = inputs.pAtlasLayout->GetProbeCapacity();
+	const uint32_t probesPerRow = inputs.pAtlasLayout->GetProbesPerRow();
+	const glm::vec2 irradianceAtlasDimensions = glm::vec2(inputs.pAtlasLayout->GetIrradianceAtlasDimensions());
+	const glm::vec2 visibilityAtlasDimensions = glm::vec2(inputs.pAtlasLayout->GetVisibilityAtlasDimensions());
+
+	// Visibility is tested from a point pushed off the surface, so the surface the probes' rays hit around the point does not occlude it
+	const glm::vec3 visibilityPoint = shadingPoint + normal * (volume.GridOriginAndSpacing.w * PROBE_VISIBILITY_NORMAL_BIAS);
+
+	// Spherical harmonic probes are all evaluated in the direction of the normal, so its basis functions are shared by the cage
+	const uint32_t shCoefficientCount = GetProbeShCoefficientCount(static_cast<ProbeEncoding>(volume.ScrollOffset.w));
+	float normalBasis[PROBE_SH_MAX_COEFFICIENT_COUNT];
+	if (shCoefficientCount > 0)
+	{
+		Math::EvaluateShBasis(normal, shCoefficientCount, normalBasis);
+	}
+
+	// Blend the eight probes at the corners of the grid cell around the point
+	glm::ivec3 baseCoordinate;
+	glm::vec3 alpha;
+	GetProbeCage(volume, shadingPoint, baseCoordinate, alpha);
+	for (int32_t c = 0; c < 8; ++c)
+	{
+		const glm::ivec3 offset = glm::ivec3(c & 1, (c >> 1) & 1, c >> 2);
+		const glm::ivec3 corner = glm::min(baseCoordinate + offset, glm::ivec3(volume.ProbeCounts) - 1);
+		const uint32_t i = GetPoolProbeIndex(volume, corner);
+
+		// Inactive probes and probes past the atlas capacity hold no traced data
+		if (i >= atlasProbeCapacity || (*inputs.pProbeStates)[i] != static_cast<uint32_t>(ProbeState::Active))
+		{
+			continue;
+		}
+
+		const glm::vec3 pointToProbe = glm::vec3((*inputs.pProbePositions)[i]) - shadingPoint;
+		const glm::vec3 direction = pointToProbe / std::max(glm::length(pointToProbe), 0.0001f);
+		const glm::vec3 visibilityPointToProbe = glm::vec3((*inputs.pProbePositions)[i]) - visibilityPoint;
+		const float visibilityDistance = glm::length(visibilityPointToProbe);
+		const glm::vec3 visibilityDirection = visibilityPointToProbe / std::max(visibilityDistance, 0.0001f);
+
+		// Trilinear weight of the corner from the point's position in the cell
+		const glm::vec3 trilinear = glm::mix(1.0f - alpha, alpha, glm::vec3(offset));
+		float weight = trilinear.x * trilinear.y * trilinear.z;
+		weight *= ProbeNormalWeight(direction, normal);
+
+		if (shCoefficientCount > 0)
+		{
+			// Ringing can take either function below zero
+			const float* pCoefficients = inputs.pShCoefficients->data() + static_cast<size_t>(i) * PROBE_SH_MAX_COEFFICIENT_COUNT * PROBE_SH_CHANNEL_COUNT;
+			const glm::vec2 moments = glm::vec2(
+				Math::EvaluateSh(pCoefficients, shCoefficientCount, PROBE_SH_CHANNEL_COUNT, 3, -visibilityDirection),
+				Math::EvaluateSh(pCoefficients, shCoefficientCount, PROBE_SH_CHANNEL_COUNT, 4, -visibilityDirection));
+			weight *= ProbeVisibilityWeight(glm::max(moments, glm::vec2(0.0f)), visibilityDistance);
+
+			glm::vec3 probeIrradiance;
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				probeIrradiance[k] = std::max(Math::EvaluateShWithBasis(pCoefficients, normalBasis, shCoefficientCount, PROBE_SH_CHANNEL_COUNT, k), 0.0f);
+			}
+
+			sumIrradiance += weight * probeIrradiance;
+			sumWeight += weight;
+			continue;
+		}
+
+		// Visibility is read in the direction from the probe to the point. Moments are linear, so they are filtered like irradiance
+		const glm::vec2 visibilityTexelIndex = GetProbeTexelCoordinate(-visibilityDirection, i, probesPerRow, static_cast<float>(VISIBILITY_PROBE_SIDE_LENGTH), PROBE_PADDING);
+		weight *= ProbeVisibilityWeight(visibilityAtlas.SampleLinear(visibilityTexelIndex / visibilityAtlasDimensions), visibilityDistance);
+
+		// Every probe is sampled in the direction of the surface normal, so the blend is over the same direction of each probe
+		const glm::vec2 irradianceTexelIndex = GetProbeTexelCoordinate(normal, i, probesPerRow, static_cast<float>(IRRADIANCE_PROBE_SIDE_LENGTH), PROBE_PADDING);
+		const glm::vec3 probeIrradiance = irradianceAtlas.SampleLinear(irradianceTexelIndex / irradianceAtlasDimensions);
+
+		sumIrradiance += weight * probeIrradiance;
+		sumWeight += weight;
+	}
+
+	// Normalize so probes skipped as inactive or occluded do not darken the point
+	return sumWeight > 0.0f ? sumIrradiance / sumWeight : sumIrradiance;
+}
+
+float Renderer::CPU::ProbeNormalWeight(const glm::vec3& direction, const glm::vec3& shadingPointNormal)
+{
+	return ProbeShadingSquare((glm::dot(direction, shadingPointNormal) + 1.0f) * 0.5f) + 0.2f;
+}
+
+float Renderer::CPU::ProbeVisibilityWeight(const glm::vec2& moments, const float distance)
+{
+	// Rays never see past the max distance, so farther points are tested at it, and probes not traced yet hold zero
+	const float testDistance = std::min(distance, PROBE_MAX_RAY_DISTANCE);
+	if (moments.x <= 0.0f || testDistance <= moments.x)
+	{
+		return 1.0f;
+	}
+	const float variance = std::max(moments.y - ProbeShadingSquare(moments.x), PROBE_MIN_VISIBILITY_VARIANCE);
+	const float chebyshev = variance / (variance + ProbeShadingSquare(testDistance - moments.x));
+	// The bound is loose, so cubing it darkens the tail that would otherwise leak light through thin walls
+	return chebyshev * chebyshev * chebyshev;
+}
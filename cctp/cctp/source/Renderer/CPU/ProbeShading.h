@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Texture2D.h"
+#include "Renderer/GIConstants.h"
+#include "Renderer/ProbeAtlasLayout.h"
+
+namespace Renderer
+{
+	namespace CPU
+	{
+		// Probe field data read by Irradiance() in Shaders/PixelShader.hlsl
+		struct ProbeShadingInputs
+		{
+			// Volume grids in lookup order, as written by ProbePool::GetVolumeData
+			const std::vector<ProbeVolumeData>* pVolumeData = nullptr;
+			// Positions and states of every probe in the pool, indexed by pool index
+			const std::vector<glm::vec4>* pProbePositions = nullptr;
+			const std::vector<uint32_t>* pProbeStates = nullptr;
+			// Atlases laid out as the GPU output textures. Probes past the capacity of the layout are skipped as the shader skips them
+			const ProbeAtlasLayout* pAtlasLayout = nullptr;
+			const Texture2D<glm::vec3>* pIrradianceAtlas = nullptr;
+			const Texture2D<glm::vec2>* pVisibilityAtlas = nullptr;
+			// Coefficients of the probes of spherical harmonic volumes, laid out as ProbeTracer::GetProbeShCoefficients. Unused by octahedral volumes
+			const std::vector<float>* pShCoefficients = nullptr;
+		};
+
+		// CPU reference of Irradiance() in Shaders/PixelShader.hlsl. Blends the eight probes at the corners of the grid cell around the point
+		// with trilinear, normal and visibility weights, so the cost per point does not grow with the probe count. Probes are read from the atlases
+		// or from their spherical harmonic coefficients by the encoding of the volume lighting the point
+		glm::vec3 Irradiance(const ProbeShadingInputs& inputs, const glm::vec3& shadingPoint, const glm::vec3& shadingPointNormal);
+		// CPU versions of the probe weight functions in Shaders/PixelShader.hlsl. The visibility weight takes the mean (x) and mean square (y)
+		// hit distance of the probe towards the point and bounds how likely the probe sees as far as the point with Chebyshev's inequality
+		float ProbeNormalWeight(const glm::vec3& direction, const glm::vec3& shadingPointNormal);
+		float ProbeVisibilityWeight(const glm::vec2& moments, const float distance);
+	}
+}
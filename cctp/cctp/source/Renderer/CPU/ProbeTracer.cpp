@@ -0,0 +1,596 @@
+#include "CpuPch.h"
+#include "ProbeTracer.h"
+#include "RaytracingScene.h"
+#include "Math/Octahedral.h"
+#include "Math/PackedFloat.h"
+#include "Math/SphericalHarmonics.h"
+#include "Renderer/GIConstants.h"
+#include "Renderer/ProbeVolume.h"
+#include "Renderer/ProbeRayTable.h"
+#include "Renderer/BakedProbeFile.h"
+#include "ProbeFilter.h"
+#include "Threading/TaskScheduler.h"
+
+// Matches the PI define in Shaders/Common.hlsl
+constexpr float SHADER_PI = 3.14159274f;
+// Match the defines in Shaders/RayGen.hlsl
+constexpr float PROBE_CHANGE_LUMINANCE_FLOOR = 0.01f;
+constexpr float PROBE_MAX_SAMPLE_COUNT = 1024.0f;
+// Floats of a probe's spherical harmonic coefficients
+constexpr size_t PROBE_SH_FLOAT_COUNT = Renderer::PROBE_SH_MAX_COEFFICIENT_COUNT * Renderer::PROBE_SH_CHANNEL_COUNT;
+// Probes handed to a task at a time. Each probe traces, filters or blends hundreds of texels or rays, so small ranges still outweigh the task cost
+constexpr size_t PROBE_TRACE_RANGE_SIZE = 4;
+
+glm::vec4 Renderer::CPU::ShadeProbeRay(const RaytracingScene& scene, const glm::vec3& origin, const glm::vec3& direction, const RayHit& hit,
+	const glm::vec3& lightVectorWS, const float lightIntensity)
+{
+	if (!hit.IsHit())
+	{
+		// Miss
+		return glm::vec4(0.0f, 0.0f, 0.0f, PROBE_MAX_RAY_DISTANCE);
+	}
+
+	const glm::vec3 hitPointWS = origin + (direction * hit.T);
+	const glm::vec3 normalWS = scene.GetHitNormalWS(hit);
+
+	// Trace towards the light in place of the shadow map lookup
+	Ray shadowRay = {};
+	shadowRay.Origin = hitPointWS + (normalWS * SHADOW_BIAS);
+	shadowRay.Direction = lightVectorWS;
+	const float shadow = scene.Occluded(shadowRay) ? 0.0f : 1.0f;
+
+	return glm::vec4(scene.GetInstanceAlbedo(hit.InstanceID) * Lighting(normalWS, lightVectorWS, shadow, lightIntensity), hit.T);
+}
+
+glm::vec4 Renderer::CPU::TraceProbeRay(const RaytracingScene& scene, const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& lightVectorWS,
+	const float lightIntensity)
+{
+	Ray ray = {};
+	ray.Origin = origin;
+	ray.Direction = direction;
+	ray.TMax = PROBE_MAX_RAY_DISTANCE;
+	RayHit hit;
+	scene.Intersect(ray, hit, true);
+	return ShadeProbeRay(scene, origin, direction, hit, lightVectorWS, lightIntensity);
+}
+
+void Renderer::CPU::TraceProbeReference(const RaytracingScene& scene, const glm::vec3& origin, const uint32_t rayCount, const glm::vec3& lightVectorWS,
+	const float lightIntensity, std::vector<glm::vec3>& rayDirections, std::vector<glm::vec4>& rayData)
+{
+	rayDirections.resize(rayCount);
+	rayData.resize(rayCount);
+	for (uint32_t r = 0; r < rayCount; ++r)
+	{
+		rayDirections[r] = glm::normalize(SphericalFibonacci(static_cast<float>(r), static_cast<float>(rayCount)));
+		rayData[r] = TraceProbeRay(scene, origin, rayDirections[r], lightVectorWS, lightIntensity);
+	}
+}
+
+glm::vec3 Renderer::CPU::IntegrateProbeIrradiance(const glm::vec4* pRayData, const glm::vec3* pRayDirections, const uint32_t rayCount, const glm::vec3& normal)
+{
+	glm::vec3 sumRadiance = glm::vec3(0.0f);
+	float sumWeight = 0.0f;
+	for (uint32_t r = 0; r < rayCount; ++r)
+	{
+		const float weight = std::max(glm::dot(normal, pRayDirections[r]), 0.0f);
+		sumRadiance += glm::vec3(pRayData[r]) * weight;
+		sumWeight += weight;
+	}
+	return (sumWeight > 0.0f) ? (sumRadiance / sumWeight) : glm::vec3(0.0f);
+}
+
+// Port of BlendProbeOutput in Shaders/RayGen.hlsl. Blends the probe's whole tile, borders included. Returns the probe's statistics after the blend
+Renderer::ProbeStatistics BlendProbeOutput(const Renderer::CPU::Texture2D<glm::vec3>& irradianceOutput, const Renderer::CPU::Texture2D<glm::vec2>& visibilityOutput,
+	Renderer::CPU::Texture2D<glm::vec3>& irradianceAtlas, Renderer::CPU::Texture2D<glm::vec2>& visibilityAtlas, const uint32_t p, const uint32_t probesPerRow,
+	const glm::vec3& origin, Renderer::ProbeStatistics statistics, const Renderer::ProbeBlendSettings& settings)
+{
+	const glm::vec2 irradianceTopLeft = Renderer::CPU::GetProbeTopLeftPosition(p, probesPerRow, static_cast<float>(Renderer::IRRADIANCE_PROBE_SIDE_LENGTH), Renderer::PROBE_PADDING) -
+		static_cast<float>(Renderer::PROBE_PADDING);
+	const glm::vec2 visibilityTopLeft = Renderer::CPU::GetProbeTopLeftPosition(p, probesPerRow, static_cast<float>(Renderer::VISIBILITY_PROBE_SIDE_LENGTH), Renderer::PROBE_PADDING) -
+		static_cast<float>(Renderer::PROBE_PADDING);
+	const auto irradianceTileSideLength = static_cast<int32_t>(Renderer::IRRADIANCE_PROBE_SIDE_LENGTH + 2 * Renderer::PROBE_PADDING);
+	const auto visibilityTileSideLength = static_cast<int32_t>(Renderer::VISIBILITY_PROBE_SIDE_LENGTH + 2 * Renderer::PROBE_PADDING);
+
+	float sampleCount = statistics.Position == origin ? statistics.SampleCount : 0.0f;
+
+	// Measure the output against the history, as the relative change in irradiance luminance and in visibility distance
+	float sumLuminance = 0.0f;
+	float sumLuminanceChange = 0.0f;
+	float sumAbsoluteLuminanceChange = 0.0f;
+	float sumSquareLuminanceChange = 0.0f;
+	for (int32_t y = 0; y < irradianceTileSideLength; ++y)
+	{
+		for (int32_t x = 0; x < irradianceTileSideLength; ++x)
+		{
+			const glm::vec2 texel = irradianceTopLeft + glm::vec2(static_cast<float>(x), static_cast<float>(y));
+			const float luminance = Renderer::CPU::Luminance(irradianceOutput.Load(texel));
+			const float previousLuminance = Renderer::CPU::Luminance(irradianceAtlas.Load(texel));
+			sumLuminance += std::max(luminance, previousLuminance);
+			sumLuminanceChange += luminance - previousLuminance;
+			sumAbsoluteLuminanceChange += std::abs(luminance - previousLuminance);
+			sumSquareLuminanceChange += (luminance - previousLuminance) * (luminance - previousLuminance);
+		}
+	}
+
+	float sumDistanceChange = 0.0f;
+	for (int32_t y = 0; y < visibilityTileSideLength; ++y)
+	{
+		for (int32_t x = 0; x < visibilityTileSideLength; ++x)
+		{
+			const glm::vec2 texel = visibilityTopLeft + glm::vec2(static_cast<float>(x), static_cast<float>(y));
+			sumDistanceChange += std::abs(visibilityOutput.Load(texel).x - visibilityAtlas.Load(texel).x) / Renderer::PROBE_MAX_RAY_DISTANCE;
+		}
+	}
+
+	const auto irradianceTexelCount = static_cast<float>(irradianceTileSideLength * irradianceTileSideLength);
+	const float irradianceChange = sumAbsoluteLuminanceChange / std::max(sumLuminance, PROBE_CHANGE_LUMINANCE_FLOOR * irradianceTexelCount);
+	const float change = std::max(irradianceChange, sumDistanceChange / static_cast<float>(visibilityTileSideLength * visibilityTileSideLength));
+	if (change > settings.ChangeThreshold)
+	{
+		sampleCount = 0.0f;
+	}
+	const float hysteresis = std::min(settings.Hysteresis, sampleCount / (sampleCount + 1.0f)) *
+		std::clamp(2.0f - (2.0f * change / settings.ChangeThreshold), 0.0f, 1.0f);
+
+	sumLuminance = 0.0f;
+	for (int32_t y = 0; y < irradianceTileSideLength; ++y)
+	{
+		for (int32_t x = 0; x < irradianceTileSideLength; ++x)
+		{
+			const glm::vec2 texel = irradianceTopLeft + glm::vec2(static_cast<float>(x), static_cast<float>(y));
+			const glm::vec3 irradiance = glm::mix(irradianceOutput.Load(texel), irradianceAtlas.Load(texel), hysteresis);
+			irradianceAtlas.Store(texel, irradiance);
+			sumLuminance += Renderer::CPU::Luminance(irradiance);
+		}
+	}
+
+	for (int32_t y = 0; y < visibilityTileSideLength; ++y)
+	{
+		for (int32_t x = 0; x < visibilityTileSideLength; ++x)
+		{
+			const glm::vec2 texel = visibilityTopLeft + glm::vec2(static_cast<float>(x), static_cast<float>(y));
+			visibilityAtlas.Store(texel, glm::mix(visibilityOutput.Load(texel), visibilityAtlas.Load(texel), hysteresis));
+		}
+	}
+
+	const float meanLuminanceChange = sumLuminanceChange / irradianceTexelCount;
+	statistics.Position = origin;
+	statistics.SampleCount = std::min(sampleCount + 1.0f, PROBE_MAX_SAMPLE_COUNT);
+	statistics.Change = change;
+	statistics.LuminanceVariance = std::max((sumSquareLuminanceChange / irradianceTexelCount) - (meanLuminanceChange * meanLuminanceChange), 0.0f);
+	statistics.MeanLuminance = sumLuminance / irradianceTexelCount;
+	statistics.Hysteresis = hysteresis;
+	return statistics;
+}
+
+// Port of BlendProbeSh in Shaders/RayGen.hlsl. Measures the change of a spherical harmonic probe as BlendProbeOutput does, with the gather and history
+// evaluated in the directions of the probe's rays in place of texels. Returns the probe's statistics after the blend
+Renderer::ProbeStatistics BlendProbeSh(const float* pGather, float* pCoefficients, const uint32_t coefficientCount, const glm::vec3* pRayDirections,
+	const glm::vec3& origin, Renderer::ProbeStatistics statistics, const Renderer::ProbeBlendSettings& settings)
+{
+	constexpr uint32_t rayCount = Renderer::PROBE_RAY_COUNT;
+	float sampleCount = statistics.Position == origin ? statistics.SampleCount : 0.0f;
+
+	std::array<float, Renderer::PROBE_SH_CHANNEL_COUNT * rayCount> values;
+	std::array<float, Renderer::PROBE_SH_CHANNEL_COUNT * rayCount> previousValues;
+	Math::EvaluateSh(pGather, coefficientCount, Renderer::PROBE_SH_CHANNEL_COUNT, pRayDirections, rayCount, values.data());
+	Math::EvaluateSh(pCoefficients, coefficientCount, Renderer::PROBE_SH_CHANNEL_COUNT, pRayDirections, rayCount, previousValues.data());
+
+	std::array<float, rayCount> luminances;
+	std::array<float, rayCount> previousLuminances;
+	float sumLuminance = 0.0f;
+	float sumLuminanceChange = 0.0f;
+	float sumAbsoluteLuminanceChange = 0.0f;
+	float sumSquareLuminanceChange = 0.0f;
+	float sumDistanceChange = 0.0f;
+	for (uint32_t r = 0; r < rayCount; ++r)
+	{
+		luminances[r] = Renderer::CPU::Luminance(glm::vec3(values[r], values[rayCount + r], values[2 * rayCount + r]));
+		previousLuminances[r] = Renderer::CPU::Luminance(glm::vec3(previousValues[r], previousValues[rayCount + r], previousValues[2 * rayCount + r]));
+		const float luminanceChange = luminances[r] - previousLuminances[r];
+		sumLuminance += std::max(luminances[r], previousLuminances[r]);
+		sumLuminanceChange += luminanceChange;
+		sumAbsoluteLuminanceChange += std::abs(luminanceChange);
+		sumSquareLuminanceChange += luminanceChange * luminanceChange;
+		sumDistanceChange += std::abs(values[3 * rayCount + r] - previousValues[3 * rayCount + r]) / Renderer::PROBE_MAX_RAY_DISTANCE;
+	}
+
+	const auto directionCount = static_cast<float>(rayCount);
+	const float irradianceChange = sumAbsoluteLuminanceChange / std::max(sumLuminance, PROBE_CHANGE_LUMINANCE_FLOOR * directionCount);
+	const float change = std::max(irradianceChange, sumDistanceChange / directionCount);
+	if (change > settings.ChangeThreshold)
+	{
+		sampleCount = 0.0f;
+	}
+	const float hysteresis = std::min(settings.Hysteresis, sampleCount / (sampleCount + 1.0f)) *
+		std::clamp(2.0f - (2.0f * change / settings.ChangeThreshold), 0.0f, 1.0f);
+
+	for (uint32_t j = 0; j < coefficientCount * Renderer::PROBE_SH_CHANNEL_COUNT; ++j)
+	{
+		pCoefficients[j] = glm::mix(pGather[j], pCoefficients[j], hysteresis);
+	}
+
+	// Evaluation is linear in the coefficients, so the blended luminance is the blend of the luminances
+	sumLuminance = 0.0f;
+	for (uint32_t r = 0; r < rayCount; ++r)
+	{
+		sumLuminance += glm::mix(luminances[r], previousLuminances[r], hysteresis);
+	}
+
+	const float meanLuminanceChange = sumLuminanceChange / directionCount;
+	statistics.Position = origin;
+	statistics.SampleCount = std::min(sampleCount + 1.0f, PROBE_MAX_SAMPLE_COUNT);
+	statistics.Change = change;
+	statistics.LuminanceVariance = std::max((sumSquareLuminanceChange / directionCount) - (meanLuminanceChange * meanLuminanceChange), 0.0f);
+	statistics.MeanLuminance = sumLuminance / directionCount;
+	statistics.Hysteresis = hysteresis;
+	return statistics;
+}
+
+// Zeroes a probe's tile of the output, its square and the border around it
+template<typename T>
+void ClearProbeOutput(Renderer::CPU::Texture2D<T>& output, const glm::vec2& probeTopLeft, const uint32_t singleProbeSideLength)
+{
+	const auto left = static_cast<int32_t>(probeTopLeft.x) - static_cast<int32_t>(Renderer::PROBE_PADDING);
+	const auto top = static_cast<int32_t>(probeTopLeft.y) - static_cast<int32_t>(Renderer::PROBE_PADDING);
+	const auto sideLength = static_cast<int32_t>(singleProbeSideLength + 2 * Renderer::PROBE_PADDING);
+
+	for (int32_t y = top; y < top + sideLength; ++y)
+	{
+		for (int32_t x = left; x < left + sideLength; ++x)
+		{
+			output.Store(x, y, T(0.0f));
+		}
+	}
+}
+
+// Packs the texels of a probe's tile, border included, into a baked atlas with rows rowPitch bytes apart, or unpacks them back. Tiles lie within the
+// atlases, so rows are converted in batches. Top lefts are those of the probe's square inside the border
+template<typename T, typename Pack>
+void PackBakedProbeTile(const Renderer::CPU::Texture2D<T>& atlas, const glm::vec2& probeTopLeft, const uint32_t singleProbeSideLength, uint8_t* pBakedAtlas,
+	const glm::vec2& bakedProbeTopLeft, const uint32_t rowPitch, Pack&& pack)
+{
+	const uint32_t sideLength = singleProbeSideLength + 2 * Renderer::PROBE_PADDING;
+	const glm::uvec2 tileTopLeft = glm::uvec2(probeTopLeft) - Renderer::PROBE_PADDING;
+	const glm::uvec2 bakedTileTopLeft = glm::uvec2(bakedProbeTopLeft) - Renderer::PROBE_PADDING;
+	for (uint32_t y = 0; y < sideLength; ++y)
+	{
+		auto* pRow = reinterpret_cast<uint32_t*>(pBakedAtlas + (static_cast<size_t>(bakedTileTopLeft.y) + y) * rowPitch) + static_cast<size_t>(bakedTileTopLeft.x);
+		pack(atlas.GetData() + (static_cast<size_t>(tileTopLeft.y) + y) * atlas.GetWidth() + static_cast<size_t>(tileTopLeft.x), sideLength, pRow);
+	}
+}
+
+template<typename T, typename Unpack>
+void UnpackBakedProbeTile(const uint8_t* pBakedAtlas, const glm::vec2& bakedProbeTopLeft, const uint32_t rowPitch, const uint32_t singleProbeSideLength,
+	Renderer::CPU::Texture2D<T>& atlas, const glm::vec2& probeTopLeft, Unpack&& unpack)
+{
+	const uint32_t sideLength = singleProbeSideLength + 2 * Renderer::PROBE_PADDING;
+	const glm::uvec2 tileTopLeft = glm::uvec2(probeTopLeft) - Renderer::PROBE_PADDING;
+	const glm::uvec2 bakedTileTopLeft = glm::uvec2(bakedProbeTopLeft) - Renderer::PROBE_PADDING;
+	for (uint32_t y = 0; y < sideLength; ++y)
+	{
+		const auto* pRow = reinterpret_cast<const uint32_t*>(pBakedAtlas + (static_cast<size_t>(bakedTileTopLeft.y) + y) * rowPitch) +
+			static_cast<size_t>(bakedTileTopLeft.x);
+		unpack(pRow, sideLength, atlas.GetData() + (static_cast<size_t>(tileTopLeft.y) + y) * atlas.GetWidth() + static_cast<size_t>(tileTopLeft.x));
+	}
+}
+
+// Writes a portable float map. Two channel images store zero in the blue channel
+template<typename T>
+bool SavePFM(const std::filesystem::path& path, const Renderer::CPU::Texture2D<T>& texture, const uint32_t channelCount)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	file << "PF\n" << texture.GetWidth() << " " << texture.GetHeight() << "\n-1.0\n";
+
+	// Rows are stored bottom to top. Channels past the texel's own are zero
+	const uint32_t storedChannelCount = std::min(channelCount, static_cast<uint32_t>(sizeof(T) / sizeof(float)));
+	std::vector<float> row(static_cast<size_t>(texture.GetWidth()) * 3, 0.0f);
+	for (int32_t y = static_cast<int32_t>(texture.GetHeight()) - 1; y >= 0; --y)
+	{
+		for (uint32_t x = 0; x < texture.GetWidth(); ++x)
+		{
+			const T texel = texture.Load(static_cast<int32_t>(x), y);
+			for (uint32_t c = 0; c < storedChannelCount; ++c)
+			{
+				row[x * 3 + c] = texel[c];
+			}
+		}
+		file.write(reinterpret_cast<const char*>(row.data()), row.size() * sizeof(float));
+	}
+
+	return file.good();
+}
+
+void Renderer::CPU::ProbeTracer::ReserveAtlases(const size_t probeCount, const glm::ivec3& gridProbeCounts)
+{
+	if (IrradianceAtlas.GetTexelCount() > 0 && probeCount <= AtlasLayout.GetProbeCapacity())
+	{
+		return;
+	}
+
+	AtlasLayout = ProbeAtlasLayout(probeCount, gridProbeCounts);
+	const glm::uvec2 irradianceDimensions = AtlasLayout.GetIrradianceAtlasDimensions();
+	const glm::uvec2 visibilityDimensions = AtlasLayout.GetVisibilityAtlasDimensions();
+	IrradianceAtlas = Texture2D<glm::vec3>(irradianceDimensions.x, irradianceDimensions.y);
+	VisibilityAtlas = Texture2D<glm::vec2>(visibilityDimensions.x, visibilityDimensions.y);
+	IrradianceFiltered = Texture2D<glm::vec3>(irradianceDimensions.x, irradianceDimensions.y);
+	VisibilityFiltered = Texture2D<glm::vec2>(visibilityDimensions.x, visibilityDimensions.y);
+	Statistics.assign(AtlasLayout.GetProbeCapacity(), ProbeStatistics());
+	ShCoefficients.assign(AtlasLayout.GetProbeCapacity() * PROBE_SH_FLOAT_COUNT, 0.0f);
+	RayData.assign(AtlasLayout.GetProbeCapacity() * PROBE_RAY_COUNT, glm::vec4(0.0f));
+}
+
+Renderer::CPU::ProbeTraceStats Renderer::CPU::ProbeTracer::TraceProbes(const RaytracingScene& scene, const std::vector<glm::vec4>& probePositions,
+	const ProbeTraceSettings& settings)
+{
+	std::vector<uint32_t> probeIndices(probePositions.size());
+	std::iota(probeIndices.begin(), probeIndices.end(), 0);
+	return TraceProbes(scene, probePositions, probeIndices, settings);
+}
+
+Renderer::CPU::ProbeTraceStats Renderer::CPU::ProbeTracer::TraceProbes(const RaytracingScene& scene, const std::vector<glm::vec4>& probePositions,
+	const std::vector<uint32_t>& probeIndices, const ProbeTraceSettings& settings)
+{
+	assert((settings.pProbeStates == nullptr || settings.pProbeStates->size() == probePositions.size()) && "Every probe must have a state.");
+
+	// Skip inactive probes
+	std::vector<uint32_t> activeProbeIndices;
+	activeProbeIndices.reserve(probeIndices.size());
+	for (const uint32_t p : probeIndices)
+	{
+		if (settings.pProbeStates == nullptr || (*settings.pProbeStates)[p] == static_cast<uint32_t>(ProbeState::Active))
+		{
+			activeProbeIndices.push_back(p);
+		}
+	}
+
+	ReserveAtlases(probePositions.size());
+	const uint32_t probesPerRow = AtlasLayout.GetProbesPerRow();
+
+	ProbeTraceStats stats = {};
+	stats.ProbeCount = activeProbeIndices.size();
+	stats.RayCount = activeProbeIndices.size() * PROBE_RAY_COUNT;
+	stats.SkippedProbeCount = probeIndices.size() - activeProbeIndices.size();
+	stats.SkippedRayCount = stats.SkippedProbeCount * PROBE_RAY_COUNT;
+	auto& scheduler = (settings.pTaskScheduler != nullptr) ? *settings.pTaskScheduler : Threading::TaskScheduler::GetDefault();
+	stats.ThreadCount = scheduler.GetThreadCount();
+
+	const glm::vec3 lightVectorWS = -glm::normalize(settings.LightDirectionWS);
+	const ProbeRayTable& rayTable = GetProbeRayTable();
+	const uint32_t shCoefficientCount = GetProbeShCoefficientCount(settings.Encoding);
+
+	// Shoot rays from each probe into the ray data. Every probe only writes its own rays
+	auto traceStartTime = std::chrono::high_resolution_clock::now();
+	scheduler.ParallelFor(activeProbeIndices.size(), PROBE_TRACE_RANGE_SIZE, [&](const size_t begin, const size_t end)
+		{
+			for (size_t listIndex = begin; listIndex < end; ++listIndex)
+			{
+				const uint32_t p = activeProbeIndices[listIndex];
+				const glm::vec3 origin = glm::vec3(probePositions[p]);
+				const uint32_t rotationIndex = GetProbeRayRotationIndex(settings.RayRotationSeed, p);
+				glm::vec4* pRayData = RayData.data() + static_cast<size_t>(p) * PROBE_RAY_COUNT;
+
+				// The probe's rays share its position so they are traced together in packets
+				for (uint32_t firstRay = 0; firstRay < PROBE_RAY_COUNT; firstRay += RayPacket::MaxRayCount)
+				{
+					RayPacket packet = {};
+					packet.Origin = origin;
+					packet.TMin = 0.0f;
+					packet.TMax = PROBE_MAX_RAY_DISTANCE;
+					packet.RayCount = std::min(RayPacket::MaxRayCount, PROBE_RAY_COUNT - firstRay);
+					for (uint32_t i = 0; i < packet.RayCount; ++i)
+					{
+						packet.Directions[i] = rayTable.GetRay(rotationIndex, firstRay + i).Direction;
+					}
+
+					std::array<RayHit, RayPacket::MaxRayCount> hits;
+					scene.IntersectPacket(packet, hits.data(), true);
+
+					// Store the ray's radiance and hit distance for the probe
+					for (uint32_t i = 0; i < packet.RayCount; ++i)
+					{
+						pRayData[firstRay + i] = ShadeProbeRay(scene, origin, packet.Directions[i], hits[i], lightVectorWS, settings.LightIntensity);
+					}
+				}
+			}
+		});
+	auto filterStartTime = std::chrono::high_resolution_clock::now();
+
+	// Filter once every probe has been traced, as the ProbeFilter dispatch follows the RayGen dispatch. Each probe only reads its own rays and
+	// writes its own tile of the filtered textures. Spherical harmonic probes have no texels to filter
+	const size_t filteredProbeCount = shCoefficientCount > 0 ? 0 : activeProbeIndices.size();
+	scheduler.ParallelFor(filteredProbeCount, PROBE_TRACE_RANGE_SIZE, [&](const size_t begin, const size_t end)
+		{
+			for (size_t listIndex = begin; listIndex < end; ++listIndex)
+			{
+				const uint32_t p = activeProbeIndices[listIndex];
+				const uint32_t rotationIndex = GetProbeRayRotationIndex(settings.RayRotationSeed, p);
+				std::array<glm::vec3, PROBE_RAY_COUNT> rayDirections;
+				for (uint32_t r = 0; r < PROBE_RAY_COUNT; ++r)
+				{
+					rayDirections[r] = rayTable.GetRay(rotationIndex, r).Direction;
+				}
+
+				const glm::vec4* pRayData = RayData.data() + static_cast<size_t>(p) * PROBE_RAY_COUNT;
+				FilterProbeRays(pRayData, rayDirections.data(), PROBE_RAY_COUNT, IrradianceFiltered,
+					glm::ivec2(GetProbeTopLeftPosition(p, probesPerRow, static_cast<float>(IRRADIANCE_PROBE_SIDE_LENGTH), PROBE_PADDING)), IRRADIANCE_PROBE_SIDE_LENGTH);
+				FilterProbeRays(pRayData, rayDirections.data(), PROBE_RAY_COUNT, VisibilityFiltered,
+					glm::ivec2(GetProbeTopLeftPosition(p, probesPerRow, static_cast<float>(VISIBILITY_PROBE_SIDE_LENGTH), PROBE_PADDING)), VISIBILITY_PROBE_SIDE_LENGTH);
+			}
+		});
+	auto blendStartTime = std::chrono::high_resolution_clock::now();
+
+	// Blend each probe's filtered output into its history. Spherical harmonic probes project their rays here, as ProbeBlend projects them
+	scheduler.ParallelFor(activeProbeIndices.size(), PROBE_TRACE_RANGE_SIZE, [&](const size_t begin, const size_t end)
+		{
+			for (size_t listIndex = begin; listIndex < end; ++listIndex)
+			{
+				const uint32_t p = activeProbeIndices[listIndex];
+				if (shCoefficientCount > 0)
+				{
+					// Project the probe's rays, spread evenly over the sphere, and turn their radiance into irradiance
+					const uint32_t rotationIndex = GetProbeRayRotationIndex(settings.RayRotationSeed, p);
+					const glm::vec4* pRayData = RayData.data() + static_cast<size_t>(p) * PROBE_RAY_COUNT;
+					std::array<glm::vec3, PROBE_RAY_COUNT> rayDirections;
+					std::array<float, PROBE_SH_CHANNEL_COUNT * PROBE_RAY_COUNT> rayValues;
+					for (uint32_t r = 0; r < PROBE_RAY_COUNT; ++r)
+					{
+						rayDirections[r] = rayTable.GetRay(rotationIndex, r).Direction;
+						rayValues[r] = pRayData[r].x;
+						rayValues[PROBE_RAY_COUNT + r] = pRayData[r].y;
+						rayValues[2 * PROBE_RAY_COUNT + r] = pRayData[r].z;
+						rayValues[3 * PROBE_RAY_COUNT + r] = pRayData[r].w;
+						rayValues[4 * PROBE_RAY_COUNT + r] = pRayData[r].w * pRayData[r].w;
+					}
+
+					std::array<float, PROBE_SH_FLOAT_COUNT> gather = {};
+					Math::ProjectSh(rayDirections.data(), rayValues.data(), PROBE_RAY_COUNT, PROBE_SH_CHANNEL_COUNT, 4.0f * SHADER_PI / static_cast<float>(PROBE_RAY_COUNT),
+						shCoefficientCount, gather.data());
+					Math::ConvolveShCosineLobe(gather.data(), shCoefficientCount, PROBE_SH_CHANNEL_COUNT, 0, 3);
+					Statistics[p] = BlendProbeSh(gather.data(), ShCoefficients.data() + p * PROBE_SH_FLOAT_COUNT, shCoefficientCount,
+						rayDirections.data(), glm::vec3(probePositions[p]), Statistics[p], settings.Blend);
+					continue;
+				}
+
+				Statistics[p] = BlendProbeOutput(IrradianceFiltered, VisibilityFiltered, IrradianceAtlas, VisibilityAtlas, p, probesPerRow, glm::vec3(probePositions[p]),
+					Statistics[p], settings.Blend);
+			}
+		});
+	auto endTime = std::chrono::high_resolution_clock::now();
+
+	for (const uint32_t p : activeProbeIndices)
+	{
+		stats.RestartedProbeCount += Statistics[p].SampleCount == 1.0f ? 1 : 0;
+		stats.MeanChange += Statistics[p].Change;
+	}
+	stats.MeanChange = activeProbeIndices.empty() ? 0.0 : stats.MeanChange / static_cast<double>(activeProbeIndices.size());
+
+	stats.TraceMilliseconds = std::chrono::duration<double, std::milli>(filterStartTime - traceStartTime).count();
+	stats.FilterMilliseconds = std::chrono::duration<double, std::milli>(blendStartTime - filterStartTime).count();
+	stats.BlendMilliseconds = std::chrono::duration<double, std::milli>(endTime - blendStartTime).count();
+	return stats;
+}
+
+void Renderer::CPU::ProbeTracer::ClearProbes(const std::vector<uint32_t>& probeIndices)
+{
+	// Nothing has been traced before the atlases are laid out
+	const uint32_t probesPerRow = AtlasLayout.GetProbesPerRow();
+	if (probesPerRow == 0)
+	{
+		return;
+	}
+
+	for (const uint32_t p : probeIndices)
+	{
+		ClearProbeOutput(IrradianceAtlas, GetProbeTopLeftPosition(p, probesPerRow, static_cast<float>(IRRADIANCE_PROBE_SIDE_LENGTH), PROBE_PADDING), IRRADIANCE_PROBE_SIDE_LENGTH);
+		ClearProbeOutput(VisibilityAtlas, GetProbeTopLeftPosition(p, probesPerRow, static_cast<float>(VISIBILITY_PROBE_SIDE_LENGTH), PROBE_PADDING), VISIBILITY_PROBE_SIDE_LENGTH);
+		std::fill_n(ShCoefficients.begin() + p * PROBE_SH_FLOAT_COUNT, PROBE_SH_FLOAT_COUNT, 0.0f);
+		Statistics[p] = ProbeStatistics();
+	}
+}
+
+void Renderer::CPU::ProbeTracer::GetBakedProbes(const uint32_t firstProbeIndex, const glm::ivec3& gridProbeCounts, BakedProbeAtlases& atlases) const
+{
+	atlases.Reserve(gridProbeCounts);
+	assert(firstProbeIndex + atlases.Statistics.size() <= Statistics.size() && "Baked probes must have been traced.");
+
+	const uint32_t probesPerRow = AtlasLayout.GetProbesPerRow();
+	const uint32_t bakedProbesPerRow = atlases.Layout.GetProbesPerRow();
+	for (uint32_t i = 0; i < static_cast<uint32_t>(atlases.Statistics.size()); ++i)
+	{
+		const uint32_t p = firstProbeIndex + i;
+		PackBakedProbeTile(IrradianceAtlas, GetProbeTopLeftPosition(p, probesPerRow, static_cast<float>(IRRADIANCE_PROBE_SIDE_LENGTH), PROBE_PADDING),
+			IRRADIANCE_PROBE_SIDE_LENGTH, atlases.IrradianceAtlas.data(),
+			GetProbeTopLeftPosition(i, bakedProbesPerRow, static_cast<float>(IRRADIANCE_PROBE_SIDE_LENGTH), PROBE_PADDING), atlases.IrradianceRowPitch,
+			[](const glm::vec3* pIrradiance, const size_t count, uint32_t* pPacked) { Math::PackR11G11B10Float(pIrradiance, count, pPacked); });
+		PackBakedProbeTile(VisibilityAtlas, GetProbeTopLeftPosition(p, probesPerRow, static_cast<float>(VISIBILITY_PROBE_SIDE_LENGTH), PROBE_PADDING),
+			VISIBILITY_PROBE_SIDE_LENGTH, atlases.VisibilityAtlas.data(),
+			GetProbeTopLeftPosition(i, bakedProbesPerRow, static_cast<float>(VISIBILITY_PROBE_SIDE_LENGTH), PROBE_PADDING), atlases.VisibilityRowPitch,
+			[](const glm::vec2* pVisibility, const size_t count, uint32_t* pPacked) { Math::PackR16G16Float(pVisibility, count, pPacked); });
+		atlases.Statistics[i] = Statistics[p];
+	}
+}
+
+void Renderer::CPU::ProbeTracer::LoadBakedProbes(const BakedProbeData& data, const uint32_t firstProbeIndex)
+{
+	const BakedProbeVolume& volume = *data.pVolume;
+	const auto probeCount = static_cast<uint32_t>(volume.GetProbeCount());
+	ReserveAtlases(firstProbeIndex + probeCount, glm::ivec3(volume.ProbeCounts));
+
+	const uint32_t probesPerRow = AtlasLayout.GetProbesPerRow();
+	for (uint32_t i = 0; i < probeCount; ++i)
+	{
+		const uint32_t p = firstProbeIndex + i;
+		UnpackBakedProbeTile(data.pIrradianceAtlas, GetProbeTopLeftPosition(i, volume.AtlasLayout.x, static_cast<float>(IRRADIANCE_PROBE_SIDE_LENGTH), PROBE_PADDING),
+			volume.AtlasLayout.z, IRRADIANCE_PROBE_SIDE_LENGTH, IrradianceAtlas,
+			GetProbeTopLeftPosition(p, probesPerRow, static_cast<float>(IRRADIANCE_PROBE_SIDE_LENGTH), PROBE_PADDING),
+			[](const uint32_t* pPacked, const size_t count, glm::vec3* pIrradiance) { Math::UnpackR11G11B10Float(pPacked, count, pIrradiance); });
+		UnpackBakedProbeTile(data.pVisibilityAtlas, GetProbeTopLeftPosition(i, volume.AtlasLayout.x, static_cast<float>(VISIBILITY_PROBE_SIDE_LENGTH), PROBE_PADDING),
+			volume.AtlasLayout.w, VISIBILITY_PROBE_SIDE_LENGTH, VisibilityAtlas,
+			GetProbeTopLeftPosition(p, probesPerRow, static_cast<float>(VISIBILITY_PROBE_SIDE_LENGTH), PROBE_PADDING),
+			[](const uint32_t* pPacked, const size_t count, glm::vec2* pVisibility) { Math::UnpackR16G16Float(pPacked, count, pVisibility); });
+		Statistics[p] = data.pStatistics[i];
+	}
+}
+
+bool Renderer::CPU::ProbeTracer::SaveAtlases(const std::filesystem::path& directory) const
+{
+	return SavePFM(directory / "ProbeIrradiance.pfm", IrradianceAtlas, 3) &&
+		SavePFM(directory / "ProbeVisibility.pfm", VisibilityAtlas, 2);
+}
+
+glm::vec3 Renderer::CPU::SphericalFibonacci(const float i, const float n)
+{
+	// Majercik et al. https://jcgt.org/published/0008/02/01/
+	const float PHI = std::sqrt(5.0f) * 0.5f + 0.5f;
+	auto madfrac = [](const float a, const float b) { return (a * b) - std::floor(a * b); };
+	const float phi = 2.0f * SHADER_PI * madfrac(i, PHI - 1.0f);
+	const float cosTheta = 1.0f - (2.0f * i + 1.0f) * (1.0f / n);
+	const float sinTheta = std::sqrt(std::clamp(1.0f - cosTheta * cosTheta, 0.0f, 1.0f));
+	return glm::vec3(
+		std::cos(phi) * sinTheta,
+		std::sin(phi) * sinTheta,
+		cosTheta);
+}
+
+glm::vec2 Renderer::CPU::GetProbeTopLeftPosition(const uint32_t probeIndex, const uint32_t probesPerRow, const float singleProbeSideLength, const uint32_t padding)
+{
+	const float tileSideLength = singleProbeSideLength + static_cast<float>(2 * padding);
+	return glm::vec2(
+		static_cast<float>(probeIndex % probesPerRow) * tileSideLength,
+		static_cast<float>(probeIndex / probesPerRow) * tileSideLength
+	) + static_cast<float>(padding);
+}
+
+glm::vec2 Renderer::CPU::GetProbeTexelCoordinate(const glm::vec3& direction, const uint32_t probeIndex, const uint32_t probesPerRow, const float singleProbeSideLength,
+	const uint32_t padding)
+{
+	// Encode the direction to oct texture coordinate in [0, 1] range
+	glm::vec2 normalizedOctCoordZeroOne = (Math::OctEncode(direction) + 1.0f) * 0.5f;
+
+	// Calculate the oct coordinate in the dimensions of the probe output texture
+	glm::vec2 normalizedOctCoordTextureDimensions = normalizedOctCoordZeroOne * singleProbeSideLength;
+
+	// Calculate the top left texel of this probe's output in the texture
+	glm::vec2 probeTopLeftPosition = GetProbeTopLeftPosition(probeIndex, probesPerRow, singleProbeSideLength, padding);
+
+	return probeTopLeftPosition + normalizedOctCoordTextureDimensions;
+}
+
+glm::vec3 Renderer::CPU::Lighting(const glm::vec3& normalWS, const glm::vec3& lightVectorWS, const float shadow, const float lightIntensity)
+{
+	// Ambient and specular terms are zero in the shader model
+	const glm::vec3 lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
+	const glm::vec3 diffuse = lightColor * std::clamp(glm::dot(normalWS, lightVectorWS), 0.0f, 1.0f);
+	return diffuse * lightIntensity * shadow;
+}
+
+float Renderer::CPU::Luminance(const glm::vec3& color)
+{
+	return glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+}
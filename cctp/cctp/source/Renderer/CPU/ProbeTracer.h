@@ -0,0 +1,135 @@
+#pragma once
+
+#include "Texture2D.h"
+#include "Renderer/ProbeAtlasLayout.h"
+#include "Renderer/ProbeVolume.h"
+
+namespace Threading
+{
+	class TaskScheduler;
+}
+
+namespace Renderer
+{
+	struct BakedProbeAtlases;
+	struct BakedProbeData;
+
+	namespace CPU
+	{
+		class RaytracingScene;
+		struct RayHit;
+
+		struct ProbeTraceSettings
+		{
+			glm::vec3 LightDirectionWS = glm::vec3(0.0f, -1.0f, 0.0f);
+			float LightIntensity = 1.0f;
+			// Scheduler the probes are spread across. Null uses the default scheduler with a thread per hardware thread
+			Threading::TaskScheduler* pTaskScheduler = nullptr;
+			// States of the probes, as stored by ProbeVolume. Inactive probes are skipped as RayGen skips them. Null traces every probe
+			const std::vector<uint32_t>* pProbeStates = nullptr;
+			// How new rays are blended into each probe's history, as RayGen blends them with the per frame probe blend settings
+			ProbeBlendSettings Blend = {};
+			// Picks the rotation of the probe ray table each probe is traced with, as the per frame ray rotation seed does for RayGen. Zero traces the
+			// unrotated directions
+			uint32_t RayRotationSeed = 0;
+			// Encoding of the probes traced, as ProbeVolumeData tells the shaders. Spherical harmonic probes project their rays onto coefficients in the
+			// blend in place of filtering them into texels, so they skip the filter and leave their atlas tiles untouched
+			ProbeEncoding Encoding = ProbeEncoding::Octahedral;
+		};
+
+		struct ProbeTraceStats
+		{
+			size_t ProbeCount = 0;
+			size_t RayCount = 0;
+			// Inactive probes and the rays not traced for them
+			size_t SkippedProbeCount = 0;
+			size_t SkippedRayCount = 0;
+			// Traced probes that started a new history, having none or having changed by more than the change threshold
+			size_t RestartedProbeCount = 0;
+			// Mean relative change of the traced probes' output against their history
+			double MeanChange = 0.0;
+			uint32_t ThreadCount = 0;
+			double TraceMilliseconds = 0.0;
+			double FilterMilliseconds = 0.0;
+			double BlendMilliseconds = 0.0;
+
+			double GetTotalMilliseconds() const { return TraceMilliseconds + FilterMilliseconds + BlendMilliseconds; }
+			double GetMraysPerSecond() const { return TraceMilliseconds > 0.0 ? (static_cast<double>(RayCount) / (TraceMilliseconds * 1000.0)) : 0.0; }
+		};
+
+		// CPU reference implementation of the probe field update performed by RayGen.hlsl, ClosestHit.hlsl and Miss.hlsl.
+		// Each trace stores the radiance and hit distance of every probe ray as RayGen stores them in the ray data buffer, filters each probe's rays into
+		// textures with the same dimensions and texel layout as the GPU filtered textures as ProbeFilter does, then blends them into the probe
+		// irradiance and visibility atlases with the same per probe statistics as ProbeBlend, so tracing the same probes again accumulates their history
+		// as the GPU does across gathers.
+		// Shadowing is resolved with a shadow ray towards the light instead of a shadow map lookup
+		class ProbeTracer
+		{
+		public:
+			ProbeTracer() = default;
+			// Lays the atlases out for at least the probe count, as the renderer does for the GPU atlases. Atlas data is cleared when the layout
+			// changes. Tracing reserves the atlases for the probes traced
+			void ReserveAtlases(const size_t probeCount, const glm::ivec3& gridProbeCounts = glm::ivec3(0));
+			// Probe positions are world space float4s as stored by ProbeVolume
+			ProbeTraceStats TraceProbes(const RaytracingScene& scene, const std::vector<glm::vec4>& probePositions, const ProbeTraceSettings& settings);
+			// Traces only the listed probes, leaving the atlas data of the others untouched
+			ProbeTraceStats TraceProbes(const RaytracingScene& scene, const std::vector<glm::vec4>& probePositions, const std::vector<uint32_t>& probeIndices,
+				const ProbeTraceSettings& settings);
+			// Zeroes the atlas regions, spherical harmonic coefficients and history of the listed probes, so probes moved to a new position do not keep
+			// what their previous position left behind until they are traced
+			void ClearProbes(const std::vector<uint32_t>& probeIndices);
+			const ProbeAtlasLayout& GetAtlasLayout() const { return AtlasLayout; }
+			const Texture2D<glm::vec3>& GetIrradianceAtlas() const { return IrradianceAtlas; }
+			const Texture2D<glm::vec2>& GetVisibilityAtlas() const { return VisibilityAtlas; }
+			// Indexed by probe index up to the atlas capacity
+			const std::vector<ProbeStatistics>& GetProbeStatistics() const { return Statistics; }
+			// PROBE_SH_MAX_COEFFICIENT_COUNT coefficients of PROBE_SH_CHANNEL_COUNT floats per probe, indexed by probe index up to the atlas capacity.
+			// Irradiance channels are convolved with the cosine lobe. Only probes traced with a spherical harmonic encoding hold coefficients
+			const std::vector<float>& GetProbeShCoefficients() const { return ShCoefficients; }
+			// Radiance (rgb) and hit distance (a) of each probe's rays in its last trace, PROBE_RAY_COUNT per probe indexed by probe index up to the
+			// atlas capacity, as RayGen writes the ray data buffer
+			const std::vector<glm::vec4>& GetProbeRayData() const { return RayData; }
+			// Packs the atlas tiles and statistics of a volume's probes, from the first probe index, into the formats they are baked and uploaded in
+			void GetBakedProbes(const uint32_t firstProbeIndex, const glm::ivec3& gridProbeCounts, BakedProbeAtlases& atlases) const;
+			// Unpacks a baked volume's atlas tiles and statistics into the atlases from the first probe index, so tracing continues from the baked history
+			void LoadBakedProbes(const BakedProbeData& data, const uint32_t firstProbeIndex);
+			// Writes both atlases into the directory as portable float maps
+			bool SaveAtlases(const std::filesystem::path& directory) const;
+
+		private:
+			ProbeAtlasLayout AtlasLayout;
+			Texture2D<glm::vec3> IrradianceAtlas;
+			Texture2D<glm::vec2> VisibilityAtlas;
+			Texture2D<glm::vec3> IrradianceFiltered;
+			Texture2D<glm::vec2> VisibilityFiltered;
+			std::vector<ProbeStatistics> Statistics;
+			std::vector<float> ShCoefficients;
+			std::vector<glm::vec4> RayData;
+		};
+
+		// Port of the ClosestHit and Miss shaders for a probe ray, given the closest hit found along it. Returns the radiance (rgb) and hit distance (a)
+		// the probe stores for the ray, the max ray distance for a miss
+		glm::vec4 ShadeProbeRay(const RaytracingScene& scene, const glm::vec3& origin, const glm::vec3& direction, const RayHit& hit,
+			const glm::vec3& lightVectorWS, const float lightIntensity);
+		// Finds the closest hit of a single probe ray, culling back faces as RayGen does, and shades it
+		glm::vec4 TraceProbeRay(const RaytracingScene& scene, const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& lightVectorWS,
+			const float lightIntensity);
+
+		// Rays the benchmarks trace with TraceProbeReference to stand in for the irradiance and visibility a probe converges to
+		constexpr uint32_t PROBE_REFERENCE_RAY_COUNT = 2048;
+		// Traces rayCount rays from the origin, spread evenly over the sphere, with TraceProbeRay. Fills the direction of each ray and its radiance and
+		// hit distance, as the ray data holds them
+		void TraceProbeReference(const RaytracingScene& scene, const glm::vec3& origin, const uint32_t rayCount, const glm::vec3& lightVectorWS,
+			const float lightIntensity, std::vector<glm::vec3>& rayDirections, std::vector<glm::vec4>& rayData);
+		// Irradiance / pi around the normal from traced rays, the mean of their radiance weighted by their cosine to the normal
+		glm::vec3 IntegrateProbeIrradiance(const glm::vec4* pRayData, const glm::vec3* pRayDirections, const uint32_t rayCount, const glm::vec3& normal);
+
+		// CPU versions of the probe functions in Shaders/RayGen.hlsl and Shaders/Common.hlsl
+		glm::vec3 SphericalFibonacci(const float i, const float n);
+		glm::vec2 GetProbeTopLeftPosition(const uint32_t probeIndex, const uint32_t probesPerRow, const float singleProbeSideLength, const uint32_t padding);
+		glm::vec2 GetProbeTexelCoordinate(const glm::vec3& direction, const uint32_t probeIndex, const uint32_t probesPerRow, const float singleProbeSideLength,
+			const uint32_t padding);
+		glm::vec3 Lighting(const glm::vec3& normalWS, const glm::vec3& lightVectorWS, const float shadow, const float lightIntensity);
+		float Luminance(const glm::vec3& color);
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+namespace Renderer
+{
+	namespace CPU
+	{
+		constexpr uint32_t INVALID_ID = 0xFFFFFFFF;
+
+		// Mirrors the HLSL RayDesc structure
+		struct Ray
+		{
+			glm::vec3 Origin = glm::vec3(0.0f, 0.0f, 0.0f);
+			float TMin = 0.0f;
+			glm::vec3 Direction = glm::vec3(0.0f, 0.0f, 1.0f);
+			float TMax = std::numeric_limits<float>::max();
+		};
+
+		struct RayHit
+		{
+			float T = std::numeric_limits<float>::max();
+			// Barycentrics of the hit point for the second and third triangle vertices, as BuiltInTriangleIntersectionAttributes
+			glm::vec2 Barycentrics = glm::vec2(0.0f, 0.0f);
+			uint32_t InstanceID = INVALID_ID;
+			uint32_t PrimitiveIndex = INVALID_ID;
+
+			bool IsHit() const { return InstanceID != INVALID_ID; }
+		};
+
+		// Rays sharing an origin, such as the rays shot from a probe, traced together so each node is visited once for every ray that reaches it.
+		// Bit i of a ray mask refers to the ray with direction Directions[i]
+		struct RayPacket
+		{
+			static constexpr uint32_t MaxRayCount = 32;
+
+			glm::vec3 Origin = glm::vec3(0.0f, 0.0f, 0.0f);
+			float TMin = 0.0f;
+			float TMax = std::numeric_limits<float>::max();
+			uint32_t RayCount = 0;
+			std::array<glm::vec3, MaxRayCount> Directions;
+
+			uint32_t GetRayMask() const { return (RayCount >= 32) ? 0xFFFFFFFF : ((1u << RayCount) - 1); }
+		};
+	}
+}
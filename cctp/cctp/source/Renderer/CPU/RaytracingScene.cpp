@@ -0,0 +1,110 @@
+#include "CpuPch.h"
+#include "RaytracingScene.h"
+
+uint32_t Renderer::CPU::RaytracingScene::AddMesh(const Vertex1Pos1UV1Norm* pVertices, const size_t vertexCount, const uint32_t* pIndices, const size_t indexCount)
+{
+	assert(indexCount % 3 == 0 && "Raytracing scene meshes must be triangle lists.");
+
+	auto mesh = std::make_unique<MeshData>();
+	mesh->AccelerationStructure.Build(pVertices, vertexCount, pIndices, indexCount);
+	mesh->WideAccelerationStructure.Build(mesh->AccelerationStructure);
+	mesh->Normals.reserve(vertexCount);
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		mesh->Normals.push_back(pVertices[i].Normal);
+	}
+	mesh->Indices.assign(pIndices, pIndices + indexCount);
+
+	Meshes.push_back(std::move(mesh));
+	return static_cast<uint32_t>(Meshes.size() - 1);
+}
+
+uint32_t Renderer::CPU::RaytracingScene::AddInstance(const uint32_t meshIndex, const glm::mat4& transformMatrix, const glm::vec3& albedo)
+{
+	assert(meshIndex < Meshes.size() && "Adding an instance of an invalid mesh to the raytracing scene.");
+
+	Instance instance = {};
+	instance.MeshIndex = meshIndex;
+	instance.Albedo = albedo;
+	Instances.push_back(instance);
+
+	auto instanceID = TopLevel.AddInstance(Meshes[meshIndex]->AccelerationStructure, transformMatrix);
+	assert(instanceID == Instances.size() - 1 && "Raytracing scene instances are out of sync with the top level bvh.");
+	SetInstanceTransform(instanceID, transformMatrix);
+	return instanceID;
+}
+
+void Renderer::CPU::RaytracingScene::SetInstanceTransform(const uint32_t instanceID, const glm::mat4& transformMatrix)
+{
+	assert(instanceID < Instances.size() && "Setting instance transform with invalid instance ID.");
+
+	TopLevel.SetInstanceTransform(instanceID, transformMatrix);
+	// World matrix contains non uniform scaling
+	Instances[instanceID].NormalMatrix = glm::inverse(glm::transpose(glm::mat3(transformMatrix)));
+}
+
+bool Renderer::CPU::RaytracingScene::Intersect(const Ray& ray, RayHit& hit, const bool cullBackFaces) const
+{
+	return TopLevel.Intersect(ray, hit, cullBackFaces, false);
+}
+
+uint32_t Renderer::CPU::RaytracingScene::IntersectPacket(const RayPacket& packet, RayHit* pHits, const bool cullBackFaces) const
+{
+	const uint32_t rayMask = packet.GetRayMask();
+	for (uint32_t r = 0; r < packet.RayCount; ++r)
+	{
+		pHits[r] = {};
+		pHits[r].T = packet.TMax;
+	}
+
+	uint32_t hitMask = 0;
+	TopLevel.TraversePacket(packet, rayMask, pHits, [&](const uint32_t instanceID, const uint32_t instanceRayMask)
+		{
+			// Trace in object space. The origin stays shared as it is transformed as a point
+			const glm::mat4& worldToObject = TopLevel.GetInstanceWorldToObject(instanceID);
+			RayPacket packetOS = {};
+			packetOS.Origin = glm::vec3(worldToObject * glm::vec4(packet.Origin, 1.0f));
+			packetOS.TMin = packet.TMin;
+			packetOS.TMax = packet.TMax;
+			packetOS.RayCount = packet.RayCount;
+			for (uint32_t mask = instanceRayMask; mask != 0; mask &= mask - 1)
+			{
+				const auto r = static_cast<uint32_t>(std::countr_zero(mask));
+				packetOS.Directions[r] = glm::mat3(worldToObject) * packet.Directions[r];
+			}
+
+			const auto& mesh = *Meshes[Instances[instanceID].MeshIndex];
+			const uint32_t instanceHitMask = mesh.WideAccelerationStructure.IntersectPacket(packetOS, instanceRayMask, cullBackFaces, false, pHits);
+			for (uint32_t mask = instanceHitMask; mask != 0; mask &= mask - 1)
+			{
+				pHits[std::countr_zero(mask)].InstanceID = instanceID;
+			}
+			hitMask |= instanceHitMask;
+
+			// Closest hit rays keep tracing
+			return rayMask;
+		});
+
+	return hitMask;
+}
+
+bool Renderer::CPU::RaytracingScene::Occluded(const Ray& ray) const
+{
+	RayHit hit;
+	return TopLevel.Intersect(ray, hit, false, true);
+}
+
+glm::vec3 Renderer::CPU::RaytracingScene::GetHitNormalWS(const RayHit& hit) const
+{
+	assert(hit.IsHit() && "Requesting the normal of a ray that missed the scene.");
+
+	const auto& instance = Instances[hit.InstanceID];
+	const auto& mesh = *Meshes[instance.MeshIndex];
+	const auto* pIndices = &mesh.Indices[static_cast<size_t>(hit.PrimitiveIndex) * 3];
+
+	glm::vec3 normalOS = (1.0f - hit.Barycentrics.x - hit.Barycentrics.y) * mesh.Normals[pIndices[0]] +
+		hit.Barycentrics.x * mesh.Normals[pIndices[1]] +
+		hit.Barycentrics.y * mesh.Normals[pIndices[2]];
+
+	return glm::normalize(instance.NormalMatrix * normalOS);
+}
\ No newline at end of file
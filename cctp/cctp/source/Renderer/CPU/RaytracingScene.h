@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Ray.h"
+#include "TopLevelBvh.h"
+#include "WideBvh.h"
+#include "Renderer/Vertices/Vertex1Pos1UV1Norm.h"
+
+namespace Renderer
+{
+	namespace CPU
+	{
+		// CPU copy of the scene raytraced by the probe field. Meshes are referenced by instances that carry a world transform and an albedo,
+		// matching the instances set on the TopLevelAccelerationStructure and the colors in the material constant buffer
+		class RaytracingScene
+		{
+		public:
+			uint32_t AddMesh(const Vertex1Pos1UV1Norm* pVertices, const size_t vertexCount, const uint32_t* pIndices, const size_t indexCount);
+			uint32_t AddInstance(const uint32_t meshIndex, const glm::mat4& transformMatrix, const glm::vec3& albedo);
+			void SetInstanceTransform(const uint32_t instanceID, const glm::mat4& transformMatrix);
+			// Applies instance changes to the top level bvh. Must be called before tracing after instances are added or moved
+			const TopLevelBvhStats& Update(const TopLevelBvhSettings& settings = {}) { return TopLevel.Update(settings); }
+
+			// Finds the closest hit along the ray. Back facing triangles are skipped when cullBackFaces is set, as with RAY_FLAG_CULL_BACK_FACING_TRIANGLES
+			bool Intersect(const Ray& ray, RayHit& hit, const bool cullBackFaces) const;
+			// Finds the closest hit of every ray in the packet, as Intersect does for each ray, tracing the rays together through 8 wide mesh bvhs.
+			// Returns the mask of rays that hit
+			uint32_t IntersectPacket(const RayPacket& packet, RayHit* pHits, const bool cullBackFaces) const;
+			// Returns true if any triangle is hit along the ray
+			bool Occluded(const Ray& ray) const;
+
+			// Returns the interpolated world space vertex normal at the hit point
+			glm::vec3 GetHitNormalWS(const RayHit& hit) const;
+			const glm::vec3& GetInstanceAlbedo(const uint32_t instanceID) const { return Instances[instanceID].Albedo; }
+			size_t GetInstanceCount() const { return Instances.size(); }
+			size_t GetMeshCount() const { return Meshes.size(); }
+			const Bvh& GetMeshBvh(const uint32_t meshIndex) const { return Meshes[meshIndex]->AccelerationStructure; }
+			const Bvh8& GetMeshWideBvh(const uint32_t meshIndex) const { return Meshes[meshIndex]->WideAccelerationStructure; }
+			const TopLevelBvh& GetTopLevelBvh() const { return TopLevel; }
+
+		private:
+			struct MeshData
+			{
+				Bvh AccelerationStructure;
+				// Collapsed copy of AccelerationStructure traced by ray packets
+				Bvh8 WideAccelerationStructure;
+				std::vector<glm::vec3> Normals;
+				std::vector<uint32_t> Indices;
+			};
+
+			// Shading data, the transforms used for tracing are held by the top level bvh
+			struct Instance
+			{
+				uint32_t MeshIndex = 0;
+				glm::mat3 NormalMatrix = glm::identity<glm::mat3>();
+				glm::vec3 Albedo = glm::vec3(0.0f, 0.0f, 0.0f);
+			};
+
+		private:
+			// Instances reference the mesh bvh so meshes must not move in memory
+			std::vector<std::unique_ptr<MeshData>> Meshes;
+			std::vector<Instance> Instances;
+			TopLevelBvh TopLevel;
+		};
+	}
+}
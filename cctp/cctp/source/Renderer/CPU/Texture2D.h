@@ -0,0 +1,76 @@
+#pragma once
+
+namespace Renderer
+{
+	namespace CPU
+	{
+		// Row major CPU image that follows the RWTexture2D access rules used by the raytracing shaders.
+		// Out of bounds loads return a zero value and out of bounds stores are discarded
+		template<typename T>
+		class Texture2D
+		{
+		public:
+			Texture2D() = default;
+			Texture2D(const uint32_t width, const uint32_t height)
+				: Width(width), Height(height), Texels(static_cast<size_t>(width) * height, T(0.0f))
+			{
+			}
+
+			T Load(const int32_t x, const int32_t y) const
+			{
+				if (x < 0 || y < 0 || x >= static_cast<int32_t>(Width) || y >= static_cast<int32_t>(Height))
+				{
+					return T(0.0f);
+				}
+				return Texels[static_cast<size_t>(y) * Width + x];
+			}
+
+			void Store(const int32_t x, const int32_t y, const T& value)
+			{
+				if (x < 0 || y < 0 || x >= static_cast<int32_t>(Width) || y >= static_cast<int32_t>(Height))
+				{
+					return;
+				}
+				Texels[static_cast<size_t>(y) * Width + x] = value;
+			}
+
+			// Float coordinates are truncated the same way HLSL converts a float2 index into a uint2
+			T Load(const glm::vec2& coordinate) const { return Load(static_cast<int32_t>(coordinate.x), static_cast<int32_t>(coordinate.y)); }
+			void Store(const glm::vec2& coordinate, const T& value) { Store(static_cast<int32_t>(coordinate.x), static_cast<int32_t>(coordinate.y), value); }
+
+			// Bilinear filtered read at a normalized coordinate with wrap addressing, as SampleLevel with the linear sampler at mip zero
+			T SampleLinear(const glm::vec2& uv) const
+			{
+				const glm::vec2 position = (uv * glm::vec2(static_cast<float>(Width), static_cast<float>(Height))) - 0.5f;
+				const glm::vec2 base = glm::floor(position);
+				const glm::vec2 fraction = position - base;
+				const auto x = static_cast<int32_t>(base.x);
+				const auto y = static_cast<int32_t>(base.y);
+				return glm::mix(
+					glm::mix(LoadWrapped(x, y), LoadWrapped(x + 1, y), fraction.x),
+					glm::mix(LoadWrapped(x, y + 1), LoadWrapped(x + 1, y + 1), fraction.x),
+					fraction.y);
+			}
+
+			void Clear(const T& value) { std::fill(Texels.begin(), Texels.end(), value); }
+
+			uint32_t GetWidth() const { return Width; }
+			uint32_t GetHeight() const { return Height; }
+			const T* GetData() const { return Texels.data(); }
+			T* GetData() { return Texels.data(); }
+			size_t GetTexelCount() const { return Texels.size(); }
+
+		private:
+			T LoadWrapped(const int32_t x, const int32_t y) const
+			{
+				const auto width = static_cast<int32_t>(Width);
+				const auto height = static_cast<int32_t>(Height);
+				return Texels[static_cast<size_t>(((y % height) + height) % height) * Width + (((x % width) + width) % width)];
+			}
+
+			uint32_t Width = 0;
+			uint32_t Height = 0;
+			std::vector<T> Texels;
+		};
+	}
+}
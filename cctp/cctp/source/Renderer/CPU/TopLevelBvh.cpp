@@ -0,0 +1,209 @@
+#include "CpuPch.h"
+#include "TopLevelBvh.h"
+#include "Math/Math.h"
+
+// Every leaf holds a single instance so a moved instance only refits the path from its leaf to the root
+constexpr Renderer::CPU::BvhBuildSettings TOP_LEVEL_BVH_BUILD_SETTINGS = { 16, 1, 1.0f, 1.0f };
+
+uint32_t Renderer::CPU::TopLevelBvh::AddInstance(const Bvh& blas, const glm::mat4& transformMatrix)
+{
+	Instances.emplace_back();
+	StructureChanged = true;
+
+	auto instanceID = static_cast<uint32_t>(Instances.size() - 1);
+	SetInstanceBlasAndTransform(instanceID, blas, transformMatrix);
+	return instanceID;
+}
+
+void Renderer::CPU::TopLevelBvh::SetInstanceBlasAndTransform(const uint32_t instanceID, const Bvh& blas, const glm::mat4& transformMatrix)
+{
+	assert(instanceID < Instances.size() && "Setting instance blas with invalid instance ID.");
+
+	auto& instance = Instances[instanceID];
+	instance.pBlas = &blas;
+	instance.ObjectToWorld = transformMatrix;
+	instance.WorldToObject = glm::inverse(transformMatrix);
+	instance.BoundsWS = Math::TransformBoundingBox(instance.pBlas->GetBounds(), transformMatrix);
+
+	if (!instance.Moved)
+	{
+		instance.Moved = true;
+		MovedInstances.push_back(instanceID);
+	}
+}
+
+void Renderer::CPU::TopLevelBvh::SetInstanceTransform(const uint32_t instanceID, const glm::mat4& transformMatrix)
+{
+	assert(instanceID < Instances.size() && "Setting instance transform with invalid instance ID.");
+
+	// Setting an unchanged transform does not require the tree to be refit
+	if (transformMatrix != Instances[instanceID].ObjectToWorld)
+	{
+		SetInstanceBlasAndTransform(instanceID, *Instances[instanceID].pBlas, transformMatrix);
+	}
+}
+
+const Renderer::CPU::TopLevelBvhStats& Renderer::CPU::TopLevelBvh::Update(const TopLevelBvhSettings& settings)
+{
+	if (!NeedsUpdate())
+	{
+		return Stats;
+	}
+
+	if (StructureChanged)
+	{
+		return Rebuild();
+	}
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	const size_t movedInstanceCount = MovedInstances.size();
+	Refit();
+	UpdateSahCost();
+	++Stats.RefitCount;
+
+	if (Stats.SahCost > Stats.BuildSahCost * settings.RebuildCostRatio)
+	{
+		Rebuild();
+	}
+	else
+	{
+		Stats.LastUpdateRebuilt = false;
+	}
+
+	Stats.MovedInstanceCount = movedInstanceCount;
+	Stats.UpdateMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	return Stats;
+}
+
+const Renderer::CPU::TopLevelBvhStats& Renderer::CPU::TopLevelBvh::Rebuild()
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	Stats.MovedInstanceCount = MovedInstances.size();
+
+	// Build over the world space bounds of every instance
+	std::vector<BvhBuildPrimitive> primitives(Instances.size());
+	for (size_t i = 0; i < Instances.size(); ++i)
+	{
+		primitives[i].Bounds = Instances[i].BoundsWS;
+		primitives[i].Centroid = Instances[i].BoundsWS.GetCentre();
+		primitives[i].Index = static_cast<uint32_t>(i);
+	}
+	BuildBvhNodes(primitives, TOP_LEVEL_BVH_BUILD_SETTINGS, Nodes);
+
+	LeafInstances.resize(primitives.size());
+	for (size_t i = 0; i < primitives.size(); ++i)
+	{
+		LeafInstances[i] = primitives[i].Index;
+	}
+
+	// Record the links walked when refitting
+	NodeParents.assign(Nodes.size(), INVALID_ID);
+	InstanceLeafNodes.assign(Instances.size(), INVALID_ID);
+	for (uint32_t nodeIndex = 0; nodeIndex < Nodes.size(); ++nodeIndex)
+	{
+		const auto& node = Nodes[nodeIndex];
+		if (node.IsLeaf())
+		{
+			for (uint32_t i = node.LeftFirst; i < node.LeftFirst + node.PrimitiveCount; ++i)
+			{
+				InstanceLeafNodes[LeafInstances[i]] = nodeIndex;
+			}
+		}
+		else
+		{
+			NodeParents[node.LeftFirst] = nodeIndex;
+			NodeParents[node.LeftFirst + 1] = nodeIndex;
+		}
+	}
+
+	for (auto instanceID : MovedInstances)
+	{
+		Instances[instanceID].Moved = false;
+	}
+	MovedInstances.clear();
+	StructureChanged = false;
+
+	UpdateSahCost();
+	Stats.BuildSahCost = Stats.SahCost;
+	Stats.InstanceCount = Instances.size();
+	Stats.NodeCount = Nodes.size();
+	++Stats.RebuildCount;
+	Stats.LastUpdateRebuilt = true;
+	Stats.UpdateMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	return Stats;
+}
+
+bool Renderer::CPU::TopLevelBvh::Intersect(const Ray& ray, RayHit& hit, const bool cullBackFaces, const bool anyHit) const
+{
+	assert(!NeedsUpdate() && "Tracing a top level bvh with pending instance changes.");
+
+	hit = {};
+	hit.T = ray.TMax;
+
+	TraverseBvh(Nodes, ray.Origin, ray.Direction, ray.TMin, hit, [&](const BvhNode& leaf)
+		{
+			for (uint32_t i = leaf.LeftFirst; i < leaf.LeftFirst + leaf.PrimitiveCount; ++i)
+			{
+				const uint32_t instanceID = LeafInstances[i];
+				const auto& instance = Instances[instanceID];
+
+				// Trace in object space. The direction is not normalized so hit distances stay in world space units
+				const glm::vec3 originOS = glm::vec3(instance.WorldToObject * glm::vec4(ray.Origin, 1.0f));
+				const glm::vec3 directionOS = glm::mat3(instance.WorldToObject) * ray.Direction;
+
+				if (instance.pBlas->Intersect(originOS, directionOS, ray.TMin, cullBackFaces, anyHit, hit))
+				{
+					hit.InstanceID = instanceID;
+					if (anyHit)
+					{
+						return true;
+					}
+				}
+			}
+			return false;
+		});
+
+	return hit.IsHit();
+}
+
+void Renderer::CPU::TopLevelBvh::Refit()
+{
+	for (auto instanceID : MovedInstances)
+	{
+		auto& instance = Instances[instanceID];
+		instance.Moved = false;
+
+		// Refit the leaf, then every ancestor from its children
+		uint32_t nodeIndex = InstanceLeafNodes[instanceID];
+		{
+			auto& leaf = Nodes[nodeIndex];
+			BoundingBox bounds;
+			for (uint32_t i = leaf.LeftFirst; i < leaf.LeftFirst + leaf.PrimitiveCount; ++i)
+			{
+				bounds.Grow(Instances[LeafInstances[i]].BoundsWS);
+			}
+			leaf.BoundsMin = bounds.Min;
+			leaf.BoundsMax = bounds.Max;
+		}
+
+		for (nodeIndex = NodeParents[nodeIndex]; nodeIndex != INVALID_ID; nodeIndex = NodeParents[nodeIndex])
+		{
+			auto& node = Nodes[nodeIndex];
+			const auto& left = Nodes[node.LeftFirst];
+			const auto& right = Nodes[node.LeftFirst + 1];
+			node.BoundsMin = glm::min(left.BoundsMin, right.BoundsMin);
+			node.BoundsMax = glm::max(left.BoundsMax, right.BoundsMax);
+		}
+	}
+
+	MovedInstances.clear();
+}
+
+void Renderer::CPU::TopLevelBvh::UpdateSahCost()
+{
+	BvhBuildStats buildStats = {};
+	CalculateBvhStats(Nodes, TOP_LEVEL_BVH_BUILD_SETTINGS, buildStats);
+	Stats.SahCost = buildStats.SahCost;
+}
\ No newline at end of file
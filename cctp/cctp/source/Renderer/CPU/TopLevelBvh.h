@@ -0,0 +1,158 @@
+#pragma once
+
+#include "Bvh.h"
+
+namespace Renderer
+{
+	namespace CPU
+	{
+		struct TopLevelBvhSettings
+		{
+			// The tree is rebuilt once refitting raises its surface area heuristic cost this far above the cost of the last build
+			float RebuildCostRatio = 1.25f;
+		};
+
+		struct TopLevelBvhStats
+		{
+			size_t InstanceCount = 0;
+			size_t NodeCount = 0;
+			float SahCost = 0.0f;
+			// Cost of the tree straight after the last rebuild
+			float BuildSahCost = 0.0f;
+			uint32_t RebuildCount = 0;
+			uint32_t RefitCount = 0;
+			// Instances moved by the last update
+			size_t MovedInstanceCount = 0;
+			bool LastUpdateRebuilt = false;
+			double UpdateMilliseconds = 0.0;
+		};
+
+		// Bvh over instances of shared bottom level Bvh objects, the CPU equivalent of a TopLevelAccelerationStructure.
+		// Instance changes take effect on the next call to Update
+		class TopLevelBvh
+		{
+		public:
+			uint32_t AddInstance(const Bvh& blas, const glm::mat4& transformMatrix);
+			void SetInstanceBlasAndTransform(const uint32_t instanceID, const Bvh& blas, const glm::mat4& transformMatrix);
+			void SetInstanceTransform(const uint32_t instanceID, const glm::mat4& transformMatrix);
+
+			// Builds the tree after instances have been added or a blas has changed. Otherwise refits the nodes above moved instances,
+			// as a PERFORM_UPDATE build does, and rebuilds if refitting has degraded the tree past the settings threshold
+			const TopLevelBvhStats& Update(const TopLevelBvhSettings& settings = {});
+			const TopLevelBvhStats& Rebuild();
+
+			// Finds the closest hit along the ray, writing every RayHit field. Returns on the first hit found when anyHit is set
+			bool Intersect(const Ray& ray, RayHit& hit, const bool cullBackFaces, const bool anyHit) const;
+			// Visits the instances whose bounds are hit by rays of the packet, culling each ray against its own hit.T. Instances are visited nearest the packet origin first.
+			// visitInstance(instanceID, rayMask) traces the rays reaching the instance and returns the mask of rays that should keep tracing
+			template<typename InstanceFunction>
+			void TraversePacket(const RayPacket& packet, const uint32_t rayMask, const RayHit* pHits, InstanceFunction&& visitInstance) const;
+
+			bool NeedsUpdate() const { return StructureChanged || !MovedInstances.empty(); }
+			size_t GetInstanceCount() const { return Instances.size(); }
+			const glm::mat4& GetInstanceObjectToWorld(const uint32_t instanceID) const { return Instances[instanceID].ObjectToWorld; }
+			const glm::mat4& GetInstanceWorldToObject(const uint32_t instanceID) const { return Instances[instanceID].WorldToObject; }
+			const BoundingBox& GetInstanceBoundsWS(const uint32_t instanceID) const { return Instances[instanceID].BoundsWS; }
+			const auto& GetNodes() const { return Nodes; }
+			const TopLevelBvhStats& GetStats() const { return Stats; }
+
+		private:
+			struct Instance
+			{
+				const Bvh* pBlas = nullptr;
+				glm::mat4 ObjectToWorld = glm::identity<glm::mat4>();
+				glm::mat4 WorldToObject = glm::identity<glm::mat4>();
+				BoundingBox BoundsWS;
+				bool Moved = false;
+			};
+
+			void Refit();
+			void UpdateSahCost();
+
+		private:
+			std::vector<Instance> Instances;
+			std::vector<BvhNode> Nodes;
+			std::vector<uint32_t> NodeParents;
+			// Instance IDs in leaf order
+			std::vector<uint32_t> LeafInstances;
+			std::vector<uint32_t> InstanceLeafNodes;
+			std::vector<uint32_t> MovedInstances;
+			bool StructureChanged = true;
+			TopLevelBvhStats Stats;
+		};
+
+		template<typename InstanceFunction>
+		void TopLevelBvh::TraversePacket(const RayPacket& packet, const uint32_t rayMask, const RayHit* pHits, InstanceFunction&& visitInstance) const
+		{
+			assert(!NeedsUpdate() && "Tracing a top level bvh with pending instance changes.");
+
+			if (Nodes.empty())
+			{
+				return;
+			}
+
+			std::array<glm::vec3, RayPacket::MaxRayCount> inverseDirections;
+			for (uint32_t mask = rayMask; mask != 0; mask &= mask - 1)
+			{
+				const auto r = static_cast<uint32_t>(std::countr_zero(mask));
+				inverseDirections[r] = 1.0f / packet.Directions[r];
+			}
+
+			// Nodes still to visit along with the rays that reached their parent
+			std::array<uint32_t, Bvh::MaxTreeDepth + 1> stackNodes;
+			std::array<uint32_t, Bvh::MaxTreeDepth + 1> stackRayMasks;
+			uint32_t stackSize = 0;
+			stackNodes[stackSize] = 0;
+			stackRayMasks[stackSize] = rayMask;
+			++stackSize;
+
+			uint32_t activeMask = rayMask;
+			while (stackSize > 0 && activeMask != 0)
+			{
+				--stackSize;
+				const auto& node = Nodes[stackNodes[stackSize]];
+
+				uint32_t nodeRayMask = 0;
+				for (uint32_t mask = stackRayMasks[stackSize] & activeMask; mask != 0; mask &= mask - 1)
+				{
+					const auto r = static_cast<uint32_t>(std::countr_zero(mask));
+					float tEntry;
+					if (IntersectBvhNodeBounds(node, packet.Origin, inverseDirections[r], packet.TMin, pHits[r].T, tEntry))
+					{
+						nodeRayMask |= 1u << r;
+					}
+				}
+
+				if (nodeRayMask == 0)
+				{
+					continue;
+				}
+
+				if (node.IsLeaf())
+				{
+					for (uint32_t i = node.LeftFirst; i < node.LeftFirst + node.PrimitiveCount && nodeRayMask != 0; ++i)
+					{
+						const uint32_t continueMask = visitInstance(LeafInstances[i], nodeRayMask);
+						activeMask &= ~nodeRayMask | continueMask;
+						nodeRayMask &= continueMask;
+					}
+					continue;
+				}
+
+				// Every ray starts at the same point, so the child with the closer centre is visited first for all of them
+				const auto& left = Nodes[node.LeftFirst];
+				const auto& right = Nodes[node.LeftFirst + 1];
+				const glm::vec3 leftOffset = (left.BoundsMin + left.BoundsMax) * 0.5f - packet.Origin;
+				const glm::vec3 rightOffset = (right.BoundsMin + right.BoundsMax) * 0.5f - packet.Origin;
+				const bool leftFirst = glm::dot(leftOffset, leftOffset) <= glm::dot(rightOffset, rightOffset);
+
+				stackNodes[stackSize] = leftFirst ? node.LeftFirst + 1 : node.LeftFirst;
+				stackRayMasks[stackSize] = nodeRayMask;
+				++stackSize;
+				stackNodes[stackSize] = leftFirst ? node.LeftFirst : node.LeftFirst + 1;
+				stackRayMasks[stackSize] = nodeRayMask;
+				++stackSize;
+			}
+		}
+	}
+}
\ No newline at end of file
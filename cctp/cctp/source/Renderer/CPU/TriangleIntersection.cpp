@@ -0,0 +1,390 @@
+#include "CpuPch.h"
+#include "TriangleIntersection.h"
+#include "Math/Simd.h"
+
+// Matches the determinant epsilon of IntersectTriangle
+constexpr float MOLLER_TRUMBORE_EPSILON = 1e-8f;
+
+// Picks the closest of the hits in validMask from lane values stored by a kernel
+int32_t SelectClosestTriangleLane(uint32_t validMask, const float* pT, const float* pU, const float* pV, float& t, glm::vec2& barycentrics)
+{
+	int32_t closestLane = -1;
+	for (; validMask != 0; validMask &= validMask - 1)
+	{
+		const auto lane = static_cast<int32_t>(std::countr_zero(validMask));
+		if (closestLane < 0 || pT[lane] < pT[closestLane])
+		{
+			closestLane = lane;
+		}
+	}
+
+	if (closestLane >= 0)
+	{
+		t = pT[closestLane];
+		barycentrics = glm::vec2(pU[closestLane], pV[closestLane]);
+	}
+	return closestLane;
+}
+
+// IntersectTriangle for four triangles whose vertex rows start at pVertices and are rowStride floats apart
+int32_t IntersectTrianglesMollerTrumboreSse(const float* pVertices, const uint32_t rowStride, const Renderer::CPU::TriangleRay& ray, const bool cullBackFaces,
+	const float tMin, const float tMax, float& t, glm::vec2& barycentrics)
+{
+	auto load = [&](const uint32_t row) { return _mm_load_ps(pVertices + row * rowStride); };
+	const __m128 v0x = load(0);
+	const __m128 v0y = load(1);
+	const __m128 v0z = load(2);
+	const __m128 edge1x = _mm_sub_ps(load(3), v0x);
+	const __m128 edge1y = _mm_sub_ps(load(4), v0y);
+	const __m128 edge1z = _mm_sub_ps(load(5), v0z);
+	const __m128 edge2x = _mm_sub_ps(load(6), v0x);
+	const __m128 edge2y = _mm_sub_ps(load(7), v0y);
+	const __m128 edge2z = _mm_sub_ps(load(8), v0z);
+	const __m128 directionX = _mm_set1_ps(ray.Direction.x);
+	const __m128 directionY = _mm_set1_ps(ray.Direction.y);
+	const __m128 directionZ = _mm_set1_ps(ray.Direction.z);
+
+	// p = cross(direction, edge2)
+	const __m128 px = _mm_sub_ps(_mm_mul_ps(directionY, edge2z), _mm_mul_ps(edge2y, directionZ));
+	const __m128 py = _mm_sub_ps(_mm_mul_ps(directionZ, edge2x), _mm_mul_ps(edge2z, directionX));
+	const __m128 pz = _mm_sub_ps(_mm_mul_ps(directionX, edge2y), _mm_mul_ps(edge2x, directionY));
+	const __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edge1x, px), _mm_mul_ps(edge1y, py)), _mm_mul_ps(edge1z, pz));
+
+	const __m128 epsilon = _mm_set1_ps(MOLLER_TRUMBORE_EPSILON);
+	__m128 valid = cullBackFaces ? _mm_cmpge_ps(determinant, epsilon) : _mm_cmpge_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), determinant), epsilon);
+	if (_mm_movemask_ps(valid) == 0)
+	{
+		return -1;
+	}
+
+	const __m128 inverseDeterminant = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+	const __m128 sx = _mm_sub_ps(_mm_set1_ps(ray.Origin.x), v0x);
+	const __m128 sy = _mm_sub_ps(_mm_set1_ps(ray.Origin.y), v0y);
+	const __m128 sz = _mm_sub_ps(_mm_set1_ps(ray.Origin.z), v0z);
+	const __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inverseDeterminant);
+
+	// q = cross(s, edge1)
+	const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, edge1z), _mm_mul_ps(edge1y, sz));
+	const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, edge1x), _mm_mul_ps(edge1z, sx));
+	const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, edge1y), _mm_mul_ps(edge1x, sy));
+	const __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(directionX, qx), _mm_mul_ps(directionY, qy)), _mm_mul_ps(directionZ, qz)), inverseDeterminant);
+	const __m128 hitT = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(edge2x, qx), _mm_mul_ps(edge2y, qy)), _mm_mul_ps(edge2z, qz)), inverseDeterminant);
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmple_ps(u, one)));
+	valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(v, zero), _mm_cmple_ps(_mm_add_ps(u, v), one)));
+	valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(hitT, _mm_set1_ps(tMin)), _mm_cmplt_ps(hitT, _mm_set1_ps(tMax))));
+
+	alignas(16) std::array<float, 4> laneT;
+	alignas(16) std::array<float, 4> laneU;
+	alignas(16) std::array<float, 4> laneV;
+	_mm_store_ps(laneT.data(), hitT);
+	_mm_store_ps(laneU.data(), u);
+	_mm_store_ps(laneV.data(), v);
+	return SelectClosestTriangleLane(static_cast<uint32_t>(_mm_movemask_ps(valid)), laneT.data(), laneU.data(), laneV.data(), t, barycentrics);
+}
+
+// IntersectTriangleWatertight for four triangles
+int32_t IntersectTrianglesWatertightSse(const float* pVertices, const uint32_t rowStride, const Renderer::CPU::TriangleRay& ray, const bool cullBackFaces,
+	const float tMin, const float tMax, float& t, glm::vec2& barycentrics)
+{
+	const uint32_t kx = ray.Axes[0];
+	const uint32_t ky = ray.Axes[1];
+	const uint32_t kz = ray.Axes[2];
+
+	// Vertices relative to the ray origin
+	auto load = [&](const uint32_t vertex, const uint32_t axis)
+	{
+		return _mm_sub_ps(_mm_load_ps(pVertices + (vertex * 3 + axis) * rowStride), _mm_set1_ps(ray.Origin[axis]));
+	};
+	const __m128 az = load(0, kz);
+	const __m128 bz = load(1, kz);
+	const __m128 cz = load(2, kz);
+
+	// Shear so the ray runs along +z through the origin
+	const __m128 shearX = _mm_set1_ps(ray.Shear.x);
+	const __m128 shearY = _mm_set1_ps(ray.Shear.y);
+	const __m128 ax = _mm_sub_ps(load(0, kx), _mm_mul_ps(shearX, az));
+	const __m128 ay = _mm_sub_ps(load(0, ky), _mm_mul_ps(shearY, az));
+	const __m128 bx = _mm_sub_ps(load(1, kx), _mm_mul_ps(shearX, bz));
+	const __m128 by = _mm_sub_ps(load(1, ky), _mm_mul_ps(shearY, bz));
+	const __m128 cx = _mm_sub_ps(load(2, kx), _mm_mul_ps(shearX, cz));
+	const __m128 cy = _mm_sub_ps(load(2, ky), _mm_mul_ps(shearY, cz));
+
+	// Scaled barycentrics are the signed areas of the triangles the ray forms with each edge
+	const __m128 edgeU = _mm_sub_ps(_mm_mul_ps(cx, by), _mm_mul_ps(cy, bx));
+	const __m128 edgeV = _mm_sub_ps(_mm_mul_ps(ax, cy), _mm_mul_ps(ay, cx));
+	const __m128 edgeW = _mm_sub_ps(_mm_mul_ps(bx, ay), _mm_mul_ps(by, ax));
+
+	// Front faces have positive areas
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 allNonPositive = _mm_and_ps(_mm_cmple_ps(edgeU, zero), _mm_and_ps(_mm_cmple_ps(edgeV, zero), _mm_cmple_ps(edgeW, zero)));
+	const __m128 allNonNegative = _mm_and_ps(_mm_cmpge_ps(edgeU, zero), _mm_and_ps(_mm_cmpge_ps(edgeV, zero), _mm_cmpge_ps(edgeW, zero)));
+	const __m128 determinant = _mm_add_ps(_mm_add_ps(edgeU, edgeV), edgeW);
+	__m128 valid = _mm_and_ps(cullBackFaces ? allNonNegative : _mm_or_ps(allNonPositive, allNonNegative), _mm_cmpneq_ps(determinant, zero));
+	if (_mm_movemask_ps(valid) == 0)
+	{
+		return -1;
+	}
+
+	const __m128 shearZ = _mm_set1_ps(ray.Shear.z);
+	const __m128 scaledT = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edgeU, _mm_mul_ps(shearZ, az)), _mm_mul_ps(edgeV, _mm_mul_ps(shearZ, bz))),
+		_mm_mul_ps(edgeW, _mm_mul_ps(shearZ, cz)));
+	const __m128 inverseDeterminant = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+	const __m128 hitT = _mm_mul_ps(scaledT, inverseDeterminant);
+	valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(hitT, _mm_set1_ps(tMin)), _mm_cmplt_ps(hitT, _mm_set1_ps(tMax))));
+
+	alignas(16) std::array<float, 4> laneT;
+	alignas(16) std::array<float, 4> laneU;
+	alignas(16) std::array<float, 4> laneV;
+	_mm_store_ps(laneT.data(), hitT);
+	_mm_store_ps(laneU.data(), _mm_mul_ps(edgeV, inverseDeterminant));
+	_mm_store_ps(laneV.data(), _mm_mul_ps(edgeW, inverseDeterminant));
+	return SelectClosestTriangleLane(static_cast<uint32_t>(_mm_movemask_ps(valid)), laneT.data(), laneU.data(), laneV.data(), t, barycentrics);
+}
+
+// IntersectTrianglesMollerTrumboreSse for the eight triangles of a pack
+SIMD_AVX2 int32_t IntersectTrianglesMollerTrumboreAvx2(const Renderer::CPU::TrianglePack<8>& pack, const Renderer::CPU::TriangleRay& ray, const bool cullBackFaces,
+	const float tMin, const float tMax, float& t, glm::vec2& barycentrics)
+{
+	const __m256 v0x = _mm256_load_ps(pack.Vertices[0]);
+	const __m256 v0y = _mm256_load_ps(pack.Vertices[1]);
+	const __m256 v0z = _mm256_load_ps(pack.Vertices[2]);
+	const __m256 edge1x = _mm256_sub_ps(_mm256_load_ps(pack.Vertices[3]), v0x);
+	const __m256 edge1y = _mm256_sub_ps(_mm256_load_ps(pack.Vertices[4]), v0y);
+	const __m256 edge1z = _mm256_sub_ps(_mm256_load_ps(pack.Vertices[5]), v0z);
+	const __m256 edge2x = _mm256_sub_ps(_mm256_load_ps(pack.Vertices[6]), v0x);
+	const __m256 edge2y = _mm256_sub_ps(_mm256_load_ps(pack.Vertices[7]), v0y);
+	const __m256 edge2z = _mm256_sub_ps(_mm256_load_ps(pack.Vertices[8]), v0z);
+	const __m256 directionX = _mm256_set1_ps(ray.Direction.x);
+	const __m256 directionY = _mm256_set1_ps(ray.Direction.y);
+	const __m256 directionZ = _mm256_set1_ps(ray.Direction.z);
+
+	// p = cross(direction, edge2)
+	const __m256 px = _mm256_sub_ps(_mm256_mul_ps(directionY, edge2z), _mm256_mul_ps(edge2y, directionZ));
+	const __m256 py = _mm256_sub_ps(_mm256_mul_ps(directionZ, edge2x), _mm256_mul_ps(edge2z, directionX));
+	const __m256 pz = _mm256_sub_ps(_mm256_mul_ps(directionX, edge2y), _mm256_mul_ps(edge2x, directionY));
+	const __m256 determinant = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(edge1x, px), _mm256_mul_ps(edge1y, py)), _mm256_mul_ps(edge1z, pz));
+
+	const __m256 epsilon = _mm256_set1_ps(MOLLER_TRUMBORE_EPSILON);
+	__m256 valid = cullBackFaces ? _mm256_cmp_ps(determinant, epsilon, _CMP_GE_OQ) :
+		_mm256_cmp_ps(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), determinant), epsilon, _CMP_GE_OQ);
+	if (_mm256_movemask_ps(valid) == 0)
+	{
+		return -1;
+	}
+
+	const __m256 inverseDeterminant = _mm256_div_ps(_mm256_set1_ps(1.0f), determinant);
+	const __m256 sx = _mm256_sub_ps(_mm256_set1_ps(ray.Origin.x), v0x);
+	const __m256 sy = _mm256_sub_ps(_mm256_set1_ps(ray.Origin.y), v0y);
+	const __m256 sz = _mm256_sub_ps(_mm256_set1_ps(ray.Origin.z), v0z);
+	const __m256 u = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, px), _mm256_mul_ps(sy, py)), _mm256_mul_ps(sz, pz)), inverseDeterminant);
+
+	// q = cross(s, edge1)
+	const __m256 qx = _mm256_sub_ps(_mm256_mul_ps(sy, edge1z), _mm256_mul_ps(edge1y, sz));
+	const __m256 qy = _mm256_sub_ps(_mm256_mul_ps(sz, edge1x), _mm256_mul_ps(edge1z, sx));
+	const __m256 qz = _mm256_sub_ps(_mm256_mul_ps(sx, edge1y), _mm256_mul_ps(edge1x, sy));
+	const __m256 v = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(directionX, qx), _mm256_mul_ps(directionY, qy)), _mm256_mul_ps(directionZ, qz)),
+		inverseDeterminant);
+	const __m256 hitT = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(edge2x, qx), _mm256_mul_ps(edge2y, qy)), _mm256_mul_ps(edge2z, qz)),
+		inverseDeterminant);
+
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(u, zero, _CMP_GE_OQ), _mm256_cmp_ps(u, one, _CMP_LE_OQ)));
+	valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(v, zero, _CMP_GE_OQ), _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ)));
+	valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(hitT, _mm256_set1_ps(tMin), _CMP_GE_OQ), _mm256_cmp_ps(hitT, _mm256_set1_ps(tMax), _CMP_LT_OQ)));
+
+	alignas(32) std::array<float, 8> laneT;
+	alignas(32) std::array<float, 8> laneU;
+	alignas(32) std::array<float, 8> laneV;
+	_mm256_store_ps(laneT.data(), hitT);
+	_mm256_store_ps(laneU.data(), u);
+	_mm256_store_ps(laneV.data(), v);
+	return SelectClosestTriangleLane(static_cast<uint32_t>(_mm256_movemask_ps(valid)), laneT.data(), laneU.data(), laneV.data(), t, barycentrics);
+}
+
+// IntersectTrianglesWatertightSse for the eight triangles of a pack
+SIMD_AVX2 int32_t IntersectTrianglesWatertightAvx2(const Renderer::CPU::TrianglePack<8>& pack, const Renderer::CPU::TriangleRay& ray, const bool cullBackFaces,
+	const float tMin, const float tMax, float& t, glm::vec2& barycentrics)
+{
+	const uint32_t kx = ray.Axes[0];
+	const uint32_t ky = ray.Axes[1];
+	const uint32_t kz = ray.Axes[2];
+
+	// Vertices relative to the ray origin
+	const __m256 originX = _mm256_set1_ps(ray.Origin[kx]);
+	const __m256 originY = _mm256_set1_ps(ray.Origin[ky]);
+	const __m256 originZ = _mm256_set1_ps(ray.Origin[kz]);
+	const __m256 az = _mm256_sub_ps(_mm256_load_ps(pack.Vertices[kz]), originZ);
+	const __m256 bz = _mm256_sub_ps(_mm256_load_ps(pack.Vertices[3 + kz]), originZ);
+	const __m256 cz = _mm256_sub_ps(_mm256_load_ps(pack.Vertices[6 + kz]), originZ);
+
+	// Shear so the ray runs along +z through the origin
+	const __m256 shearX = _mm256_set1_ps(ray.Shear.x);
+	const __m256 shearY = _mm256_set1_ps(ray.Shear.y);
+	const __m256 ax = _mm256_sub_ps(_mm256_sub_ps(_mm256_load_ps(pack.Vertices[kx]), originX), _mm256_mul_ps(shearX, az));
+	const __m256 ay = _mm256_sub_ps(_mm256_sub_ps(_mm256_load_ps(pack.Vertices[ky]), originY), _mm256_mul_ps(shearY, az));
+	const __m256 bx = _mm256_sub_ps(_mm256_sub_ps(_mm256_load_ps(pack.Vertices[3 + kx]), originX), _mm256_mul_ps(shearX, bz));
+	const __m256 by = _mm256_sub_ps(_mm256_sub_ps(_mm256_load_ps(pack.Vertices[3 + ky]), originY), _mm256_mul_ps(shearY, bz));
+	const __m256 cx = _mm256_sub_ps(_mm256_sub_ps(_mm256_load_ps(pack.Vertices[6 + kx]), originX), _mm256_mul_ps(shearX, cz));
+	const __m256 cy = _mm256_sub_ps(_mm256_sub_ps(_mm256_load_ps(pack.Vertices[6 + ky]), originY), _mm256_mul_ps(shearY, cz));
+
+	// Scaled barycentrics are the signed areas of the triangles the ray forms with each edge
+	const __m256 edgeU = _mm256_sub_ps(_mm256_mul_ps(cx, by), _mm256_mul_ps(cy, bx));
+	const __m256 edgeV = _mm256_sub_ps(_mm256_mul_ps(ax, cy), _mm256_mul_ps(ay, cx));
+	const __m256 edgeW = _mm256_sub_ps(_mm256_mul_ps(bx, ay), _mm256_mul_ps(by, ax));
+
+	// Front faces have positive areas
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 allNonPositive = _mm256_and_ps(_mm256_cmp_ps(edgeU, zero, _CMP_LE_OQ),
+		_mm256_and_ps(_mm256_cmp_ps(edgeV, zero, _CMP_LE_OQ), _mm256_cmp_ps(edgeW, zero, _CMP_LE_OQ)));
+	const __m256 allNonNegative = _mm256_and_ps(_mm256_cmp_ps(edgeU, zero, _CMP_GE_OQ),
+		_mm256_and_ps(_mm256_cmp_ps(edgeV, zero, _CMP_GE_OQ), _mm256_cmp_ps(edgeW, zero, _CMP_GE_OQ)));
+	const __m256 determinant = _mm256_add_ps(_mm256_add_ps(edgeU, edgeV), edgeW);
+	__m256 valid = _mm256_and_ps(cullBackFaces ? allNonNegative : _mm256_or_ps(allNonPositive, allNonNegative), _mm256_cmp_ps(determinant, zero, _CMP_NEQ_OQ));
+	if (_mm256_movemask_ps(valid) == 0)
+	{
+		return -1;
+	}
+
+	const __m256 shearZ = _mm256_set1_ps(ray.Shear.z);
+	const __m256 scaledT = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(edgeU, _mm256_mul_ps(shearZ, az)), _mm256_mul_ps(edgeV, _mm256_mul_ps(shearZ, bz))),
+		_mm256_mul_ps(edgeW, _mm256_mul_ps(shearZ, cz)));
+	const __m256 inverseDeterminant = _mm256_div_ps(_mm256_set1_ps(1.0f), determinant);
+	const __m256 hitT = _mm256_mul_ps(scaledT, inverseDeterminant);
+	valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(hitT, _mm256_set1_ps(tMin), _CMP_GE_OQ), _mm256_cmp_ps(hitT, _mm256_set1_ps(tMax), _CMP_LT_OQ)));
+
+	alignas(32) std::array<float, 8> laneT;
+	alignas(32) std::array<float, 8> laneU;
+	alignas(32) std::array<float, 8> laneV;
+	_mm256_store_ps(laneT.data(), hitT);
+	_mm256_store_ps(laneU.data(), _mm256_mul_ps(edgeV, inverseDeterminant));
+	_mm256_store_ps(laneV.data(), _mm256_mul_ps(edgeW, inverseDeterminant));
+	return SelectClosestTriangleLane(static_cast<uint32_t>(_mm256_movemask_ps(valid)), laneT.data(), laneU.data(), laneV.data(), t, barycentrics);
+}
+
+int32_t IntersectTrianglesSse(const float* pVertices, const uint32_t rowStride, const Renderer::CPU::TriangleRay& ray, const Renderer::CPU::TriangleTest test,
+	const bool cullBackFaces, const float tMin, const float tMax, float& t, glm::vec2& barycentrics)
+{
+	return (test == Renderer::CPU::TriangleTest::Watertight) ?
+		IntersectTrianglesWatertightSse(pVertices, rowStride, ray, cullBackFaces, tMin, tMax, t, barycentrics) :
+		IntersectTrianglesMollerTrumboreSse(pVertices, rowStride, ray, cullBackFaces, tMin, tMax, t, barycentrics);
+}
+
+Renderer::CPU::TriangleRay Renderer::CPU::CreateTriangleRay(const glm::vec3& origin, const glm::vec3& direction)
+{
+	TriangleRay ray = {};
+	ray.Origin = origin;
+	ray.Direction = direction;
+
+	// Run along the largest direction axis. Swapping the other two axes for negative directions keeps triangle winding
+	const glm::vec3 absoluteDirection = glm::abs(direction);
+	uint32_t kz = 0;
+	if (absoluteDirection.y > absoluteDirection[kz])
+	{
+		kz = 1;
+	}
+	if (absoluteDirection.z > absoluteDirection[kz])
+	{
+		kz = 2;
+	}
+	uint32_t kx = (kz + 1) % 3;
+	uint32_t ky = (kx + 1) % 3;
+	if (direction[kz] < 0.0f)
+	{
+		std::swap(kx, ky);
+	}
+
+	ray.Axes = { kx, ky, kz };
+	ray.Shear = glm::vec3(direction[kx] / direction[kz], direction[ky] / direction[kz], 1.0f / direction[kz]);
+	return ray;
+}
+
+template<uint32_t Width>
+void Renderer::CPU::AppendTrianglePacks(const BvhTriangle* pTriangles, const uint32_t* pPrimitiveIndices, const size_t triangleCount,
+	std::vector<TrianglePack<Width>>& packs)
+{
+	for (size_t first = 0; first < triangleCount; first += Width)
+	{
+		auto& pack = packs.emplace_back();
+		for (uint32_t lane = 0; lane < Width; ++lane)
+		{
+			// Unused lanes repeat the last triangle, which can only report the same hit again
+			const size_t i = std::min(first + lane, triangleCount - 1);
+			const BvhTriangle& triangle = pTriangles[i];
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				pack.Vertices[axis][lane] = triangle.V0[axis];
+				pack.Vertices[3 + axis][lane] = triangle.V1[axis];
+				pack.Vertices[6 + axis][lane] = triangle.V2[axis];
+			}
+			pack.PrimitiveIndices[lane] = pPrimitiveIndices[i];
+		}
+	}
+}
+
+template void Renderer::CPU::AppendTrianglePacks<4>(const BvhTriangle*, const uint32_t*, const size_t, std::vector<TrianglePack<4>>&);
+template void Renderer::CPU::AppendTrianglePacks<8>(const BvhTriangle*, const uint32_t*, const size_t, std::vector<TrianglePack<8>>&);
+
+int32_t Renderer::CPU::IntersectTrianglePack(const TrianglePack<4>& pack, const TriangleRay& ray, const TriangleTest test, const bool cullBackFaces,
+	const float tMin, const float tMax, float& t, glm::vec2& barycentrics)
+{
+	return IntersectTrianglesSse(&pack.Vertices[0][0], 4, ray, test, cullBackFaces, tMin, tMax, t, barycentrics);
+}
+
+int32_t Renderer::CPU::IntersectTrianglePack(const TrianglePack<8>& pack, const TriangleRay& ray, const TriangleTest test, const bool cullBackFaces,
+	const float tMin, const float tMax, float& t, glm::vec2& barycentrics)
+{
+	if (Math::SupportsAvx2())
+	{
+		return (test == TriangleTest::Watertight) ?
+			IntersectTrianglesWatertightAvx2(pack, ray, cullBackFaces, tMin, tMax, t, barycentrics) :
+			IntersectTrianglesMollerTrumboreAvx2(pack, ray, cullBackFaces, tMin, tMax, t, barycentrics);
+	}
+
+	// Two halves of four triangles. The second half only reports hits closer than the first
+	int32_t lane = IntersectTrianglesSse(&pack.Vertices[0][0], 8, ray, test, cullBackFaces, tMin, tMax, t, barycentrics);
+	const int32_t upperLane = IntersectTrianglesSse(&pack.Vertices[0][4], 8, ray, test, cullBackFaces, tMin, (lane >= 0) ? t : tMax, t, barycentrics);
+	return (upperLane >= 0) ? upperLane + 4 : lane;
+}
+
+bool Renderer::CPU::IntersectTriangleWatertight(const TriangleRay& ray, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, const bool cullBackFaces,
+	float& t, glm::vec2& barycentrics)
+{
+	const uint32_t kx = ray.Axes[0];
+	const uint32_t ky = ray.Axes[1];
+	const uint32_t kz = ray.Axes[2];
+
+	// Vertices relative to the ray origin, sheared so the ray runs along +z
+	const glm::vec3 a = v0 - ray.Origin;
+	const glm::vec3 b = v1 - ray.Origin;
+	const glm::vec3 c = v2 - ray.Origin;
+	const float ax = a[kx] - ray.Shear.x * a[kz];
+	const float ay = a[ky] - ray.Shear.y * a[kz];
+	const float bx = b[kx] - ray.Shear.x * b[kz];
+	const float by = b[ky] - ray.Shear.y * b[kz];
+	const float cx = c[kx] - ray.Shear.x * c[kz];
+	const float cy = c[ky] - ray.Shear.y * c[kz];
+
+	// Neighbouring triangles compute shared edges as exact negations, which only holds while the products are not fused into fma
+	const float edgeU = cx * by - cy * bx;
+	const float edgeV = ax * cy - ay * cx;
+	const float edgeW = bx * ay - by * ax;
+
+	// Front faces have positive areas
+	const bool allNonPositive = edgeU <= 0.0f && edgeV <= 0.0f && edgeW <= 0.0f;
+	const bool allNonNegative = edgeU >= 0.0f && edgeV >= 0.0f && edgeW >= 0.0f;
+	const float determinant = edgeU + edgeV + edgeW;
+	if (!(cullBackFaces ? allNonNegative : (allNonPositive || allNonNegative)) || determinant == 0.0f)
+	{
+		return false;
+	}
+
+	const float scaledT = edgeU * (ray.Shear.z * a[kz]) + edgeV * (ray.Shear.z * b[kz]) + edgeW * (ray.Shear.z * c[kz]);
+	const float inverseDeterminant = 1.0f / determinant;
+	t = scaledT * inverseDeterminant;
+	barycentrics = glm::vec2(edgeV * inverseDeterminant, edgeW * inverseDeterminant);
+	return true;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Bvh.h"
+
+namespace Renderer
+{
+	namespace CPU
+	{
+		enum class TriangleTest
+		{
+			// Fastest, but rays through a shared edge can slip between both triangles
+			MollerTrumbore,
+			// Woop, Benthin and Wald. Never misses both triangles of a shared edge, as DXR guarantees
+			Watertight
+		};
+
+		// Triangles tested against a ray at once with SIMD, in the leaf order of a bvh. Vertex positions are stored as rows of one lane per triangle,
+		// in the order v0 x, v0 y, v0 z, v1 x, ... v2 z. Unused lanes repeat the last triangle of the pack
+		template<uint32_t Width>
+		struct alignas(Width * sizeof(float)) TrianglePack
+		{
+			float Vertices[9][Width];
+			// Index of each triangle in the source index buffer
+			uint32_t PrimitiveIndices[Width];
+		};
+
+		// Ray values shared by every triangle test
+		struct TriangleRay
+		{
+			glm::vec3 Origin = glm::vec3(0.0f, 0.0f, 0.0f);
+			glm::vec3 Direction = glm::vec3(0.0f, 0.0f, 1.0f);
+			// The watertight test shears triangles so the ray runs along its largest direction axis, Axes[2]
+			std::array<uint32_t, 3> Axes = { 0, 1, 2 };
+			glm::vec3 Shear = glm::vec3(0.0f, 0.0f, 1.0f);
+		};
+
+		TriangleRay CreateTriangleRay(const glm::vec3& origin, const glm::vec3& direction);
+		// Appends packs holding the triangles in order
+		template<uint32_t Width>
+		void AppendTrianglePacks(const BvhTriangle* pTriangles, const uint32_t* pPrimitiveIndices, const size_t triangleCount, std::vector<TrianglePack<Width>>& packs);
+
+		// Finds the closest hit between tMin and tMax among the triangles of the pack. Returns the lane of the hit, writing t and barycentrics, or -1 on a miss.
+		// 4 wide packs are tested with SSE, 8 wide packs with AVX2 when supported
+		int32_t IntersectTrianglePack(const TrianglePack<4>& pack, const TriangleRay& ray, const TriangleTest test, const bool cullBackFaces, const float tMin,
+			const float tMax, float& t, glm::vec2& barycentrics);
+		int32_t IntersectTrianglePack(const TrianglePack<8>& pack, const TriangleRay& ray, const TriangleTest test, const bool cullBackFaces, const float tMin,
+			const float tMax, float& t, glm::vec2& barycentrics);
+
+		// Scalar watertight ray triangle test with the same facing and barycentrics as IntersectTriangle
+		bool IntersectTriangleWatertight(const TriangleRay& ray, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, const bool cullBackFaces,
+			float& t, glm::vec2& barycentrics);
+
+		// Moller-Trumbore ray triangle test. Triangles wound clockwise when viewed from the ray origin are front facing, as in DXR
+		inline bool IntersectTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2,
+			const bool cullBackFaces, float& t, glm::vec2& barycentrics)
+		{
+			constexpr float epsilon = 1e-8f;
+
+			const glm::vec3 edge1 = v1 - v0;
+			const glm::vec3 edge2 = v2 - v0;
+			const glm::vec3 p = glm::cross(direction, edge2);
+			const float determinant = glm::dot(edge1, p);
+
+			if (cullBackFaces ? (determinant < epsilon) : (std::abs(determinant) < epsilon))
+			{
+				return false;
+			}
+
+			const float inverseDeterminant = 1.0f / determinant;
+			const glm::vec3 s = origin - v0;
+			const float u = glm::dot(s, p) * inverseDeterminant;
+			if (u < 0.0f || u > 1.0f)
+			{
+				return false;
+			}
+
+			const glm::vec3 q = glm::cross(s, edge1);
+			const float v = glm::dot(direction, q) * inverseDeterminant;
+			if (v < 0.0f || u + v > 1.0f)
+			{
+				return false;
+			}
+
+			t = glm::dot(edge2, q) * inverseDeterminant;
+			barycentrics = glm::vec2(u, v);
+			return true;
+		}
+	}
+}
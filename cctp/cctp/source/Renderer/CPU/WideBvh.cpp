@@ -0,0 +1,453 @@
+#include "CpuPch.h"
+#include "WideBvh.h"
+#include "Math/Simd.h"
+
+// Ray values shared by every box test of a traversal
+struct WideBvhRay
+{
+	glm::vec3 Origin = glm::vec3(0.0f, 0.0f, 0.0f);
+	glm::vec3 InverseDirection = glm::vec3(0.0f, 0.0f, 0.0f);
+	// Bounds rows of the planes the ray enters and leaves through along each axis, picked by the sign of the direction
+	std::array<uint32_t, 3> NearRows = { 0, 1, 2 };
+	std::array<uint32_t, 3> FarRows = { 3, 4, 5 };
+};
+
+// Node or leaf waiting to be visited. Entry is the closest distance any of the rays in RayMask enters it
+struct WideBvhStackEntry
+{
+	uint32_t Child = 0;
+	uint32_t PrimitiveCount = 0;
+	float Entry = 0.0f;
+	uint32_t RayMask = 0;
+};
+
+WideBvhRay CreateWideBvhRay(const glm::vec3& origin, const glm::vec3& direction)
+{
+	WideBvhRay ray = {};
+	ray.Origin = origin;
+	ray.InverseDirection = 1.0f / direction;
+	for (uint32_t axis = 0; axis < 3; ++axis)
+	{
+		// Picking planes by direction sign leaves empty bounds, where min is greater than max, with an entry beyond their exit
+		const bool negative = std::signbit(ray.InverseDirection[axis]);
+		ray.NearRows[axis] = negative ? axis + 3 : axis;
+		ray.FarRows[axis] = negative ? axis : axis + 3;
+	}
+	return ray;
+}
+
+// Slab test of four children whose bounds rows start at pBounds and are rowStride floats apart. Writes the entry distance of each child
+// and returns a mask with a bit set for every child hit
+uint32_t IntersectWideBvhBoundsSse(const float* pBounds, const uint32_t rowStride, const WideBvhRay& ray, const float tMin, const float tMax, float* pEntries)
+{
+	auto slab = [&](const uint32_t row, const uint32_t axis)
+	{
+		return _mm_mul_ps(_mm_sub_ps(_mm_load_ps(pBounds + row * rowStride), _mm_set1_ps(ray.Origin[axis])), _mm_set1_ps(ray.InverseDirection[axis]));
+	};
+
+	const __m128 entry = _mm_max_ps(_mm_max_ps(slab(ray.NearRows[0], 0), slab(ray.NearRows[1], 1)), _mm_max_ps(slab(ray.NearRows[2], 2), _mm_set1_ps(tMin)));
+	const __m128 exit = _mm_min_ps(_mm_min_ps(slab(ray.FarRows[0], 0), slab(ray.FarRows[1], 1)), _mm_min_ps(slab(ray.FarRows[2], 2), _mm_set1_ps(tMax)));
+	_mm_storeu_ps(pEntries, entry);
+	return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(entry, exit)));
+}
+
+// Slab test of the eight children of a Bvh8Node
+SIMD_AVX2 uint32_t IntersectWideBvhBoundsAvx2(const float* pBounds, const WideBvhRay& ray, const float tMin, const float tMax, float* pEntries)
+{
+	const __m256 originX = _mm256_set1_ps(ray.Origin.x);
+	const __m256 originY = _mm256_set1_ps(ray.Origin.y);
+	const __m256 originZ = _mm256_set1_ps(ray.Origin.z);
+	const __m256 inverseDirectionX = _mm256_set1_ps(ray.InverseDirection.x);
+	const __m256 inverseDirectionY = _mm256_set1_ps(ray.InverseDirection.y);
+	const __m256 inverseDirectionZ = _mm256_set1_ps(ray.InverseDirection.z);
+
+	const __m256 nearX = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(pBounds + ray.NearRows[0] * 8), originX), inverseDirectionX);
+	const __m256 nearY = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(pBounds + ray.NearRows[1] * 8), originY), inverseDirectionY);
+	const __m256 nearZ = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(pBounds + ray.NearRows[2] * 8), originZ), inverseDirectionZ);
+	const __m256 farX = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(pBounds + ray.FarRows[0] * 8), originX), inverseDirectionX);
+	const __m256 farY = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(pBounds + ray.FarRows[1] * 8), originY), inverseDirectionY);
+	const __m256 farZ = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(pBounds + ray.FarRows[2] * 8), originZ), inverseDirectionZ);
+
+	const __m256 entry = _mm256_max_ps(_mm256_max_ps(nearX, nearY), _mm256_max_ps(nearZ, _mm256_set1_ps(tMin)));
+	const __m256 exit = _mm256_min_ps(_mm256_min_ps(farX, farY), _mm256_min_ps(farZ, _mm256_set1_ps(tMax)));
+	_mm256_storeu_ps(pEntries, entry);
+	return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(entry, exit, _CMP_LE_OQ)));
+}
+
+template<uint32_t Width, bool UseAvx2>
+uint32_t IntersectWideBvhChildren(const Renderer::CPU::WideBvhNode<Width>& node, const WideBvhRay& ray, const float tMin, const float tMax, float* pEntries)
+{
+	if constexpr (Width == 4)
+	{
+		return IntersectWideBvhBoundsSse(&node.Bounds[0][0], Width, ray, tMin, tMax, pEntries);
+	}
+	else if constexpr (UseAvx2)
+	{
+		return IntersectWideBvhBoundsAvx2(&node.Bounds[0][0], ray, tMin, tMax, pEntries);
+	}
+	else
+	{
+		// Two halves of four children
+		return IntersectWideBvhBoundsSse(&node.Bounds[0][0], Width, ray, tMin, tMax, pEntries) |
+			(IntersectWideBvhBoundsSse(&node.Bounds[0][4], Width, ray, tMin, tMax, pEntries + 4) << 4);
+	}
+}
+
+// Pushes a child so entries pushed since firstEntry stay sorted far to near, and the nearest child is popped first
+void PushWideBvhStackEntry(WideBvhStackEntry* pStack, uint32_t& stackSize, const uint32_t firstEntry, const WideBvhStackEntry& entry)
+{
+	uint32_t i = stackSize++;
+	while (i > firstEntry && pStack[i - 1].Entry < entry.Entry)
+	{
+		pStack[i] = pStack[i - 1];
+		--i;
+	}
+	pStack[i] = entry;
+}
+
+template<uint32_t Width>
+struct WideBvhBuildContext
+{
+	const Renderer::CPU::Bvh* pBvh = nullptr;
+	std::vector<Renderer::CPU::WideBvhNode<Width>>* pNodes = nullptr;
+	std::vector<Renderer::CPU::TrianglePack<Width>>* pTrianglePacks = nullptr;
+	Renderer::CPU::WideBvhStats* pStats = nullptr;
+};
+
+template<uint32_t Width>
+uint32_t CollapseBvhNode(WideBvhBuildContext<Width>& context, const uint32_t binaryNodeIndex, const uint32_t depth)
+{
+	const auto& binaryNodes = context.pBvh->GetNodes();
+	auto& nodes = *context.pNodes;
+	auto& stats = *context.pStats;
+
+	auto getSurfaceArea = [&](const uint32_t binaryIndex)
+	{
+		BoundingBox bounds;
+		bounds.Min = binaryNodes[binaryIndex].BoundsMin;
+		bounds.Max = binaryNodes[binaryIndex].BoundsMax;
+		return bounds.GetSurfaceArea();
+	};
+
+	// Gather children by repeatedly opening the largest interior child, as it is the most likely to be hit
+	std::array<uint32_t, Width> children;
+	uint32_t childCount = 0;
+	const auto& binaryNode = binaryNodes[binaryNodeIndex];
+	if (binaryNode.IsLeaf())
+	{
+		children[childCount++] = binaryNodeIndex;
+	}
+	else
+	{
+		children[childCount++] = binaryNode.LeftFirst;
+		children[childCount++] = binaryNode.LeftFirst + 1;
+	}
+
+	while (childCount < Width)
+	{
+		int32_t largestChild = -1;
+		float largestArea = -1.0f;
+		for (uint32_t i = 0; i < childCount; ++i)
+		{
+			if (!binaryNodes[children[i]].IsLeaf() && getSurfaceArea(children[i]) > largestArea)
+			{
+				largestArea = getSurfaceArea(children[i]);
+				largestChild = static_cast<int32_t>(i);
+			}
+		}
+
+		if (largestChild < 0)
+		{
+			break;
+		}
+
+		const uint32_t openedChild = children[largestChild];
+		children[largestChild] = binaryNodes[openedChild].LeftFirst;
+		children[childCount++] = binaryNodes[openedChild].LeftFirst + 1;
+	}
+
+	const auto nodeIndex = static_cast<uint32_t>(nodes.size());
+	nodes.emplace_back();
+	for (uint32_t lane = 0; lane < Width; ++lane)
+	{
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			nodes[nodeIndex].Bounds[axis][lane] = std::numeric_limits<float>::max();
+			nodes[nodeIndex].Bounds[axis + 3][lane] = -std::numeric_limits<float>::max();
+		}
+		nodes[nodeIndex].Children[lane] = Renderer::CPU::INVALID_ID;
+		nodes[nodeIndex].PrimitiveCounts[lane] = 0;
+	}
+
+	stats.MaxDepth = std::max(stats.MaxDepth, depth);
+	stats.AverageChildCount += static_cast<float>(childCount);
+
+	for (uint32_t lane = 0; lane < childCount; ++lane)
+	{
+		const auto& child = binaryNodes[children[lane]];
+
+		// Collapsing the child may reallocate the nodes
+		uint32_t childIndex;
+		if (child.IsLeaf())
+		{
+			childIndex = static_cast<uint32_t>(context.pTrianglePacks->size());
+			Renderer::CPU::AppendTrianglePacks(&context.pBvh->GetTriangles()[child.LeftFirst], &context.pBvh->GetPrimitiveIndices()[child.LeftFirst],
+				child.PrimitiveCount, *context.pTrianglePacks);
+			++stats.LeafCount;
+		}
+		else
+		{
+			childIndex = CollapseBvhNode(context, children[lane], depth + 1);
+		}
+
+		auto& node = nodes[nodeIndex];
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			node.Bounds[axis][lane] = child.BoundsMin[axis];
+			node.Bounds[axis + 3][lane] = child.BoundsMax[axis];
+		}
+		node.Children[lane] = childIndex;
+		node.PrimitiveCounts[lane] = child.PrimitiveCount;
+	}
+
+	return nodeIndex;
+}
+
+template<uint32_t Width>
+const Renderer::CPU::WideBvhStats& Renderer::CPU::WideBvh<Width>::Build(const Bvh& bvh, const TriangleTest triangleTest)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	Nodes.clear();
+	TrianglePacks.clear();
+	Test = triangleTest;
+	Stats = {};
+
+	if (!bvh.IsEmpty())
+	{
+		WideBvhBuildContext<Width> context = {};
+		context.pBvh = &bvh;
+		context.pNodes = &Nodes;
+		context.pTrianglePacks = &TrianglePacks;
+		context.pStats = &Stats;
+
+		// A binary tree collapses into at most as many wide nodes as it has interior nodes
+		Nodes.reserve(bvh.GetNodes().size() / 2 + 1);
+		CollapseBvhNode(context, 0, 0);
+		Nodes.shrink_to_fit();
+		TrianglePacks.shrink_to_fit();
+	}
+
+	Stats.NodeCount = Nodes.size();
+	Stats.AverageChildCount = (Stats.NodeCount > 0) ? Stats.AverageChildCount / static_cast<float>(Stats.NodeCount) : 0.0f;
+	Stats.TrianglePackCount = TrianglePacks.size();
+	Stats.TrianglePackOccupancy = (Stats.TrianglePackCount > 0) ?
+		static_cast<float>(bvh.GetTriangles().size()) / static_cast<float>(Stats.TrianglePackCount * Width) : 0.0f;
+	Stats.BuildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	return Stats;
+}
+
+template<uint32_t Width>
+bool Renderer::CPU::WideBvh<Width>::Intersect(const glm::vec3& origin, const glm::vec3& direction, const float tMin, const bool cullBackFaces, const bool anyHit,
+	RayHit& hit) const
+{
+	if constexpr (Width == 8)
+	{
+		if (Math::SupportsAvx2())
+		{
+			return IntersectRay<true>(origin, direction, tMin, cullBackFaces, anyHit, hit);
+		}
+	}
+	return IntersectRay<false>(origin, direction, tMin, cullBackFaces, anyHit, hit);
+}
+
+template<uint32_t Width>
+uint32_t Renderer::CPU::WideBvh<Width>::IntersectPacket(const RayPacket& packet, const uint32_t rayMask, const bool cullBackFaces, const bool anyHit,
+	RayHit* pHits) const
+{
+	if constexpr (Width == 8)
+	{
+		if (Math::SupportsAvx2())
+		{
+			return IntersectRays<true>(packet, rayMask, cullBackFaces, anyHit, pHits);
+		}
+	}
+	return IntersectRays<false>(packet, rayMask, cullBackFaces, anyHit, pHits);
+}
+
+template<uint32_t Width>
+template<bool UseAvx2>
+bool Renderer::CPU::WideBvh<Width>::IntersectRay(const glm::vec3& origin, const glm::vec3& direction, const float tMin, const bool cullBackFaces, const bool anyHit,
+	RayHit& hit) const
+{
+	if (Nodes.empty())
+	{
+		return false;
+	}
+
+	const WideBvhRay ray = CreateWideBvhRay(origin, direction);
+	const TriangleRay triangleRay = CreateTriangleRay(origin, direction);
+
+	std::array<WideBvhStackEntry, MaxStackSize> stack;
+	uint32_t stackSize = 0;
+	stack[stackSize++] = { 0, 0, tMin, 0 };
+
+	bool hitFound = false;
+	while (stackSize > 0)
+	{
+		const WideBvhStackEntry entry = stack[--stackSize];
+		if (entry.Entry >= hit.T)
+		{
+			continue;
+		}
+
+		if (entry.PrimitiveCount > 0)
+		{
+			const uint32_t packCount = (entry.PrimitiveCount + Width - 1) / Width;
+			for (uint32_t i = entry.Child; i < entry.Child + packCount; ++i)
+			{
+				float t;
+				glm::vec2 barycentrics;
+				const int32_t lane = IntersectTrianglePack(TrianglePacks[i], triangleRay, Test, cullBackFaces, tMin, hit.T, t, barycentrics);
+				if (lane >= 0)
+				{
+					hit.T = t;
+					hit.Barycentrics = barycentrics;
+					hit.PrimitiveIndex = TrianglePacks[i].PrimitiveIndices[lane];
+					hitFound = true;
+
+					if (anyHit)
+					{
+						return true;
+					}
+				}
+			}
+			continue;
+		}
+
+		const auto& node = Nodes[entry.Child];
+		std::array<float, Width> childEntries;
+		uint32_t childMask = IntersectWideBvhChildren<Width, UseAvx2>(node, ray, tMin, hit.T, childEntries.data());
+
+		const uint32_t firstEntry = stackSize;
+		for (; childMask != 0; childMask &= childMask - 1)
+		{
+			const auto lane = static_cast<uint32_t>(std::countr_zero(childMask));
+			PushWideBvhStackEntry(stack.data(), stackSize, firstEntry, { node.Children[lane], node.PrimitiveCounts[lane], childEntries[lane], 0 });
+		}
+	}
+
+	return hitFound;
+}
+
+template<uint32_t Width>
+template<bool UseAvx2>
+uint32_t Renderer::CPU::WideBvh<Width>::IntersectRays(const RayPacket& packet, const uint32_t rayMask, const bool cullBackFaces, const bool anyHit,
+	RayHit* pHits) const
+{
+	if (Nodes.empty() || rayMask == 0)
+	{
+		return 0;
+	}
+
+	std::array<WideBvhRay, RayPacket::MaxRayCount> rays;
+	std::array<TriangleRay, RayPacket::MaxRayCount> triangleRays;
+	for (uint32_t mask = rayMask; mask != 0; mask &= mask - 1)
+	{
+		const auto r = static_cast<uint32_t>(std::countr_zero(mask));
+		rays[r] = CreateWideBvhRay(packet.Origin, packet.Directions[r]);
+		triangleRays[r] = CreateTriangleRay(packet.Origin, packet.Directions[r]);
+	}
+
+	// Every ray shares the stack, so a node is fetched once for all rays reaching it
+	std::array<WideBvhStackEntry, MaxStackSize> stack;
+	uint32_t stackSize = 0;
+	stack[stackSize++] = { 0, 0, packet.TMin, rayMask };
+
+	uint32_t activeMask = rayMask;
+	uint32_t hitMask = 0;
+	while (stackSize > 0 && activeMask != 0)
+	{
+		const WideBvhStackEntry entry = stack[--stackSize];
+
+		// Drop rays that have already hit something closer than the entry
+		uint32_t entryMask = entry.RayMask & activeMask;
+		for (uint32_t mask = entryMask; mask != 0; mask &= mask - 1)
+		{
+			const auto r = static_cast<uint32_t>(std::countr_zero(mask));
+			if (entry.Entry >= pHits[r].T)
+			{
+				entryMask &= ~(1u << r);
+			}
+		}
+
+		if (entryMask == 0)
+		{
+			continue;
+		}
+
+		if (entry.PrimitiveCount > 0)
+		{
+			const uint32_t packCount = (entry.PrimitiveCount + Width - 1) / Width;
+			for (uint32_t i = entry.Child; i < entry.Child + packCount; ++i)
+			{
+				for (uint32_t mask = entryMask; mask != 0; mask &= mask - 1)
+				{
+					const auto r = static_cast<uint32_t>(std::countr_zero(mask));
+					auto& hit = pHits[r];
+
+					float t;
+					glm::vec2 barycentrics;
+					const int32_t lane = IntersectTrianglePack(TrianglePacks[i], triangleRays[r], Test, cullBackFaces, packet.TMin, hit.T, t, barycentrics);
+					if (lane >= 0)
+					{
+						hit.T = t;
+						hit.Barycentrics = barycentrics;
+						hit.PrimitiveIndex = TrianglePacks[i].PrimitiveIndices[lane];
+						hitMask |= 1u << r;
+
+						if (anyHit)
+						{
+							activeMask &= ~(1u << r);
+							entryMask &= ~(1u << r);
+						}
+					}
+				}
+			}
+			continue;
+		}
+
+		// Test the children against every ray, gathering the rays that reach each child
+		const auto& node = Nodes[entry.Child];
+		std::array<uint32_t, Width> childRayMasks = {};
+		std::array<float, Width> childEntries;
+		childEntries.fill(std::numeric_limits<float>::max());
+		for (uint32_t mask = entryMask; mask != 0; mask &= mask - 1)
+		{
+			const auto r = static_cast<uint32_t>(std::countr_zero(mask));
+
+			std::array<float, Width> rayEntries;
+			for (uint32_t childMask = IntersectWideBvhChildren<Width, UseAvx2>(node, rays[r], packet.TMin, pHits[r].T, rayEntries.data());
+				childMask != 0; childMask &= childMask - 1)
+			{
+				const auto lane = static_cast<uint32_t>(std::countr_zero(childMask));
+				childRayMasks[lane] |= 1u << r;
+				childEntries[lane] = std::min(childEntries[lane], rayEntries[lane]);
+			}
+		}
+
+		const uint32_t firstEntry = stackSize;
+		for (uint32_t lane = 0; lane < Width; ++lane)
+		{
+			if (childRayMasks[lane] != 0)
+			{
+				PushWideBvhStackEntry(stack.data(), stackSize, firstEntry, { node.Children[lane], node.PrimitiveCounts[lane], childEntries[lane], childRayMasks[lane] });
+			}
+		}
+	}
+
+	return hitMask;
+}
+
+template class Renderer::CPU::WideBvh<4>;
+template class Renderer::CPU::WideBvh<8>;
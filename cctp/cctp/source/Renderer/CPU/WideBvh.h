@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Bvh.h"
+#include "TriangleIntersection.h"
+
+namespace Renderer
+{
+	namespace CPU
+	{
+		// Node with up to Width children whose bounds are tested against a ray at once with SIMD. Bounds are stored as rows of one lane per child,
+		// in the order min x, min y, min z, max x, max y, max z. Unused child slots hold empty bounds, which no ray intersects
+		template<uint32_t Width>
+		struct alignas(Width * sizeof(float)) WideBvhNode
+		{
+			float Bounds[6][Width];
+			// Index of the child node for interior children. Index of the first triangle pack for leaf children
+			uint32_t Children[Width];
+			// Triangle count of leaf children, which fill (count + Width - 1) / Width packs. Zero for interior children and unused slots
+			uint32_t PrimitiveCounts[Width];
+		};
+		using Bvh4Node = WideBvhNode<4>;
+		using Bvh8Node = WideBvhNode<8>;
+		static_assert(sizeof(Bvh4Node) == 128, "Bvh4Node is expected to be 128 bytes.");
+		static_assert(sizeof(Bvh8Node) == 256, "Bvh8Node is expected to be 256 bytes.");
+
+		struct WideBvhStats
+		{
+			size_t NodeCount = 0;
+			size_t LeafCount = 0;
+			size_t TrianglePackCount = 0;
+			// Share of triangle pack lanes holding a triangle
+			float TrianglePackOccupancy = 0.0f;
+			// Average number of used child slots per node
+			float AverageChildCount = 0.0f;
+			uint32_t MaxDepth = 0;
+			double BuildMilliseconds = 0.0;
+		};
+
+		// Bvh with up to Width children per node, built by collapsing a binary Bvh. Children are tested with SSE in 4 wide nodes and with AVX2 in 8 wide nodes,
+		// falling back to SSE on CPUs without AVX2. Leaf triangles are stored in packs of Width triangles tested with the same instruction set.
+		// Traces single rays, and packets of rays sharing an origin through a single traversal
+		template<uint32_t Width>
+		class WideBvh
+		{
+		public:
+			static_assert(Width == 4 || Width == 8, "WideBvh supports 4 and 8 children per node.");
+
+			// Every level of the tree pushes at most Width - 1 more entries than it pops
+			static constexpr uint32_t MaxStackSize = Bvh::MaxTreeDepth * (Width - 1) + 1;
+
+			// Copies the triangles of the binary bvh, which can be destroyed afterwards
+			const WideBvhStats& Build(const Bvh& bvh, const TriangleTest triangleTest = TriangleTest::Watertight);
+
+			// Finds the closest triangle hit between tMin and hit.T, as Bvh::Intersect does
+			bool Intersect(const glm::vec3& origin, const glm::vec3& direction, const float tMin, const bool cullBackFaces, const bool anyHit, RayHit& hit) const;
+			// Traces the rays of the packet set in rayMask, each against its own hit as Intersect does. Returns the mask of rays whose hit was updated
+			uint32_t IntersectPacket(const RayPacket& packet, const uint32_t rayMask, const bool cullBackFaces, const bool anyHit, RayHit* pHits) const;
+
+			bool IsEmpty() const { return Nodes.empty(); }
+			const auto& GetNodes() const { return Nodes; }
+			const auto& GetTrianglePacks() const { return TrianglePacks; }
+			TriangleTest GetTriangleTest() const { return Test; }
+			const WideBvhStats& GetStats() const { return Stats; }
+			size_t GetMemoryBytes() const { return Nodes.size() * sizeof(WideBvhNode<Width>) + TrianglePacks.size() * sizeof(TrianglePack<Width>); }
+
+		private:
+			template<bool UseAvx2>
+			bool IntersectRay(const glm::vec3& origin, const glm::vec3& direction, const float tMin, const bool cullBackFaces, const bool anyHit, RayHit& hit) const;
+			template<bool UseAvx2>
+			uint32_t IntersectRays(const RayPacket& packet, const uint32_t rayMask, const bool cullBackFaces, const bool anyHit, RayHit* pHits) const;
+
+		private:
+			std::vector<WideBvhNode<Width>> Nodes;
+			// Triangles in the leaf order of the binary bvh, each leaf starting a new pack
+			std::vector<TrianglePack<Width>> TrianglePacks;
+			TriangleTest Test = TriangleTest::Watertight;
+			WideBvhStats Stats;
+		};
+
+		using Bvh4 = WideBvh<4>;
+		using Bvh8 = WideBvh<8>;
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+// Probe field constants shared with the raytracing shaders. These must be kept in sync with the defines in Shaders/Common.hlsl
+namespace Renderer
+{
+	// The max number of probe volumes sharing the probe pool. Volume descriptions are stored in the per frame constant buffer
+	constexpr size_t MAX_PROBE_VOLUME_COUNT = 8;
+	// The number of rays traced from a probe. Every ray is filtered into every texel of the probe's squares, so the count is independent of the side
+	// lengths below
+	constexpr uint32_t PROBE_RAY_COUNT = 32;
+	// The number of rotations of the probe ray directions in the probe ray table. Rotation zero leaves the directions unrotated
+	constexpr uint32_t PROBE_RAY_ROTATION_COUNT = 64;
+	// The amount of texels in a square side used to store a probe's irradiance data
+	constexpr uint32_t IRRADIANCE_PROBE_SIDE_LENGTH = 8;
+	// The amount of texels in a square side used to store a probe's visibility data
+	constexpr uint32_t VISIBILITY_PROBE_SIDE_LENGTH = 16;
+	// The most spherical harmonic coefficients a probe stores, for bands zero to two. Probes of L1 volumes store the first four
+	constexpr uint32_t PROBE_SH_MAX_COEFFICIENT_COUNT = 9;
+	// Channels of each spherical harmonic coefficient: irradiance (rgb), distance and square distance
+	constexpr uint32_t PROBE_SH_CHANNEL_COUNT = 5;
+	// The uints holding a probe's coefficients in the spherical harmonic buffer, two halves to a uint, channels of a coefficient next to each other
+	constexpr uint32_t PROBE_SH_STRIDE = (PROBE_SH_MAX_COEFFICIENT_COUNT * PROBE_SH_CHANNEL_COUNT + 1) / 2;
+	// Border size in texels on every side of each probe's data. Borders hold the texels across the edges of the octahedral square, so bilinear
+	// samples near an edge blend in the directions beyond it instead of a neighbouring probe's
+	constexpr uint32_t PROBE_PADDING = 1;
+	// The maximum distance a probe ray can travel
+	constexpr float PROBE_MAX_RAY_DISTANCE = 1.0f;
+	// Exponent of the cosine weighting a probe's rays are filtered into visibility texels with. Higher keeps each texel to the rays closest to its
+	// direction, so distances stay sharp at the edges of occluders
+	constexpr float PROBE_VISIBILITY_SHARPNESS = 50.0f;
+	// Fraction of the probe spacing a shading point is pushed along its normal before probe visibility is tested from it
+	constexpr float PROBE_VISIBILITY_NORMAL_BIAS = 0.2f;
+	// Least variance of a probe's hit distances the visibility weight assumes, so texels whose rays all hit at one distance still fade smoothly
+	constexpr float PROBE_MIN_VISIBILITY_VARIANCE = 0.0001f;
+	// The fraction of a probe's previous irradiance and visibility kept when new rays are blended in
+	constexpr float PROBE_HYSTERESIS = 0.97f;
+	// A probe whose output changed by more than half this fraction since the last gather blends with less hysteresis, reaching none at this fraction
+	// where it discards its history
+	constexpr float PROBE_CHANGE_THRESHOLD = 0.25f;
+	constexpr float SHADOW_BIAS = 0.04f;
+
+	// The largest width and height of an atlas texture, matching D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION
+	constexpr uint32_t MAX_ATLAS_DIMENSION = 16384;
+
+	// A probe volume's grid as the shaders see it. Matches ProbeVolumeData in Shaders/Common.hlsl
+	struct ProbeVolumeData
+	{
+		glm::vec4 GridOriginAndSpacing = glm::vec4(0.0f); // Stores the position of grid coordinate zero (xyz) and probe spacing (w)
+		glm::ivec4 ProbeCounts = glm::ivec4(0); // Stores probe counts (xyz) and the pool index of the volume's first probe (w)
+		glm::ivec4 ScrollOffset = glm::ivec4(0); // Stores the toroidal scroll offset (xyz) and the ProbeEncoding of the volume's probes (w)
+	};
+
+	// How new probe rays are blended into the atlases. Stored in the per frame constant buffer
+	struct ProbeBlendSettings
+	{
+		float Hysteresis = PROBE_HYSTERESIS;
+		float ChangeThreshold = PROBE_CHANGE_THRESHOLD;
+	};
+
+	// Blend history of a probe, written by RayGen every gather. Matches ProbeStatistics in Shaders/Common.hlsl
+	struct ProbeStatistics
+	{
+		glm::vec3 Position = glm::vec3(0.0f); // The position the probe's history was gathered at. A probe moved elsewhere starts a new history
+		float SampleCount = 0.0f; // The number of gathers blended into the history
+		float Change = 0.0f; // Mean relative change of the probe's rays against its history in the last gather
+		float LuminanceVariance = 0.0f; // Variance of the per ray luminance change in the last gather
+		float MeanLuminance = 0.0f; // Mean luminance of the probe's rays after the last blend
+		float Hysteresis = 0.0f; // The hysteresis the last gather was blended with
+	};
+}
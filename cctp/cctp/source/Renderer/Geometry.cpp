@@ -1,4 +1,4 @@
-#include "Pch.h"
+#include "CpuPch.h"
 #include "Geometry.h"
 
 void Renderer::Geometry::GenerateCubeGeometry(std::vector<Vertex1Pos1UV1Norm>& outVertices, std::vector<uint32_t>& outIndices, const float width)
@@ -106,3 +106,37 @@ void Renderer::Geometry::GenerateSphereGeometry(std::vector<Vertex1Pos1UV1Norm>&
 
     std::reverse(outIndices.begin(), outIndices.end());
 }
+
+
+void Renderer::Geometry::GenerateTriangleSoupGeometry(std::vector<Vertex1Pos1UV1Norm>& outVertices, std::vector<uint32_t>& outIndices,
+    const size_t triangleCount, const float width, const float triangleSize, const uint32_t seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> centreDistribution(-0.5f * width, 0.5f * width);
+    std::uniform_real_distribution<float> offsetDistribution(-0.5f * triangleSize, 0.5f * triangleSize);
+
+    outVertices.reserve(outVertices.size() + triangleCount * 3);
+    outIndices.reserve(outIndices.size() + triangleCount * 3);
+
+    for (size_t i = 0; i < triangleCount; i++)
+    {
+        const glm::vec3 centre(centreDistribution(generator), centreDistribution(generator), centreDistribution(generator));
+
+        Renderer::Vertex1Pos1UV1Norm verts[3];
+        for (auto& vert : verts)
+        {
+            vert.Position = centre + glm::vec3(offsetDistribution(generator), offsetDistribution(generator), offsetDistribution(generator));
+        }
+
+        glm::vec3 normal = glm::cross(verts[1].Position - verts[0].Position, verts[2].Position - verts[0].Position);
+        const float length = glm::length(normal);
+        normal = (length > 0.f) ? normal / length : glm::vec3(0.f, 1.f, 0.f);
+
+        for (auto& vert : verts)
+        {
+            vert.Normal = normal;
+            outIndices.push_back(static_cast<uint32_t>(outVertices.size()));
+            outVertices.push_back(vert);
+        }
+    }
+}
\ No newline at end of file
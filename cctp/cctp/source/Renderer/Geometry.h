@@ -9,5 +9,8 @@ namespace Renderer
 		void GenerateCubeGeometry(std::vector<Vertex1Pos1UV1Norm>& outVertices, std::vector<uint32_t>& outIndices, const float width);
 		void GenerateSphereGeometry(std::vector<Vertex1Pos1UV1Norm>& outVertices, std::vector<uint32_t>& outIndices, 
 			const float radius, const int32_t sectors, const int32_t stacks);
+		// Randomly placed and oriented triangles inside a cube of the given width centred on the origin
+		void GenerateTriangleSoupGeometry(std::vector<Vertex1Pos1UV1Norm>& outVertices, std::vector<uint32_t>& outIndices,
+			const size_t triangleCount, const float width, const float triangleSize, const uint32_t seed);
 	}
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "Pch.h"
 #include "GraphicsPipeline.h"
 #include "Binary/Binary.h"
+#include "Renderer/Renderer.h"
 
 bool Renderer::GraphicsPipeline::Init(ID3D12Device* pDevice, DXGI_FORMAT renderTargetFormat)
 {
@@ -52,7 +53,7 @@ bool Renderer::GraphicsPipeline::Init(ID3D12Device* pDevice, DXGI_FORMAT renderT
     perFrameConstantBufferDescriptorPixelDesc.ShaderRegister = 0;
     perFrameConstantBufferDescriptorPixelDesc.RegisterSpace = 0;
 
-    D3D12_DESCRIPTOR_RANGE tableRanges[3];
+    D3D12_DESCRIPTOR_RANGE tableRanges[4];
     // Shadow map
     tableRanges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
     tableRanges[0].BaseShaderRegister = 0;
@@ -74,6 +75,13 @@ bool Renderer::GraphicsPipeline::Init(ID3D12Device* pDevice, DXGI_FORMAT renderT
     tableRanges[2].NumDescriptors = 1;
     tableRanges[2].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
 
+    // Probe positions, states and spherical harmonic coefficients. The table starts at the shadow map
+    tableRanges[3].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+    tableRanges[3].BaseShaderRegister = 3;
+    tableRanges[3].RegisterSpace = 0;
+    tableRanges[3].NumDescriptors = 3;
+    tableRanges[3].OffsetInDescriptorsFromTableStart = Renderer::PROBE_POSITIONS_SRV_DESCRIPTOR_INDEX - Renderer::SHADOW_MAP_SRV_DESCRIPTOR_INDEX;
+
     D3D12_ROOT_DESCRIPTOR_TABLE dTable = {};
     dTable.NumDescriptorRanges = _countof(tableRanges);
     dTable.pDescriptorRanges = tableRanges;
@@ -0,0 +1,37 @@
+#include "CpuPch.h"
+#include "ProbeAtlasLayout.h"
+
+Renderer::ProbeAtlasLayout::ProbeAtlasLayout(const size_t probeCount, const glm::ivec3& gridProbeCounts)
+{
+	// The visibility atlas has the larger tiles, so it limits how many probes fit along a side
+	const uint32_t maxProbesPerSide = MAX_ATLAS_DIMENSION / (std::max(IRRADIANCE_PROBE_SIDE_LENGTH, VISIBILITY_PROBE_SIDE_LENGTH) + 2 * PROBE_PADDING);
+	const auto count = static_cast<uint32_t>(std::max<size_t>(probeCount, 1));
+	const auto squareProbesPerRow = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+
+	// Prefer rows holding whole grid slices, then whole grid rows, as long as the atlas stays within twice the width of a square one
+	const auto sliceProbeCount = static_cast<uint32_t>(std::max(gridProbeCounts.x * gridProbeCounts.y, 1));
+	const auto rowProbeCount = static_cast<uint32_t>(std::max(gridProbeCounts.x, 1));
+	uint32_t alignment = 1;
+	for (const uint32_t candidate : { sliceProbeCount, rowProbeCount })
+	{
+		if (candidate <= maxProbesPerSide && candidate <= squareProbesPerRow * 2)
+		{
+			alignment = candidate;
+			break;
+		}
+	}
+
+	ProbesPerRow = std::min(((squareProbesPerRow + alignment - 1) / alignment) * alignment, (maxProbesPerSide / alignment) * alignment);
+	RowCount = (count + ProbesPerRow - 1) / ProbesPerRow;
+	assert(RowCount <= maxProbesPerSide && "Attempting to lay out more probes than the largest atlas holds.");
+}
+
+glm::uvec2 Renderer::ProbeAtlasLayout::GetAtlasDimensions(const uint32_t singleProbeSideLength) const
+{
+	return glm::uvec2(ProbesPerRow, RowCount) * (singleProbeSideLength + 2 * PROBE_PADDING);
+}
+
+glm::ivec4 Renderer::ProbeAtlasLayout::GetShaderData() const
+{
+	return glm::ivec4(static_cast<int32_t>(ProbesPerRow), static_cast<int32_t>(RowCount), static_cast<int32_t>(GetProbeCapacity()), 0);
+}
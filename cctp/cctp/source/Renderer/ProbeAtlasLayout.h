@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Renderer/GIConstants.h"
+
+namespace Renderer
+{
+	// Tiles the octahedral maps of a probe pool across 2D atlases. Probe p takes the tile in column p % ProbesPerRow and row p / ProbesPerRow, each
+	// tile being a probe's square of texels inside a border of padding, as GetProbeTopLeftPosition in Shaders/Common.hlsl lays them out. The atlases are
+	// kept near square, and rows hold whole grid slices or rows of probes where possible so probes read together by a shading cage sit close in the
+	// atlas
+	class ProbeAtlasLayout
+	{
+	public:
+		ProbeAtlasLayout() = default;
+		// Lays out at least the probe count. Grid probe counts are those of the volumes in the pool, used to align rows with grid slices
+		ProbeAtlasLayout(const size_t probeCount, const glm::ivec3& gridProbeCounts);
+
+		const auto& GetProbesPerRow() const { return ProbesPerRow; }
+		const auto& GetRowCount() const { return RowCount; }
+		uint32_t GetProbeCapacity() const { return ProbesPerRow * RowCount; }
+		// Texel dimensions of an atlas storing probes with the side length
+		glm::uvec2 GetAtlasDimensions(const uint32_t singleProbeSideLength) const;
+		glm::uvec2 GetIrradianceAtlasDimensions() const { return GetAtlasDimensions(IRRADIANCE_PROBE_SIDE_LENGTH); }
+		glm::uvec2 GetVisibilityAtlasDimensions() const { return GetAtlasDimensions(VISIBILITY_PROBE_SIDE_LENGTH); }
+		// Stores probes per atlas row (x), atlas row count (y) and atlas probe capacity (z), as probeAtlasLayout in the shader per frame constants
+		glm::ivec4 GetShaderData() const;
+
+	private:
+		uint32_t ProbesPerRow = 0;
+		uint32_t RowCount = 0;
+	};
+}
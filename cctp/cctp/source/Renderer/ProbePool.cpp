@@ -0,0 +1,118 @@
+#include "CpuPch.h"
+#include "ProbePool.h"
+
+Renderer::ProbePool::ProbePool()
+{
+	// Reserving every volume up front keeps references to volumes valid as more are added
+	Volumes.reserve(MAX_PROBE_VOLUME_COUNT);
+	BaseProbeIndices.reserve(MAX_PROBE_VOLUME_COUNT);
+}
+
+uint32_t Renderer::ProbePool::AddVolume(ProbeVolume&& volume)
+{
+	assert(Volumes.size() < MAX_PROBE_VOLUME_COUNT && "Attempting to add more probe volumes than the max probe volume count.");
+	assert(static_cast<size_t>(TotalProbeCount) + volume.GetTotalProbeCount() <= std::numeric_limits<int32_t>::max() &&
+		"Pool indices must fit in the signed integers shaders store them in.");
+
+	BaseProbeIndices.push_back(TotalProbeCount);
+	TotalProbeCount += static_cast<uint32_t>(volume.GetTotalProbeCount());
+	Volumes.push_back(std::move(volume));
+	++LayoutVersion;
+	return static_cast<uint32_t>(Volumes.size() - 1);
+}
+
+uint32_t Renderer::ProbePool::AddCascades(const glm::vec3& position, const glm::vec3& volumeExtents, float probeSpacing, const uint32_t cascadeCount,
+	float debugProbeSize)
+{
+	const uint32_t firstVolumeIndex = GetVolumeCount();
+	glm::vec3 extents = volumeExtents;
+	for (uint32_t i = 0; i < cascadeCount; ++i)
+	{
+		ProbeVolume cascade(position, extents, probeSpacing, debugProbeSize);
+		cascade.SetScrolling(true);
+		AddVolume(std::move(cascade));
+
+		// Every cascade has the same probe counts and covers eight times the volume of the last
+		extents *= 2.0f;
+		probeSpacing *= 2.0f;
+		debugProbeSize *= 2.0f;
+	}
+	return firstVolumeIndex;
+}
+
+void Renderer::ProbePool::RemoveVolumes(const uint32_t firstVolumeIndex)
+{
+	if (firstVolumeIndex >= Volumes.size())
+	{
+		return;
+	}
+
+	TotalProbeCount = BaseProbeIndices[firstVolumeIndex];
+	Volumes.erase(Volumes.begin() + firstVolumeIndex, Volumes.end());
+	BaseProbeIndices.erase(BaseProbeIndices.begin() + firstVolumeIndex, BaseProbeIndices.end());
+	++LayoutVersion;
+}
+
+void Renderer::ProbePool::Update()
+{
+	for (auto& volume : Volumes)
+	{
+		volume.Update();
+	}
+}
+
+void Renderer::ProbePool::GetProbesAffectedBy(const BoundingBox& boundsWS, const glm::vec3& lightDirectionWS, const float rayDistance,
+	std::vector<uint32_t>& poolProbeIndices) const
+{
+	if (boundsWS.IsEmpty())
+	{
+		return;
+	}
+
+	// A surface within the ray distance of a probe is shadowed by the bounds when the ray from it towards the light enters them, so the ray from
+	// the probe towards the light enters the bounds grown by the ray distance
+	const glm::vec3 reachMin = boundsWS.Min - glm::vec3(rayDistance);
+	const glm::vec3 reachMax = boundsWS.Max + glm::vec3(rayDistance);
+	const glm::vec3 lightVector = -glm::normalize(lightDirectionWS);
+	for (uint32_t v = 0; v < GetVolumeCount(); ++v)
+	{
+		const auto& positions = Volumes[v].GetProbePositions();
+		for (uint32_t i = 0; i < static_cast<uint32_t>(positions.size()); ++i)
+		{
+			// Slab test along the light vector from the probe
+			float entry = 0.0f;
+			float exit = std::numeric_limits<float>::max();
+			for (int32_t axis = 0; (axis < 3) && (entry <= exit); ++axis)
+			{
+				const float position = positions[i][axis];
+				if (std::abs(lightVector[axis]) < 1.0e-6f)
+				{
+					// Parallel to the slab, which the probe is either inside or misses
+					exit = ((position >= reachMin[axis]) && (position <= reachMax[axis])) ? exit : -1.0f;
+					continue;
+				}
+				const float t0 = (reachMin[axis] - position) / lightVector[axis];
+				const float t1 = (reachMax[axis] - position) / lightVector[axis];
+				entry = std::max(entry, std::min(t0, t1));
+				exit = std::min(exit, std::max(t0, t1));
+			}
+			if (entry <= exit)
+			{
+				poolProbeIndices.push_back(BaseProbeIndices[v] + i);
+			}
+		}
+	}
+}
+
+void Renderer::ProbePool::GetVolumeData(std::vector<ProbeVolumeData>& volumeData) const
+{
+	volumeData.resize(Volumes.size());
+	for (size_t i = 0; i < Volumes.size(); ++i)
+	{
+		const auto& volume = Volumes[i];
+		volumeData[i].GridOriginAndSpacing = glm::vec4(volume.GetGridOrigin(), volume.GetProbeSpacing());
+		volumeData[i].ProbeCounts = glm::ivec4(static_cast<int32_t>(volume.GetProbeCountX()), static_cast<int32_t>(volume.GetProbeCountY()),
+			static_cast<int32_t>(volume.GetProbeCountZ()), static_cast<int32_t>(BaseProbeIndices[i]));
+		volumeData[i].ScrollOffset = glm::ivec4(volume.GetScrollOffset(), static_cast<int32_t>(volume.GetProbeEncoding()));
+	}
+}
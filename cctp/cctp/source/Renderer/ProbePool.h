@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Renderer/GIConstants.h"
+#include "Renderer/ProbeVolume.h"
+
+namespace Renderer
+{
+	// Probe volumes sharing one probe index space. Each volume's probes occupy a contiguous range of pool indices starting at the volume's base
+	// probe index, so the probe data of every volume is uploaded into one set of structured buffers and shaders address any probe with a single
+	// index. Volumes are looked up in the order they were added, so finer volumes should be added before the coarser volumes around them
+	class ProbePool
+	{
+	public:
+		ProbePool();
+
+		// Adds a volume after the existing volumes and returns its index
+		uint32_t AddVolume(ProbeVolume&& volume);
+		// Adds scrolling volumes centred on the position, each with twice the probe spacing and extents of the last, and returns the index of the finest
+		uint32_t AddCascades(const glm::vec3& position, const glm::vec3& volumeExtents, float probeSpacing, const uint32_t cascadeCount, float debugProbeSize);
+		// Removes the volume at the index and every volume after it. Earlier volumes keep their index and probe range
+		void RemoveVolumes(const uint32_t firstVolumeIndex);
+		// Updates every volume
+		void Update();
+
+		// Volumes are never reallocated, so references to them stay valid until they are removed
+		ProbeVolume& GetVolume(const uint32_t volumeIndex) { return Volumes[volumeIndex]; }
+		const ProbeVolume& GetVolume(const uint32_t volumeIndex) const { return Volumes[volumeIndex]; }
+		uint32_t GetVolumeCount() const { return static_cast<uint32_t>(Volumes.size()); }
+		const auto& GetBaseProbeIndex(const uint32_t volumeIndex) const { return BaseProbeIndices[volumeIndex]; }
+		const auto& GetTotalProbeCount() const { return TotalProbeCount; }
+		// Counts up each time volumes are added or removed. Pool indices and probe data uploaded for an older layout are invalid
+		const auto& GetLayoutVersion() const { return LayoutVersion; }
+		// Appends the pool index of every probe that can see a change inside the bounds: probes whose rays reach into the bounds, and probes whose rays
+		// reach surfaces the bounds cast a shadow on from the directional light. Conservative, a probe within the ray distance of the bounds' box
+		// along the light is included. Other probes never see the change
+		void GetProbesAffectedBy(const BoundingBox& boundsWS, const glm::vec3& lightDirectionWS, const float rayDistance, std::vector<uint32_t>& poolProbeIndices) const;
+		// Writes the grid of every volume in shader layout, in lookup order
+		void GetVolumeData(std::vector<ProbeVolumeData>& volumeData) const;
+
+	private:
+		std::vector<ProbeVolume> Volumes;
+		std::vector<uint32_t> BaseProbeIndices;
+		uint32_t TotalProbeCount = 0;
+		uint64_t LayoutVersion = 1;
+	};
+}
@@ -0,0 +1,50 @@
+#include "CpuPch.h"
+#include "ProbeRayTable.h"
+#include "Renderer/CPU/ProbeTracer.h"
+
+Renderer::ProbeRayTable::ProbeRayTable()
+{
+	// Uniformly distributed random rotations from a fixed seed, so every run traces the same table
+	std::mt19937 random(PROBE_RAY_COUNT);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	Rotations[0] = glm::mat3(1.0f);
+	for (uint32_t r = 1; r < PROBE_RAY_ROTATION_COUNT; ++r)
+	{
+		// Shoemake's uniform random unit quaternion
+		const float u1 = unit(random);
+		const float u2 = 2.0f * glm::pi<float>() * unit(random);
+		const float u3 = 2.0f * glm::pi<float>() * unit(random);
+		const float a = std::sqrt(1.0f - u1);
+		const float b = std::sqrt(u1);
+		Rotations[r] = glm::mat3_cast(glm::quat(b * std::cos(u3), a * std::sin(u2), a * std::cos(u2), b * std::sin(u3)));
+	}
+
+	for (uint32_t r = 0; r < PROBE_RAY_ROTATION_COUNT; ++r)
+	{
+		for (uint32_t i = 0; i < PROBE_RAY_COUNT; ++i)
+		{
+			ProbeRay& ray = Rays[r * PROBE_RAY_COUNT + i];
+			const glm::vec3 direction = glm::normalize(CPU::SphericalFibonacci(static_cast<float>(i), static_cast<float>(PROBE_RAY_COUNT)));
+			ray.Direction = (r == 0) ? direction : glm::normalize(Rotations[r] * direction);
+		}
+	}
+}
+
+const Renderer::ProbeRayTable& Renderer::GetProbeRayTable()
+{
+	static const ProbeRayTable table;
+	return table;
+}
+
+uint32_t Renderer::GetProbeRayRotationIndex(const uint32_t seed, const uint32_t probeIndex)
+{
+	if (seed == 0)
+	{
+		return 0;
+	}
+
+	// PCG hash of the seed and probe index
+	const uint32_t state = seed * 747796405u + probeIndex * 2891336453u;
+	const uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return 1 + (((word >> 22u) ^ word) % (PROBE_RAY_ROTATION_COUNT - 1));
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Renderer/GIConstants.h"
+
+namespace Renderer
+{
+	// A probe ray under one rotation. Matches ProbeRay in Shaders/Common.hlsl
+	struct ProbeRay
+	{
+		glm::vec3 Direction = glm::vec3(0.0f, 0.0f, 1.0f);
+	};
+
+	// The spherical Fibonacci directions every probe traces, under PROBE_RAY_ROTATION_COUNT rotations. Directions are the same for every probe, so
+	// they are generated once here instead of for every probe and ray, and RayGen, the probe filter and blend stages and the CPU probe tracer read the
+	// same table. Rotation zero is the identity and the others are random, so probes traced with a new rotation each update sample different
+	// directions and their blended history covers the sphere more evenly than a fixed ray set
+	class ProbeRayTable
+	{
+	public:
+		ProbeRayTable();
+
+		const ProbeRay& GetRay(const uint32_t rotationIndex, const uint32_t rayIndex) const { return Rays[rotationIndex * PROBE_RAY_COUNT + rayIndex]; }
+		// Rotation major, PROBE_RAY_COUNT rays per rotation, as the shaders index them
+		const auto& GetRays() const { return Rays; }
+		const auto& GetRotations() const { return Rotations; }
+
+	private:
+		std::array<glm::mat3, PROBE_RAY_ROTATION_COUNT> Rotations;
+		std::array<ProbeRay, PROBE_RAY_ROTATION_COUNT * PROBE_RAY_COUNT> Rays;
+	};
+
+	// The table shared by every probe update, generated on first use
+	const ProbeRayTable& GetProbeRayTable();
+	// The rotation a probe's rays are traced with in an update. Seed zero traces the unrotated directions. Matches GetProbeRayRotationIndex in
+	// Shaders/Common.hlsl
+	uint32_t GetProbeRayRotationIndex(const uint32_t seed, const uint32_t probeIndex);
+}
@@ -0,0 +1,35 @@
+#include "CpuPch.h"
+#include "ProbeStatistics.h"
+
+Renderer::ProbeStatisticsSummary Renderer::SummarizeProbeStatistics(const ProbeStatistics* pStatistics, const size_t probeCount, const float convergedChange)
+{
+	ProbeStatisticsSummary summary = {};
+	for (size_t p = 0; p < probeCount; ++p)
+	{
+		const ProbeStatistics& statistics = pStatistics[p];
+		if (statistics.SampleCount <= 0.0f)
+		{
+			continue;
+		}
+
+		++summary.ProbeCount;
+		if (statistics.SampleCount > 1.0f && statistics.Change <= convergedChange)
+		{
+			++summary.ConvergedProbeCount;
+		}
+		summary.MeanChange += statistics.Change;
+		summary.MeanLuminanceVariance += statistics.LuminanceVariance;
+		summary.MeanSampleCount += statistics.SampleCount;
+		summary.MeanHysteresis += statistics.Hysteresis;
+	}
+
+	if (summary.ProbeCount > 0)
+	{
+		const auto count = static_cast<double>(summary.ProbeCount);
+		summary.MeanChange /= count;
+		summary.MeanLuminanceVariance /= count;
+		summary.MeanSampleCount /= count;
+		summary.MeanHysteresis /= count;
+	}
+	return summary;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Renderer/GIConstants.h"
+
+namespace Renderer
+{
+	// Convergence of a set of probes, summarized from the statistics RayGen and the CPU probe tracer write every gather
+	struct ProbeStatisticsSummary
+	{
+		// Probes with a blend history. Probes never traced, such as inactive ones, are left out of every other value
+		size_t ProbeCount = 0;
+		// Probes blended more than once whose last gather changed them by no more than the converged change
+		size_t ConvergedProbeCount = 0;
+		double MeanChange = 0.0;
+		double MeanLuminanceVariance = 0.0;
+		double MeanSampleCount = 0.0;
+		double MeanHysteresis = 0.0;
+	};
+
+	ProbeStatisticsSummary SummarizeProbeStatistics(const ProbeStatistics* pStatistics, const size_t probeCount, const float convergedChange);
+}
@@ -0,0 +1,180 @@
+#include "CpuPch.h"
+#include "ProbeUpdateScheduler.h"
+#include "ProbePool.h"
+
+// Priority of a probe at a new position before its distance weight. Higher than any age reached by a scheduled probe
+constexpr float PROBE_RESET_PRIORITY = 1.0e20f;
+// Weight of the latest measurement in the smoothed update cost
+constexpr double PROBE_UPDATE_COST_SMOOTHING = 0.1;
+// Updates since invalidation of a probe that has settled since it was last invalidated
+constexpr uint32_t PROBE_SETTLED = std::numeric_limits<uint32_t>::max();
+
+const Renderer::ProbeUpdateSchedule& Renderer::ProbeUpdateScheduler::Schedule(const ProbePool& pool, const glm::vec3& cameraPositionWS, const ProbeStatistics* pStatistics,
+	const size_t statisticsCount, const ProbeUpdateSchedulerSettings& settings)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+	++FrameIndex;
+
+	// Pool indices refer to other probes once volumes are added or removed
+	const size_t probeCount = pool.GetTotalProbeCount();
+	if ((pool.GetLayoutVersion() != LayoutVersion) || (UpdateFrameIndices.size() != probeCount))
+	{
+		UpdateFrameIndices.assign(probeCount, 0);
+		UpdatePositions.assign(probeCount, glm::vec4(0.0f));
+		UpdatesSinceInvalidation.assign(probeCount, 0);
+		LayoutVersion = pool.GetLayoutVersion();
+	}
+	Priorities.assign(probeCount, 0.0f);
+	Candidates.clear();
+
+	ProbeUpdateSchedule& schedule = LastSchedule;
+	schedule = ProbeUpdateSchedule{ std::move(schedule.ProbeIndices) };
+	schedule.ProbeIndices.clear();
+	schedule.MicrosecondsPerRay = MicrosecondsPerRay;
+	schedule.RayBudget = GetRayBudget(settings);
+
+	uint64_t sumAge = 0;
+	for (uint32_t v = 0; v < pool.GetVolumeCount(); ++v)
+	{
+		const auto& volume = pool.GetVolume(v);
+		const auto& positions = volume.GetProbePositions();
+		const auto& states = volume.GetProbeStates();
+		const uint32_t baseProbeIndex = pool.GetBaseProbeIndex(v);
+		for (uint32_t i = 0; i < static_cast<uint32_t>(positions.size()); ++i)
+		{
+			const uint32_t p = baseProbeIndex + i;
+			if (states[i] != static_cast<uint32_t>(ProbeState::Active))
+			{
+				++schedule.InactiveProbeCount;
+				continue;
+			}
+
+			const float distance = glm::distance(glm::vec3(positions[i]), cameraPositionWS);
+			const float distanceWeight = 1.0f + settings.DistanceWeight * (settings.DistanceFalloff / (settings.DistanceFalloff + distance));
+			// A probe found at another position was reset or relocated and waits to be traced there, then converges as an invalidated probe
+			if (positions[i] != UpdatePositions[p])
+			{
+				UpdateFrameIndices[p] = 0;
+				UpdatePositions[p] = positions[i];
+				UpdatesSinceInvalidation[p] = 0;
+			}
+
+			const float change = (p < statisticsCount) ? std::min(pStatistics[p].Change, 1.0f) : 0.0f;
+			uint32_t& updatesSinceInvalidation = UpdatesSinceInvalidation[p];
+			if ((updatesSinceInvalidation != PROBE_SETTLED) && (updatesSinceInvalidation >= settings.MinUpdatesAfterChange) &&
+				((updatesSinceInvalidation >= settings.MaxUpdatesAfterChange) || (change < settings.SettledChange)))
+			{
+				updatesSinceInvalidation = PROBE_SETTLED;
+			}
+			if (updatesSinceInvalidation != PROBE_SETTLED)
+			{
+				++schedule.InvalidatedProbeCount;
+			}
+			else if (settings.ChangeDriven && (UpdateFrameIndices[p] != 0))
+			{
+				++schedule.SettledProbeCount;
+				continue;
+			}
+
+			if (UpdateFrameIndices[p] == 0)
+			{
+				Priorities[p] = PROBE_RESET_PRIORITY * distanceWeight;
+				++schedule.ResetProbeCount;
+			}
+			else
+			{
+				const uint64_t age = FrameIndex - UpdateFrameIndices[p];
+				Priorities[p] = static_cast<float>(age) * distanceWeight * (1.0f + settings.ChangeWeight * change);
+				schedule.MaxAge = std::max(schedule.MaxAge, age);
+				sumAge += age;
+			}
+			Candidates.push_back({ Priorities[p], p });
+		}
+	}
+	schedule.CandidateProbeCount = Candidates.size();
+	const size_t agedProbeCount = schedule.CandidateProbeCount - schedule.ResetProbeCount;
+	schedule.MeanAge = agedProbeCount > 0 ? (static_cast<double>(sumAge) / agedProbeCount) : 0.0;
+
+	// Partition the highest priorities to the front. Ties go to the lower pool index so the order is the same every run
+	const size_t scheduledProbeCount = std::min<size_t>(Candidates.size(), std::max(1u, schedule.RayBudget / PROBE_RAY_COUNT));
+	const auto higherPriority = [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b)
+		{
+			return (a.first > b.first) || ((a.first == b.first) && (a.second < b.second));
+		};
+	if (scheduledProbeCount < Candidates.size())
+	{
+		std::nth_element(Candidates.begin(), Candidates.begin() + scheduledProbeCount, Candidates.end(), higherPriority);
+	}
+
+	uint64_t sumScheduledAge = 0;
+	size_t agedScheduledProbeCount = 0;
+	schedule.MinScheduledPriority = std::numeric_limits<float>::max();
+	for (size_t i = 0; i < scheduledProbeCount; ++i)
+	{
+		const uint32_t p = Candidates[i].second;
+		schedule.ProbeIndices.push_back(p);
+		schedule.MinScheduledPriority = std::min(schedule.MinScheduledPriority, Priorities[p]);
+		if (UpdateFrameIndices[p] != 0)
+		{
+			sumScheduledAge += FrameIndex - UpdateFrameIndices[p];
+			++agedScheduledProbeCount;
+		}
+		UpdateFrameIndices[p] = FrameIndex;
+		if (UpdatesSinceInvalidation[p] != PROBE_SETTLED)
+		{
+			++UpdatesSinceInvalidation[p];
+		}
+	}
+	schedule.MinScheduledPriority = schedule.ProbeIndices.empty() ? 0.0f : schedule.MinScheduledPriority;
+	schedule.MeanScheduledAge = agedScheduledProbeCount > 0 ? (static_cast<double>(sumScheduledAge) / agedScheduledProbeCount) : 0.0;
+	schedule.DeferredResetProbeCount = schedule.ResetProbeCount - (schedule.ProbeIndices.size() - agedScheduledProbeCount);
+	schedule.RayCount = schedule.ProbeIndices.size() * PROBE_RAY_COUNT;
+
+	// Traced in pool order, which keeps neighbouring probes, and their atlas tiles, together
+	std::sort(schedule.ProbeIndices.begin(), schedule.ProbeIndices.end());
+
+	schedule.Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	return schedule;
+}
+
+void Renderer::ProbeUpdateScheduler::ReportUpdateCost(const size_t rayCount, const double microseconds)
+{
+	if (rayCount == 0)
+	{
+		return;
+	}
+
+	const double microsecondsPerRay = microseconds / static_cast<double>(rayCount);
+	MicrosecondsPerRay = MicrosecondsPerRay > 0.0 ? glm::mix(MicrosecondsPerRay, microsecondsPerRay, PROBE_UPDATE_COST_SMOOTHING) : microsecondsPerRay;
+}
+
+void Renderer::ProbeUpdateScheduler::Reset()
+{
+	UpdateFrameIndices.assign(UpdateFrameIndices.size(), 0);
+	InvalidateAllProbes();
+}
+
+void Renderer::ProbeUpdateScheduler::InvalidateProbes(const std::vector<uint32_t>& poolProbeIndices)
+{
+	for (const uint32_t p : poolProbeIndices)
+	{
+		if (p < UpdatesSinceInvalidation.size())
+		{
+			UpdatesSinceInvalidation[p] = 0;
+		}
+	}
+}
+
+void Renderer::ProbeUpdateScheduler::InvalidateAllProbes()
+{
+	UpdatesSinceInvalidation.assign(UpdatesSinceInvalidation.size(), 0);
+}
+
+uint32_t Renderer::ProbeUpdateScheduler::GetRayBudget(const ProbeUpdateSchedulerSettings& settings) const
+{
+	if ((settings.BudgetMode == ProbeUpdateBudgetMode::Microseconds) && (MicrosecondsPerRay > 0.0))
+	{
+		return static_cast<uint32_t>(std::min(static_cast<double>(settings.MicrosecondBudget) / MicrosecondsPerRay, static_cast<double>(std::numeric_limits<uint32_t>::max())));
+	}
+	return settings.RayBudget;
+}
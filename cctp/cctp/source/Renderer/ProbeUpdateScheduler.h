@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Renderer/GIConstants.h"
+
+namespace Renderer
+{
+	class ProbePool;
+
+	// Default per frame probe update budgets. 32768 rays trace 1024 probes a frame
+	constexpr uint32_t PROBE_UPDATE_RAY_BUDGET = 32768;
+	constexpr float PROBE_UPDATE_MICROSECOND_BUDGET = 1000.0f;
+
+	enum class ProbeUpdateBudgetMode
+	{
+		Rays,
+		// Converted to rays with the measured cost of recent updates. The ray budget is used until a cost is reported
+		Microseconds
+	};
+
+	struct ProbeUpdateSchedulerSettings
+	{
+		ProbeUpdateBudgetMode BudgetMode = ProbeUpdateBudgetMode::Rays;
+		uint32_t RayBudget = PROBE_UPDATE_RAY_BUDGET;
+		float MicrosecondBudget = PROBE_UPDATE_MICROSECOND_BUDGET;
+		// Distance from the camera in world units at which a probe's distance weight has halved
+		float DistanceFalloff = 4.0f;
+		// Probes at the camera are updated up to 1 + DistanceWeight times as often as distant ones
+		float DistanceWeight = 3.0f;
+		// Probes are updated up to 1 + ChangeWeight times as often while their last update changed them by the whole of their history
+		float ChangeWeight = 4.0f;
+		// Only probes invalidated by a change in the scene, and probes at a new position, are updated, until they settle. Nothing is traced while
+		// nothing changes. Otherwise every active probe is updated in turn
+		bool ChangeDriven = false;
+		// Updates an invalidated probe gets before it can settle, and after which it settles even while it keeps changing, as a noisy probe does
+		uint32_t MinUpdatesAfterChange = 8;
+		uint32_t MaxUpdatesAfterChange = 64;
+		// An invalidated probe has settled once its last update changed it by less than this fraction of its history
+		float SettledChange = 0.02f;
+	};
+
+	// The probes picked for a frame and how they were picked
+	struct ProbeUpdateSchedule
+	{
+		// Pool indices of the probes to trace this frame, ascending
+		std::vector<uint32_t> ProbeIndices;
+		// The rays the budget allowed and the rays scheduled
+		uint32_t RayBudget = 0;
+		size_t RayCount = 0;
+		// Active probes competing for the budget and the inactive probes left out
+		size_t CandidateProbeCount = 0;
+		size_t InactiveProbeCount = 0;
+		// Probes never traced at their position, which are scheduled before every other probe, and those the budget left for later frames
+		size_t ResetProbeCount = 0;
+		size_t DeferredResetProbeCount = 0;
+		// Active probes invalidated and not yet settled, and in change driven mode the settled probes left out
+		size_t InvalidatedProbeCount = 0;
+		size_t SettledProbeCount = 0;
+		// Frames since the traced candidates were last updated, over every candidate and over the scheduled ones
+		uint64_t MaxAge = 0;
+		double MeanAge = 0.0;
+		double MeanScheduledAge = 0.0;
+		// The lowest priority that was scheduled. Probes below it wait for a later frame
+		float MinScheduledPriority = 0.0f;
+		double MicrosecondsPerRay = 0.0;
+		double Milliseconds = 0.0;
+	};
+
+	// Spreads probe updates over frames so each frame traces a fixed budget of rays instead of every probe at once.
+	// Each probe's priority grows with the frames since it was last traced, so probes take turns round-robin, and is scaled up for probes near the
+	// camera and probes whose last update changed them. Probes at a new position have no valid data and go first, nearest first.
+	// A probe waits at most (1 + DistanceWeight) * (1 + ChangeWeight) times as long as a probe at the camera whose light changes.
+	// In change driven mode only invalidated probes compete for the budget, each for a few updates until its history has converged again
+	class ProbeUpdateScheduler
+	{
+	public:
+		ProbeUpdateScheduler() = default;
+		// Picks the probes to trace this frame and advances the frame. Statistics are indexed by pool probe index, as read back from RayGen or the CPU
+		// probe tracer. Probes past the statistics count, or every probe when there are none, are scheduled without their change
+		const ProbeUpdateSchedule& Schedule(const ProbePool& pool, const glm::vec3& cameraPositionWS, const ProbeStatistics* pStatistics, const size_t statisticsCount,
+			const ProbeUpdateSchedulerSettings& settings);
+		// Measured time taken to trace and blend the rays of an earlier schedule. Converts microsecond budgets into rays
+		void ReportUpdateCost(const size_t rayCount, const double microseconds);
+		// Forgets when each probe was traced, so every probe is scheduled as if reset
+		void Reset();
+		// Marks probes, by pool index, as changed so they are updated until they settle again. Indices past the current layout are ignored,
+		// a new layout resets every probe anyway
+		void InvalidateProbes(const std::vector<uint32_t>& poolProbeIndices);
+		// Marks every probe as changed, as when the light changes
+		void InvalidateAllProbes();
+
+		const auto& GetSchedule() const { return LastSchedule; }
+		// Indexed by pool probe index. Zero for inactive probes
+		const auto& GetProbePriorities() const { return Priorities; }
+		// Frame each probe was last scheduled at, indexed by pool probe index. Zero for probes not yet scheduled at their position
+		const auto& GetProbeUpdateFrameIndices() const { return UpdateFrameIndices; }
+		const auto& GetFrameIndex() const { return FrameIndex; }
+		const auto& GetMicrosecondsPerRay() const { return MicrosecondsPerRay; }
+
+	private:
+		uint32_t GetRayBudget(const ProbeUpdateSchedulerSettings& settings) const;
+
+	private:
+		ProbeUpdateSchedule LastSchedule;
+		std::vector<uint64_t> UpdateFrameIndices;
+		// Position each probe was last seen at. A probe found elsewhere was reset or relocated and is scheduled as reset
+		std::vector<glm::vec4> UpdatePositions;
+		// Updates each probe has had since it was last invalidated, or PROBE_SETTLED
+		std::vector<uint32_t> UpdatesSinceInvalidation;
+		std::vector<float> Priorities;
+		// Priority and pool index of each active probe, partitioned by priority
+		std::vector<std::pair<float, uint32_t>> Candidates;
+		uint64_t LayoutVersion = 0;
+		uint64_t FrameIndex = 0;
+		double MicrosecondsPerRay = 0.0;
+	};
+}
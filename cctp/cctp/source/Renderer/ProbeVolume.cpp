@@ -1,13 +1,32 @@
-#include "Pch.h"
+#include "CpuPch.h"
 #include "ProbeVolume.h"
+#include "BakedProbeFile.h"
+#include "Math/Simd.h"
+#include "Math/SphericalHarmonics.h"
+
+// Distance in world units the grid origin of a baked probe file may be from a volume's for the file to be loaded into it
+constexpr float BAKED_PROBE_GRID_TOLERANCE = 1.0e-4f;
 
 float CalculateBias(const float spacing)
 {
 	return (spacing - static_cast<int32_t>(spacing)) > 0.0f ? 0.0f : 1.0f;
 }
 
+uint32_t Renderer::GetProbeShCoefficientCount(const ProbeEncoding encoding)
+{
+	switch (encoding)
+	{
+	case ProbeEncoding::SphericalHarmonicsL1:
+		return Math::SH_L1_COEFFICIENT_COUNT;
+	case ProbeEncoding::SphericalHarmonicsL2:
+		return Math::SH_L2_COEFFICIENT_COUNT;
+	default:
+		return 0;
+	}
+}
+
 Renderer::ProbeVolume::ProbeVolume(const glm::vec3& position, const glm::vec3& volumeExtents, float probeSpacing, float debugProbeSize)
-	: Position(position), Extents(volumeExtents), ProbeSpacing(probeSpacing)
+	: Position(position), Extents(volumeExtents), ProbeSpacing(probeSpacing), DebugProbeSize(debugProbeSize)
 {
 	// Calculate the number of probes
 	ProbeCountX = static_cast<size_t>(volumeExtents.x / probeSpacing);
@@ -15,31 +34,298 @@ Renderer::ProbeVolume::ProbeVolume(const glm::vec3& position, const glm::vec3& v
 	ProbeCountZ = static_cast<size_t>(volumeExtents.z / probeSpacing);
 	auto probeCountTotal = ProbeCountX * ProbeCountY * ProbeCountZ;
 
-	// Initialize probe transforms
-	ProbeTransforms.resize(probeCountTotal, { {0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}, {debugProbeSize, debugProbeSize, debugProbeSize} });
-	UpdateProbePositions();
+	// Initialize probe data
+	ProbePositions.resize(probeCountTotal, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	ProbeStates.resize(probeCountTotal, static_cast<uint32_t>(ProbeState::Active));
+	ProbeOffsets.resize(probeCountTotal, glm::vec4(0.0f));
+	ProbeRelocationOffsets.resize(probeCountTotal, glm::vec4(0.0f));
+	ProbeResetFrameIndices.resize(probeCountTotal, FrameIndex);
+	UpdateProbeOffsets();
+	TranslateProbes();
 }
 
 void Renderer::ProbeVolume::Update()
 {
-	if (UpdatedPosition != Position)
+	++FrameIndex;
+
+	if (Scrolling)
+	{
+		// Follow the position in whole probe steps
+		const glm::ivec3 scrollOffset = glm::ivec3(glm::round((Position - ScrollOrigin) / ProbeSpacing));
+		if (scrollOffset != ScrollOffset)
+		{
+			ScrollProbes(scrollOffset);
+		}
+	}
+	else if (UpdatedPosition != Position)
+	{
+		// The grid layout is fixed, so a moved volume only needs its probes offset by the new position. Every probe is somewhere new
+		TranslateProbes();
+		ResetAllProbes();
+	}
+}
+
+void Renderer::ProbeVolume::GetProbesResetSince(const uint64_t frameIndex, std::vector<uint32_t>& probeIndices) const
+{
+	for (size_t i = 0; i < ProbeResetFrameIndices.size(); ++i)
+	{
+		if (ProbeResetFrameIndices[i] > frameIndex)
+		{
+			probeIndices.push_back(static_cast<uint32_t>(i));
+		}
+	}
+}
+
+void Renderer::ProbeVolume::SetProbeStates(const std::vector<uint32_t>& probeStates)
+{
+	assert(probeStates.size() == ProbeStates.size() && "Every probe must have a state.");
+	if (probeStates != ProbeStates)
+	{
+		ProbeStates = probeStates;
+		ChangedFrameIndex = FrameIndex;
+	}
+}
+
+void Renderer::ProbeVolume::SetProbeRelocationOffsets(const std::vector<glm::vec4>& relocationOffsets)
+{
+	assert(relocationOffsets.size() == ProbeRelocationOffsets.size() && "Every probe must have a relocation offset.");
+	for (size_t i = 0; i < relocationOffsets.size(); ++i)
+	{
+		if (relocationOffsets[i] != ProbeRelocationOffsets[i])
+		{
+			ProbeRelocationOffsets[i] = relocationOffsets[i];
+			ProbePositions[i] = glm::vec4(GetProbeGridPosition(static_cast<uint32_t>(i)), 1.0f) + relocationOffsets[i];
+			ChangedFrameIndex = FrameIndex;
+		}
+	}
+}
+
+glm::vec3 Renderer::ProbeVolume::GetProbeGridPosition(const uint32_t probeIndex) const
+{
+	// Inverse of GetProbeIndex, matching the positions placed by TranslateProbes and ScrollProbes bit for bit
+	auto calculatePosition = [this](const size_t index, const size_t count, const float extent, const float origin, const int32_t scrollOffset)
+	{
+		const auto signedCount = static_cast<int32_t>(count);
+		const int32_t coordinate = scrollOffset + ((((static_cast<int32_t>(index) - scrollOffset) % signedCount) + signedCount) % signedCount);
+		return origin + ((static_cast<float>(coordinate) * ProbeSpacing) - ((extent - ProbeSpacing) / 2.0f));
+	};
+	const glm::vec3 origin = Scrolling ? ScrollOrigin : UpdatedPosition;
+	return glm::vec3(
+		calculatePosition(probeIndex % ProbeCountX, ProbeCountX, Extents.x, origin.x, ScrollOffset.x),
+		calculatePosition((probeIndex / ProbeCountX) % ProbeCountY, ProbeCountY, Extents.y, origin.y, ScrollOffset.y),
+		calculatePosition(probeIndex / (ProbeCountX * ProbeCountY), ProbeCountZ, Extents.z, origin.z, ScrollOffset.z));
+}
+
+glm::vec3 Renderer::ProbeVolume::GetGridOrigin() const
+{
+	const glm::vec3 origin = Scrolling ? ScrollOrigin : UpdatedPosition;
+	return origin + ((glm::vec3(ScrollOffset) * ProbeSpacing) - ((Extents - ProbeSpacing) / 2.0f));
+}
+
+void Renderer::ProbeVolume::GetProbesNear(const BoundingBox& bounds, const float distance, std::vector<uint32_t>& probeIndices) const
+{
+	const float squaredDistance = distance * distance;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(ProbePositions.size()); ++i)
+	{
+		const glm::vec3 gridPosition = GetProbeGridPosition(i);
+		const glm::vec3 closestPoint = glm::clamp(gridPosition, bounds.Min, bounds.Max);
+		const glm::vec3 toProbe = gridPosition - closestPoint;
+		if (glm::dot(toProbe, toProbe) <= squaredDistance)
+		{
+			probeIndices.push_back(i);
+		}
+	}
+}
+
+void Renderer::ProbeVolume::SetScrolling(const bool scrolling)
+{
+	if (scrolling == Scrolling)
+	{
+		return;
+	}
+	Scrolling = scrolling;
+
+	if (Scrolling)
+	{
+		// Probes are already in place for a scroll offset of zero from where the grid was last placed
+		ScrollOrigin = UpdatedPosition;
+		ScrollOffset = glm::ivec3(0);
+	}
+	else
+	{
+		// Probe indices return to the fixed layout
+		ScrollOffset = glm::ivec3(0);
+		TranslateProbes();
+		ResetAllProbes();
+	}
+}
+
+bool Renderer::ProbeVolume::SaveBakedProbes(const std::filesystem::path& path, const BakedProbeAtlases& atlases, const BakedProbeCompression compression) const
+{
+	if (Scrolling)
+	{
+		DEBUG_LOG("ERROR: Scrolling probe volumes cannot be baked.");
+		return false;
+	}
+	assert(atlases.Statistics.size() == ProbePositions.size() && "Every probe must have baked atlas tiles.");
+
+	BakedProbeVolume volume;
+	volume.GridOriginAndSpacing = glm::vec4(GetGridOrigin(), ProbeSpacing);
+	volume.ProbeCounts = glm::ivec4(static_cast<int32_t>(ProbeCountX), static_cast<int32_t>(ProbeCountY), static_cast<int32_t>(ProbeCountZ), 0);
+	volume.AtlasLayout = glm::uvec4(atlases.Layout.GetProbesPerRow(), atlases.Layout.GetRowCount(), atlases.IrradianceRowPitch, atlases.VisibilityRowPitch);
+
+	BakedProbeData data;
+	data.pVolume = &volume;
+	data.pProbeStates = ProbeStates.data();
+	data.pRelocationOffsets = ProbeRelocationOffsets.data();
+	data.pStatistics = atlases.Statistics.data();
+	data.pIrradianceAtlas = atlases.IrradianceAtlas.data();
+	data.pVisibilityAtlas = atlases.VisibilityAtlas.data();
+	return WriteBakedProbeFile(path, data, compression);
+}
+
+bool Renderer::ProbeVolume::LoadBakedProbes(const std::filesystem::path& path, BakedProbeFile& file)
+{
+	if (Scrolling || !file.Open(path))
+	{
+		return false;
+	}
+
+	// Baked probe data belongs to the probes at the grid positions it was traced at
+	const BakedProbeData& data = file.GetData();
+	const BakedProbeVolume& volume = *data.pVolume;
+	if ((volume.ProbeCounts != glm::ivec4(static_cast<int32_t>(ProbeCountX), static_cast<int32_t>(ProbeCountY), static_cast<int32_t>(ProbeCountZ), 0)) ||
+		(volume.GridOriginAndSpacing.w != ProbeSpacing) || (glm::distance(glm::vec3(volume.GridOriginAndSpacing), GetGridOrigin()) > BAKED_PROBE_GRID_TOLERANCE))
+	{
+		DEBUG_LOG("ERROR: Baked probe file " + path.string() + " was baked for another probe grid.");
+		file.Close();
+		return false;
+	}
+
+	const size_t probeCount = ProbePositions.size();
+	SetProbeStates(std::vector<uint32_t>(data.pProbeStates, data.pProbeStates + probeCount));
+	SetProbeRelocationOffsets(std::vector<glm::vec4>(data.pRelocationOffsets, data.pRelocationOffsets + probeCount));
+	return true;
+}
+
+uint32_t Renderer::ProbeVolume::GetProbeIndex(const glm::ivec3& gridCoordinate) const
+{
+	auto wrap = [](const int32_t coordinate, const size_t count)
+	{
+		const auto signedCount = static_cast<int32_t>(count);
+		return static_cast<size_t>(((coordinate % signedCount) + signedCount) % signedCount);
+	};
+	const size_t x = wrap(gridCoordinate.x + ScrollOffset.x, ProbeCountX);
+	const size_t y = wrap(gridCoordinate.y + ScrollOffset.y, ProbeCountY);
+	const size_t z = wrap(gridCoordinate.z + ScrollOffset.z, ProbeCountZ);
+	return static_cast<uint32_t>(x + ProbeCountX * (y + ProbeCountY * z));
+}
+
+void Renderer::ProbeVolume::UpdateProbeOffsets()
+{
+	// Offsets of each probe row, column and layer from the volume centre
+	auto calculateOffsets = [this](const size_t count, const float extent)
+	{
+		std::vector<float> offsets(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			offsets[i] = (i * ProbeSpacing) - ((extent - ProbeSpacing) / 2.0f);
+		}
+		return offsets;
+	};
+	const auto offsetsX = calculateOffsets(ProbeCountX, Extents.x);
+	const auto offsetsY = calculateOffsets(ProbeCountY, Extents.y);
+	const auto offsetsZ = calculateOffsets(ProbeCountZ, Extents.z);
+
+	// Probes are stored x fastest
+	for (size_t z = 0; z < ProbeCountZ; ++z)
+	{
+		for (size_t y = 0; y < ProbeCountY; ++y)
+		{
+			for (size_t x = 0; x < ProbeCountX; ++x)
+			{
+				ProbeOffsets[x + ProbeCountX * (y + ProbeCountY * z)] = glm::vec4(offsetsX[x], offsetsY[y], offsetsZ[z], 0.0f);
+			}
+		}
+	}
+}
+
+void Renderer::ProbeVolume::TranslateProbes()
+{
+	// The default allocator aligns to 16 bytes on 64 bit targets
+	assert(reinterpret_cast<uintptr_t>(ProbePositions.data()) % 16 == 0 && "Probe positions must be 16 byte aligned.");
+	assert(reinterpret_cast<uintptr_t>(ProbeOffsets.data()) % 16 == 0 && "Probe offsets must be 16 byte aligned.");
+
+	// Adding the position to the offsets rather than the position change to the previous positions keeps repeated moves free of drift
+	const __m128 position = _mm_setr_ps(Position.x, Position.y, Position.z, 1.0f);
+	const float* pOffsets = &ProbeOffsets.data()->x;
+	float* pPositions = &ProbePositions.data()->x;
+	const size_t probeCount = ProbePositions.size();
+	for (size_t i = 0; i < probeCount; ++i)
 	{
-		UpdateProbePositions();
+		_mm_store_ps(pPositions + i * 4, _mm_add_ps(position, _mm_load_ps(pOffsets + i * 4)));
 	}
+
+	UpdatedPosition = Position;
 }
 
-void Renderer::ProbeVolume::UpdateProbePositions()
+void Renderer::ProbeVolume::ScrollProbes(const glm::ivec3& scrollOffset)
 {
-	for (auto x = 0; x < ProbeCountX; ++x)
+	// The probe at index i along an axis holds the grid coordinate within the volume that is congruent to i modulo the probe count. For each index,
+	// find the world position of its coordinate after the scroll and whether the coordinate changed
+	auto calculatePlanes = [this](const size_t count, const float extent, const float origin, const int32_t previousOffset, const int32_t offset,
+		std::vector<float>& positions, std::vector<uint8_t>& exposed)
 	{
-		for (auto y = 0; y < ProbeCountY; ++y)
+		const auto signedCount = static_cast<int32_t>(count);
+		auto getCoordinate = [signedCount](const int32_t index, const int32_t scrollOffset)
 		{
-			for (auto z = 0; z < ProbeCountZ; ++z)
+			return scrollOffset + ((((index - scrollOffset) % signedCount) + signedCount) % signedCount);
+		};
+
+		positions.resize(count);
+		exposed.resize(count);
+		for (int32_t i = 0; i < signedCount; ++i)
+		{
+			const int32_t coordinate = getCoordinate(i, offset);
+			positions[i] = origin + ((static_cast<float>(coordinate) * ProbeSpacing) - ((extent - ProbeSpacing) / 2.0f));
+			exposed[i] = coordinate != getCoordinate(i, previousOffset);
+		}
+	};
+	std::vector<float> positionsX, positionsY, positionsZ;
+	std::vector<uint8_t> exposedX, exposedY, exposedZ;
+	calculatePlanes(ProbeCountX, Extents.x, ScrollOrigin.x, ScrollOffset.x, scrollOffset.x, positionsX, exposedX);
+	calculatePlanes(ProbeCountY, Extents.y, ScrollOrigin.y, ScrollOffset.y, scrollOffset.y, positionsY, exposedY);
+	calculatePlanes(ProbeCountZ, Extents.z, ScrollOrigin.z, ScrollOffset.z, scrollOffset.z, positionsZ, exposedZ);
+
+	// Only probes on an exposed plane move. Probes that stay inside the volume keep their position and data
+	float* pPositions = &ProbePositions.data()->x;
+	for (size_t z = 0; z < ProbeCountZ; ++z)
+	{
+		for (size_t y = 0; y < ProbeCountY; ++y)
+		{
+			const bool rowExposed = exposedZ[z] || exposedY[y];
+			const size_t rowStart = ProbeCountX * (y + ProbeCountY * z);
+			for (size_t x = 0; x < ProbeCountX; ++x)
 			{
-				ProbeTransforms[x + ProbeCountX * (y + ProbeCountZ * z)].Position = Position + glm::vec3((x * ProbeSpacing) - ((Extents.x - ProbeSpacing) / 2.0f),
-													   (y * ProbeSpacing) - ((Extents.y - ProbeSpacing) / 2.0f),
-													   (z * ProbeSpacing) - ((Extents.z - ProbeSpacing) / 2.0f));
+				if (rowExposed || exposedX[x])
+				{
+					_mm_store_ps(pPositions + (rowStart + x) * 4, _mm_setr_ps(positionsX[x], positionsY[y], positionsZ[z], 1.0f));
+					ProbeRelocationOffsets[rowStart + x] = glm::vec4(0.0f);
+					ProbeResetFrameIndices[rowStart + x] = FrameIndex;
+				}
 			}
 		}
 	}
+
+	ScrollOffset = scrollOffset;
+	UpdatedPosition = ScrollOrigin + glm::vec3(ScrollOffset) * ProbeSpacing;
+	ChangedFrameIndex = FrameIndex;
+}
+
+void Renderer::ProbeVolume::ResetAllProbes()
+{
+	// Probes are placed without relocation
+	std::fill(ProbeRelocationOffsets.begin(), ProbeRelocationOffsets.end(), glm::vec4(0.0f));
+	std::fill(ProbeResetFrameIndices.begin(), ProbeResetFrameIndices.end(), FrameIndex);
+	ChangedFrameIndex = FrameIndex;
 }
@@ -1,32 +1,118 @@
 #pragma once
 
-#include "Math/Transform.h"
+#include "Math/BoundingBox.h"
 
 namespace Renderer
 {
+	class BakedProbeFile;
+	struct BakedProbeAtlases;
+	enum class BakedProbeCompression : uint32_t;
+
+	// Per probe state, stored as 32 bits so the state array can be copied into shader buffers as is
+	enum class ProbeState : uint32_t
+	{
+		Active = 0,
+		Inactive = 1
+	};
+
+	// How a volume's probes store their irradiance and visibility, stored as 32 bits in ProbeVolumeData. Octahedral probes own a tile in each atlas.
+	// Spherical harmonic probes project their rays onto the coefficients of bands zero to one (L1) or zero to two (L2) instead, taking a fraction
+	// of the memory at the cost of the sharper lighting and occlusion an atlas tile can hold
+	enum class ProbeEncoding : uint32_t
+	{
+		Octahedral = 0,
+		SphericalHarmonicsL1 = 1,
+		SphericalHarmonicsL2 = 2
+	};
+
+	// The spherical harmonic coefficients a probe of the encoding stores, zero for octahedral probes
+	uint32_t GetProbeShCoefficientCount(const ProbeEncoding encoding);
+
+	// Probe data is stored as structure of arrays. Positions are float4 with w set to one, matching ProbePositionsWS in the shaders, so ranges of
+	// probes copy straight into constant and structured buffers and are updated with aligned SIMD loads and stores.
+	// A scrolling volume moves in whole probe steps and addresses its probes toroidally: a probe keeps its index, and so its atlas texels, while
+	// it stays inside the volume, and only the planes of probes newly exposed on the leading faces are given new positions and reset
 	class ProbeVolume
 	{
 	public:
 		ProbeVolume(const glm::vec3& position, const glm::vec3& volumeExtents, float probeSpacing, float debugProbeSize);
+		// Advances the frame index and moves the probes if the volume position changed since the last update
 		void Update();
 
-		const auto& GetProbeTransforms() const { return ProbeTransforms; }
+		// Returns true if probe data changed after the given frame. Frame zero precedes the volume, so every volume has changed since frame zero
+		bool HasChangedSince(const uint64_t frameIndex) const { return ChangedFrameIndex > frameIndex; }
+		const auto& GetFrameIndex() const { return FrameIndex; }
+		// Appends the index of every probe placed at a new grid position after the given frame. Their atlas data is stale and must be traced
+		void GetProbesResetSince(const uint64_t frameIndex, std::vector<uint32_t>& probeIndices) const;
+
+		// While scrolling, the volume position is a target the probe grid follows in whole probe steps. Switching mode resets every probe
+		void SetScrolling(const bool scrolling);
+		bool IsScrolling() const { return Scrolling; }
+		// Index of the probe at a grid coordinate counted from the volume's minimum corner, wrapped toroidally while scrolling
+		uint32_t GetProbeIndex(const glm::ivec3& gridCoordinate) const;
+
+		// World space positions in w = 1 float4s, 16 byte aligned
+		const auto& GetProbePositions() const { return ProbePositions; }
+		const auto& GetProbeStates() const { return ProbeStates; }
+		// Marks probe data changed if any state differs
+		void SetProbeStates(const std::vector<uint32_t>& probeStates);
+		// Offsets of the probe positions from their grid positions with w = 0, moving probes out of nearby geometry. Reset probes have no offset
+		const auto& GetProbeRelocationOffsets() const { return ProbeRelocationOffsets; }
+		// Places every probe whose offset differs at its grid position plus the offset and marks probe data changed
+		void SetProbeRelocationOffsets(const std::vector<glm::vec4>& relocationOffsets);
+		// Position of the probe before relocation
+		glm::vec3 GetProbeGridPosition(const uint32_t probeIndex) const;
+		// Position of grid coordinate zero, the volume's minimum corner before relocation
+		glm::vec3 GetGridOrigin() const;
+		const auto& GetScrollOffset() const { return ScrollOffset; }
+		// Appends the index of every probe whose grid position is within the distance of the bounds
+		void GetProbesNear(const BoundingBox& bounds, const float distance, std::vector<uint32_t>& probeIndices) const;
 		auto& GetVolumePosition() { return Position; } // Returns the center of the probe volume in world space
 		auto GetTotalProbeCount() const { return ProbeCountX * ProbeCountY * ProbeCountZ; }
 		const auto& GetProbeCountX() const { return ProbeCountX; }
 		const auto& GetProbeCountY() const { return ProbeCountY; }
 		const auto& GetProbeCountZ() const { return ProbeCountZ; }
 		const auto& GetProbeSpacing() const { return ProbeSpacing; }
+		const auto& GetDebugProbeSize() const { return DebugProbeSize; }
+		// Probes keep the data of each encoding they were traced with. After a change, each probe's next gather is measured against what its new
+		// encoding last stored, and restarts its history if that differs by more than the change threshold
+		void SetProbeEncoding(const ProbeEncoding encoding) { Encoding = encoding; }
+		const auto& GetProbeEncoding() const { return Encoding; }
+
+		// Writes the grid, probe states and relocation offsets with the probes' atlas tiles and statistics, indexed by volume probe index, as a baked
+		// probe file. Scrolling volumes are placed around the camera at runtime and are not baked. Returns false if the file could not be written
+		bool SaveBakedProbes(const std::filesystem::path& path, const BakedProbeAtlases& atlases, const BakedProbeCompression compression) const;
+		// Opens a baked probe file and takes its probe states and relocation offsets. The file must have been baked for the same grid at the same place.
+		// The file is left open for the atlas tiles and statistics to be uploaded from, and is closed if it does not match
+		bool LoadBakedProbes(const std::filesystem::path& path, BakedProbeFile& file);
 
 	private:
-		void UpdateProbePositions();
+		void UpdateProbeOffsets();
+		void TranslateProbes();
+		void ScrollProbes(const glm::ivec3& scrollOffset);
+		void ResetAllProbes();
 
 	private:
 		glm::vec3 Position;
 		glm::vec3 Extents;
 		float ProbeSpacing;
-		std::vector<Transform> ProbeTransforms;
+		float DebugProbeSize;
+		std::vector<glm::vec4> ProbePositions;
+		std::vector<uint32_t> ProbeStates;
+		// Probe positions relative to the volume centre with w = 0. Moving the volume adds the same offset to every probe
+		std::vector<glm::vec4> ProbeOffsets;
+		std::vector<glm::vec4> ProbeRelocationOffsets;
+		// Volume position the probe positions were last placed around
 		glm::vec3 UpdatedPosition;
+		uint64_t FrameIndex = 1;
+		uint64_t ChangedFrameIndex = 1;
+		// Frame each probe was last placed at a new grid position
+		std::vector<uint64_t> ProbeResetFrameIndices;
+		bool Scrolling = false;
+		ProbeEncoding Encoding = ProbeEncoding::Octahedral;
+		// Volume position scrolling started from and the whole probe steps the grid has scrolled since
+		glm::vec3 ScrollOrigin;
+		glm::ivec3 ScrollOffset = glm::ivec3(0);
 		size_t ProbeCountX;
 		size_t ProbeCountY;
 		size_t ProbeCountZ;
@@ -7,12 +7,16 @@
 #include "Pipeline/GraphicsPipeline.h"
 #include "DescriptorHeap.h"
 #include "Material.h"
+#include "ProbeRayTable.h"
+#include "BakedProbeFile.h"
 
 constexpr float CLEAR_COLOR[4] = { 0.005f, 0.005f, 0.005f, 1.0f };
 constexpr UINT64 CONSTANT_BUFFER_ALIGNMENT_SIZE_BYTES = 256;
 constexpr uint32_t SIZE_64KB = 65536;
 constexpr size_t BACK_BUFFER_COUNT = 3;
 constexpr uint32_t MAX_DRAWS_PER_FRAME = SIZE_64KB / CONSTANT_BUFFER_ALIGNMENT_SIZE_BYTES;
+constexpr size_t MIN_PROBE_BUFFER_CAPACITY = 1024;
+constexpr size_t MIN_PROBE_ATLAS_CAPACITY = 1024;
 
 // Renderer
 Microsoft::WRL::ComPtr<IDXGIFactory4> DXGIFactory;
@@ -50,9 +54,11 @@ struct PerObjectConstants
 struct PerFrameConstants
 {
     glm::mat4 LightMatrix = glm::identity<glm::mat4>();
-    glm::vec4 ProbePositionsWS[Renderer::MAX_PROBE_COUNT];
     glm::vec4 LightDirectionWS = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
-    glm::vec4 PackedData = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f); // Stores probe count (x), probe spacing (y), light intensity (z)
+    glm::vec4 PackedData = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f); // Stores probe count (x), probe spacing (y), light intensity (z), probe volume count (w)
+    glm::ivec4 ProbeAtlasLayout = glm::ivec4(0); // Stores probes per atlas row (x), atlas row count (y), atlas probe capacity (z)
+    glm::vec4 ProbeBlendSettings = glm::vec4(0.0f); // Stores hysteresis (x), change threshold (y), probe ray rotation seed bits (z)
+    Renderer::ProbeVolumeData ProbeVolumes[Renderer::MAX_PROBE_VOLUME_COUNT];
 };
 
 struct PerPassConstants
@@ -79,6 +85,47 @@ uint8_t* MappedPerPassConstantBufferLocation;
 Microsoft::WRL::ComPtr<ID3D12Resource> MaterialConstantBuffer;
 uint8_t* MappedMaterialConstantBufferLocation;
 
+// Probe data structured buffers, indexed by pool probe index
+Microsoft::WRL::ComPtr<ID3D12Resource> ProbePositionBuffer;
+uint8_t* MappedProbePositionBufferLocation;
+Microsoft::WRL::ComPtr<ID3D12Resource> ProbeStateBuffer;
+uint8_t* MappedProbeStateBufferLocation;
+// Pool indices of the probes traced by the next dispatch, one per ray gen thread
+Microsoft::WRL::ComPtr<ID3D12Resource> ProbeUpdateIndexBuffer;
+uint8_t* MappedProbeUpdateIndexBufferLocation;
+size_t ProbeBufferCapacity = 0;
+// The probe ray table, written once at initialization
+Microsoft::WRL::ComPtr<ID3D12Resource> ProbeRayBuffer;
+uint8_t* MappedProbeRayBufferLocation;
+
+// Probe irradiance and visibility atlases, tiled by the atlas layout. Each gather is traced into the ray data buffer, PROBE_RAY_COUNT float4s per
+// probe sized to the atlas capacity, filtered into the filtered textures then blended into the atlases
+Microsoft::WRL::ComPtr<ID3D12Resource> ProbeIrradianceAtlas;
+Microsoft::WRL::ComPtr<ID3D12Resource> ProbeVisibilityAtlas;
+Microsoft::WRL::ComPtr<ID3D12Resource> ProbeRayDataBuffer;
+Microsoft::WRL::ComPtr<ID3D12Resource> ProbeIrradianceFiltered;
+Microsoft::WRL::ComPtr<ID3D12Resource> ProbeVisibilityFiltered;
+Renderer::ProbeAtlasLayout AtlasLayout;
+
+// Probe blend statistics written by RayGen, sized to the atlas capacity, and a copy of them per frame to read on the CPU
+Microsoft::WRL::ComPtr<ID3D12Resource> ProbeStatisticsBuffer;
+Microsoft::WRL::ComPtr<ID3D12Resource> ProbeShBuffer;
+std::array<Microsoft::WRL::ComPtr<ID3D12Resource>, BACK_BUFFER_COUNT> ProbeStatisticsReadbackBuffers;
+std::array<const Renderer::ProbeStatistics*, BACK_BUFFER_COUNT> MappedProbeStatisticsReadbackLocations;
+// Statistics of the last completed probe dispatch. Frames without a dispatch leave their readback holding an older one, and a readback is written
+// again while later frames still read it, so the latest is kept on the CPU
+std::vector<Renderer::ProbeStatistics> LastProbeStatistics;
+
+// Timestamps written around each frame's probe dispatch, resolved into a readback buffer read once the frame's fence is reached
+Microsoft::WRL::ComPtr<ID3D12QueryHeap> RaytraceTimestampQueryHeap;
+Microsoft::WRL::ComPtr<ID3D12Resource> RaytraceTimestampReadbackBuffer;
+const UINT64* MappedRaytraceTimestampReadbackLocation;
+UINT64 TimestampFrequency = 0;
+// Ray gen threads dispatched by each frame index's timed dispatch, zero for frames without one
+std::array<uint32_t, BACK_BUFFER_COUNT> RaytraceTimestampDispatchWidths = {};
+double LastRaytraceMilliseconds = 0.0;
+uint32_t LastRaytraceDispatchWidth = 0;
+
 // Rendering
 size_t FrameIndex = 0;
 uint32_t FrameDrawCount = 0;
@@ -278,6 +325,163 @@ bool WaitForFenceToReachValue(Microsoft::WRL::ComPtr<ID3D12Fence> fence, UINT64
     return true;
 }
 
+bool CreateMappedProbeBuffer(const size_t sizeInBytes, const wchar_t* name, Microsoft::WRL::ComPtr<ID3D12Resource>& buffer, uint8_t*& mappedLocation)
+{
+    auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+    auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(static_cast<UINT64>(sizeInBytes));
+    if (FAILED(Device->CreateCommittedResource(&heapProperties,
+        D3D12_HEAP_FLAG_NONE,
+        &resourceDesc,
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&buffer))))
+    {
+        DEBUG_LOG("ERROR: Failed to create probe buffer.");
+        return false;
+    }
+
+    if (FAILED(buffer->SetName(name)))
+    {
+        DEBUG_LOG("ERROR: Failed to name probe buffer.");
+        return false;
+    }
+
+    D3D12_RANGE readRange(0, 0);
+    void* mappedResource;
+    if (FAILED(buffer->Map(0, &readRange, &mappedResource)))
+    {
+        DEBUG_LOG("ERROR: Failed to map probe buffer.");
+        return false;
+    }
+    mappedLocation = static_cast<uint8_t*>(mappedResource);
+    return true;
+}
+
+bool CreateProbeStatisticsBuffers(const size_t probeCapacity)
+{
+    // Committed resources start zeroed, so every probe starts without history
+    const auto sizeInBytes = static_cast<UINT64>(probeCapacity * sizeof(Renderer::ProbeStatistics));
+    auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+    auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+    if (FAILED(Device->CreateCommittedResource(&heapProperties,
+        D3D12_HEAP_FLAG_NONE,
+        &resourceDesc,
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+        nullptr,
+        IID_PPV_ARGS(&ProbeStatisticsBuffer))))
+    {
+        DEBUG_LOG("ERROR: Failed to create probe statistics buffer.");
+        return false;
+    }
+
+    if (FAILED(ProbeStatisticsBuffer->SetName(L"ProbeStatisticsBuffer")))
+    {
+        DEBUG_LOG("ERROR: Failed to name probe statistics buffer.");
+        return false;
+    }
+
+    auto readbackHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK);
+    auto readbackResourceDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeInBytes);
+    for (size_t i = 0; i < BACK_BUFFER_COUNT; ++i)
+    {
+        if (FAILED(Device->CreateCommittedResource(&readbackHeapProperties,
+            D3D12_HEAP_FLAG_NONE,
+            &readbackResourceDesc,
+            D3D12_RESOURCE_STATE_COPY_DEST,
+            nullptr,
+            IID_PPV_ARGS(&ProbeStatisticsReadbackBuffers[i]))))
+        {
+            DEBUG_LOG("ERROR: Failed to create probe statistics readback buffer.");
+            return false;
+        }
+
+        // Readback buffers stay mapped. A frame's copy is only read after waiting for the frame's fence
+        void* mappedResource;
+        if (FAILED(ProbeStatisticsReadbackBuffers[i]->Map(0, nullptr, &mappedResource)))
+        {
+            DEBUG_LOG("ERROR: Failed to map probe statistics readback buffer.");
+            return false;
+        }
+        MappedProbeStatisticsReadbackLocations[i] = static_cast<const Renderer::ProbeStatistics*>(mappedResource);
+    }
+    LastProbeStatistics.assign(probeCapacity, Renderer::ProbeStatistics());
+    return true;
+}
+
+bool CreateProbeShBuffer(const size_t probeCapacity)
+{
+    // Committed resources start zeroed, so every probe starts with no spherical harmonic history
+    const auto sizeInBytes = static_cast<UINT64>(probeCapacity * Renderer::PROBE_SH_STRIDE * sizeof(uint32_t));
+    auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+    auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+    if (FAILED(Device->CreateCommittedResource(&heapProperties,
+        D3D12_HEAP_FLAG_NONE,
+        &resourceDesc,
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+        nullptr,
+        IID_PPV_ARGS(&ProbeShBuffer))))
+    {
+        DEBUG_LOG("ERROR: Failed to create probe spherical harmonic buffer.");
+        return false;
+    }
+
+    if (FAILED(ProbeShBuffer->SetName(L"ProbeShBuffer")))
+    {
+        DEBUG_LOG("ERROR: Failed to name probe spherical harmonic buffer.");
+        return false;
+    }
+    return true;
+}
+
+bool CreateProbeRayDataBuffer(const size_t probeCapacity)
+{
+    const auto sizeInBytes = static_cast<UINT64>(probeCapacity * Renderer::PROBE_RAY_COUNT * sizeof(glm::vec4));
+    auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+    auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+    if (FAILED(Device->CreateCommittedResource(&heapProperties,
+        D3D12_HEAP_FLAG_NONE,
+        &resourceDesc,
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+        nullptr,
+        IID_PPV_ARGS(&ProbeRayDataBuffer))))
+    {
+        DEBUG_LOG("ERROR: Failed to create probe ray data buffer.");
+        return false;
+    }
+
+    if (FAILED(ProbeRayDataBuffer->SetName(L"ProbeRayDataBuffer")))
+    {
+        DEBUG_LOG("ERROR: Failed to name probe ray data buffer.");
+        return false;
+    }
+    return true;
+}
+
+bool CreateProbeAtlas(const DXGI_FORMAT format, const glm::uvec2& dimensions, const wchar_t* name, Microsoft::WRL::ComPtr<ID3D12Resource>& atlas)
+{
+    auto resourceDesc = CD3DX12_RESOURCE_DESC::Tex2D(format, static_cast<UINT64>(dimensions.x), static_cast<UINT>(dimensions.y));
+    resourceDesc.MipLevels = 1;
+    resourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+    auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+    if (FAILED(Device->CreateCommittedResource(&heapProperties,
+        D3D12_HEAP_FLAG_NONE,
+        &resourceDesc,
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+        nullptr,
+        IID_PPV_ARGS(&atlas))))
+    {
+        DEBUG_LOG("ERROR: Failed to create probe atlas.");
+        return false;
+    }
+
+    if (FAILED(atlas->SetName(name)))
+    {
+        DEBUG_LOG("ERROR: Failed to name probe atlas.");
+        return false;
+    }
+    return true;
+}
+
 bool Renderer::Init(const uint32_t shaderVisibleCBVSRVUAVDescriptorCount)
 {
     // Enable debug features if in debug configuration
@@ -404,6 +608,44 @@ bool Renderer::Init(const uint32_t shaderVisibleCBVSRVUAVDescriptorCount)
         return false;
     }
 
+    // Create raytrace timestamp queries
+    if (FAILED(DirectCommandQueue->GetTimestampFrequency(&TimestampFrequency)))
+    {
+        DEBUG_LOG("ERROR: Failed to get direct command queue timestamp frequency.");
+        return false;
+    }
+
+    D3D12_QUERY_HEAP_DESC timestampQueryHeapDesc = {};
+    timestampQueryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+    timestampQueryHeapDesc.Count = static_cast<UINT>(BACK_BUFFER_COUNT * 2);
+    if (FAILED(Device->CreateQueryHeap(&timestampQueryHeapDesc, IID_PPV_ARGS(&RaytraceTimestampQueryHeap))))
+    {
+        DEBUG_LOG("ERROR: Failed to create raytrace timestamp query heap.");
+        return false;
+    }
+
+    auto timestampReadbackHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK);
+    auto timestampReadbackResourceDesc = CD3DX12_RESOURCE_DESC::Buffer(BACK_BUFFER_COUNT * 2 * sizeof(UINT64));
+    if (FAILED(Device->CreateCommittedResource(&timestampReadbackHeapProperties,
+        D3D12_HEAP_FLAG_NONE,
+        &timestampReadbackResourceDesc,
+        D3D12_RESOURCE_STATE_COPY_DEST,
+        nullptr,
+        IID_PPV_ARGS(&RaytraceTimestampReadbackBuffer))))
+    {
+        DEBUG_LOG("ERROR: Failed to create raytrace timestamp readback buffer.");
+        return false;
+    }
+
+    // The readback buffer stays mapped. A frame's timestamps are only read after waiting for the frame's fence
+    void* mappedTimestampReadbackResource;
+    if (FAILED(RaytraceTimestampReadbackBuffer->Map(0, nullptr, &mappedTimestampReadbackResource)))
+    {
+        DEBUG_LOG("ERROR: Failed to map raytrace timestamp readback buffer.");
+        return false;
+    }
+    MappedRaytraceTimestampReadbackLocation = static_cast<const UINT64*>(mappedTimestampReadbackResource);
+
     // Create per frame constant buffer
     auto perFrameHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
     auto perFrameResourceDesc = CD3DX12_RESOURCE_DESC::Buffer(SIZE_64KB);
@@ -549,6 +791,24 @@ bool Renderer::Init(const uint32_t shaderVisibleCBVSRVUAVDescriptorCount)
         CBVSRVUAVDescriptorHeap->GetCPUDescriptorHandle(0),
         CBVSRVUAVDescriptorHeap->GetGPUDescriptorHandle(0));
 
+    // Create the probe ray table buffer. The table never changes, so it is copied once
+    const auto& probeRays = GetProbeRayTable().GetRays();
+    if (!CreateMappedProbeBuffer(sizeof(probeRays), L"ProbeRayBuffer", ProbeRayBuffer, MappedProbeRayBufferLocation))
+    {
+        return false;
+    }
+    memcpy(MappedProbeRayBufferLocation, probeRays.data(), sizeof(probeRays));
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC probeRaySRVDesc = {};
+    probeRaySRVDesc.Format = DXGI_FORMAT_UNKNOWN;
+    probeRaySRVDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+    probeRaySRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    probeRaySRVDesc.Buffer.FirstElement = 0;
+    probeRaySRVDesc.Buffer.NumElements = static_cast<UINT>(probeRays.size());
+    probeRaySRVDesc.Buffer.StructureByteStride = sizeof(ProbeRay);
+    probeRaySRVDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+    AddSRVDescriptorToShaderVisibleHeap(ProbeRayBuffer.Get(), &probeRaySRVDesc, PROBE_RAYS_SRV_DESCRIPTOR_INDEX);
+
 	return true;
 }
 
@@ -872,6 +1132,231 @@ void Renderer::AddSRVDescriptorToShaderVisibleHeap(ID3D12Resource* pResource, co
     Device->CreateShaderResourceView(pResource, pDesc, CBVSRVUAVDescriptorHeap->GetCPUDescriptorHandle(descriptorIndex));
 }
 
+bool Renderer::ReserveProbeBuffers(const size_t probeCount)
+{
+    if (ProbePositionBuffer && (probeCount <= ProbeBufferCapacity))
+    {
+        return true;
+    }
+
+    // The GPU may still be reading the buffers being replaced
+    if (!Flush())
+    {
+        return false;
+    }
+
+    // Grow geometrically so adding volumes one at a time does not recreate the buffers each time
+    size_t capacity = std::max(ProbeBufferCapacity, MIN_PROBE_BUFFER_CAPACITY);
+    while (capacity < probeCount)
+    {
+        capacity *= 2;
+    }
+
+    if (!CreateMappedProbeBuffer(capacity * sizeof(glm::vec4), L"ProbePositionBuffer", ProbePositionBuffer, MappedProbePositionBufferLocation) ||
+        !CreateMappedProbeBuffer(capacity * sizeof(uint32_t), L"ProbeStateBuffer", ProbeStateBuffer, MappedProbeStateBufferLocation) ||
+        !CreateMappedProbeBuffer(capacity * sizeof(uint32_t), L"ProbeUpdateIndexBuffer", ProbeUpdateIndexBuffer, MappedProbeUpdateIndexBufferLocation))
+    {
+        return false;
+    }
+    ProbeBufferCapacity = capacity;
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC probeBufferSRVDesc = {};
+    probeBufferSRVDesc.Format = DXGI_FORMAT_UNKNOWN;
+    probeBufferSRVDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+    probeBufferSRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    probeBufferSRVDesc.Buffer.FirstElement = 0;
+    probeBufferSRVDesc.Buffer.NumElements = static_cast<UINT>(capacity);
+    probeBufferSRVDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+
+    probeBufferSRVDesc.Buffer.StructureByteStride = sizeof(glm::vec4);
+    AddSRVDescriptorToShaderVisibleHeap(ProbePositionBuffer.Get(), &probeBufferSRVDesc, PROBE_POSITIONS_SRV_DESCRIPTOR_INDEX);
+
+    probeBufferSRVDesc.Buffer.StructureByteStride = sizeof(uint32_t);
+    AddSRVDescriptorToShaderVisibleHeap(ProbeStateBuffer.Get(), &probeBufferSRVDesc, PROBE_STATES_SRV_DESCRIPTOR_INDEX);
+    AddSRVDescriptorToShaderVisibleHeap(ProbeUpdateIndexBuffer.Get(), &probeBufferSRVDesc, PROBE_UPDATE_INDICES_SRV_DESCRIPTOR_INDEX);
+    return true;
+}
+
+bool Renderer::ReserveProbeAtlases(const size_t probeCount, const glm::ivec3& gridProbeCounts)
+{
+    if (ProbeIrradianceAtlas && (probeCount <= AtlasLayout.GetProbeCapacity()))
+    {
+        return true;
+    }
+
+    // The GPU may still be reading the atlases being replaced
+    if (!Flush())
+    {
+        return false;
+    }
+
+    // Grow geometrically so adding volumes one at a time does not recreate the atlases each time
+    const size_t capacity = std::max({ probeCount, MIN_PROBE_ATLAS_CAPACITY, static_cast<size_t>(AtlasLayout.GetProbeCapacity()) * 2 });
+    AtlasLayout = ProbeAtlasLayout(capacity, gridProbeCounts);
+
+    if (!CreateProbeAtlas(DXGI_FORMAT_R11G11B10_FLOAT, AtlasLayout.GetIrradianceAtlasDimensions(), L"ProbeIrradianceAtlas", ProbeIrradianceAtlas) ||
+        !CreateProbeAtlas(DXGI_FORMAT_R16G16_FLOAT, AtlasLayout.GetVisibilityAtlasDimensions(), L"ProbeVisibilityAtlas", ProbeVisibilityAtlas) ||
+        !CreateProbeAtlas(DXGI_FORMAT_R11G11B10_FLOAT, AtlasLayout.GetIrradianceAtlasDimensions(), L"ProbeIrradianceFiltered", ProbeIrradianceFiltered) ||
+        !CreateProbeAtlas(DXGI_FORMAT_R16G16_FLOAT, AtlasLayout.GetVisibilityAtlasDimensions(), L"ProbeVisibilityFiltered", ProbeVisibilityFiltered) ||
+        !CreateProbeStatisticsBuffers(AtlasLayout.GetProbeCapacity()) ||
+        !CreateProbeShBuffer(AtlasLayout.GetProbeCapacity()) ||
+        !CreateProbeRayDataBuffer(AtlasLayout.GetProbeCapacity()))
+    {
+        return false;
+    }
+
+    AddUAVDescriptorToShaderVisibleHeap(ProbeIrradianceAtlas.Get(), nullptr, PROBE_IRRADIANCE_ATLAS_UAV_DESCRIPTOR_INDEX);
+    AddSRVDescriptorToShaderVisibleHeap(ProbeIrradianceAtlas.Get(), nullptr, RAYTRACE_IRRADIANCE_SRV_DESCRIPTOR_INDEX);
+    AddUAVDescriptorToShaderVisibleHeap(ProbeVisibilityAtlas.Get(), nullptr, PROBE_VISIBILITY_ATLAS_UAV_DESCRIPTOR_INDEX);
+    AddSRVDescriptorToShaderVisibleHeap(ProbeVisibilityAtlas.Get(), nullptr, RAYTRACE_VISIBILITY_SRV_DESCRIPTOR_INDEX);
+    AddUAVDescriptorToShaderVisibleHeap(ProbeIrradianceFiltered.Get(), nullptr, PROBE_IRRADIANCE_FILTERED_UAV_DESCRIPTOR_INDEX);
+    AddUAVDescriptorToShaderVisibleHeap(ProbeVisibilityFiltered.Get(), nullptr, PROBE_VISIBILITY_FILTERED_UAV_DESCRIPTOR_INDEX);
+
+    D3D12_UNORDERED_ACCESS_VIEW_DESC probeStatisticsUAVDesc = {};
+    probeStatisticsUAVDesc.Format = DXGI_FORMAT_UNKNOWN;
+    probeStatisticsUAVDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+    probeStatisticsUAVDesc.Buffer.FirstElement = 0;
+    probeStatisticsUAVDesc.Buffer.NumElements = static_cast<UINT>(AtlasLayout.GetProbeCapacity());
+    probeStatisticsUAVDesc.Buffer.StructureByteStride = sizeof(ProbeStatistics);
+    probeStatisticsUAVDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
+    AddUAVDescriptorToShaderVisibleHeap(ProbeStatisticsBuffer.Get(), &probeStatisticsUAVDesc, PROBE_STATISTICS_UAV_DESCRIPTOR_INDEX);
+
+    // ProbeBlend projects rays and blends them into the spherical harmonic coefficients the pixel shader reads
+    D3D12_UNORDERED_ACCESS_VIEW_DESC probeShUAVDesc = {};
+    probeShUAVDesc.Format = DXGI_FORMAT_UNKNOWN;
+    probeShUAVDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+    probeShUAVDesc.Buffer.FirstElement = 0;
+    probeShUAVDesc.Buffer.NumElements = static_cast<UINT>(AtlasLayout.GetProbeCapacity() * PROBE_SH_STRIDE);
+    probeShUAVDesc.Buffer.StructureByteStride = sizeof(uint32_t);
+    probeShUAVDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
+    AddUAVDescriptorToShaderVisibleHeap(ProbeShBuffer.Get(), &probeShUAVDesc, PROBE_SH_UAV_DESCRIPTOR_INDEX);
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC probeShSRVDesc = {};
+    probeShSRVDesc.Format = DXGI_FORMAT_UNKNOWN;
+    probeShSRVDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+    probeShSRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    probeShSRVDesc.Buffer.FirstElement = 0;
+    probeShSRVDesc.Buffer.NumElements = static_cast<UINT>(AtlasLayout.GetProbeCapacity() * PROBE_SH_STRIDE);
+    probeShSRVDesc.Buffer.StructureByteStride = sizeof(uint32_t);
+    probeShSRVDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+    AddSRVDescriptorToShaderVisibleHeap(ProbeShBuffer.Get(), &probeShSRVDesc, PROBE_SH_SRV_DESCRIPTOR_INDEX);
+
+    // RayGen writes the radiance and hit distance of every ray of a probe, indexed by its pool index, for ProbeFilter and ProbeBlend to read
+    D3D12_UNORDERED_ACCESS_VIEW_DESC probeRayDataUAVDesc = {};
+    probeRayDataUAVDesc.Format = DXGI_FORMAT_UNKNOWN;
+    probeRayDataUAVDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+    probeRayDataUAVDesc.Buffer.FirstElement = 0;
+    probeRayDataUAVDesc.Buffer.NumElements = static_cast<UINT>(AtlasLayout.GetProbeCapacity() * PROBE_RAY_COUNT);
+    probeRayDataUAVDesc.Buffer.StructureByteStride = sizeof(glm::vec4);
+    probeRayDataUAVDesc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
+    AddUAVDescriptorToShaderVisibleHeap(ProbeRayDataBuffer.Get(), &probeRayDataUAVDesc, PROBE_RAY_DATA_UAV_DESCRIPTOR_INDEX);
+    return true;
+}
+
+bool Renderer::UploadBakedProbes(const BakedProbeData& data, const uint32_t firstProbeIndex)
+{
+    const BakedProbeVolume& volume = *data.pVolume;
+    const auto probeCount = static_cast<uint32_t>(volume.GetProbeCount());
+    if (!ProbeIrradianceAtlas || (firstProbeIndex + probeCount > AtlasLayout.GetProbeCapacity()))
+    {
+        DEBUG_LOG("ERROR: Probe atlases must be reserved before baked probes are uploaded.");
+        return false;
+    }
+
+    // The GPU may still be using the atlases and statistics being written
+    if (!Flush())
+    {
+        return false;
+    }
+
+    // The baked sections are copied into the upload buffer as they are stored. Atlas sections are already placed footprints
+    const glm::uvec2 irradianceDimensions = volume.GetAtlasDimensions(IRRADIANCE_PROBE_SIDE_LENGTH);
+    const glm::uvec2 visibilityDimensions = volume.GetAtlasDimensions(VISIBILITY_PROBE_SIDE_LENGTH);
+    const size_t irradianceSize = static_cast<size_t>(volume.AtlasLayout.z) * irradianceDimensions.y;
+    const size_t visibilitySize = static_cast<size_t>(volume.AtlasLayout.w) * visibilityDimensions.y;
+    const size_t statisticsSize = probeCount * sizeof(ProbeStatistics);
+    auto alignPlacement = [](const size_t offset) { return ((offset + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1) / D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT) * D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT; };
+    const size_t visibilityOffset = alignPlacement(irradianceSize);
+    const size_t statisticsOffset = alignPlacement(visibilityOffset + visibilitySize);
+
+    Microsoft::WRL::ComPtr<ID3D12Resource> uploadBuffer;
+    uint8_t* pMappedUploadBuffer = nullptr;
+    if (!CreateMappedProbeBuffer(statisticsOffset + statisticsSize, L"BakedProbeUploadBuffer", uploadBuffer, pMappedUploadBuffer))
+    {
+        return false;
+    }
+    memcpy(pMappedUploadBuffer, data.pIrradianceAtlas, irradianceSize);
+    memcpy(pMappedUploadBuffer + visibilityOffset, data.pVisibilityAtlas, visibilitySize);
+    memcpy(pMappedUploadBuffer + statisticsOffset, data.pStatistics, statisticsSize);
+
+    if (FAILED(GraphicsLoadCommandAllocator->Reset()))
+    {
+        DEBUG_LOG("Failed to reset copy command allocator.");
+        return false;
+    }
+
+    if (FAILED(GraphicsLoadCommandList->Reset(GraphicsLoadCommandAllocator.Get(), nullptr)))
+    {
+        DEBUG_LOG("Failed to reset copy command list.");
+        return false;
+    }
+
+    CD3DX12_RESOURCE_BARRIER copyBarriers[] = {
+        CD3DX12_RESOURCE_BARRIER::Transition(ProbeIrradianceAtlas.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST),
+        CD3DX12_RESOURCE_BARRIER::Transition(ProbeVisibilityAtlas.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST),
+        CD3DX12_RESOURCE_BARRIER::Transition(ProbeStatisticsBuffer.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST) };
+    GraphicsLoadCommandList->ResourceBarrier(_countof(copyBarriers), copyBarriers);
+
+    // Each probe's tile moves from its place in the volume's layout to its place in the pool's
+    auto copyTiles = [&](ID3D12Resource* pAtlas, const DXGI_FORMAT format, const glm::uvec2& dimensions, const uint32_t rowPitch, const size_t offset,
+        const uint32_t singleProbeSideLength)
+    {
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = {};
+        footprint.Offset = static_cast<UINT64>(offset);
+        footprint.Footprint = CD3DX12_SUBRESOURCE_FOOTPRINT(format, dimensions.x, dimensions.y, 1, rowPitch);
+        const CD3DX12_TEXTURE_COPY_LOCATION source(uploadBuffer.Get(), footprint);
+        const CD3DX12_TEXTURE_COPY_LOCATION destination(pAtlas, 0);
+        const uint32_t tileSideLength = singleProbeSideLength + 2 * PROBE_PADDING;
+        for (uint32_t i = 0; i < probeCount; ++i)
+        {
+            const uint32_t p = firstProbeIndex + i;
+            const UINT sourceX = (i % volume.AtlasLayout.x) * tileSideLength;
+            const UINT sourceY = (i / volume.AtlasLayout.x) * tileSideLength;
+            const D3D12_BOX sourceBox = { sourceX, sourceY, 0, sourceX + tileSideLength, sourceY + tileSideLength, 1 };
+            GraphicsLoadCommandList->CopyTextureRegion(&destination, (p % AtlasLayout.GetProbesPerRow()) * tileSideLength,
+                (p / AtlasLayout.GetProbesPerRow()) * tileSideLength, 0, &source, &sourceBox);
+        }
+    };
+    copyTiles(ProbeIrradianceAtlas.Get(), DXGI_FORMAT_R11G11B10_FLOAT, irradianceDimensions, volume.AtlasLayout.z, 0, IRRADIANCE_PROBE_SIDE_LENGTH);
+    copyTiles(ProbeVisibilityAtlas.Get(), DXGI_FORMAT_R16G16_FLOAT, visibilityDimensions, volume.AtlasLayout.w, visibilityOffset, VISIBILITY_PROBE_SIDE_LENGTH);
+    GraphicsLoadCommandList->CopyBufferRegion(ProbeStatisticsBuffer.Get(), static_cast<UINT64>(firstProbeIndex) * sizeof(ProbeStatistics), uploadBuffer.Get(),
+        static_cast<UINT64>(statisticsOffset), static_cast<UINT64>(statisticsSize));
+
+    CD3DX12_RESOURCE_BARRIER unorderedAccessBarriers[] = {
+        CD3DX12_RESOURCE_BARRIER::Transition(ProbeIrradianceAtlas.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS),
+        CD3DX12_RESOURCE_BARRIER::Transition(ProbeVisibilityAtlas.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS),
+        CD3DX12_RESOURCE_BARRIER::Transition(ProbeStatisticsBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS) };
+    GraphicsLoadCommandList->ResourceBarrier(_countof(unorderedAccessBarriers), unorderedAccessBarriers);
+
+    if (FAILED(GraphicsLoadCommandList->Close()))
+    {
+        return false;
+    }
+
+    ID3D12CommandList* commandLists[] = { GraphicsLoadCommandList.Get() };
+    GraphicsLoadCommandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
+
+    ++GraphicsLoadFenceValue;
+    if (FAILED(GraphicsLoadCommandQueue->Signal(GraphicsLoadFence.Get(), GraphicsLoadFenceValue)))
+    {
+        return false;
+    }
+
+    // The upload buffer is released on return, so wait on CPU for the copies to finish
+    return WaitForFenceToReachValue(GraphicsLoadFence, GraphicsLoadFenceValue, MainThreadFenceEvent,
+        static_cast<DWORD>(std::chrono::milliseconds::max().count()));
+}
+
 void Renderer::AddUAVDescriptorToShaderVisibleHeap(ID3D12Resource* pResource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* pDesc, const uint32_t descriptorIndex)
 {
     assert(descriptorIndex != 0 && "Descriptor index 0 is occupied by ImGui resources in CBV SRV UAV descriptor heap. Use another index.");
@@ -928,6 +1413,33 @@ UINT64 Renderer::GetConstantBufferAllignmentSize()
     return CONSTANT_BUFFER_ALIGNMENT_SIZE_BYTES;
 }
 
+const Renderer::ProbeAtlasLayout& Renderer::GetProbeAtlasLayout()
+{
+    return AtlasLayout;
+}
+
+ID3D12Resource* Renderer::GetProbeIrradianceAtlas()
+{
+    return ProbeIrradianceAtlas.Get();
+}
+
+ID3D12Resource* Renderer::GetProbeVisibilityAtlas()
+{
+    return ProbeVisibilityAtlas.Get();
+}
+
+const Renderer::ProbeStatistics* Renderer::GetProbeStatistics()
+{
+    return ProbeStatisticsBuffer ? LastProbeStatistics.data() : nullptr;
+}
+
+bool Renderer::GetRaytraceTiming(double& milliseconds, uint32_t& dispatchWidth)
+{
+    milliseconds = LastRaytraceMilliseconds;
+    dispatchWidth = LastRaytraceDispatchWidth;
+    return LastRaytraceDispatchWidth > 0;
+}
+
 ID3D12Device5* Renderer::GetDevice()
 {
     return Device.Get();
@@ -951,6 +1463,16 @@ bool Renderer::Commands::StartFrame(SwapChain* pSwapChain)
     // Increment frame fence value for the next frame
     ++frameFenceValue;
 
+    // The frame's timestamps and probe statistics have been resolved now its fence is reached
+    LastRaytraceDispatchWidth = RaytraceTimestampDispatchWidths[FrameIndex];
+    if (LastRaytraceDispatchWidth > 0)
+    {
+        memcpy(LastProbeStatistics.data(), MappedProbeStatisticsReadbackLocations[FrameIndex], LastProbeStatistics.size() * sizeof(ProbeStatistics));
+        const UINT64* pTimestamps = MappedRaytraceTimestampReadbackLocation + (FrameIndex * 2);
+        LastRaytraceMilliseconds = static_cast<double>(pTimestamps[1] - pTimestamps[0]) * 1000.0 / static_cast<double>(TimestampFrequency);
+        RaytraceTimestampDispatchWidths[FrameIndex] = 0;
+    }
+
     // Reset command recording objects
     if (FAILED(pCurrentFrameCommandAllocator->Reset()))
     {
@@ -1045,23 +1567,27 @@ void Renderer::Commands::SetGraphicsPipeline(GraphicsPipelineBase* pPipeline)
     DirectCommandList->SetGraphicsRootSignature(pPipeline->GetRootSignature());
 }
 
-void Renderer::Commands::UpdatePerFrameConstants(const std::vector<Transform>& probeTransformsWS, const glm::vec3& lightDirectionWS, const float lightIntensity, const float probeSpacing)
+void Renderer::Commands::UpdatePerFrameConstants(const std::vector<ProbeVolumeData>& probeVolumes, const uint32_t probeCount,
+    const glm::vec3& lightDirectionWS, const float lightIntensity, const float probeSpacing, const ProbeBlendSettings& probeBlendSettings, const uint32_t probeRayRotationSeed)
 {
     PerFrameConstants perFrameConstants = {};
 
-    // Update probe position
-    assert(probeTransformsWS.size() <= Renderer::MAX_PROBE_COUNT && "Attempting to use more probes than the max probe count.");
-    size_t index = 0;
-    for (const auto& transform : probeTransformsWS)
-    {
-        perFrameConstants.ProbePositionsWS[index] = glm::vec4(transform.Position.x, transform.Position.y, transform.Position.z, 1.0f);
-        ++index;
-    }
+    // Update probe volumes. Probe positions and states are in the probe structured buffers
+    assert(probeVolumes.size() <= Renderer::MAX_PROBE_VOLUME_COUNT && "Attempting to use more probe volumes than the max probe volume count.");
+    assert(probeCount <= ProbeBufferCapacity && "Probe buffers must be reserved for every probe.");
+    std::copy(probeVolumes.begin(), probeVolumes.end(), perFrameConstants.ProbeVolumes);
+
+    // Update probe atlas layout
+    perFrameConstants.ProbeAtlasLayout = AtlasLayout.GetShaderData();
 
-    // Update probe count, spacing and light intensity
-    perFrameConstants.PackedData.x = static_cast<float>(probeTransformsWS.size());
+    // Update probe blend settings and the ray rotation seed, which RayGen reads back as bits
+    perFrameConstants.ProbeBlendSettings = glm::vec4(probeBlendSettings.Hysteresis, probeBlendSettings.ChangeThreshold, std::bit_cast<float>(probeRayRotationSeed), 0.0f);
+
+    // Update probe count, spacing, light intensity and probe volume count
+    perFrameConstants.PackedData.x = static_cast<float>(probeCount);
     perFrameConstants.PackedData.y = probeSpacing;
     perFrameConstants.PackedData.z = lightIntensity;
+    perFrameConstants.PackedData.w = static_cast<float>(probeVolumes.size());
 
     // Update light direction
     perFrameConstants.LightDirectionWS.x = lightDirectionWS.x;
@@ -1081,6 +1607,22 @@ void Renderer::Commands::UpdatePerFrameConstants(const std::vector<Transform>& p
     memcpy(MappedPerFrameConstantBufferLocation, &perFrameConstants, sizeof(PerFrameConstants));
 }
 
+void Renderer::Commands::UpdateProbeBuffers(const std::vector<glm::vec4>& probePositionsWS, const std::vector<uint32_t>& probeStates, const uint32_t firstProbeIndex)
+{
+    assert(probeStates.size() == probePositionsWS.size() && "Every probe must have a state.");
+    assert(firstProbeIndex + probePositionsWS.size() <= ProbeBufferCapacity && "Probe buffers must be reserved before probes are copied to them.");
+
+    memcpy(MappedProbePositionBufferLocation + (firstProbeIndex * sizeof(glm::vec4)), probePositionsWS.data(), probePositionsWS.size() * sizeof(glm::vec4));
+    memcpy(MappedProbeStateBufferLocation + (firstProbeIndex * sizeof(uint32_t)), probeStates.data(), probeStates.size() * sizeof(uint32_t));
+}
+
+void Renderer::Commands::UpdateProbeUpdateIndices(const std::vector<uint32_t>& probeIndices)
+{
+    assert(probeIndices.size() <= ProbeBufferCapacity && "Probe buffers must be reserved before probe indices are copied to them.");
+
+    memcpy(MappedProbeUpdateIndexBufferLocation, probeIndices.data(), probeIndices.size() * sizeof(uint32_t));
+}
+
 void Renderer::Commands::UpdatePerPassConstants(const uint32_t passIndex, const glm::vec2& viewportDims, const Camera& camera)
 {
     PerPassConstants perPassConstants = {};
@@ -1207,13 +1749,38 @@ void Renderer::Commands::RebuildTlas(TopLevelAccelerationStructure* tlas)
     DirectCommandList->ResourceBarrier(1, &barrier);
 }
 
-void Renderer::Commands::Raytrace(const D3D12_DISPATCH_RAYS_DESC& dispatchRaysDesc, ID3D12StateObject* pPipelineStateObject, ID3D12Resource* pRaytraceOutputResource,
+void Renderer::Commands::Raytrace(const D3D12_DISPATCH_RAYS_DESC& dispatchRaysDesc, const D3D12_DISPATCH_RAYS_DESC& filterDispatchRaysDesc,
+    const D3D12_DISPATCH_RAYS_DESC& blendDispatchRaysDesc, ID3D12StateObject* pPipelineStateObject, ID3D12Resource* pRaytraceOutputResource,
     ID3D12Resource* pRaytraceOutput2Resource)
 {
     DirectCommandList->SetPipelineState1(pPipelineStateObject);
+
+    // Time the dispatches for the probe update scheduler
+    const UINT firstTimestampIndex = static_cast<UINT>(FrameIndex * 2);
+    DirectCommandList->EndQuery(RaytraceTimestampQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, firstTimestampIndex);
     DirectCommandList->DispatchRays(&dispatchRaysDesc);
-    CD3DX12_RESOURCE_BARRIER barriers[] = { CD3DX12_RESOURCE_BARRIER::UAV(pRaytraceOutputResource), CD3DX12_RESOURCE_BARRIER::UAV(pRaytraceOutput2Resource) };
+
+    // Every probe is traced before its rays are filtered
+    auto rayDataBarrier = CD3DX12_RESOURCE_BARRIER::UAV(ProbeRayDataBuffer.Get());
+    DirectCommandList->ResourceBarrier(1, &rayDataBarrier);
+    DirectCommandList->DispatchRays(&filterDispatchRaysDesc);
+
+    CD3DX12_RESOURCE_BARRIER filteredBarriers[] = { CD3DX12_RESOURCE_BARRIER::UAV(ProbeIrradianceFiltered.Get()), CD3DX12_RESOURCE_BARRIER::UAV(ProbeVisibilityFiltered.Get()) };
+    DirectCommandList->ResourceBarrier(_countof(filteredBarriers), filteredBarriers);
+    DirectCommandList->DispatchRays(&blendDispatchRaysDesc);
+    DirectCommandList->EndQuery(RaytraceTimestampQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, firstTimestampIndex + 1);
+    DirectCommandList->ResolveQueryData(RaytraceTimestampQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, firstTimestampIndex, 2, RaytraceTimestampReadbackBuffer.Get(),
+        firstTimestampIndex * sizeof(UINT64));
+    RaytraceTimestampDispatchWidths[FrameIndex] = dispatchRaysDesc.Width;
+    CD3DX12_RESOURCE_BARRIER barriers[] = { CD3DX12_RESOURCE_BARRIER::UAV(pRaytraceOutputResource), CD3DX12_RESOURCE_BARRIER::UAV(pRaytraceOutput2Resource),
+        CD3DX12_RESOURCE_BARRIER::UAV(ProbeRayDataBuffer.Get()),
+        CD3DX12_RESOURCE_BARRIER::Transition(ProbeStatisticsBuffer.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE) };
     DirectCommandList->ResourceBarrier(_countof(barriers), barriers);
+
+    // Copy the probe statistics for the CPU to read once this frame completes
+    DirectCommandList->CopyResource(ProbeStatisticsReadbackBuffers[FrameIndex].Get(), ProbeStatisticsBuffer.Get());
+    auto statisticsBarrier = CD3DX12_RESOURCE_BARRIER::Transition(ProbeStatisticsBuffer.Get(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    DirectCommandList->ResourceBarrier(1, &statisticsBarrier);
 }
 
 void Renderer::Commands::SetGraphicsDescriptorTableRootParam(UINT rootParameterIndex, const uint32_t baseDescriptorIndex)
@@ -11,6 +11,8 @@
 #include "BottomLevelAccelerationStructure.h"
 #include "TopLevelAccelerationStructure.h"
 #include "DescriptorHeap.h"
+#include "GIConstants.h"
+#include "ProbeAtlasLayout.h"
 
 struct Transform;
 
@@ -21,28 +23,35 @@ namespace Renderer
 		IMGUI_DESCRIPTOR_INDEX = 0,
 
 		SCENE_BVH_SRV_DESCRIPTOR_INDEX,
-		RAYTRACE_IRRADIANCE_UAV_DESCRIPTOR_INDEX,
-		RAYTRACE_VISIBILITY_UAV_DESCRIPTOR_INDEX,
+		PROBE_RAY_DATA_UAV_DESCRIPTOR_INDEX,
 		SCENE_SRV_DESCRIPTOR_INDEX,
 		SCENE_DEPTH_SRV_DESCRIPTOR_INDEX,
 		SHADOW_MAP_SRV_DESCRIPTOR_INDEX,
 		RAYTRACE_IRRADIANCE_SRV_DESCRIPTOR_INDEX,
 		RAYTRACE_VISIBILITY_SRV_DESCRIPTOR_INDEX,
 		CUBE_VERTEX_BUFFER_SRV_DESCRIPTOR_INDEX,
+		PROBE_POSITIONS_SRV_DESCRIPTOR_INDEX,
+		PROBE_STATES_SRV_DESCRIPTOR_INDEX,
+		PROBE_SH_SRV_DESCRIPTOR_INDEX,
+		PROBE_STATISTICS_UAV_DESCRIPTOR_INDEX,
+		PROBE_IRRADIANCE_ATLAS_UAV_DESCRIPTOR_INDEX,
+		PROBE_VISIBILITY_ATLAS_UAV_DESCRIPTOR_INDEX,
+		PROBE_SH_UAV_DESCRIPTOR_INDEX,
+		PROBE_IRRADIANCE_FILTERED_UAV_DESCRIPTOR_INDEX,
+		PROBE_VISIBILITY_FILTERED_UAV_DESCRIPTOR_INDEX,
+		PROBE_UPDATE_INDICES_SRV_DESCRIPTOR_INDEX,
+		PROBE_RAYS_SRV_DESCRIPTOR_INDEX,
 
 		SHADER_VISIBLE_CBV_SRV_UAV_DESCRIPTOR_COUNT
 	};
 
-	constexpr glm::vec2 RAYTRACE_IRRADIANCE_OUTPUT_DIMS = glm::vec2(4300.0f, 16.0f);
-	constexpr glm::vec2 RAYTRACE_VISIBILITY_OUTPUT_DIMS = glm::vec2(7000.0f, 32.0f);
 	constexpr glm::vec2 SHADOW_MAP_DIMS = glm::vec2(1024.0f, 1024.0f);
 
 	class Material;
+	struct BakedProbeData;
 
 	constexpr size_t MAX_MATERIAL_COUNT = 8;
 
-	constexpr size_t MAX_PROBE_COUNT = 350;
-
 	bool Init(const uint32_t shaderVisibleCBVSRVUAVDescriptorCount);
 	bool Shutdown();
 	bool Flush();
@@ -61,6 +70,18 @@ namespace Renderer
 	void AddSRVDescriptorToShaderVisibleHeap(ID3D12Resource* pResource, const D3D12_SHADER_RESOURCE_VIEW_DESC* pDesc, const uint32_t descriptorIndex);
 	// First descriptor index is occupied by ImGui resources
 	void AddUAVDescriptorToShaderVisibleHeap(ID3D12Resource* pResource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* pDesc, const uint32_t descriptorIndex);
+	// Grows the probe position, state and update index structured buffers to hold at least the probe count and writes their shader resource views. Waits for the
+	// GPU to finish with the previous buffers when they grow, so call before the frame starts
+	bool ReserveProbeBuffers(const size_t probeCount);
+	// Lays the probe irradiance and visibility atlases, the filtered textures blended into them and the ray data buffer, out for at least the probe count, recreating them
+	// and writing their unordered access and shader resource views when they grow. Grid probe counts align atlas rows with grid slices. Atlas contents are lost when they grow, so every probe must
+	// be traced again. The probe statistics buffer is sized with the atlases and starts every probe without history when they grow. Waits for the GPU
+	// to finish with the previous atlases when they grow, so call before the frame starts
+	bool ReserveProbeAtlases(const size_t probeCount, const glm::ivec3& gridProbeCounts);
+	// Copies a baked volume's atlas tiles and statistics into the probe atlases and statistics buffer from the first probe index, so its probes start
+	// from their baked history instead of from black. The atlases must be reserved for the probes. Waits for the GPU to finish, so call before the
+	// frame starts
+	bool UploadBakedProbes(const BakedProbeData& data, const uint32_t firstProbeIndex);
 
 	UINT GetRTDescriptorIncrementSize();
 	UINT GetDSDescriptorIncrementSize();
@@ -72,6 +93,15 @@ namespace Renderer
 	D3D12_GPU_VIRTUAL_ADDRESS GetPerPassConstantBufferGPUVirtualAddress();
 	D3D12_GPU_VIRTUAL_ADDRESS GetMaterialConstantBufferGPUVirtualAddress();
 	UINT64 GetConstantBufferAllignmentSize();
+	const ProbeAtlasLayout& GetProbeAtlasLayout();
+	ID3D12Resource* GetProbeIrradianceAtlas();
+	ID3D12Resource* GetProbeVisibilityAtlas();
+	// Probe statistics copied by the last completed gather, indexed by pool probe index up to the atlas capacity. Frames that dispatch no gather
+	// keep the statistics of the last one that did. Null before the atlases are reserved
+	const ProbeStatistics* GetProbeStatistics();
+	// GPU time of the last probe dispatch recorded for the current frame index and the ray gen threads it dispatched. Valid between StartFrame and
+	// EndFrame. Returns false if the frame index recorded no dispatch
+	bool GetRaytraceTiming(double& milliseconds, uint32_t& dispatchWidth);
 
 	// Temporary
 	ID3D12Device5* GetDevice();
@@ -87,7 +117,12 @@ namespace Renderer
 		void SetViewport(SwapChain* pSwapChain);
 		void SetViewport(const D3D12_VIEWPORT& viewport, const D3D12_RECT& scissorRect);
 		void SetGraphicsPipeline(GraphicsPipelineBase* pPipeline);
-		void UpdatePerFrameConstants(const std::vector<Transform>& probeTransformsWS, const glm::vec3& lightDirectionWS, const float lightIntensity, const float probeSpacing);
+		void UpdatePerFrameConstants(const std::vector<ProbeVolumeData>& probeVolumes, const uint32_t probeCount, const glm::vec3& lightDirectionWS, const float lightIntensity, const float probeSpacing,
+			const ProbeBlendSettings& probeBlendSettings, const uint32_t probeRayRotationSeed);
+		// Copies a range of probes into the probe structured buffers, starting at the pool index of the first probe
+		void UpdateProbeBuffers(const std::vector<glm::vec4>& probePositionsWS, const std::vector<uint32_t>& probeStates, const uint32_t firstProbeIndex);
+		// Copies the pool indices of the probes the next dispatch traces, one per ray gen thread
+		void UpdateProbeUpdateIndices(const std::vector<uint32_t>& probeIndices);
 		void UpdatePerPassConstants(const uint32_t passIndex, const glm::vec2& viewportDims, const Camera& camera);
 		void UpdateMaterialConstants(const Renderer::Material* pMaterials, const uint32_t materialCount);
 		void SubmitMesh(UINT perObjectConstantsParameterIndex, const Mesh& mesh, const Transform& transform, const glm::vec4& color, const bool lit);
@@ -96,7 +131,9 @@ namespace Renderer
 		void BeginImGui();
 		void EndImGui();
 		void RebuildTlas(TopLevelAccelerationStructure* tlas);
-		void Raytrace(const D3D12_DISPATCH_RAYS_DESC& dispatchRaysDesc, ID3D12StateObject* pPipelineStateObject, ID3D12Resource* pRaytraceOutputResource, ID3D12Resource* pRaytraceOutput2Resource);
+		// Traces the scheduled probes into the ray data buffer, filters each probe's rays into its texels then blends them into the atlases, one dispatch each
+		void Raytrace(const D3D12_DISPATCH_RAYS_DESC& dispatchRaysDesc, const D3D12_DISPATCH_RAYS_DESC& filterDispatchRaysDesc, const D3D12_DISPATCH_RAYS_DESC& blendDispatchRaysDesc,
+			ID3D12StateObject* pPipelineStateObject, ID3D12Resource* pRaytraceOutputResource, ID3D12Resource* pRaytraceOutput2Resource);
 		void SetGraphicsDescriptorTableRootParam(UINT rootParameterIndex, const uint32_t baseDescriptorIndex);
 		void SetGraphicsConstantBufferViewRootParam(UINT rootParameterIndex, const D3D12_GPU_VIRTUAL_ADDRESS bufferAddress);
 
@@ -1,6 +1,26 @@
 #pragma once
 
 #include "Renderer/Renderer.h"
+#include "Math/BoundingBox.h"
+
+// A scene instance whose transform changed during the last tick
+struct SceneInstanceChange
+{
+	uint32_t InstanceID = 0;
+	glm::mat4 PreviousTransform = glm::identity<glm::mat4>();
+	glm::mat4 Transform = glm::identity<glm::mat4>();
+	// World space bounds of the instance before and after the change
+	BoundingBox PreviousBoundsWS;
+	BoundingBox BoundsWS;
+
+	// Bounds of the space the instance moved through, which covers every surface it uncovered or now covers
+	BoundingBox GetSweptBoundsWS() const
+	{
+		BoundingBox swept = PreviousBoundsWS;
+		swept.Grow(BoundsWS);
+		return swept;
+	}
+};
 
 class SceneBase
 {
@@ -13,7 +33,11 @@ public:
 	virtual void DrawImGui() = 0;
 
 	const Renderer::Camera& GetMainCamera() const { return MainCamera; }
+	// Instances moved by the last tick. Empty while nothing in the scene moves
+	const std::vector<SceneInstanceChange>& GetInstanceChanges() const { return InstanceChanges; }
 
 protected:
 	Renderer::Camera MainCamera = {};
+	// Cleared and filled by each tick
+	std::vector<SceneInstanceChange> InstanceChanges;
 };
\ No newline at end of file
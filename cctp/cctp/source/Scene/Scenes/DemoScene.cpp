@@ -5,6 +5,8 @@
 #include "Input/InputCodes.h"
 #include "Events/EventSystem.h"
 #include "Window/Window.h"
+#include "Renderer/CPU/ProbeClassifier.h"
+#include "Renderer/CPU/ProbeRelocation.h"
 
 bool IsInputPressed(InputCode input)
 {
@@ -12,12 +14,12 @@ bool IsInputPressed(InputCode input)
 }
 
 DemoScene::DemoScene()
-	: ProbeVolume(ProbeVolumeStartPosition, ProbeVolumeExtents, ProbeVolumeProbeSpacing, ProbeVolumeDebugProbeScale)
 {
-	DEBUG_LOG("Total probe count: " + std::to_string(ProbeVolume.GetTotalProbeCount()));
-	DEBUG_LOG("Probe count X: " + std::to_string(ProbeVolume.GetProbeCountX()));
-	DEBUG_LOG("Probe count Y: " + std::to_string(ProbeVolume.GetProbeCountY()));
-	DEBUG_LOG("Probe count Z: " + std::to_string(ProbeVolume.GetProbeCountZ()));
+	ProbePool.AddVolume(DemoSceneLayout::CreateProbeVolume());
+	DEBUG_LOG("Total probe count: " + std::to_string(GetProbeVolume().GetTotalProbeCount()));
+	DEBUG_LOG("Probe count X: " + std::to_string(GetProbeVolume().GetProbeCountX()));
+	DEBUG_LOG("Probe count Y: " + std::to_string(GetProbeVolume().GetProbeCountY()));
+	DEBUG_LOG("Probe count Z: " + std::to_string(GetProbeVolume().GetProbeCountZ()));
 
 	// Subscribe input event function
 	EventSystem::SubscribeToEvent<InputEvent>([this](InputEvent&& event)
@@ -62,66 +64,29 @@ DemoScene::DemoScene()
 	}
 
 	// Setup scene mesh transforms and colors
-	MeshTransforms.resize(SceneMeshTransformCount);
-	MeshMaterials.resize(SceneMeshTransformCount);
+	DemoSceneLayout::CreateSceneInstances(MeshTransforms, MeshMaterials);
 	assert(MeshMaterials.size() <= Renderer::MAX_MATERIAL_COUNT && 
 		"Demo scene is creating an unsupported number of materials. Consider reducing the number of materials used by the scene.");
-
-	// Floor
-	MeshTransforms[0].Position = glm::vec3(0.0f, -0.5f, 0.0f);
-	MeshTransforms[0].Scale = glm::vec3(4.9f, 0.49f, 4.9f);
-	MeshMaterials[0].SetColor(glm::vec4(0.6f, 0.6f, 0.6f, 1.0f));
-
-	// Identity cube
-	MeshTransforms[1].Position = glm::vec3(1.0f, 0.25f, -0.5f);
-	MeshTransforms[1].Scale = glm::vec3(1.0f, 1.0f, 1.0f);
-	MeshMaterials[1].SetColor(glm::vec4(0.6f, 0.6f, 0.6f, 1.0f));
-
-	// Right wall
-	MeshTransforms[2].Position = glm::vec3(2.25f, 1.75f, 0.0f);
-	MeshTransforms[2].Scale = glm::vec3(0.5f, 5.0f, 5.0f);
-	MeshMaterials[2].SetColor(glm::vec4(0.0f, 0.5f, 0.0f, 1.0f));
-
-	// Left wall
-	MeshTransforms[3].Position = glm::vec3(-2.25f, 1.75f, 0.0f);
-	MeshTransforms[3].Scale = glm::vec3(0.5f, 5.0f, 5.0f);
-	MeshMaterials[3].SetColor(glm::vec4(0.8f, 0.0f, 0.0f, 1.0f));
-
-	// Back wall
-	MeshTransforms[4].Position = glm::vec3(0.0f, 1.75f, 2.65f);
-	MeshTransforms[4].Scale = glm::vec3(5.0f, 5.0f, 0.5f);
-	MeshMaterials[4].SetColor(glm::vec4(0.6f, 0.6f, 0.6f, 1.0f));
-
-	// Transformed cube
-	MeshTransforms[5].Position = glm::vec3(-1.0f, 0.5f, 0.5f);
-	MeshTransforms[5].Rotation = glm::vec3(0.0f, 45.0f, 0.0f);
-	MeshTransforms[5].Scale = glm::vec3(1.0f, 2.0f, 1.0f);
-	MeshMaterials[5].SetColor(glm::vec4(0.6f, 0.6f, 0.6f, 1.0f));
-
-	// Ceiling
-	MeshTransforms[6].Position = glm::vec3(0.0f, 4.0f, 0.0f);
-	MeshTransforms[6].Scale = glm::vec3(4.9f, 0.49f, 4.9f);
-	MeshMaterials[6].SetColor(glm::vec4(0.6f, 0.6f, 0.6f, 1.0f));
-
-	// Door
-	MeshTransforms[7].Position = glm::vec3(DoorOpenX, 1.75f, -2.65f);
-	MeshTransforms[7].Scale = glm::vec3(5.0f, 5.0f, 0.5f);
-	MeshMaterials[7].SetColor(glm::vec4(0.8f, 0.8f, 0.8f, 1.0f));
 	DoorStartX = MeshTransforms[7].Position.x;
 	DoorTargetX = DoorStartX;
 
 	// Create top level acceleration structure
-	Renderer::CreateTopLevelAccelerationStructure(tlAccelStructure, true, static_cast<uint32_t>(SceneMeshTransformCount));
+	Renderer::CreateTopLevelAccelerationStructure(tlAccelStructure, true, static_cast<uint32_t>(DemoSceneLayout::SCENE_INSTANCE_COUNT));
 
 	// Set tlas instances
-	for (size_t i = 0; i < SceneMeshTransformCount; ++i)
+	InstanceTransforms.resize(DemoSceneLayout::SCENE_INSTANCE_COUNT);
+	for (size_t i = 0; i < DemoSceneLayout::SCENE_INSTANCE_COUNT; ++i)
 	{
-		tlAccelStructure->SetInstanceBlasAndTransform(static_cast<uint32_t>(i), *blAccelStructures[0].get(), Math::CalculateWorldMatrix(MeshTransforms[i]));
+		InstanceTransforms[i] = Math::CalculateWorldMatrix(MeshTransforms[i]);
+		tlAccelStructure->SetInstanceBlasAndTransform(static_cast<uint32_t>(i), *blAccelStructures[0].get(), InstanceTransforms[i]);
 	}
 
 	// Build tlas
 	Renderer::BuildTopLevelAccelerationStructures(&tlAccelStructure, 1);
 
+	// Create CPU copy of the raytraced scene
+	DemoSceneLayout::CreateRaytracingScene(MeshTransforms, MeshMaterials, CPURaytracingScene);
+
 	// Move main camera back
 	MainCamera.Position = CameraStartPosition;
 
@@ -140,6 +105,93 @@ void DemoScene::Tick(float deltaTime)
 	float doorX = glm::lerp(0.0f, DoorTargetX, LerpAccum);
 	MeshTransforms[7].Position.x = doorX;
 
+	// Apply the instances moved since the last tick to the CPU scene and report them. Refits the top level bvh while the door is moving
+	InstanceChanges.clear();
+	const auto& topLevelBvh = CPURaytracingScene.GetTopLevelBvh();
+	for (uint32_t i = 0; i < static_cast<uint32_t>(DemoSceneLayout::SCENE_INSTANCE_COUNT); ++i)
+	{
+		const glm::mat4 transform = Math::CalculateWorldMatrix(MeshTransforms[i]);
+		if (transform == InstanceTransforms[i])
+		{
+			continue;
+		}
+
+		SceneInstanceChange change;
+		change.InstanceID = i;
+		change.PreviousTransform = InstanceTransforms[i];
+		change.Transform = transform;
+		change.PreviousBoundsWS = topLevelBvh.GetInstanceBoundsWS(i);
+		InstanceChanges.push_back(change);
+		InstanceTransforms[i] = transform;
+		CPURaytracingScene.SetInstanceTransform(i, transform);
+	}
+	if (!InstanceChanges.empty())
+	{
+		CPURaytracingScene.Update();
+		for (auto& change : InstanceChanges)
+		{
+			change.BoundsWS = topLevelBvh.GetInstanceBoundsWS(change.InstanceID);
+		}
+	}
+
+	// Add or remove the cascades, which stay centred on the camera
+	if (ProbeCascadesEnabled != (ProbePool.GetVolumeCount() > 1))
+	{
+		if (ProbeCascadesEnabled)
+		{
+			ProbePool.AddCascades(MainCamera.Position, ProbeCascadeExtents, ProbeCascadeProbeSpacing, ProbeCascadeCount, DemoSceneLayout::PROBE_VOLUME_DEBUG_PROBE_SCALE);
+		}
+		else
+		{
+			ProbePool.RemoveVolumes(1);
+		}
+	}
+	for (uint32_t v = 1; v < ProbePool.GetVolumeCount(); ++v)
+	{
+		ProbePool.GetVolume(v).GetVolumePosition() = MainCamera.Position;
+	}
+
+	// Moves the probes if the volume was moved last frame
+	auto& probeVolume = GetProbeVolume();
+	probeVolume.SetScrolling(ProbeVolumeFollowsCamera);
+	if (ProbeVolumeFollowsCamera)
+	{
+		probeVolume.GetVolumePosition() = MainCamera.Position;
+	}
+	ProbePool.Update();
+
+	// Relocate and classify probes placed at new positions, and probes near moved instances. Relocation rays reach one probe spacing
+	// from a probe moved up to half a spacing along each axis, so probes further than two spacings from a moved instance are unaffected by it.
+	// Volumes are only ever added or removed at the end of the pool, so added volumes start from frame zero
+	ClassifiedProbeFrameIndices.resize(ProbePool.GetVolumeCount(), 0);
+	std::vector<uint32_t> probeIndices;
+	for (uint32_t v = 0; v < ProbePool.GetVolumeCount(); ++v)
+	{
+		auto& volume = ProbePool.GetVolume(v);
+		probeIndices.clear();
+		volume.GetProbesResetSince(ClassifiedProbeFrameIndices[v], probeIndices);
+		ClassifiedProbeFrameIndices[v] = volume.GetFrameIndex();
+		if (!InstanceChanges.empty())
+		{
+			for (const auto& change : InstanceChanges)
+			{
+				volume.GetProbesNear(change.GetSweptBoundsWS(), volume.GetProbeSpacing() * 2.0f, probeIndices);
+			}
+			std::sort(probeIndices.begin(), probeIndices.end());
+			probeIndices.erase(std::unique(probeIndices.begin(), probeIndices.end()), probeIndices.end());
+		}
+		if (!probeIndices.empty())
+		{
+			auto relocationOffsets = volume.GetProbeRelocationOffsets();
+			Renderer::CPU::RelocateProbes(CPURaytracingScene, volume, probeIndices, {}, relocationOffsets);
+			volume.SetProbeRelocationOffsets(relocationOffsets);
+
+			auto probeStates = volume.GetProbeStates();
+			Renderer::CPU::ClassifyProbes(CPURaytracingScene, volume.GetProbePositions(), probeIndices, {}, probeStates);
+			volume.SetProbeStates(probeStates);
+		}
+	}
+
 	if (OpenDoor)
 	{
 		LerpAccum = std::clamp(LerpAccum + deltaTime * DoorOpenSpeed, 0.0f, 1.0f);
@@ -148,7 +200,7 @@ void DemoScene::Tick(float deltaTime)
 
 void DemoScene::Draw(UINT perObjectConstantsRootParamIndex)
 {
-	for (size_t i = 0; i < SceneMeshTransformCount; ++i)
+	for (size_t i = 0; i < DemoSceneLayout::SCENE_INSTANCE_COUNT; ++i)
 	{
 		// Cube meshes
 		Renderer::Commands::SubmitMesh(perObjectConstantsRootParamIndex, *Meshes[0].get(), MeshTransforms[i], MeshMaterials[i].GetColor(), true);
@@ -157,10 +209,16 @@ void DemoScene::Draw(UINT perObjectConstantsRootParamIndex)
 	// Probe debug spheres
 	if (DrawProbes)
 	{
-		const auto& probeTransforms = ProbeVolume.GetProbeTransforms();
-		for (const auto& transform : probeTransforms)
+		Transform transform;
+		for (uint32_t v = 0; v < ProbePool.GetVolumeCount(); ++v)
 		{
-			Renderer::Commands::SubmitMesh(perObjectConstantsRootParamIndex, *Meshes[1].get(), transform, glm::vec4(0.1f, 0.9f, 0.9f, 1.0f), false);
+			const auto& volume = ProbePool.GetVolume(v);
+			transform.Scale = glm::vec3(volume.GetDebugProbeSize());
+			for (const auto& position : volume.GetProbePositions())
+			{
+				transform.Position = glm::vec3(position);
+				Renderer::Commands::SubmitMesh(perObjectConstantsRootParamIndex, *Meshes[1].get(), transform, glm::vec4(0.1f, 0.9f, 0.9f, 1.0f), false);
+			}
 		}
 	}
 }
@@ -175,7 +233,7 @@ void DemoScene::DrawImGui()
 		OpenDoor = true;
 		MeshTransforms[7].Position.x = 0.0f;
 		LerpAccum = 0.0f;
-		DoorTargetX = DoorOpenX;
+		DoorTargetX = DemoSceneLayout::DOOR_OPEN_X;
 	}
 	ImGui::End();
 }
@@ -3,7 +3,9 @@
 #include "Scene/SceneBase.h"
 #include "Math/Transform.h"
 #include "Renderer/Material.h"
-#include "Renderer/ProbeVolume.h"
+#include "Renderer/ProbePool.h"
+#include "Renderer/CPU/RaytracingScene.h"
+#include "Scene/Scenes/DemoSceneLayout.h"
 
 struct InputEvent;
 
@@ -17,14 +19,19 @@ public:
 	void DrawImGui() final;
 
 	Renderer::TopLevelAccelerationStructure* GetTlas() const { return tlAccelStructure.get(); }
-	glm::vec3& GetProbeVolumePositionWS() { return ProbeVolume.GetVolumePosition(); }
-	Renderer::ProbeVolume& GetProbeVolume() { return ProbeVolume; }
+	glm::vec3& GetProbeVolumePositionWS() { return GetProbeVolume().GetVolumePosition(); }
+	// The scene's probe volume, first in the probe pool
+	Renderer::ProbeVolume& GetProbeVolume() { return ProbePool.GetVolume(0); }
+	Renderer::ProbePool& GetProbePool() { return ProbePool; }
+	bool& GetProbeVolumeFollowsCamera() { return ProbeVolumeFollowsCamera; }
+	bool& GetProbeCascadesEnabled() { return ProbeCascadesEnabled; }
 	glm::vec3& GetLightDirectionWS() { return LightDirectionWS; }
 	float& GetLightIntensity() { return LightIntensity; }
 	const Renderer::Material* GetMaterialsPtr() const { return MeshMaterials.data(); }
 	size_t GetMaterialCount() const { return MeshMaterials.size(); }
 	void SetDrawProbes(const bool draw) { DrawProbes = draw; }
 	const auto& GetMeshes() const { return Meshes; }
+	const Renderer::CPU::RaytracingScene& GetCPURaytracingScene() const { return CPURaytracingScene; }
 
 public:
 	static constexpr glm::vec3 SceneForwardVector = glm::vec3(0.0f, 0.0f, 1.0f);
@@ -36,27 +43,34 @@ private:
 	void PollInputs(float deltaTime);
 
 private:
-	static constexpr size_t SceneMeshTransformCount = 8;
 	static constexpr float CameraYawSensitivity = 0.075f;
 	static constexpr float CameraPitchSensitivity = 0.075f;
 	static constexpr float CameraPitchMin = -90.0f;
 	static constexpr float CameraPitchMax = 90.0f;
 	static constexpr float CameraFlySpeed = 0.0075f;
 	static constexpr glm::vec3 CameraStartPosition = glm::vec3(0.0f, 2.0f, -10.0f);
-	static constexpr glm::vec3 ProbeVolumeStartPosition = glm::vec3(0.02f, 1.78f, 0.0f);
-	static constexpr glm::vec3 ProbeVolumeExtents = glm::vec3(5.0f);
-	static constexpr float ProbeVolumeProbeSpacing = 0.99f;
-	static constexpr float ProbeVolumeDebugProbeScale = 0.05f;
+	static constexpr uint32_t ProbeCascadeCount = 2;
+	static constexpr glm::vec3 ProbeCascadeExtents = glm::vec3(10.0f);
+	static constexpr float ProbeCascadeProbeSpacing = 2.0f;
 
-	Renderer::ProbeVolume ProbeVolume;
+	Renderer::ProbePool ProbePool;
+	// Scrolls the probe volume with the main camera
+	bool ProbeVolumeFollowsCamera = false;
+	// Adds coarser scrolling volumes around the main camera after the probe volume, lighting the scene outside it
+	bool ProbeCascadesEnabled = false;
+	// Frame of each volume up to which placed probes have been classified
+	std::vector<uint64_t> ClassifiedProbeFrameIndices;
 
 	std::vector<std::unique_ptr<Renderer::Mesh>> Meshes;
 	std::vector<std::unique_ptr<Renderer::BottomLevelAccelerationStructure>> blAccelStructures;
 	std::unique_ptr<Renderer::TopLevelAccelerationStructure> tlAccelStructure;
 	std::vector<Transform> MeshTransforms;
+	// World matrix of each instance as last applied to the CPU raytracing scene
+	std::vector<glm::mat4> InstanceTransforms;
 	std::vector<Renderer::Material> MeshMaterials;
+	Renderer::CPU::RaytracingScene CPURaytracingScene;
 
-	glm::vec3 LightDirectionWS = glm::vec3(-0.5f, -0.3f, 1.0f);
+	glm::vec3 LightDirectionWS = DemoSceneLayout::DEFAULT_LIGHT_DIRECTION_WS;
 	float LightIntensity = 1.0f;
 
 	bool DrawProbes = true;
@@ -66,5 +80,4 @@ private:
 	float LerpAccum = 1.0f;
 	bool OpenDoor = false;
 	static constexpr float DoorOpenSpeed = 0.0001f;
-	static constexpr float DoorOpenX = 5.0f;
 };
\ No newline at end of file
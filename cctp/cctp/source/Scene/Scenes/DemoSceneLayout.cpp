@@ -0,0 +1,74 @@
+#include "CpuPch.h"
+#include "DemoSceneLayout.h"
+#include "Math/Math.h"
+#include "Renderer/Geometry.h"
+
+void DemoSceneLayout::CreateSceneInstances(std::vector<Transform>& transforms, std::vector<Renderer::Material>& materials)
+{
+	transforms.resize(SCENE_INSTANCE_COUNT);
+	materials.resize(SCENE_INSTANCE_COUNT);
+
+	// Floor
+	transforms[0].Position = glm::vec3(0.0f, -0.5f, 0.0f);
+	transforms[0].Scale = glm::vec3(4.9f, 0.49f, 4.9f);
+	materials[0].SetColor(glm::vec4(0.6f, 0.6f, 0.6f, 1.0f));
+
+	// Identity cube
+	transforms[1].Position = glm::vec3(1.0f, 0.25f, -0.5f);
+	transforms[1].Scale = glm::vec3(1.0f, 1.0f, 1.0f);
+	materials[1].SetColor(glm::vec4(0.6f, 0.6f, 0.6f, 1.0f));
+
+	// Right wall
+	transforms[2].Position = glm::vec3(2.25f, 1.75f, 0.0f);
+	transforms[2].Scale = glm::vec3(0.5f, 5.0f, 5.0f);
+	materials[2].SetColor(glm::vec4(0.0f, 0.5f, 0.0f, 1.0f));
+
+	// Left wall
+	transforms[3].Position = glm::vec3(-2.25f, 1.75f, 0.0f);
+	transforms[3].Scale = glm::vec3(0.5f, 5.0f, 5.0f);
+	materials[3].SetColor(glm::vec4(0.8f, 0.0f, 0.0f, 1.0f));
+
+	// Back wall
+	transforms[4].Position = glm::vec3(0.0f, 1.75f, 2.65f);
+	transforms[4].Scale = glm::vec3(5.0f, 5.0f, 0.5f);
+	materials[4].SetColor(glm::vec4(0.6f, 0.6f, 0.6f, 1.0f));
+
+	// Transformed cube
+	transforms[5].Position = glm::vec3(-1.0f, 0.5f, 0.5f);
+	transforms[5].Rotation = glm::vec3(0.0f, 45.0f, 0.0f);
+	transforms[5].Scale = glm::vec3(1.0f, 2.0f, 1.0f);
+	materials[5].SetColor(glm::vec4(0.6f, 0.6f, 0.6f, 1.0f));
+
+	// Ceiling
+	transforms[6].Position = glm::vec3(0.0f, 4.0f, 0.0f);
+	transforms[6].Scale = glm::vec3(4.9f, 0.49f, 4.9f);
+	materials[6].SetColor(glm::vec4(0.6f, 0.6f, 0.6f, 1.0f));
+
+	// Door
+	transforms[7].Position = glm::vec3(DOOR_OPEN_X, 1.75f, -2.65f);
+	transforms[7].Scale = glm::vec3(5.0f, 5.0f, 0.5f);
+	materials[7].SetColor(glm::vec4(0.8f, 0.8f, 0.8f, 1.0f));
+}
+
+Renderer::ProbeVolume DemoSceneLayout::CreateProbeVolume()
+{
+	return Renderer::ProbeVolume(PROBE_VOLUME_START_POSITION, PROBE_VOLUME_EXTENTS, PROBE_VOLUME_PROBE_SPACING, PROBE_VOLUME_DEBUG_PROBE_SCALE);
+}
+
+void DemoSceneLayout::CreateRaytracingScene(const std::vector<Transform>& transforms, const std::vector<Renderer::Material>& materials,
+	Renderer::CPU::RaytracingScene& scene)
+{
+	// Every scene instance is a cube, as in the tlas
+	std::vector<Renderer::Vertex1Pos1UV1Norm> cubeVertices;
+	std::vector<uint32_t> cubeIndices;
+	Renderer::Geometry::GenerateCubeGeometry(cubeVertices, cubeIndices, 1.0f);
+	auto cubeMeshIndex = scene.AddMesh(cubeVertices.data(), cubeVertices.size(), cubeIndices.data(), cubeIndices.size());
+
+	for (size_t i = 0; i < transforms.size(); ++i)
+	{
+		scene.AddInstance(cubeMeshIndex, Math::CalculateWorldMatrix(transforms[i]), glm::vec3(materials[i].GetColor()));
+	}
+
+	// Build the top level bvh
+	scene.Update();
+}
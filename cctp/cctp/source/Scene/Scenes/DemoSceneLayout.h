@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Math/Transform.h"
+#include "Renderer/Material.h"
+#include "Renderer/ProbeVolume.h"
+#include "Renderer/CPU/RaytracingScene.h"
+
+// The demo scene's instances, probe volume and light, built without the renderer so the headless CPU target can share them with DemoScene
+namespace DemoSceneLayout
+{
+	// Every instance is a cube. The last is the door
+	constexpr size_t SCENE_INSTANCE_COUNT = 8;
+	constexpr float DOOR_OPEN_X = 5.0f;
+
+	constexpr glm::vec3 PROBE_VOLUME_START_POSITION = glm::vec3(0.02f, 1.78f, 0.0f);
+	constexpr glm::vec3 PROBE_VOLUME_EXTENTS = glm::vec3(5.0f);
+	constexpr float PROBE_VOLUME_PROBE_SPACING = 0.99f;
+	constexpr float PROBE_VOLUME_DEBUG_PROBE_SCALE = 0.05f;
+
+	constexpr glm::vec3 DEFAULT_LIGHT_DIRECTION_WS = glm::vec3(-0.5f, -0.3f, 1.0f);
+	// Baked probes for the probe volume, loaded at startup from the working directory. Written by running headless with -bake
+	constexpr const char* BAKED_PROBE_FILE_PATH = "DemoScene.probes";
+
+	// Fills the transform and material of every scene mesh instance
+	void CreateSceneInstances(std::vector<Transform>& transforms, std::vector<Renderer::Material>& materials);
+	Renderer::ProbeVolume CreateProbeVolume();
+	// Builds a CPU copy of the geometry raytraced by the probe field. Does not require the renderer to be initialized
+	void CreateRaytracingScene(const std::vector<Transform>& transforms, const std::vector<Renderer::Material>& materials,
+		Renderer::CPU::RaytracingScene& scene);
+}
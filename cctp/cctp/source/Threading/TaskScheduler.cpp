@@ -0,0 +1,138 @@
+#include "CpuPch.h"
+#include "TaskScheduler.h"
+
+// Scheduler and queue of the calling thread when it is a worker thread
+thread_local const Threading::TaskScheduler* pWorkerTaskScheduler = nullptr;
+thread_local uint32_t WorkerTaskQueueIndex = 0;
+
+Threading::TaskScheduler::TaskScheduler(const uint32_t threadCount)
+{
+	ThreadCount = (threadCount > 0) ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+
+	// One queue per worker thread and one for threads outside the pool
+	Queues.reserve(ThreadCount);
+	for (uint32_t i = 0; i < ThreadCount; ++i)
+	{
+		Queues.push_back(std::make_unique<TaskQueue>());
+	}
+
+	Workers.reserve(ThreadCount - 1);
+	for (uint32_t i = 0; i < ThreadCount - 1; ++i)
+	{
+		Workers.emplace_back(&TaskScheduler::RunWorker, this, i);
+	}
+}
+
+Threading::TaskScheduler::~TaskScheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock(SleepMutex);
+		Stopping = true;
+	}
+	WakeCondition.notify_all();
+
+	for (auto& worker : Workers)
+	{
+		worker.join();
+	}
+}
+
+void Threading::TaskScheduler::Submit(TaskGroup& group, std::function<void()>&& task)
+{
+	group.PendingTaskCount.fetch_add(1, std::memory_order_relaxed);
+
+	// Counted under the sleep mutex so a worker about to sleep either sees the task or is woken for it
+	{
+		std::lock_guard<std::mutex> lock(SleepMutex);
+		QueuedTaskCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	auto& queue = *Queues[GetQueueIndex()];
+	{
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		queue.Tasks.push_back({ &group, std::move(task) });
+	}
+	WakeCondition.notify_one();
+}
+
+void Threading::TaskScheduler::Wait(TaskGroup& group)
+{
+	const uint32_t queueIndex = GetQueueIndex();
+	while (!group.IsFinished())
+	{
+		// Tasks of the group may be running on other threads with nothing left to run here
+		if (!RunTask(queueIndex))
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+Threading::TaskScheduler& Threading::TaskScheduler::GetDefault()
+{
+	static TaskScheduler scheduler;
+	return scheduler;
+}
+
+uint32_t Threading::TaskScheduler::GetQueueIndex() const
+{
+	return (pWorkerTaskScheduler == this) ? WorkerTaskQueueIndex : ThreadCount - 1;
+}
+
+bool Threading::TaskScheduler::RunTask(const uint32_t queueIndex)
+{
+	Task task;
+	bool found = false;
+
+	// Own queue newest first, then the other queues oldest first
+	for (uint32_t i = 0; i < ThreadCount && !found; ++i)
+	{
+		auto& queue = *Queues[(queueIndex + i) % ThreadCount];
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		if (!queue.Tasks.empty())
+		{
+			if (i == 0)
+			{
+				task = std::move(queue.Tasks.back());
+				queue.Tasks.pop_back();
+			}
+			else
+			{
+				task = std::move(queue.Tasks.front());
+				queue.Tasks.pop_front();
+			}
+			found = true;
+		}
+	}
+
+	if (!found)
+	{
+		return false;
+	}
+
+	QueuedTaskCount.fetch_sub(1, std::memory_order_relaxed);
+	task.Function();
+	task.pGroup->PendingTaskCount.fetch_sub(1, std::memory_order_release);
+	return true;
+}
+
+void Threading::TaskScheduler::RunWorker(const uint32_t queueIndex)
+{
+	pWorkerTaskScheduler = this;
+	WorkerTaskQueueIndex = queueIndex;
+
+	while (true)
+	{
+		if (RunTask(queueIndex))
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(SleepMutex);
+		WakeCondition.wait(lock, [this]() { return Stopping || QueuedTaskCount.load(std::memory_order_relaxed) > 0; });
+		if (Stopping)
+		{
+			return;
+		}
+	}
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+namespace Threading
+{
+	// Tracks the tasks submitted with it that are yet to finish, so a thread can wait on them
+	class TaskGroup
+	{
+	public:
+		bool IsFinished() const { return PendingTaskCount.load(std::memory_order_acquire) == 0; }
+
+	private:
+		friend class TaskScheduler;
+
+		std::atomic<uint32_t> PendingTaskCount = 0;
+	};
+
+	// Pool of worker threads that each own a queue of tasks. Workers run their newest task first and steal the oldest task of another queue when
+	// theirs is empty, so tasks spawned from a task stay on the thread whose caches hold their data until another thread runs out of work
+	class TaskScheduler
+	{
+	public:
+		// The calling thread runs tasks while it waits, so threadCount - 1 worker threads are created. Zero uses every hardware thread
+		explicit TaskScheduler(const uint32_t threadCount = 0);
+		~TaskScheduler();
+
+		TaskScheduler(const TaskScheduler&) = delete;
+		TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+		// Queues the task on the queue of the calling worker, tasks may submit further tasks to the same group
+		void Submit(TaskGroup& group, std::function<void()>&& task);
+		// Runs queued tasks on the calling thread until every task of the group has finished
+		void Wait(TaskGroup& group);
+
+		// Runs function(begin, end) over [0, count) in ranges of up to rangeSize across the pool, returning once every range has finished
+		template<typename Function>
+		void ParallelFor(const size_t count, const size_t rangeSize, Function&& function);
+
+		uint32_t GetThreadCount() const { return ThreadCount; }
+
+		// Scheduler with a thread per hardware thread, created on first use
+		static TaskScheduler& GetDefault();
+
+	private:
+		struct Task
+		{
+			TaskGroup* pGroup = nullptr;
+			std::function<void()> Function;
+		};
+
+		struct TaskQueue
+		{
+			std::mutex Mutex;
+			std::deque<Task> Tasks;
+		};
+
+		// Index of the queue the calling thread pushes to. Threads outside the pool share the last queue
+		uint32_t GetQueueIndex() const;
+		// Runs the newest task of the queue or else steals the oldest task of another, returning false if every queue was empty
+		bool RunTask(const uint32_t queueIndex);
+		void RunWorker(const uint32_t queueIndex);
+
+	private:
+		uint32_t ThreadCount = 1;
+		std::vector<std::unique_ptr<TaskQueue>> Queues;
+		std::vector<std::thread> Workers;
+
+		// Idle workers sleep until tasks are queued
+		std::mutex SleepMutex;
+		std::condition_variable WakeCondition;
+		std::atomic<uint32_t> QueuedTaskCount = 0;
+		bool Stopping = false;
+	};
+
+	template<typename Function>
+	void TaskScheduler::ParallelFor(const size_t count, const size_t rangeSize, Function&& function)
+	{
+		if (count <= rangeSize || ThreadCount == 1)
+		{
+			function(static_cast<size_t>(0), count);
+			return;
+		}
+
+		// The calling thread takes the first range
+		TaskGroup group;
+		for (size_t begin = rangeSize; begin < count; begin += rangeSize)
+		{
+			const size_t end = std::min(begin + rangeSize, count);
+			Submit(group, [&function, begin, end]() { function(begin, end); });
+		}
+		function(static_cast<size_t>(0), rangeSize);
+		Wait(group);
+	}
+}